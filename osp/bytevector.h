@@ -23,6 +23,7 @@ Software.
 #pragma once
 
 #include "icryptography.h"
+#include <string.h>
 #include <string>
 
 namespace OneStrongPassword
@@ -0,0 +1,184 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#include "cipherstream.h"
+
+#include <algorithm>
+
+using namespace OneStrongPassword;
+using namespace std;
+
+bool CipherStream::Begin(size_t size, OSPError* error)
+{
+	if (Active())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_ALREADY_INITIALIZED);
+
+	size_t blocksize = cryptography.BlockSize(error);
+	if (!blocksize)
+		return false;
+
+	if (!size || size > cryptography.MaxDataSize())
+		size = cryptography.MaxDataSize();
+	size -= size % blocksize;
+
+	if (!size)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	// The chain is the block the next chunk is chained to and, decrypting, the
+	// block after it, kept before the chunk it ends is decrypted in place
+	if (!chain.Alloc(2 * blocksize, error))
+		return false;
+
+	if (!window.Alloc(size, error))
+	{
+		chain.Destroy(nullptr);
+		return false;
+	}
+
+	return active = true;
+}
+
+bool CipherStream::End(OSPError* error)
+{
+	if (!Active())
+		return true;
+
+	active = false;
+
+	bool success = window.Destroy(error);
+	return chain.Destroy(error) && success;
+}
+
+bool CipherStream::Fill(const Source& source, size_t& filled, OSPError* error)
+{
+	filled = 0;
+
+	while (filled < window.Size())
+	{
+		size_t part = 0;
+		if (!source(&window[filled], window.Size() - filled, part, error))
+			return false;
+		if (!part)
+			break;
+		filled += min(part, window.Size() - filled);
+	}
+
+	return true;
+}
+
+bool CipherStream::Encrypt(
+	const Cipher& cipher, const ByteVector& iv, const Source& source, const Sink& sink, size_t& size, OSPError* error
+) {
+	size = 0;
+
+	if (!Active())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	size_t blocksize = cryptography.BlockSize(error);
+	if (iv.Size() < blocksize)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	memcpy(&chain[0], &iv[0], blocksize);
+
+	bool success = true;
+	size_t filled = window.Size();
+
+	// Only the last chunk is short, or empty when the payload fills the window
+	while (success && filled == window.Size())
+	{
+		if (!(success = Fill(source, filled, error)) || !filled)
+			break;
+
+		// Padded here so Encrypt never has to grow the window
+		size_t esize = cryptography.DataSize(filled);
+		OS::Zero(&window[filled], esize - filled);
+
+		ByteVector chunk(&cryptography, &window[0], esize);
+
+		success = cryptography.Encrypt(cipher, chain, chunk, chunk, error) && sink(&window[0], esize, error);
+		if (success)
+		{
+			memcpy(&chain[0], &window[esize - blocksize], blocksize);
+			size += filled;
+		}
+	}
+
+	chain.Zero();
+	window.Zero();
+
+	return success;
+}
+
+bool CipherStream::Decrypt(
+	const Cipher& cipher, const ByteVector& iv, const Source& source, const Sink& sink, size_t size, OSPError* error
+) {
+	if (!Active())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	size_t blocksize = cryptography.BlockSize(error);
+	if (iv.Size() < blocksize)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	memcpy(&chain[0], &iv[0], blocksize);
+
+	bool success = true;
+	size_t filled = window.Size();
+	size_t remaining = size;
+
+	while (success && filled == window.Size())
+	{
+		if (!(success = Fill(source, filled, error)) || !filled)
+			break;
+
+		// Ciphertext is whole blocks, one cut short was truncated
+		if (filled % blocksize)
+		{
+			success = OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_MALFORMED_CIPHERTEXT);
+			break;
+		}
+
+		memcpy(&chain[blocksize], &window[filled - blocksize], blocksize);
+
+		// Zeroed by its destructor, so the plaintext is gone once sink has it
+		ByteVector chunk(&cryptography, &window[0], filled);
+
+		if (success = cryptography.Decrypt(cipher, chain, chunk, chunk, error))
+		{
+			size_t part = min(remaining, filled);
+			if (success = sink(&window[0], part, error))
+			{
+				memcpy(&chain[0], &chain[blocksize], blocksize);
+				remaining -= part;
+			}
+		}
+	}
+
+	// Less ciphertext than size bytes of plaintext was truncated too
+	if (success && remaining)
+		success = OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_MALFORMED_CIPHERTEXT);
+
+	chain.Zero();
+	window.Zero();
+
+	return success;
+}
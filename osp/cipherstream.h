@@ -0,0 +1,100 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#pragma once
+
+#include <functional>
+
+#include "bytevector.h"
+#include "cryptography.h"
+
+namespace OneStrongPassword
+{
+	// Encrypts and decrypts payloads of any size a chunk at a time through one
+	// locked window allocated at Begin. The CBC chain is carried from the last
+	// cipher block of each chunk to the next, so the ciphertext is the same as
+	// encrypting the payload whole, while the locked memory held stays the
+	// window and two blocks of chain whatever the payload's size.
+	//
+	// Nothing is stored here: the ciphertext only passes through the window to
+	// the sink, keeping it, as one entry or chunked, is the caller's job.
+	class CipherStream
+	{
+	public:
+		typedef ICryptography::byte byte;
+
+		// Fills up to size bytes of data, filled left 0 at the end of the payload
+		typedef std::function<bool(byte* const data, size_t size, size_t& filled, OSPError* error)> Source;
+
+		// Takes size bytes of data, the window is zeroed once it returns
+		typedef std::function<bool(const byte* const data, size_t size, OSPError* error)> Sink;
+
+		explicit CipherStream(Cryptography& cryptography)
+			: cryptography(cryptography), window(cryptography), chain(cryptography) { }
+
+		virtual ~CipherStream() { End(nullptr); }
+
+		bool Active() const { return active; }
+
+		size_t WindowSize() const { return active ? window.Size() : 0; }
+
+		// Window is rounded down to the block size and limited to MaxDataSize, 0
+		// for MaxDataSize
+		bool Begin(size_t window = 0, OSPError* error = nullptr);
+		bool End(OSPError* error = nullptr);
+
+		// Encrypts everything source fills, the last chunk padded with zeros to the
+		// block size. Size is set to the plaintext bytes taken from source.
+		bool Encrypt(
+			const Cipher& cipher,
+			const ByteVector& iv,
+			const Source& source,
+			const Sink& sink,
+			size_t& size,
+			OSPError* error = nullptr
+		);
+
+		// Decrypts everything source fills, a multiple of the block size, passing
+		// only the first size bytes of plaintext on to sink. Ciphertext that is
+		// not whole blocks, or too short for size, fails with
+		// OSP_ERROR_MALFORMED_CIPHERTEXT.
+		bool Decrypt(
+			const Cipher& cipher,
+			const ByteVector& iv,
+			const Source& source,
+			const Sink& sink,
+			size_t size,
+			OSPError* error = nullptr
+		);
+
+	protected:
+		// Fills the window from source, a short fill only at the end of the payload
+		bool Fill(const Source& source, size_t& filled, OSPError* error);
+
+	private:
+		Cryptography& cryptography;
+		ByteVector window;
+		ByteVector chain;
+		bool active = false;
+	};
+}
@@ -23,10 +23,15 @@ Software.
 #pragma once
 
 #include "osp.h"
+
+#include <mutex>
+#include <string_view>
+
 #include "os.h"
 #include "icryptography.h"
 #include "cipher.h"
 #include "hashvector.h"
+#include "hashsession.h"
 
 namespace OneStrongPassword
 {
@@ -35,6 +40,10 @@ namespace OneStrongPassword
 	public:
 		typedef ICryptography::byte byte;
 
+		// AES-GCM nonces and authentication tags
+		static const size_t NONCE_SIZE = 12;
+		static const size_t TAG_SIZE = 16;
+
 		Cryptography();
 		Cryptography(size_t count, size_t maxsize = 0, OSPError* error = nullptr);
 
@@ -43,12 +52,27 @@ namespace OneStrongPassword
 		size_t AvailableMemory() const { return OS::AvailableMemory(); }
 		size_t MaxDataSize() const { return OS::MaxDataSize(); }
 		size_t MinDataSize() const { return HashSize(); }
+		size_t Allocations() const { return OS::Allocations(); }
 
 		virtual size_t BlockSize(OSPError* error = nullptr) const;
 		virtual size_t HashSize(OSPError* error = nullptr) const;
+		virtual size_t HashLanes(OSPError* error = nullptr) const;
+
+		// Independent entries the batch Encrypt advances together
+		virtual size_t EncryptLanes(OSPError* error = nullptr) const;
 
+		// Cipher blocks Decrypt keeps in flight at once
+		virtual size_t DecryptLanes(OSPError* error = nullptr) const;
+
+		// Blocks EncryptGcm and DecryptGcm encrypt and hash together
+		virtual size_t GcmLanes(OSPError* error = nullptr) const;
+
+		// Drawn from the calling thread's Drbg
 		virtual byte * const Randomize(byte* const data, size_t size, OSPError* error = nullptr) const;
 
+		// Straight from the system's random number generator, what seeds a Drbg
+		static bool Entropy(byte* const data, size_t size, OSPError* error = nullptr);
+
 		virtual bool Initialize(size_t count, size_t maxsize = 0, OSPError* error = nullptr)
 			{ return Initialize(count, maxsize, 0, error); }
 
@@ -74,6 +98,18 @@ namespace OneStrongPassword
 			OSPError* error = nullptr
 		);
 
+		// Count independent entries, each chained from iv, the same as encrypting
+		// them one by one. Encrypted buffers are not grown, each has to hold its
+		// data padded to whole blocks, and may be the data itself.
+		bool Encrypt(
+			const Cipher& cipher,
+			const ByteVector& iv,
+			ByteVector* const data[],
+			ByteVector* const encrypted[],
+			size_t count,
+			OSPError* error = nullptr
+		);
+
 		bool Decrypt(
 			const Cipher& cipher,
 			const ByteVector& iv,
@@ -82,8 +118,38 @@ namespace OneStrongPassword
 			OSPError* error = nullptr
 		);
 
+		// AES-GCM, data encrypted and authenticated together with aad, which is
+		// only authenticated. Encrypted holds as many bytes as data and may be
+		// it, no padding is needed. A nonce is never to be used twice with a key.
+		bool EncryptGcm(
+			const Cipher& cipher,
+			const ByteVector& nonce,
+			ByteVector& data,
+			ByteVector& encrypted,
+			ByteVector& tag,
+			std::string_view aad,
+			OSPError* error = nullptr
+		);
+
+		// All of encrypted is authenticated. When tag does not match it, or aad,
+		// fails with OSP_ERROR_DATA_NOT_AUTHENTIC with decrypted zeroed and
+		// encrypted left as it was, unless decrypted in place.
+		bool DecryptGcm(
+			const Cipher& cipher,
+			const ByteVector& nonce,
+			ByteVector& encrypted,
+			const ByteVector& tag,
+			ByteVector& decrypted,
+			std::string_view aad,
+			OSPError* error = nullptr
+		);
+
 		bool Hash(const ByteVector& data, ByteVector& hash, OSPError* error = nullptr);
 
+		// Lookups of Completed ciphers' keys that found them cached or had to make them
+		size_t KeyCacheHits() const;
+		size_t KeyCacheMisses() const;
+
 		void* State(OSPError* error = nullptr);
 		const void* State(OSPError* error = nullptr) const;
 
@@ -97,5 +163,6 @@ namespace OneStrongPassword
 
 	private:
 		mutable void* _state = NULL;
+		mutable std::mutex _statelock;
 	};
 }
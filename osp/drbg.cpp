@@ -0,0 +1,168 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "drbg.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace OneStrongPassword;
+using namespace std;
+
+inline uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+inline uint32_t load32(const uint8_t* p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32(uint8_t* p, uint32_t x)
+{
+	p[0] = uint8_t(x);
+	p[1] = uint8_t(x >> 8);
+	p[2] = uint8_t(x >> 16);
+	p[3] = uint8_t(x >> 24);
+}
+
+inline void quarterRound(uint32_t* x, int a, int b, int c, int d)
+{
+	x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+	x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+	x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+	x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+}
+
+Drbg& Drbg::Thread()
+{
+	static thread_local Drbg drbg;
+	return drbg;
+}
+
+void Drbg::ChaCha20(
+	const byte* const key, const byte* const nonce, uint32_t counter, byte* const out, size_t blocks
+) {
+	uint32_t input[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+	for (int n = 0; n < 8; n++)
+		input[4 + n] = load32(key + 4 * n);
+	for (int n = 0; n < 3; n++)
+		input[13 + n] = load32(nonce + 4 * n);
+
+	uint32_t x[16];
+	for (size_t block = 0; block < blocks; block++)
+	{
+		input[12] = counter + uint32_t(block);
+		memcpy(x, input, sizeof(x));
+
+		for (int round = 0; round < 10; round++)
+		{
+			quarterRound(x, 0, 4, 8, 12);
+			quarterRound(x, 1, 5, 9, 13);
+			quarterRound(x, 2, 6, 10, 14);
+			quarterRound(x, 3, 7, 11, 15);
+			quarterRound(x, 0, 5, 10, 15);
+			quarterRound(x, 1, 6, 11, 12);
+			quarterRound(x, 2, 7, 8, 13);
+			quarterRound(x, 3, 4, 9, 14);
+		}
+
+		for (int n = 0; n < 16; n++)
+			store32(out + BLOCK_SIZE * block + 4 * n, x[n] + input[n]);
+	}
+
+	OS::Zero((byte*)x, sizeof(x));
+	OS::Zero((byte*)input, sizeof(input));
+}
+
+Drbg::Drbg()
+{
+	OS::Zero((byte*)&state, sizeof(state));
+	locked = OS::LockMemory(&state, sizeof(state));
+}
+
+Drbg::~Drbg()
+{
+	OS::Zero((byte*)&state, sizeof(state));
+	if (locked)
+		OS::UnlockMemory(&state, sizeof(state));
+}
+
+bool Drbg::Generate(byte* const data, size_t size, Entropy entropy, OSPError* error)
+{
+	if (!data || !size)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	for (size_t pos = 0; pos < size;)
+	{
+		if (!available && !Refill(entropy, error))
+		{
+			OS::Zero(data, size);
+			return false;
+		}
+
+		size_t count = min(size - pos, available);
+		byte* served = &state.Buffer[BUFFER_SIZE - available];
+
+		memcpy(data + pos, served, count);
+		OS::Zero(served, count);
+
+		available -= count;
+		generated += count;
+		pos += count;
+	}
+
+	return true;
+}
+
+void Drbg::Reseed()
+{
+	OS::Zero(state.Buffer, BUFFER_SIZE);
+	available = 0;
+	generated = RESEED_SIZE;
+}
+
+bool Drbg::Refill(Entropy entropy, OSPError* error)
+{
+	if (generated >= RESEED_SIZE)
+	{
+		byte seed[KEY_SIZE];
+		if (!entropy(seed, KEY_SIZE, error))
+			return false;
+
+		// Mixed into the key, a seed is never all there is to it
+		for (size_t n = 0; n < KEY_SIZE; n++)
+			state.Key[n] ^= seed[n];
+		OS::Zero(seed, KEY_SIZE);
+
+		generated = 0;
+		reseeds++;
+	}
+
+	// The key is used once, the keystream's start is the next key
+	const byte nonce[NONCE_SIZE] = { 0 };
+	ChaCha20(state.Key, nonce, 0, state.Buffer, BUFFER_SIZE / BLOCK_SIZE);
+
+	memcpy(state.Key, state.Buffer, KEY_SIZE);
+	OS::Zero(state.Buffer, KEY_SIZE);
+
+	available = BUFFER_SIZE - KEY_SIZE;
+	return true;
+}
@@ -0,0 +1,85 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+#include "osp.h"
+
+#include <stdint.h>
+
+#include "os.h"
+
+namespace OneStrongPassword
+{
+	// Random bytes for one thread, a ChaCha20 generator with fast key erasure.
+	// Every refill rekeys it from its own first output, so nothing it served
+	// can be recovered, and the rest of the refill is served to requests and
+	// zeroed as it is consumed. It seeds from the entropy source on first use
+	// and again every RESEED_SIZE bytes or when asked to.
+	class Drbg
+	{
+	public:
+		typedef OS::byte byte;
+		typedef bool (*Entropy)(byte* const data, size_t size, OSPError* error);
+
+		static const size_t KEY_SIZE = 32;
+		static const size_t NONCE_SIZE = 12;
+		static const size_t BLOCK_SIZE = 64;
+		static const size_t BUFFER_SIZE = 9 * BLOCK_SIZE;
+		static const size_t RESEED_SIZE = 1 << 20;
+
+		// The calling thread's generator
+		static Drbg& Thread();
+
+		// RFC 8439 keystream, blocks of it starting at counter
+		static void ChaCha20(
+			const byte* const key, const byte* const nonce, uint32_t counter, byte* const out, size_t blocks
+		);
+
+		Drbg();
+		~Drbg();
+
+		Drbg(const Drbg&) = delete;
+		Drbg& operator=(const Drbg&) = delete;
+
+		bool Generate(byte* const data, size_t size, Entropy entropy, OSPError* error = nullptr);
+
+		// Drops what is buffered and seeds again on the next request
+		void Reseed();
+
+		size_t Reseeds() const { return reseeds; }
+
+	private:
+		bool Refill(Entropy entropy, OSPError* error);
+
+		// Locked in memory together
+		struct State
+		{
+			byte Key[KEY_SIZE];
+			byte Buffer[BUFFER_SIZE];
+		} state;
+
+		size_t available = 0;
+		size_t generated = RESEED_SIZE;
+		size_t reseeds = 0;
+		bool locked = false;
+	};
+}
@@ -0,0 +1,68 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#include "hashsession.h"
+#include "cryptography.h"
+
+using namespace OneStrongPassword;
+
+bool HashSession::Hash(const ByteVector& data, ByteVector& hash, OSPError* error)
+{
+	hash.Zero();
+
+	if (!Active())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	const byte* dpart = data;
+	byte* hpart = hash;
+
+	size_t hashsize = cryptography.HashSize(error);
+	size_t datasize = data.Size();
+
+	if (!hashsize || hashsize > MAX_HASH_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	size_t count = hash.Size() / hashsize;
+
+	bool success = true;
+
+	for (size_t n = 0; success && n < count; n++)
+	{
+		if (success = Digest(dpart, datasize, hpart, error))
+		{
+			dpart = hpart;
+			datasize = hashsize;
+			hpart += hashsize;
+		}
+	}
+
+	size_t remaining = hash.Size() % hashsize;
+	if (success && remaining)
+	{
+		ByteArray<MAX_HASH_SIZE> tmp;
+		if (success = Digest(dpart, datasize, tmp, error))
+			tmp.CopyTo(hpart, remaining, error);
+	}
+
+	return success;
+}
@@ -0,0 +1,63 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#pragma once
+
+#include "bytevector.h"
+
+namespace OneStrongPassword
+{
+	class Cryptography;
+
+	// One hash object that is created once and reused for every digest until
+	// End, so repeated hashing does not allocate or recreate handles.
+	class HashSession
+	{
+	public:
+		typedef ICryptography::byte byte;
+
+		static const size_t MAX_HASH_SIZE = 64;
+
+		explicit HashSession(Cryptography& cryptography) : cryptography(cryptography) { }
+		virtual ~HashSession() { End(nullptr); }
+
+		bool Active() const { return nullptr != _session; }
+
+		bool Begin(OSPError* error = nullptr);
+		bool End(OSPError* error = nullptr);
+
+		// Hash size bytes of digest for size bytes of data
+		bool Digest(const byte* const data, size_t size, byte* const hash, OSPError* error = nullptr);
+
+		// Fills hash, each hash size part the digest of the part before it
+		bool Hash(const ByteVector& data, ByteVector& hash, OSPError* error = nullptr);
+
+		// Replaces each of count hash size digests with the digest of itself rounds
+		// times, advancing up to Cryptography::HashLanes() digests together
+		bool Rehash(byte* const hashes[], size_t count, size_t rounds, OSPError* error = nullptr);
+
+	private:
+		Cryptography& cryptography;
+		void* _session = nullptr;
+	};
+}
@@ -0,0 +1,1337 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "kdf.h"
+
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "cryptography.h"
+#include "hashsession.h"
+#include "threadpool.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define OSP_KDF_SIMD
+#endif
+
+using namespace OneStrongPassword;
+using namespace std;
+
+const char* const Kdf::SALT = "OneStrongPassword";
+
+inline uint32_t rotl32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+inline uint64_t rotr64(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+inline uint32_t load32(const uint8_t* p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32(uint8_t* p, uint32_t x)
+{
+	for (int n = 0; n < 4; n++)
+		p[n] = uint8_t(x >> (8 * n));
+}
+
+inline uint64_t load64(const uint8_t* p)
+{
+	return uint64_t(load32(p)) | (uint64_t(load32(p + 4)) << 32);
+}
+
+inline void store64(uint8_t* p, uint64_t x)
+{
+	store32(p, uint32_t(x));
+	store32(p + 4, uint32_t(x >> 32));
+}
+
+inline uint32_t load32be(const uint8_t* p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void store32be(uint8_t* p, uint32_t x)
+{
+	for (int n = 0; n < 4; n++)
+		p[n] = uint8_t(x >> (24 - 8 * n));
+}
+
+#pragma region SHA-256
+
+const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+typedef struct Sha256State
+{
+	uint32_t H[8];
+	uint8_t Block[64];
+	size_t Used;
+	uint64_t Length;
+} Sha256State;
+
+void sha256Compress(uint32_t* h, const uint8_t* block)
+{
+	uint32_t w[64];
+	for (int t = 0; t < 16; t++)
+		w[t] = load32be(block + 4 * t);
+	for (int t = 16; t < 64; t++)
+	{
+		uint32_t s0 = rotr32(w[t - 15], 7) ^ rotr32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+		uint32_t s1 = rotr32(w[t - 2], 17) ^ rotr32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+		w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+	}
+
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+	for (int t = 0; t < 64; t++)
+	{
+		uint32_t t1 = k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[t] + w[t];
+		uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		k = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+
+	OS::Zero((uint8_t*)w, sizeof(w));
+}
+
+void sha256Init(Sha256State& state)
+{
+	const uint32_t iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	memcpy(state.H, iv, sizeof(iv));
+	state.Used = 0;
+	state.Length = 0;
+}
+
+void sha256Update(Sha256State& state, const uint8_t* data, size_t size)
+{
+	state.Length += size;
+	while (size)
+	{
+		size_t take = min(size, sizeof(state.Block) - state.Used);
+		memcpy(state.Block + state.Used, data, take);
+		state.Used += take;
+		data += take;
+		size -= take;
+
+		if (state.Used == sizeof(state.Block))
+		{
+			sha256Compress(state.H, state.Block);
+			state.Used = 0;
+		}
+	}
+}
+
+void sha256Final(Sha256State& state, uint8_t* hash)
+{
+	uint64_t bits = state.Length * 8;
+
+	state.Block[state.Used++] = 0x80;
+	if (state.Used > 56)
+	{
+		memset(state.Block + state.Used, 0, sizeof(state.Block) - state.Used);
+		sha256Compress(state.H, state.Block);
+		state.Used = 0;
+	}
+	memset(state.Block + state.Used, 0, 56 - state.Used);
+	store32be(state.Block + 56, uint32_t(bits >> 32));
+	store32be(state.Block + 60, uint32_t(bits));
+	sha256Compress(state.H, state.Block);
+
+	for (int n = 0; n < 8; n++)
+		store32be(hash + 4 * n, state.H[n]);
+
+	OS::Zero((uint8_t*)&state, sizeof(state));
+}
+
+// PBKDF2-HMAC-SHA256 with one iteration, all scrypt asks of it
+void pbkdf2Sha256(const uint8_t* password, size_t plen, const uint8_t* salt, size_t slen, uint8_t* derived, size_t size)
+{
+	uint8_t key[64] = { 0 };
+	if (plen > sizeof(key))
+		Kdf::Sha256(password, plen, key);
+	else
+		memcpy(key, password, plen);
+
+	uint8_t ipad[64], opad[64];
+	for (size_t n = 0; n < sizeof(key); n++)
+	{
+		ipad[n] = key[n] ^ 0x36;
+		opad[n] = key[n] ^ 0x5c;
+	}
+
+	uint8_t counter[4], inner[32], block[32];
+	Sha256State state;
+
+	for (uint32_t index = 1, pos = 0; pos < size; index++, pos += sizeof(block))
+	{
+		store32be(counter, index);
+
+		sha256Init(state);
+		sha256Update(state, ipad, sizeof(ipad));
+		sha256Update(state, salt, slen);
+		sha256Update(state, counter, sizeof(counter));
+		sha256Final(state, inner);
+
+		sha256Init(state);
+		sha256Update(state, opad, sizeof(opad));
+		sha256Update(state, inner, sizeof(inner));
+		sha256Final(state, block);
+
+		memcpy(derived + pos, block, min(sizeof(block), size - pos));
+	}
+
+	OS::Zero(key, sizeof(key));
+	OS::Zero(ipad, sizeof(ipad));
+	OS::Zero(opad, sizeof(opad));
+	OS::Zero(inner, sizeof(inner));
+	OS::Zero(block, sizeof(block));
+}
+
+#pragma endregion
+
+#pragma region scrypt
+
+void salsa208(uint32_t* b)
+{
+	uint32_t x[16];
+	memcpy(x, b, sizeof(x));
+
+	for (int round = 0; round < 8; round += 2)
+	{
+		x[ 4] ^= rotl32(x[ 0] + x[12],  7); x[ 8] ^= rotl32(x[ 4] + x[ 0],  9);
+		x[12] ^= rotl32(x[ 8] + x[ 4], 13); x[ 0] ^= rotl32(x[12] + x[ 8], 18);
+		x[ 9] ^= rotl32(x[ 5] + x[ 1],  7); x[13] ^= rotl32(x[ 9] + x[ 5],  9);
+		x[ 1] ^= rotl32(x[13] + x[ 9], 13); x[ 5] ^= rotl32(x[ 1] + x[13], 18);
+		x[14] ^= rotl32(x[10] + x[ 6],  7); x[ 2] ^= rotl32(x[14] + x[10],  9);
+		x[ 6] ^= rotl32(x[ 2] + x[14], 13); x[10] ^= rotl32(x[ 6] + x[ 2], 18);
+		x[ 3] ^= rotl32(x[15] + x[11],  7); x[ 7] ^= rotl32(x[ 3] + x[15],  9);
+		x[11] ^= rotl32(x[ 7] + x[ 3], 13); x[15] ^= rotl32(x[11] + x[ 7], 18);
+
+		x[ 1] ^= rotl32(x[ 0] + x[ 3],  7); x[ 2] ^= rotl32(x[ 1] + x[ 0],  9);
+		x[ 3] ^= rotl32(x[ 2] + x[ 1], 13); x[ 0] ^= rotl32(x[ 3] + x[ 2], 18);
+		x[ 6] ^= rotl32(x[ 5] + x[ 4],  7); x[ 7] ^= rotl32(x[ 6] + x[ 5],  9);
+		x[ 4] ^= rotl32(x[ 7] + x[ 6], 13); x[ 5] ^= rotl32(x[ 4] + x[ 7], 18);
+		x[11] ^= rotl32(x[10] + x[ 9],  7); x[ 8] ^= rotl32(x[11] + x[10],  9);
+		x[ 9] ^= rotl32(x[ 8] + x[11], 13); x[10] ^= rotl32(x[ 9] + x[ 8], 18);
+		x[12] ^= rotl32(x[15] + x[14],  7); x[13] ^= rotl32(x[12] + x[15],  9);
+		x[14] ^= rotl32(x[13] + x[12], 13); x[15] ^= rotl32(x[14] + x[13], 18);
+	}
+
+	for (int n = 0; n < 16; n++)
+		b[n] += x[n];
+}
+
+// Mixes the 2r blocks of b, y is as large
+void blockMix(uint32_t* b, uint32_t* y, size_t r)
+{
+	uint32_t x[16];
+	memcpy(x, &b[(2 * r - 1) * 16], sizeof(x));
+
+	for (size_t i = 0; i < 2 * r; i++)
+	{
+		for (int n = 0; n < 16; n++)
+			x[n] ^= b[i * 16 + n];
+		salsa208(x);
+		memcpy(&y[i * 16], x, sizeof(x));
+	}
+
+	// Even blocks first, then odd ones
+	for (size_t i = 0; i < r; i++)
+	{
+		memcpy(&b[i * 16], &y[2 * i * 16], sizeof(x));
+		memcpy(&b[(r + i) * 16], &y[(2 * i + 1) * 16], sizeof(x));
+	}
+}
+
+#ifdef OSP_KDF_SIMD
+
+// Salsa20/8 on a block held in diagonal order, word (5 * i) % 16 at i, so every
+// quarter round of a column or row works on whole vectors
+__attribute__((target("sse2")))
+inline void salsa208Sse2(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3)
+{
+	#define ROTL(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+	__m128i b0 = x0, b1 = x1, b2 = x2, b3 = x3;
+
+	for (int round = 0; round < 8; round += 2)
+	{
+		x1 = _mm_xor_si128(x1, ROTL(_mm_add_epi32(x0, x3),  7));
+		x2 = _mm_xor_si128(x2, ROTL(_mm_add_epi32(x1, x0),  9));
+		x3 = _mm_xor_si128(x3, ROTL(_mm_add_epi32(x2, x1), 13));
+		x0 = _mm_xor_si128(x0, ROTL(_mm_add_epi32(x3, x2), 18));
+
+		x1 = _mm_shuffle_epi32(x1, 0x93);
+		x2 = _mm_shuffle_epi32(x2, 0x4E);
+		x3 = _mm_shuffle_epi32(x3, 0x39);
+
+		x3 = _mm_xor_si128(x3, ROTL(_mm_add_epi32(x0, x1),  7));
+		x2 = _mm_xor_si128(x2, ROTL(_mm_add_epi32(x3, x0),  9));
+		x1 = _mm_xor_si128(x1, ROTL(_mm_add_epi32(x2, x3), 13));
+		x0 = _mm_xor_si128(x0, ROTL(_mm_add_epi32(x1, x2), 18));
+
+		x1 = _mm_shuffle_epi32(x1, 0x39);
+		x2 = _mm_shuffle_epi32(x2, 0x4E);
+		x3 = _mm_shuffle_epi32(x3, 0x93);
+	}
+
+	#undef ROTL
+
+	x0 = _mm_add_epi32(x0, b0);
+	x1 = _mm_add_epi32(x1, b1);
+	x2 = _mm_add_epi32(x2, b2);
+	x3 = _mm_add_epi32(x3, b3);
+}
+
+// blockMix on diagonal ordered blocks, the output goes straight to its even or odd half
+__attribute__((target("sse2")))
+void blockMixSse2(__m128i* b, __m128i* y, size_t r)
+{
+	__m128i x0 = _mm_loadu_si128(&b[(2 * r - 1) * 4 + 0]);
+	__m128i x1 = _mm_loadu_si128(&b[(2 * r - 1) * 4 + 1]);
+	__m128i x2 = _mm_loadu_si128(&b[(2 * r - 1) * 4 + 2]);
+	__m128i x3 = _mm_loadu_si128(&b[(2 * r - 1) * 4 + 3]);
+
+	for (size_t i = 0; i < 2 * r; i++)
+	{
+		x0 = _mm_xor_si128(x0, _mm_loadu_si128(&b[i * 4 + 0]));
+		x1 = _mm_xor_si128(x1, _mm_loadu_si128(&b[i * 4 + 1]));
+		x2 = _mm_xor_si128(x2, _mm_loadu_si128(&b[i * 4 + 2]));
+		x3 = _mm_xor_si128(x3, _mm_loadu_si128(&b[i * 4 + 3]));
+		salsa208Sse2(x0, x1, x2, x3);
+
+		__m128i* out = &y[((i & 1) * r + i / 2) * 4];
+		_mm_storeu_si128(&out[0], x0);
+		_mm_storeu_si128(&out[1], x1);
+		_mm_storeu_si128(&out[2], x2);
+		_mm_storeu_si128(&out[3], x3);
+	}
+
+	memcpy(b, y, 2 * r * 4 * sizeof(__m128i));
+}
+
+__attribute__((target("sse2")))
+void roMixSse2(uint8_t* block, size_t r, uint64_t n, uint32_t* v, uint32_t* x, uint32_t* y)
+{
+	size_t words = 32 * r;
+	size_t vectors = words / 4;
+
+	// Word 0 of every block stays put, so integerify reads the same word as the scalar loop
+	for (size_t k = 0; k < words; k += 16)
+	{
+		for (size_t i = 0; i < 16; i++)
+			x[k + i] = load32(block + 4 * (k + (5 * i) % 16));
+	}
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		memcpy(&v[i * words], x, words * sizeof(uint32_t));
+		blockMixSse2((__m128i*)x, (__m128i*)y, r);
+	}
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+		__m128i* xv = (__m128i*)x;
+		const __m128i* vv = (const __m128i*)&v[j * words];
+		for (size_t k = 0; k < vectors; k++)
+			_mm_storeu_si128(&xv[k], _mm_xor_si128(_mm_loadu_si128(&xv[k]), _mm_loadu_si128(&vv[k])));
+		blockMixSse2(xv, (__m128i*)y, r);
+	}
+
+	for (size_t k = 0; k < words; k += 16)
+	{
+		for (size_t i = 0; i < 16; i++)
+			store32(block + 4 * (k + (5 * i) % 16), x[k + i]);
+	}
+}
+
+#endif
+
+bool salsaSupported()
+{
+#ifdef OSP_KDF_SIMD
+	static const bool supported = __builtin_cpu_supports("sse2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+void roMix(uint8_t* block, size_t r, uint64_t n, uint32_t* v, uint32_t* x, uint32_t* y)
+{
+#ifdef OSP_KDF_SIMD
+	if (salsaSupported())
+	{
+		roMixSse2(block, r, n, v, x, y);
+		return;
+	}
+#endif
+
+	size_t words = 32 * r;
+
+	for (size_t k = 0; k < words; k++)
+		x[k] = load32(block + 4 * k);
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		memcpy(&v[i * words], x, words * sizeof(uint32_t));
+		blockMix(x, y, r);
+	}
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+		for (size_t k = 0; k < words; k++)
+			x[k] ^= v[j * words + k];
+		blockMix(x, y, r);
+	}
+
+	for (size_t k = 0; k < words; k++)
+		store32(block + 4 * k, x[k]);
+}
+
+#pragma endregion
+
+#pragma region BLAKE2b and Argon2id
+
+const uint64_t BLAKE2B_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const uint8_t BLAKE2B_SIGMA[12][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+typedef struct Blake2bState
+{
+	uint64_t H[8];
+	uint8_t Block[128];
+	size_t Used;
+	uint64_t Length;
+	size_t Size;
+} Blake2bState;
+
+inline void blake2bG(uint64_t* v, int a, int b, int c, int d, uint64_t x, uint64_t y)
+{
+	v[a] = v[a] + v[b] + x; v[d] = rotr64(v[d] ^ v[a], 32);
+	v[c] = v[c] + v[d];     v[b] = rotr64(v[b] ^ v[c], 24);
+	v[a] = v[a] + v[b] + y; v[d] = rotr64(v[d] ^ v[a], 16);
+	v[c] = v[c] + v[d];     v[b] = rotr64(v[b] ^ v[c], 63);
+}
+
+void blake2bCompress(Blake2bState& state, bool last)
+{
+	uint64_t m[16], v[16];
+	for (int n = 0; n < 16; n++)
+		m[n] = load64(state.Block + 8 * n);
+
+	for (int n = 0; n < 8; n++)
+	{
+		v[n] = state.H[n];
+		v[n + 8] = BLAKE2B_IV[n];
+	}
+	v[12] ^= state.Length;
+	if (last)
+		v[14] = ~v[14];
+
+	for (int round = 0; round < 12; round++)
+	{
+		const uint8_t* s = BLAKE2B_SIGMA[round];
+		blake2bG(v, 0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+		blake2bG(v, 1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+		blake2bG(v, 2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+		blake2bG(v, 3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+		blake2bG(v, 0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+		blake2bG(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+		blake2bG(v, 2, 7,  8, 13, m[s[12]], m[s[13]]);
+		blake2bG(v, 3, 4,  9, 14, m[s[14]], m[s[15]]);
+	}
+
+	for (int n = 0; n < 8; n++)
+		state.H[n] ^= v[n] ^ v[n + 8];
+
+	OS::Zero((uint8_t*)m, sizeof(m));
+	OS::Zero((uint8_t*)v, sizeof(v));
+}
+
+void blake2bInit(Blake2bState& state, size_t size)
+{
+	memcpy(state.H, BLAKE2B_IV, sizeof(state.H));
+	state.H[0] ^= 0x01010000 ^ uint64_t(size);
+	state.Used = 0;
+	state.Length = 0;
+	state.Size = size;
+}
+
+void blake2bUpdate(Blake2bState& state, const uint8_t* data, size_t size)
+{
+	while (size)
+	{
+		// The last block is compressed by Final, so a full one waits for more data
+		if (state.Used == sizeof(state.Block))
+		{
+			state.Length += sizeof(state.Block);
+			blake2bCompress(state, false);
+			state.Used = 0;
+		}
+
+		size_t take = min(size, sizeof(state.Block) - state.Used);
+		memcpy(state.Block + state.Used, data, take);
+		state.Used += take;
+		data += take;
+		size -= take;
+	}
+}
+
+void blake2bUpdate(Blake2bState& state, uint32_t value)
+{
+	uint8_t bytes[4];
+	store32(bytes, value);
+	blake2bUpdate(state, bytes, sizeof(bytes));
+}
+
+void blake2bFinal(Blake2bState& state, uint8_t* hash)
+{
+	state.Length += state.Used;
+	memset(state.Block + state.Used, 0, sizeof(state.Block) - state.Used);
+	blake2bCompress(state, true);
+
+	uint8_t full[64];
+	for (int n = 0; n < 8; n++)
+		store64(full + 8 * n, state.H[n]);
+	memcpy(hash, full, state.Size);
+
+	OS::Zero(full, sizeof(full));
+	OS::Zero((uint8_t*)&state, sizeof(state));
+}
+
+// H' of RFC 9106, any size from chained 64 byte digests
+void blake2bLong(const uint8_t* data, size_t dsize, uint8_t* hash, size_t size)
+{
+	Blake2bState state;
+	blake2bInit(state, min(size, size_t(64)));
+	blake2bUpdate(state, uint32_t(size));
+	blake2bUpdate(state, data, dsize);
+
+	if (size <= 64)
+	{
+		blake2bFinal(state, hash);
+		return;
+	}
+
+	uint8_t v[64];
+	blake2bFinal(state, v);
+	memcpy(hash, v, 32);
+
+	size_t pos = 32;
+	for (; size - pos > 64; pos += 32)
+	{
+		Kdf::Blake2b(v, sizeof(v), v, sizeof(v));
+		memcpy(hash + pos, v, 32);
+	}
+	Kdf::Blake2b(v, sizeof(v), hash + pos, size - pos);
+
+	OS::Zero(v, sizeof(v));
+}
+
+const size_t ARGON2_BLOCK_WORDS = 128;
+const size_t ARGON2_BLOCK_SIZE = 8 * ARGON2_BLOCK_WORDS;
+const size_t ARGON2_SLICES = 4;
+const uint32_t ARGON2_VERSION = 0x13;
+const uint32_t ARGON2_ID = 2;
+
+inline uint64_t blaMka(uint64_t x, uint64_t y)
+{
+	const uint64_t low = 0xFFFFFFFF;
+	return x + y + 2 * ((x & low) * (y & low));
+}
+
+inline void blaMkaG(uint64_t& a, uint64_t& b, uint64_t& c, uint64_t& d)
+{
+	a = blaMka(a, b); d = rotr64(d ^ a, 32);
+	c = blaMka(c, d); b = rotr64(b ^ c, 24);
+	a = blaMka(a, b); d = rotr64(d ^ a, 16);
+	c = blaMka(c, d); b = rotr64(b ^ c, 63);
+}
+
+// The BLAKE2b round on sixteen words, picked as a row or a column of a block
+inline void blaMkaRound(uint64_t* r, const size_t* w)
+{
+	blaMkaG(r[w[0]], r[w[4]], r[w[ 8]], r[w[12]]);
+	blaMkaG(r[w[1]], r[w[5]], r[w[ 9]], r[w[13]]);
+	blaMkaG(r[w[2]], r[w[6]], r[w[10]], r[w[14]]);
+	blaMkaG(r[w[3]], r[w[7]], r[w[11]], r[w[15]]);
+	blaMkaG(r[w[0]], r[w[5]], r[w[10]], r[w[15]]);
+	blaMkaG(r[w[1]], r[w[6]], r[w[11]], r[w[12]]);
+	blaMkaG(r[w[2]], r[w[7]], r[w[ 8]], r[w[13]]);
+	blaMkaG(r[w[3]], r[w[4]], r[w[ 9]], r[w[14]]);
+}
+
+#ifdef OSP_KDF_SIMD
+
+// Four BlaMka G functions at once, a to d hold a row of sixteen words
+__attribute__((target("avx2")))
+inline void blaMkaG4(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+	#define BLAMKA(x, y) _mm256_add_epi64(_mm256_add_epi64((x), (y)), \
+		_mm256_slli_epi64(_mm256_mul_epu32((x), (y)), 1))
+	#define ROTR(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+
+	a = BLAMKA(a, b); d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), _MM_SHUFFLE(2, 3, 0, 1));
+	c = BLAMKA(c, d); b = ROTR(_mm256_xor_si256(b, c), 24);
+	a = BLAMKA(a, b); d = ROTR(_mm256_xor_si256(d, a), 16);
+	c = BLAMKA(c, d); b = ROTR(_mm256_xor_si256(b, c), 63);
+
+	#undef ROTR
+	#undef BLAMKA
+}
+
+// The BLAKE2b round, columns then diagonals, the diagonals lined up by rotating b to d
+__attribute__((target("avx2")))
+inline void blaMkaRound4(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+	blaMkaG4(a, b, c, d);
+
+	b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+	c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+	d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+	blaMkaG4(a, b, c, d);
+
+	b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+	c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+	d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+}
+
+// Two word pairs, sixteen words apart, as one vector
+__attribute__((target("avx2")))
+inline __m256i loadPairs(const uint64_t* p)
+{
+	return _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)), _mm_loadu_si128((const __m128i*)(p + 16)), 1
+	);
+}
+
+__attribute__((target("avx2")))
+inline void storePairs(uint64_t* p, __m256i x)
+{
+	_mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(x));
+	_mm_storeu_si128((__m128i*)(p + 16), _mm256_extracti128_si256(x, 1));
+}
+
+__attribute__((target("avx2")))
+void fillBlockAvx2(const uint64_t* prev, const uint64_t* ref, uint64_t* next, bool xored)
+{
+	uint64_t r[ARGON2_BLOCK_WORDS], t[ARGON2_BLOCK_WORDS];
+	for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n += 4)
+	{
+		__m256i x = _mm256_xor_si256(
+			_mm256_loadu_si256((const __m256i*)&prev[n]), _mm256_loadu_si256((const __m256i*)&ref[n])
+		);
+		_mm256_storeu_si256((__m256i*)&r[n], x);
+		if (xored)
+			x = _mm256_xor_si256(x, _mm256_loadu_si256((const __m256i*)&next[n]));
+		_mm256_storeu_si256((__m256i*)&t[n], x);
+	}
+
+	// Rows are sixteen consecutive words
+	for (size_t i = 0; i < 8; i++)
+	{
+		__m256i* row = (__m256i*)&r[16 * i];
+		__m256i a = _mm256_loadu_si256(&row[0]), b = _mm256_loadu_si256(&row[1]);
+		__m256i c = _mm256_loadu_si256(&row[2]), d = _mm256_loadu_si256(&row[3]);
+		blaMkaRound4(a, b, c, d);
+		_mm256_storeu_si256(&row[0], a); _mm256_storeu_si256(&row[1], b);
+		_mm256_storeu_si256(&row[2], c); _mm256_storeu_si256(&row[3], d);
+	}
+
+	// Columns are word pairs 2i and 2i + 1 of every row
+	for (size_t i = 0; i < 8; i++)
+	{
+		uint64_t* column = &r[2 * i];
+		__m256i a = loadPairs(column), b = loadPairs(column + 32);
+		__m256i c = loadPairs(column + 64), d = loadPairs(column + 96);
+		blaMkaRound4(a, b, c, d);
+		storePairs(column, a); storePairs(column + 32, b);
+		storePairs(column + 64, c); storePairs(column + 96, d);
+	}
+
+	for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n += 4)
+	{
+		_mm256_storeu_si256((__m256i*)&next[n], _mm256_xor_si256(
+			_mm256_loadu_si256((const __m256i*)&t[n]), _mm256_loadu_si256((const __m256i*)&r[n])
+		));
+	}
+}
+
+#endif
+
+bool blaMkaSupported()
+{
+#ifdef OSP_KDF_SIMD
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+// next = G(prev, ref), xored into next on later passes
+void fillBlock(const uint64_t* prev, const uint64_t* ref, uint64_t* next, bool xored)
+{
+#ifdef OSP_KDF_SIMD
+	if (blaMkaSupported())
+	{
+		fillBlockAvx2(prev, ref, next, xored);
+		return;
+	}
+#endif
+
+	uint64_t r[ARGON2_BLOCK_WORDS], t[ARGON2_BLOCK_WORDS];
+	for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n++)
+	{
+		r[n] = prev[n] ^ ref[n];
+		t[n] = xored ? r[n] ^ next[n] : r[n];
+	}
+
+	size_t w[16];
+	for (size_t i = 0; i < 8; i++)
+	{
+		for (size_t n = 0; n < 16; n++)
+			w[n] = 16 * i + n;
+		blaMkaRound(r, w);
+	}
+	for (size_t i = 0; i < 8; i++)
+	{
+		for (size_t n = 0; n < 8; n++)
+		{
+			w[2 * n] = 2 * i + 16 * n;
+			w[2 * n + 1] = 2 * i + 16 * n + 1;
+		}
+		blaMkaRound(r, w);
+	}
+
+	for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n++)
+		next[n] = t[n] ^ r[n];
+}
+
+typedef struct Argon2Instance
+{
+	uint64_t* Memory;
+	uint32_t Passes;
+	uint32_t Lanes;
+	uint32_t Blocks;
+	uint32_t LaneLength;
+	uint32_t SegmentLength;
+} Argon2Instance;
+
+uint32_t indexAlpha(
+	const Argon2Instance& instance, uint32_t pass, uint32_t slice, uint32_t index, uint32_t random, bool samelane
+) {
+	uint32_t area;
+	if (pass == 0)
+	{
+		if (slice == 0)
+			area = index - 1;
+		else if (samelane)
+			area = slice * instance.SegmentLength + index - 1;
+		else
+			area = slice * instance.SegmentLength - (index == 0 ? 1 : 0);
+	}
+	else if (samelane)
+		area = instance.LaneLength - instance.SegmentLength + index - 1;
+	else
+		area = instance.LaneLength - instance.SegmentLength - (index == 0 ? 1 : 0);
+
+	uint64_t relative = random;
+	relative = (relative * relative) >> 32;
+	relative = area - 1 - ((area * relative) >> 32);
+
+	uint32_t start = 0;
+	if (pass != 0 && slice != ARGON2_SLICES - 1)
+		start = (slice + 1) * instance.SegmentLength;
+
+	return uint32_t((start + relative) % instance.LaneLength);
+}
+
+void fillSegment(const Argon2Instance& instance, uint32_t pass, uint32_t lane, uint32_t slice)
+{
+	// Argon2id addresses independently of the data for the first half of the first pass
+	bool independent = pass == 0 && slice < ARGON2_SLICES / 2;
+
+	uint64_t zero[ARGON2_BLOCK_WORDS] = { 0 };
+	uint64_t input[ARGON2_BLOCK_WORDS] = { 0 };
+	uint64_t addresses[ARGON2_BLOCK_WORDS] = { 0 };
+
+	auto nextAddresses = [&]()
+	{
+		input[6]++;
+		fillBlock(zero, input, addresses, false);
+		fillBlock(zero, addresses, addresses, false);
+	};
+
+	if (independent)
+	{
+		input[0] = pass;
+		input[1] = lane;
+		input[2] = slice;
+		input[3] = instance.Blocks;
+		input[4] = instance.Passes;
+		input[5] = ARGON2_ID;
+	}
+
+	uint32_t first = 0;
+	if (pass == 0 && slice == 0)
+	{
+		first = 2;
+		if (independent)
+			nextAddresses();
+	}
+
+	uint32_t current = lane * instance.LaneLength + slice * instance.SegmentLength + first;
+	uint32_t previous = current % instance.LaneLength == 0 ? current + instance.LaneLength - 1 : current - 1;
+
+	for (uint32_t index = first; index < instance.SegmentLength; index++, current++, previous++)
+	{
+		if (current % instance.LaneLength == 1)
+			previous = current - 1;
+
+		uint64_t random;
+		if (independent)
+		{
+			if (index % ARGON2_BLOCK_WORDS == 0)
+				nextAddresses();
+			random = addresses[index % ARGON2_BLOCK_WORDS];
+		}
+		else
+			random = instance.Memory[size_t(previous) * ARGON2_BLOCK_WORDS];
+
+		uint32_t reflane = uint32_t((random >> 32) % instance.Lanes);
+		if (pass == 0 && slice == 0)
+			reflane = lane;
+
+		uint32_t refindex = indexAlpha(instance, pass, slice, index, uint32_t(random), reflane == lane);
+
+		fillBlock(
+			&instance.Memory[size_t(previous) * ARGON2_BLOCK_WORDS],
+			&instance.Memory[(size_t(instance.LaneLength) * reflane + refindex) * ARGON2_BLOCK_WORDS],
+			&instance.Memory[size_t(current) * ARGON2_BLOCK_WORDS],
+			pass != 0
+		);
+	}
+
+	OS::Zero((uint8_t*)addresses, sizeof(addresses));
+}
+
+#pragma endregion
+
+#pragma region Kdf
+
+OSPKdfProfile Kdf::Legacy(uint32_t rounds)
+{
+	DECLARE_OSPKdfProfile(profile);
+	profile.Iterations = rounds;
+	return profile;
+}
+
+OSPKdfProfile Kdf::Pbkdf2(uint32_t iterations)
+{
+	DECLARE_OSPKdfProfile(profile);
+	profile.Kdf = OSP_KDF_PBKDF2;
+	profile.Iterations = iterations;
+	return profile;
+}
+
+OSPKdfProfile Kdf::Scrypt(uint32_t log2n, uint32_t r, uint32_t p)
+{
+	DECLARE_OSPKdfProfile(profile);
+	profile.Kdf = OSP_KDF_SCRYPT;
+	profile.Iterations = 0;
+	profile.Memory = log2n;
+	profile.BlockSize = r;
+	profile.Parallelism = p;
+	return profile;
+}
+
+OSPKdfProfile Kdf::Argon2id(uint32_t passes, uint32_t memory, uint32_t lanes)
+{
+	DECLARE_OSPKdfProfile(profile);
+	profile.Kdf = OSP_KDF_ARGON2ID;
+	profile.Iterations = passes;
+	profile.Memory = memory;
+	profile.Parallelism = lanes;
+	return profile;
+}
+
+bool Kdf::Valid(const OSPKdfProfile& profile)
+{
+	if (profile.Version != OSP_KDF_PROFILE_VERSION)
+		return false;
+
+	if (profile.Expansion > OSP_EXPANSION_COUNTER || profile.Generator > OSP_GENERATOR_CONSTRUCTIVE)
+		return false;
+
+	switch (profile.Kdf)
+	{
+	case OSP_KDF_LEGACY:
+	case OSP_KDF_PBKDF2:
+		return profile.Iterations > 0;
+
+	case OSP_KDF_SCRYPT:
+		return
+			profile.Memory > 0 && profile.Memory <= MAX_SCRYPT_LOG2_N &&
+			profile.BlockSize > 0 && profile.Parallelism > 0 &&
+			uint64_t(profile.BlockSize) * profile.Parallelism < (uint64_t(1) << 30) &&
+			(uint64_t(128) * profile.BlockSize << profile.Memory) <= uint64_t(MAX_ARGON2_MEMORY) * 1024;
+
+	case OSP_KDF_ARGON2ID:
+		return
+			profile.Iterations > 0 &&
+			profile.Parallelism > 0 && profile.Parallelism <= MAX_ARGON2_LANES &&
+			profile.Memory >= 8 * profile.Parallelism && profile.Memory <= MAX_ARGON2_MEMORY;
+	}
+
+	return false;
+}
+
+uint64_t Kdf::Cost(const OSPKdfProfile& profile)
+{
+	switch (profile.Kdf)
+	{
+	case OSP_KDF_LEGACY:
+	case OSP_KDF_PBKDF2:
+		return profile.Iterations;
+
+	case OSP_KDF_SCRYPT:
+		return (uint64_t(128) * profile.BlockSize << profile.Memory) * profile.Parallelism / 1024;
+
+	case OSP_KDF_ARGON2ID:
+		return uint64_t(profile.Memory) * profile.Iterations;
+	}
+
+	return 0;
+}
+
+OSPKdfProfile Kdf::Scaled(const OSPKdfProfile& profile, uint64_t cost)
+{
+	OSPKdfProfile scaled = profile;
+
+	switch (profile.Kdf)
+	{
+	case OSP_KDF_LEGACY:
+	case OSP_KDF_PBKDF2:
+	{
+		uint64_t iterations = max(uint64_t(MIN_SCALED_ITERATIONS), min(cost, uint64_t(UINT32_MAX - 1)));
+		if (profile.Kdf == OSP_KDF_LEGACY)
+			iterations += iterations % 2;
+		scaled.Iterations = uint32_t(iterations);
+		break;
+	}
+
+	case OSP_KDF_SCRYPT:
+	{
+		// N only comes in powers of two, the largest not over the cost
+		uint64_t per = max(uint64_t(1), uint64_t(128) * profile.BlockSize * profile.Parallelism / 1024);
+		uint64_t n = cost / per;
+		scaled.Memory = 1;
+		while (scaled.Memory < MAX_SCRYPT_LOG2_N && (uint64_t(1) << (scaled.Memory + 1)) <= n)
+			scaled.Memory++;
+		while (scaled.Memory > 1 && !Valid(scaled))
+			scaled.Memory--;
+		break;
+	}
+
+	case OSP_KDF_ARGON2ID:
+	{
+		// Whole segments in every lane
+		uint64_t segments = 4 * uint64_t(max(profile.Parallelism, uint32_t(1)));
+		uint64_t memory = cost / max(profile.Iterations, uint32_t(1));
+		memory = max(2 * segments, min(memory, uint64_t(MAX_ARGON2_MEMORY)));
+		scaled.Memory = uint32_t(memory - memory % segments);
+		break;
+	}
+	}
+
+	return scaled;
+}
+
+bool Kdf::Derive(
+	Cryptography& cryptography,
+	const OSPKdfProfile& profile,
+	const byte* const data,
+	size_t dsize,
+	byte* const derived,
+	size_t size,
+	OSPError* error
+) {
+	if (!Valid(profile))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	const byte* salt = (const byte*)SALT;
+	size_t slen = strlen(SALT);
+
+	switch (profile.Kdf)
+	{
+	case OSP_KDF_PBKDF2:
+		return Pbkdf2(cryptography, data, dsize, salt, slen, profile.Iterations, derived, size, error);
+
+	case OSP_KDF_SCRYPT:
+		return Scrypt(
+			data, dsize, salt, slen, profile.Memory, profile.BlockSize, profile.Parallelism, derived, size, error
+		);
+
+	case OSP_KDF_ARGON2ID:
+		return Argon2id(
+			data, dsize, salt, slen, nullptr, 0, nullptr, 0,
+			profile.Iterations, profile.Memory, profile.Parallelism, derived, size, error
+		);
+	}
+
+	// The legacy chain is the store's own
+	return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+}
+
+bool Expansion::Begin(const byte* const key, size_t ksize, OSPError* error)
+{
+	static const char LABEL[LABEL_SIZE + 1] = "OneStrongPassword expansion";
+
+	if (!key || !ksize)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	if (cryptography.HashSize(error) != HashSession::MAX_HASH_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	if (!pads.Data())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+
+	if (!session.Begin(error))
+		return false;
+
+	byte* inner = this->inner();
+	byte* outer = this->outer();
+
+	byte* padded = outer;
+	memset(padded, 0, PAD_SIZE);
+
+	if (ksize > PAD_SIZE && !session.Digest(key, ksize, padded, error))
+	{
+		End(nullptr);
+		return false;
+	}
+	if (ksize <= PAD_SIZE)
+		memcpy(padded, key, ksize);
+
+	for (size_t n = 0; n < PAD_SIZE; n++)
+	{
+		inner[n] = padded[n] ^ 0x36;
+		outer[n] = padded[n] ^ 0x5c;
+	}
+
+	memcpy(inner + PAD_SIZE + 4, LABEL, LABEL_SIZE);
+	counter = 0;
+
+	return true;
+}
+
+bool Expansion::End(OSPError* error)
+{
+	OS::Zero(pads.Data(), pads.Bytes());
+	counter = 0;
+	return !session.Active() || session.End(error);
+}
+
+bool Expansion::Next(byte* const block, OSPError* error)
+{
+	if (!session.Active())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	store32be(inner() + PAD_SIZE, ++counter);
+
+	return
+		session.Digest(inner(), INNER_SIZE, outer() + PAD_SIZE, error) &&
+		session.Digest(outer(), OUTER_SIZE, block, error);
+}
+
+bool Kdf::Pbkdf2(
+	Cryptography& cryptography,
+	const byte* const password, size_t plen,
+	const byte* const salt, size_t slen,
+	uint32_t iterations,
+	byte* const derived, size_t size,
+	OSPError* error
+) {
+	const size_t HASH_SIZE = 64;
+	const size_t BLOCK_SIZE = 128;
+
+	if (!password || !derived || !size || (!salt && slen))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	if (!iterations || cryptography.HashSize(error) != HASH_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	HashSession session(cryptography);
+	if (!session.Begin(error))
+		return false;
+
+	// The inner and outer HMAC messages, each after its padded key
+	Locked<byte> inner(BLOCK_SIZE + max(slen + 4, HASH_SIZE));
+	Locked<byte> outer(BLOCK_SIZE + HASH_SIZE);
+	Locked<byte> u(2 * HASH_SIZE);
+	if (!inner.Data() || !outer.Data() || !u.Data())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+
+	byte* key = outer.Data();
+	memset(key, 0, BLOCK_SIZE);
+
+	bool success = true;
+	if (plen > BLOCK_SIZE)
+		success = session.Digest(password, plen, key, error);
+	else
+		memcpy(key, password, plen);
+
+	for (size_t n = 0; n < BLOCK_SIZE; n++)
+	{
+		inner[n] = key[n] ^ 0x36;
+		outer[n] = key[n] ^ 0x5c;
+	}
+
+	byte* t = u.Data() + HASH_SIZE;
+
+	for (uint32_t index = 1, pos = 0; success && pos < size; index++, pos += HASH_SIZE)
+	{
+		memcpy(&inner[BLOCK_SIZE], salt, slen);
+		store32be(&inner[BLOCK_SIZE + slen], index);
+
+		success =
+			session.Digest(inner.Data(), BLOCK_SIZE + slen + 4, &outer[BLOCK_SIZE], error) &&
+			session.Digest(outer.Data(), BLOCK_SIZE + HASH_SIZE, u.Data(), error);
+		memcpy(t, u.Data(), HASH_SIZE);
+
+		for (uint32_t iteration = 1; success && iteration < iterations; iteration++)
+		{
+			memcpy(&inner[BLOCK_SIZE], u.Data(), HASH_SIZE);
+			success =
+				session.Digest(inner.Data(), BLOCK_SIZE + HASH_SIZE, &outer[BLOCK_SIZE], error) &&
+				session.Digest(outer.Data(), BLOCK_SIZE + HASH_SIZE, u.Data(), error);
+			for (size_t n = 0; n < HASH_SIZE; n++)
+				t[n] ^= u[n];
+		}
+
+		if (success)
+			memcpy(derived + pos, t, min(HASH_SIZE, size - pos));
+	}
+
+	success = session.End(error) && success;
+	if (!success)
+		OS::Zero(derived, size);
+	return success;
+}
+
+bool Kdf::Scrypt(
+	const byte* const password, size_t plen,
+	const byte* const salt, size_t slen,
+	uint32_t log2n, uint32_t r, uint32_t p,
+	byte* const derived, size_t size,
+	OSPError* error
+) {
+	if (!password || !derived || !size || (!salt && slen))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	if (!Valid(Scrypt(log2n, r, p)))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	uint64_t n = uint64_t(1) << log2n;
+	size_t blocksize = 128 * size_t(r);
+
+	Locked<byte> b(blocksize * p);
+	Locked<uint32_t> v(size_t(32) * r * n);
+	Locked<uint32_t> xy(size_t(64) * r);
+	if (!b.Data() || !v.Data() || !xy.Data())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+
+	pbkdf2Sha256(password, plen, salt, slen, b.Data(), b.Bytes());
+
+	for (uint32_t i = 0; i < p; i++)
+		roMix(&b[i * blocksize], r, n, v.Data(), xy.Data(), xy.Data() + 32 * size_t(r));
+
+	pbkdf2Sha256(password, plen, b.Data(), b.Bytes(), derived, size);
+
+	return true;
+}
+
+bool Kdf::Argon2id(
+	const byte* const password, size_t plen,
+	const byte* const salt, size_t slen,
+	const byte* const secret, size_t klen,
+	const byte* const associated, size_t alen,
+	uint32_t passes, uint32_t memory, uint32_t lanes,
+	byte* const derived, size_t size,
+	OSPError* error
+) {
+	if (!password || !salt || !derived || (!secret && klen) || (!associated && alen))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	if (size < 4 || slen < 8 || !Valid(Argon2id(passes, memory, lanes)))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	Argon2Instance instance;
+	instance.Passes = passes;
+	instance.Lanes = lanes;
+	instance.SegmentLength = memory / (lanes * uint32_t(ARGON2_SLICES));
+	instance.LaneLength = instance.SegmentLength * uint32_t(ARGON2_SLICES);
+	instance.Blocks = instance.LaneLength * lanes;
+
+	Locked<uint64_t> blocks(size_t(instance.Blocks) * ARGON2_BLOCK_WORDS);
+	if (!blocks.Data())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+	instance.Memory = blocks.Data();
+
+	// The lanes of a slice only reference finished slices, so they fill at once
+	ThreadPool pool;
+	size_t threads = min(size_t(lanes), ThreadPool::MaxThreads());
+	if (threads > 1 && !pool.Start(threads, error))
+		return false;
+
+	uint8_t h0[64 + 8];
+
+	Blake2bState state;
+	blake2bInit(state, 64);
+	blake2bUpdate(state, lanes);
+	blake2bUpdate(state, uint32_t(size));
+	blake2bUpdate(state, memory);
+	blake2bUpdate(state, passes);
+	blake2bUpdate(state, ARGON2_VERSION);
+	blake2bUpdate(state, ARGON2_ID);
+	blake2bUpdate(state, uint32_t(plen));
+	blake2bUpdate(state, password, plen);
+	blake2bUpdate(state, uint32_t(slen));
+	blake2bUpdate(state, salt, slen);
+	blake2bUpdate(state, uint32_t(klen));
+	blake2bUpdate(state, secret, klen);
+	blake2bUpdate(state, uint32_t(alen));
+	blake2bUpdate(state, associated, alen);
+	blake2bFinal(state, h0);
+
+	uint8_t bytes[ARGON2_BLOCK_SIZE];
+
+	// The first two blocks of every lane
+	for (uint32_t lane = 0; lane < lanes; lane++)
+	{
+		for (uint32_t index = 0; index < 2; index++)
+		{
+			store32(h0 + 64, index);
+			store32(h0 + 68, lane);
+			blake2bLong(h0, sizeof(h0), bytes, sizeof(bytes));
+
+			uint64_t* block = &instance.Memory[(size_t(lane) * instance.LaneLength + index) * ARGON2_BLOCK_WORDS];
+			for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n++)
+				block[n] = load64(bytes + 8 * n);
+		}
+	}
+
+	for (uint32_t pass = 0; pass < passes; pass++)
+	{
+		for (uint32_t slice = 0; slice < ARGON2_SLICES; slice++)
+		{
+			if (threads > 1)
+			{
+				pool.Run(lanes, [&](size_t, size_t lane, OSPError*)
+				{
+					fillSegment(instance, pass, uint32_t(lane), slice);
+					return true;
+				});
+			}
+			else
+			{
+				for (uint32_t lane = 0; lane < lanes; lane++)
+					fillSegment(instance, pass, lane, slice);
+			}
+		}
+	}
+
+	// The last blocks of all lanes xored
+	uint64_t final[ARGON2_BLOCK_WORDS];
+	memcpy(final, &instance.Memory[size_t(instance.LaneLength - 1) * ARGON2_BLOCK_WORDS], sizeof(final));
+	for (uint32_t lane = 1; lane < lanes; lane++)
+	{
+		const uint64_t* last = &instance.Memory[
+			(size_t(lane) * instance.LaneLength + instance.LaneLength - 1) * ARGON2_BLOCK_WORDS
+		];
+		for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n++)
+			final[n] ^= last[n];
+	}
+
+	for (size_t n = 0; n < ARGON2_BLOCK_WORDS; n++)
+		store64(bytes + 8 * n, final[n]);
+	blake2bLong(bytes, sizeof(bytes), derived, size);
+
+	OS::Zero(h0, sizeof(h0));
+	OS::Zero(bytes, sizeof(bytes));
+	OS::Zero((uint8_t*)final, sizeof(final));
+
+	return true;
+}
+
+void Kdf::Blake2b(const byte* const data, size_t dsize, byte* const hash, size_t size)
+{
+	Blake2bState state;
+	blake2bInit(state, size);
+	blake2bUpdate(state, data, dsize);
+	blake2bFinal(state, hash);
+}
+
+void Kdf::Sha256(const byte* const data, size_t dsize, byte* const hash)
+{
+	Sha256State state;
+	sha256Init(state);
+	sha256Update(state, data, dsize);
+	sha256Final(state, hash);
+}
+
+#pragma endregion
@@ -0,0 +1,154 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+#include "osp.h"
+
+#include <stdint.h>
+
+#include "hashsession.h"
+#include "os.h"
+
+namespace OneStrongPassword
+{
+	class Cryptography;
+
+	// The key derivation functions a SecureStore's StrongHash can stretch with,
+	// other than its own legacy chain. Each runs with the cost a profile gives
+	// it, so a profile reproduces what it derived on any machine.
+	class Kdf
+	{
+	public:
+		typedef OS::byte byte;
+
+		// Salt of every derivation, the strong mnemonic is the secret
+		static const char* const SALT;
+
+		static const uint32_t MAX_SCRYPT_LOG2_N = 24;
+		static const uint32_t MAX_ARGON2_MEMORY = 4 * 1024 * 1024;
+		static const uint32_t MAX_ARGON2_LANES = 255;
+
+		// Fewest iterations Scaled gives the legacy chain or PBKDF2
+		static const uint32_t MIN_SCALED_ITERATIONS = 1000;
+
+		// Profiles with the given costs
+		static OSPKdfProfile Legacy(uint32_t rounds = 20000);
+		static OSPKdfProfile Pbkdf2(uint32_t iterations);
+		static OSPKdfProfile Scrypt(uint32_t log2n, uint32_t r, uint32_t p);
+		static OSPKdfProfile Argon2id(uint32_t passes, uint32_t memory, uint32_t lanes);
+
+		static bool Valid(const OSPKdfProfile& profile);
+
+		// What a derivation with profile costs, in the parameter calibration
+		// scales: iterations for the legacy chain and PBKDF2, KiB of memory filled
+		// for scrypt and KiB times passes for Argon2id
+		static uint64_t Cost(const OSPKdfProfile& profile);
+
+		// Profile like the one given with its cost scaled to about cost, kept valid.
+		// Iterations are at least MIN_SCALED_ITERATIONS, legacy ones rounded up to
+		// even so the chain runs in whole pairs, though odd counts are valid too.
+		static OSPKdfProfile Scaled(const OSPKdfProfile& profile, uint64_t cost);
+
+		// Derives size bytes from data with a profile other than the legacy one
+		static bool Derive(
+			Cryptography& cryptography,
+			const OSPKdfProfile& profile,
+			const byte* const data,
+			size_t dsize,
+			byte* const derived,
+			size_t size,
+			OSPError* error = nullptr
+		);
+
+		// RFC 8018, HMAC with the cryptography's SHA-512
+		static bool Pbkdf2(
+			Cryptography& cryptography,
+			const byte* const password, size_t plen,
+			const byte* const salt, size_t slen,
+			uint32_t iterations,
+			byte* const derived, size_t size,
+			OSPError* error = nullptr
+		);
+
+		// RFC 7914
+		static bool Scrypt(
+			const byte* const password, size_t plen,
+			const byte* const salt, size_t slen,
+			uint32_t log2n, uint32_t r, uint32_t p,
+			byte* const derived, size_t size,
+			OSPError* error = nullptr
+		);
+
+		// RFC 9106, memory in KiB. The lanes of each slice are filled in parallel,
+		// on up to one thread per lane.
+		static bool Argon2id(
+			const byte* const password, size_t plen,
+			const byte* const salt, size_t slen,
+			const byte* const secret, size_t klen,
+			const byte* const associated, size_t alen,
+			uint32_t passes, uint32_t memory, uint32_t lanes,
+			byte* const derived, size_t size,
+			OSPError* error = nullptr
+		);
+
+		// Digests the functions above are built on, up to 64 and 32 bytes
+		static void Blake2b(const byte* const data, size_t dsize, byte* const hash, size_t size);
+		static void Sha256(const byte* const data, size_t dsize, byte* const hash);
+	};
+
+	// An endless stream of hash size blocks from one stretched key, HMAC with
+	// the cryptography's SHA-512 in counter mode (NIST SP 800-108). The key is
+	// only kept as its padded HMAC keys, zeroed by End.
+	class Expansion
+	{
+	public:
+		typedef OS::byte byte;
+
+		explicit Expansion(Cryptography& cryptography)
+			: cryptography(cryptography), session(cryptography), pads(INNER_SIZE + OUTER_SIZE) { }
+		virtual ~Expansion() { End(nullptr); }
+
+		bool Begin(const byte* const key, size_t ksize, OSPError* error = nullptr);
+		bool End(OSPError* error = nullptr);
+
+		// The next block, hash size bytes
+		bool Next(byte* const block, OSPError* error = nullptr);
+
+		uint32_t Blocks() const { return counter; }
+
+	private:
+		static const size_t PAD_SIZE = 128;
+		static const size_t LABEL_SIZE = 27;
+		static const size_t INNER_SIZE = PAD_SIZE + 4 + LABEL_SIZE;
+		static const size_t OUTER_SIZE = PAD_SIZE + HashSession::MAX_HASH_SIZE;
+
+		byte* inner() { return pads.Data(); }
+		byte* outer() { return pads.Data() + INNER_SIZE; }
+
+		Cryptography& cryptography;
+		HashSession session;
+		uint32_t counter = 0;
+
+		// The messages of the inner and outer hash, each after its padded key
+		Locked<byte> pads;
+	};
+}
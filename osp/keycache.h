@@ -0,0 +1,184 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+#include "osp.h"
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+#include "os.h"
+
+namespace OneStrongPassword
+{
+	// Key schedules made from Completed ciphers' key blobs, so repeated
+	// operations with the same cipher skip importing or expanding its key.
+	// Entries are matched by the whole blob, kept in locked memory and compared
+	// in constant time. The least recently used one is evicted when full, and
+	// evicting destroys the key and zeroes the blob.
+	// A key is leased to one operation at a time, Key needs a Destroy().
+	template <typename Key>
+	class KeyCache
+	{
+	public:
+		typedef OS::byte byte;
+
+		static const size_t SLOTS = 8;
+
+		KeyCache() { }
+		~KeyCache() { Clear(); }
+
+		KeyCache(const KeyCache&) = delete;
+		KeyCache& operator=(const KeyCache&) = delete;
+
+		size_t Hits() const { return hits; }
+		size_t Misses() const { return misses; }
+
+		// Leases the key for blob, made by make(key) on a miss. Returns nullptr
+		// when the key is leased already, every slot is leased or make fails, the caller
+		// then makes a key of its own.
+		template <typename Make>
+		Key* Lease(const byte* const blob, size_t size, Make make)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			Entry* victim = nullptr;
+			for (Entry& entry : entries)
+			{
+				if (entry.Matches(blob, size))
+				{
+					if (!entry.Leased)
+					{
+						hits++;
+						return Take(entry);
+					}
+					victim = nullptr;
+					break;
+				}
+
+				if (!entry.Leased && (!victim || entry.Used < victim->Used))
+					victim = &entry;
+			}
+
+			misses++;
+
+			if (!victim)
+				return nullptr;
+
+			Evict(*victim);
+			if (!victim->Blob.Reset(size))
+				return nullptr;
+
+			if (!make(victim->Schedule))
+			{
+				victim->Blob.Reset(0);
+				return nullptr;
+			}
+
+			memcpy(victim->Blob.Data(), blob, size);
+			return Take(*victim);
+		}
+
+		void Return(Key* key)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (Entry& entry : entries)
+			{
+				if (&entry.Schedule == key)
+				{
+					entry.Leased = false;
+					if (entry.Stale)
+						Evict(entry);
+				}
+			}
+		}
+
+		// Drops the key for blob, its cipher is being zeroed
+		void Evict(const byte* const blob, size_t size)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (Entry& entry : entries)
+			{
+				if (!entry.Matches(blob, size))
+					continue;
+				if (entry.Leased)
+					entry.Stale = true;
+				else
+					Evict(entry);
+			}
+		}
+
+		void Clear()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (Entry& entry : entries)
+				Evict(entry);
+		}
+
+	private:
+		typedef struct Entry
+		{
+			Key Schedule;
+			Locked<byte> Blob;
+			size_t Used = 0;
+			bool Leased = false;
+			bool Stale = false;
+
+			bool Matches(const byte* const blob, size_t size) const
+			{
+				if (!Blob.Data() || Blob.Bytes() != size)
+					return false;
+
+				// The blob is key material, so every byte is compared
+				byte diff = 0;
+				for (size_t n = 0; n < size; n++)
+					diff |= Blob[n] ^ blob[n];
+				return diff == 0;
+			}
+		} Entry;
+
+		Key* Take(Entry& entry)
+		{
+			entry.Leased = true;
+			entry.Used = ++clock;
+			return &entry.Schedule;
+		}
+
+		void Evict(Entry& entry)
+		{
+			if (entry.Blob.Data())
+			{
+				entry.Schedule.Destroy();
+				entry.Blob.Reset(0);
+			}
+			entry.Stale = false;
+		}
+
+		std::mutex lock;
+		Entry entries[SLOTS];
+		size_t clock = 0;
+
+		std::atomic<size_t> hits { 0 };
+		std::atomic<size_t> misses { 0 };
+	};
+}
@@ -0,0 +1,162 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+#include "osp.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OneStrongPassword
+{
+	// Open addressing index of values by name. A name is hashed once per
+	// operation, probing walks only the packed hashes and compares names only
+	// when the hashes match, and lookups take a string_view so callers never
+	// build a std::string. Erasing shifts the rest of the probe run back, so
+	// no tombstones build up.
+	template <typename T>
+	class NameIndex
+	{
+	public:
+		static const size_t NONE = size_t(-1);
+
+		// Never 0, an empty slot's hash
+		static size_t Hash(std::string_view name)
+		{
+			size_t hash = std::hash<std::string_view>()(name);
+			return hash ? hash : 1;
+		}
+
+		size_t Size() const { return count; }
+
+		// Slot holding name, NONE if it is not indexed
+		size_t Find(std::string_view name, size_t hash) const
+		{
+			if (!count)
+				return NONE;
+
+			size_t mask = hashes.size() - 1;
+			for (size_t slot = hash & mask; hashes[slot]; slot = (slot + 1) & mask)
+			{
+				if (hashes[slot] == hash && slots[slot].Name == name)
+					return slot;
+			}
+			return NONE;
+		}
+
+		// Slot holding name, a new value initialized one if it was not indexed
+		size_t Insert(std::string_view name, size_t hash, bool& inserted)
+		{
+			size_t slot = Find(name, hash);
+			inserted = (slot == NONE);
+			if (inserted)
+			{
+				if ((count + 1) * 4 > hashes.size() * 3)
+					Grow();
+
+				size_t mask = hashes.size() - 1;
+				for (slot = hash & mask; hashes[slot]; slot = (slot + 1) & mask);
+
+				hashes[slot] = hash;
+				slots[slot].Name.assign(name.data(), name.size());
+				slots[slot].Value = T();
+				count++;
+			}
+			return slot;
+		}
+
+		T& Value(size_t slot) { return slots[slot].Value; }
+		const T& Value(size_t slot) const { return slots[slot].Value; }
+
+		void Erase(size_t slot)
+		{
+			size_t mask = hashes.size() - 1;
+
+			// Entries further along the run move into the hole unless that would
+			// put them before their home slot
+			size_t hole = slot;
+			for (size_t next = (hole + 1) & mask; hashes[next]; next = (next + 1) & mask)
+			{
+				size_t home = hashes[next] & mask;
+				if (((next - home) & mask) >= ((next - hole) & mask))
+				{
+					hashes[hole] = hashes[next];
+					slots[hole] = std::move(slots[next]);
+					hole = next;
+				}
+			}
+
+			hashes[hole] = 0;
+			slots[hole] = Slot();
+			count--;
+		}
+
+		template <typename F>
+		void ForEach(F each)
+		{
+			for (size_t slot = 0; slot < hashes.size(); slot++)
+			{
+				if (hashes[slot])
+					each(slots[slot].Value);
+			}
+		}
+
+		void Clear()
+		{
+			hashes.clear();
+			slots.clear();
+			count = 0;
+		}
+
+	private:
+		typedef struct Slot { std::string Name; T Value; } Slot;
+
+		// Moves every entry by its kept hash, names are never hashed again
+		void Grow()
+		{
+			std::vector<size_t> oldhashes(hashes.size() ? 2 * hashes.size() : 16, 0);
+			std::vector<Slot> oldslots(oldhashes.size());
+			oldhashes.swap(hashes);
+			oldslots.swap(slots);
+
+			size_t mask = hashes.size() - 1;
+			for (size_t old = 0; old < oldhashes.size(); old++)
+			{
+				if (!oldhashes[old])
+					continue;
+
+				size_t slot = oldhashes[old] & mask;
+				while (hashes[slot])
+					slot = (slot + 1) & mask;
+
+				hashes[slot] = oldhashes[old];
+				slots[slot] = std::move(oldslots[old]);
+			}
+		}
+
+		std::vector<size_t> hashes;
+		std::vector<Slot> slots;
+		size_t count = 0;
+	};
+}
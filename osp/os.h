@@ -23,6 +23,8 @@ Software.
 #pragma once
 
 #include "osp.h"
+#include <atomic>
+#include <new>
 #include <string>
 
 namespace OneStrongPassword
@@ -39,6 +41,10 @@ namespace OneStrongPassword
 		static byte* Zero(byte* const data, size_t size);
 		static bool Zeroed(const byte* const data, size_t size);
 
+		// Keeps data out of the page file, best effort
+		static bool LockMemory(void* const data, size_t size);
+		static void UnlockMemory(void* const data, size_t size);
+
 		static int32_t Show(
 			char* const data, size_t size, size_t width, const std::string& title, uint32_t type, OSPError* error
 		);
@@ -53,8 +59,18 @@ namespace OneStrongPassword
 		virtual ~OS() { Destroy(nullptr); }
 
 		size_t AvailableMemory() const { return _available - _memory; }
+#ifdef _DEBUG
+		// Available memory as the calling thread sees it, for memory checks
+		size_t ThreadAvailableMemory() const { return _available - THREAD_MEMORY; }
+#endif
 		size_t MaxDataSize() const { return _maxdatasize; }
 
+		// Allocations made from the heap since it was initialized, for benchmarks
+		size_t Allocations() const { return _allocations; }
+
+		// Whether every block handed out so far sits in locked memory
+		bool MemoryLocked() const;
+
 		bool Initialize(size_t count, size_t maxsize, OSPError* error)
 			{ return Initialize(count, maxsize, 0, error); }
 
@@ -75,9 +91,53 @@ namespace OneStrongPassword
 
 		size_t _maxdatasize = 0;
 		size_t _available = 0;
-		size_t _memory = 0;
+		std::atomic<size_t> _memory { 0 };
+		std::atomic<size_t> _allocations { 0 };
 
 		void* heap = NULL;
 	};
 
+	// Memory kept out of the page file where the system allows and zeroed when
+	// freed, for secrets that live outside a secure store
+	template <typename T>
+	class Locked
+	{
+	public:
+		Locked() { }
+		explicit Locked(size_t count) { Reset(count); }
+
+		~Locked() { Reset(0); }
+
+		Locked(const Locked&) = delete;
+		Locked& operator=(const Locked&) = delete;
+
+		// Zeroes and frees the items, then allocates count new ones, none for 0
+		bool Reset(size_t count)
+		{
+			if (items)
+			{
+				OS::Zero((OS::byte*)items, Bytes());
+				if (locked)
+					OS::UnlockMemory(items, Bytes());
+				delete[] items;
+			}
+
+			items = count ? new (std::nothrow) T[count] : nullptr;
+			this->count = items ? count : 0;
+			locked = items && OS::LockMemory(items, Bytes());
+			return items || !count;
+		}
+
+		      T* Data()       { return items; }
+		const T* Data() const { return items; }
+		size_t Bytes() const { return count * sizeof(T); }
+
+		      T& operator[](size_t n)       { return items[n]; }
+		const T& operator[](size_t n) const { return items[n]; }
+
+	private:
+		T* items = nullptr;
+		size_t count = 0;
+		bool locked = false;
+	};
 }
@@ -24,6 +24,7 @@ Software.
 
 #ifdef _DEBUG
 
-int EXPOSURE_COUNT = 0;
+thread_local int EXPOSURE_COUNT = 0;
+thread_local size_t THREAD_MEMORY = 0;
 
 #endif
@@ -21,18 +21,27 @@ Software.
 */
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include <assert.h>
 
 #ifdef _DEBUG
 
-extern int EXPOSURE_COUNT;
+// Counted per thread, so callers on different threads do not see each other's exposures
+extern thread_local int EXPOSURE_COUNT;
 
 #define INCREASE_EXPOSURE (++EXPOSURE_COUNT)
 #define DECREASE_EXPOSURE (EXPOSURE_COUNT--)
 
 #define CLEAR_EXPOSURE (EXPOSURE_COUNT = 0)
 
+// Secure memory the thread holds, so memory checks only count a thread's own
+// allocations and other threads sharing the heap do not upset them
+extern thread_local size_t THREAD_MEMORY;
+
+#define COUNT_MEMORY(size) (THREAD_MEMORY += (size))
+#define UNCOUNT_MEMORY(size) (THREAD_MEMORY -= (size))
+
 #define BEGIN_MEMORY_CHECK(size) size_t _MEMORY_CHECK_ = (size);
 #define END_MEMORY_CHECK(size) assert(_MEMORY_CHECK_ == (size));
 
@@ -45,6 +54,9 @@ extern int EXPOSURE_COUNT;
 
 #define CLEAR_EXPOSURE
 
+#define COUNT_MEMORY(size)
+#define UNCOUNT_MEMORY(size)
+
 #define BEGIN_MEMORY_CHECK(size)
 #define END_MEMORY_CHECK(size)
 
@@ -91,6 +103,74 @@ CLEAR_OSPError(error)
 #define OSP_ERROR_STRONG_PASSWORD_ENTRY_FULL             (uint32_t(0x10))
 #define OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS   (uint32_t(0x11))
 #define OSP_ERROR_TIMEOUT                                (uint32_t(0x12))
+#define OSP_ERROR_INVALID_KDF_PROFILE                    (uint32_t(0x13))
+#define OSP_ERROR_DATA_NOT_AUTHENTIC                     (uint32_t(0x14))
+#define OSP_ERROR_MALFORMED_CIPHERTEXT                   (uint32_t(0x15))
+
+#define OSP_PADDING_MAX_DATA_SIZE (uint32_t(0x00))
+#define OSP_PADDING_SIZE_CLASS    (uint32_t(0x01))
+
+// How entries are encrypted, every entry keeps the one it was stored with
+#define OSP_STORAGE_CBC (uint32_t(0x00))
+#define OSP_STORAGE_GCM (uint32_t(0x01))
+
+#define OSP_KDF_LEGACY   (uint32_t(0x00))
+#define OSP_KDF_PBKDF2   (uint32_t(0x01))
+#define OSP_KDF_SCRYPT   (uint32_t(0x02))
+#define OSP_KDF_ARGON2ID (uint32_t(0x03))
+
+#define OSP_KDF_PROFILE_VERSION (uint32_t(0x01))
+
+// How more bytes are had when a password runs out of hash
+#define OSP_EXPANSION_LEGACY  (uint32_t(0x00))
+#define OSP_EXPANSION_COUNTER (uint32_t(0x01))
+
+// How hash bytes are mapped to password characters
+#define OSP_GENERATOR_LEGACY       (uint32_t(0x00))
+#define OSP_GENERATOR_UNIFORM      (uint32_t(0x01))
+#define OSP_GENERATOR_CONSTRUCTIVE (uint32_t(0x02))
+
+// Latencies in milliseconds a calibrated profile can be made to take
+#define OSP_KDF_TARGET_INTERACTIVE (uint32_t(250))
+#define OSP_KDF_TARGET_BATCH       (uint32_t(50))
+
+// How strong mnemonics are stretched into the hashes passwords are taken from.
+// A password is only reproduced with the profile it was generated with.
+//   Legacy    Iterations chained hashes
+//   PBKDF2    Iterations of HMAC-SHA512
+//   scrypt    Memory is log2 N, BlockSize is r, Parallelism is p
+//   Argon2id  Iterations passes over Memory KiB in Parallelism lanes
+// Expansion is how a hash is extended, strong hashing it again for
+// OSP_EXPANSION_LEGACY or a cheap counter mode stream for OSP_EXPANSION_COUNTER.
+// Generator is how characters are taken from it, a byte at a time kept when
+// the recipe has it for OSP_GENERATOR_LEGACY, or just enough bits to index the
+// recipe's alphabet, rejecting indexes past it, for OSP_GENERATOR_UNIFORM.
+// OSP_GENERATOR_CONSTRUCTIVE samples the same way, then puts a character of
+// every required class at its own position drawn from the hash, instead of
+// retrying until the password happens to meet the recipe.
+typedef struct OSPKdfProfile
+{
+	uint32_t Version;
+	uint32_t Kdf;
+	uint32_t Iterations;
+	uint32_t Memory;
+	uint32_t Parallelism;
+	uint32_t BlockSize;
+	uint32_t Expansion;
+	uint32_t Generator;
+} OSPKdfProfile;
+
+#define CLEAR_OSPKdfProfile(profile) \
+profile.Version = OSP_KDF_PROFILE_VERSION;\
+profile.Kdf = OSP_KDF_LEGACY;\
+profile.Iterations = 20000;\
+profile.Memory = profile.Parallelism = profile.BlockSize = 0;\
+profile.Expansion = OSP_EXPANSION_LEGACY;\
+profile.Generator = OSP_GENERATOR_LEGACY;
+
+#define DECLARE_OSPKdfProfile(profile) \
+OSPKdfProfile profile;\
+CLEAR_OSPKdfProfile(profile)
 
 typedef struct OSPCipher {
 	void* Handle;
@@ -135,3 +215,20 @@ CLEAR_OSPRecipe(recipe)
 #define OSP_RECIPE_SPECIAL_REQUIRED   (uint32_t(0x0080))
 
 #define OSP_RECIPE_ALL_SUPPORTED_SPECIALS ("!@#$%^&*()_-+=[]{};:,.<>/?`~\\\'\"")
+
+typedef struct OSPPasswordRequest
+{
+	const char* Mnemonic;
+	size_t MnemonicLength;
+	size_t Length;
+	OSPRecipe Recipe;
+} OSPPasswordRequest;
+
+#define CLEAR_OSPPasswordRequest(request) \
+request.Mnemonic = nullptr;\
+request.MnemonicLength = request.Length = 0;\
+CLEAR_OSPRecipe(request.Recipe)
+
+#define DECLARE_OSPPasswordRequest(request) \
+OSPPasswordRequest request;\
+CLEAR_OSPPasswordRequest(request)
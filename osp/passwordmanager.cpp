@@ -115,7 +115,25 @@ bool PasswordManager::Initialize(size_t count, size_t length, OSPError* error)
 	// Add to count for
 	// - password buffer
 
-	return store.Initialize(count + 1, length * sizeof(char), error);
+	bool success = store.Initialize(count + 1, length * sizeof(char), error);
+
+	if (success && calibrationTarget)
+	{
+		success = store.CalibrateKdf(calibrationFunction, calibrationTarget, error);
+		calibrationTarget = 0;
+	}
+
+	return success;
+}
+
+bool PasswordManager::KdfCalibration(uint32_t function, uint32_t milliseconds, OSPError* error)
+{
+	if (function > OSP_KDF_ARGON2ID)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	calibrationFunction = function;
+	calibrationTarget = milliseconds;
+	return true;
 }
 
 bool PasswordManager::Reset(size_t count, size_t length, OSPError* error)
@@ -126,6 +144,7 @@ bool PasswordManager::Reset(size_t count, size_t length, OSPError* error)
 bool PasswordManager::Destroy(OSPError* error)
 {
 	bool success = strongPassword.Destroy();
+	pool.Stop();
 	success = store.Destroy(error) && success;
 	strongPassword.Zero();
 	strongPasswordLength = 0;
@@ -168,13 +187,13 @@ bool PasswordManager::ZeroCipher(OSPCipher& cipher, OSPError* error) const
 	return Cipher(store, cipher).Zero(error);
 }
 
-size_t PasswordManager::DataSize(const string& name) const
+size_t PasswordManager::DataSize(string_view name) const
 {
 	return store.DataSize(name);
 }
 
 bool PasswordManager::Store(
-	const string& name, const OSPCipher& ospCipher, char* const password, size_t length, OSPError* error
+	string_view name, const OSPCipher& ospCipher, char* const password, size_t length, OSPError* error
 ) {
 	Cipher cipher(store, const_cast<OSPCipher&>(ospCipher));
 	PasswordVector buffer(nullptr, password, length * sizeof(char));
@@ -182,7 +201,7 @@ bool PasswordManager::Store(
 }
 
 bool PasswordManager::Dispense(
-	const string& name, OSPCipher& ospCipher, char* const password, size_t length, OSPError* error
+	string_view name, OSPCipher& ospCipher, char* const password, size_t length, OSPError* error
 ) {
 	Cipher cipher(store, ospCipher);
 	PasswordVector buffer(nullptr, password, length * sizeof(char));
@@ -192,7 +211,7 @@ bool PasswordManager::Dispense(
 	return success;
 }
 
-bool PasswordManager::Destroy(const string& name, OSPError* error)
+bool PasswordManager::Destroy(string_view name, OSPError* error)
 {
 	return store.DestroyData(name, error);
 }
@@ -230,7 +249,7 @@ bool PasswordManager::StrongPasswordPut(char ch, OSPError* error)
 	return true;
 }
 
-bool PasswordManager::StrongPasswordFinish(const string& name, OSPCipher & cipher, OSPError* error)
+bool PasswordManager::StrongPasswordFinish(string_view name, OSPCipher & cipher, OSPError* error)
 {
 	if (!strongPassword.Size() || strongPassword.Zeroed())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_STRONG_PASSWORD_ENTRY_NOT_STARTED);
@@ -246,7 +265,7 @@ bool PasswordManager::StrongPasswordAbort(OSPError* error)
 }
 
 int PasswordManager::ShowStrongPassword(
-	const std::string& name, OSPCipher& ospCipher, size_t width, const std::string& title, uint32_t type, OSPError* error
+	string_view name, OSPCipher& ospCipher, size_t width, const std::string& title, uint32_t type, OSPError* error
 ) {
 	size_t size = DataSize(name);
 	if (!size)
@@ -273,7 +292,7 @@ int PasswordManager::ShowStrongPassword(
 }
 
 bool PasswordManager::GeneratePassword(
-	const string& name,
+	string_view name,
 	const string& mnemonic,
 	const OSPCipher& ospCipher,
 	PasswordVector& password,
@@ -288,8 +307,87 @@ bool PasswordManager::GeneratePassword(
 	) && strongPassword.Release();
 }
 
+size_t PasswordManager::PasswordsLength(const OSPPasswordRequest* const requests, size_t count)
+{
+	size_t length = 0;
+	for (size_t n = 0; n < count; n++)
+	{
+		// No room left for the password and its terminator
+		if (requests[n].Length >= SIZE_MAX - length)
+			return SIZE_MAX;
+		length += requests[n].Length + 1;
+	}
+	return length;
+}
+
+bool PasswordManager::GeneratePasswords(
+	string_view name,
+	const OSPCipher& ospCipher,
+	const OSPPasswordRequest* const requests,
+	size_t count,
+	PasswordVector& passwords,
+	OSPError* error
+) {
+	if (!count)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_SIZE_IS_0);
+
+	// SIZE_MAX when the lengths wrap, a Length of SIZE_MAX among them
+	size_t length = PasswordsLength(requests, count);
+	if (length == SIZE_MAX || length > passwords.MaxLength())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	vector<string> mnemonics;
+	vector<size_t> lengths;
+	vector<Recipe> recipes;
+	deque<PasswordVector> views;
+
+	mnemonics.reserve(count);
+	lengths.reserve(count);
+	recipes.reserve(count);
+
+	size_t offset = 0;
+	for (size_t n = 0; n < count; n++)
+	{
+		const OSPPasswordRequest& request = requests[n];
+		mnemonics.push_back(string(request.Mnemonic, strnlen(request.Mnemonic, request.MnemonicLength)));
+		lengths.push_back(request.Length);
+		recipes.push_back(request.Recipe);
+		assert(offset + request.Length + 1 <= passwords.Size());
+		views.emplace_back(nullptr, &passwords[offset], request.Length + 1);
+		offset += request.Length + 1;
+	}
+
+	vector<const Recipe*> precipes;
+	vector<PasswordVector*> pviews;
+	for (size_t n = 0; n < count; n++)
+	{
+		precipes.push_back(&recipes[n]);
+		pviews.push_back(&views[n]);
+	}
+
+	StrongPassword strongPassword(store, name);
+	Cipher cipher(store, const_cast<OSPCipher&>(ospCipher));
+
+	bool success = strongPassword.GeneratePasswords(
+		mnemonics, cipher, pviews.data(), lengths.data(), precipes.data(), pool, error
+	) && strongPassword.Release();
+
+	// The views are exposed one by one, hand the buffer back as a single exposure
+	if (success)
+	{
+		for (auto& view : views)
+		{
+			view.Release(error);
+			DECREASE_EXPOSURE;
+		}
+		INCREASE_EXPOSURE;
+	}
+
+	return success;
+}
+
 bool PasswordManager::PasswordToClipboard(
-	const string& name,
+	string_view name,
 	const string& mnemonic,
 	const OSPCipher& cipher,
 	size_t length,
@@ -312,7 +410,7 @@ bool PasswordManager::PasswordToClipboard(
 }
 
 int32_t PasswordManager::ShowPassword(
-	const string& name,
+	string_view name,
 	const string& mnemonic,
 	const OSPCipher& cipher,
 	size_t length,
@@ -24,6 +24,7 @@ Software.
 
 #include "securestore.h"
 #include "password.h"
+#include "strongpassword.h"
 
 namespace OneStrongPassword
 {
@@ -32,6 +33,10 @@ namespace OneStrongPassword
 	public:
 		typedef SecureStore::byte byte;
 		
+		// Length GeneratePasswords needs, each password followed by a terminator.
+		// SIZE_MAX when that does not fit in a size_t.
+		static size_t PasswordsLength(const OSPPasswordRequest* const requests, size_t count);
+
 		static size_t AddSeperators(
 			const PasswordVector& src,
 			PasswordVector& dst,
@@ -47,14 +52,43 @@ namespace OneStrongPassword
 
 		size_t BlockLength(OSPError* error) const { return store.BlockSize(error) / sizeof(char); }
 		size_t MinLength() const { return store.MinDataSize() / sizeof(char); }
-		size_t MaxLength() const { return store.MaxDataSize() / sizeof(char); }
+		size_t MaxLength() const { return store.MaxEntryDataSize() / sizeof(char); }
 
 		bool Destroyed() const { return store.AvailableMemory() <= 0; }
 
+		uint32_t Padding() const { return store.Padding(); }
+		void Padding(uint32_t padding) { store.Padding(padding); }
+
+		uint32_t Storage() const { return store.Storage(); }
+		void Storage(uint32_t storage) { store.Storage(storage); }
+
+		const OSPKdfProfile& KdfProfile() const { return store.KdfProfile(); }
+		bool KdfProfile(const OSPKdfProfile& profile, OSPError* error) { return store.KdfProfile(profile, error); }
+
+		// Has the next Initialize calibrate the profile to take about milliseconds
+		// with function, one of the OSP_KDF values. Done once, so the profile does
+		// not change under passwords already generated, 0 milliseconds cancels it.
+		bool KdfCalibration(uint32_t function, uint32_t milliseconds, OSPError* error);
+
+		bool CalibrateKdf(uint32_t function, uint32_t milliseconds, OSPError* error)
+			{ return store.CalibrateKdf(function, milliseconds, error); }
+
+		uint64_t KdfRate() const { return store.KdfRate(); }
+
+		size_t KeyCacheHits() const { return store.KeyCacheHits(); }
+		size_t KeyCacheMisses() const { return store.KeyCacheMisses(); }
+
 		bool Initialize(size_t count, size_t length, OSPError* error);
 		bool Reset(size_t count, size_t length, OSPError* error);
 		bool Destroy(OSPError* error);
 
+		// Threads GeneratePasswords spreads its work across, none until started
+
+		size_t Threads() const { return pool.Threads(); }
+
+		bool StartThreads(size_t threads, OSPError* error) { return pool.Start(threads, error); }
+		void StopThreads() { pool.Stop(); }
+
 		// Cipher
 
 		bool CipherPrepared(const OSPCipher& cipher) const;
@@ -68,10 +102,10 @@ namespace OneStrongPassword
 
 		// Strong Password
 
-		size_t DataSize(const std::string& name) const;
+		size_t DataSize(std::string_view name) const;
 
 		bool Store(
-			const std::string& name,
+			std::string_view name,
 			const OSPCipher& cipher,
 			char* const password,
 			size_t length,
@@ -79,22 +113,22 @@ namespace OneStrongPassword
 		);
 
 		bool Dispense(
-			const std::string& name,
+			std::string_view name,
 			OSPCipher& cipher,
 			char* const password,
 			size_t length,
 			OSPError* error
 		);
 
-		bool Destroy(const std::string& name, OSPError* error);
+		bool Destroy(std::string_view name, OSPError* error);
 
 		bool StrongPasswordStart(size_t length, OSPError* error);
 		bool StrongPasswordPut(char ch, OSPError* error);
-		bool StrongPasswordFinish(const std::string& name, OSPCipher& cipher, OSPError* error);
+		bool StrongPasswordFinish(std::string_view name, OSPCipher& cipher, OSPError* error);
 		bool StrongPasswordAbort(OSPError* error);
 
 		int ShowStrongPassword(
-			const std::string& name,
+			std::string_view name,
 			OSPCipher& cipher,
 			size_t width,
 			const std::string& title,
@@ -105,7 +139,7 @@ namespace OneStrongPassword
 		// Generate Password
 
 		bool GeneratePassword(
-			const std::string& name,
+			std::string_view name,
 			const std::string& mnemonic,
 			const OSPCipher& cipher,
 			PasswordVector& password,
@@ -114,8 +148,17 @@ namespace OneStrongPassword
 			OSPError* error
 		);
 
+		bool GeneratePasswords(
+			std::string_view name,
+			const OSPCipher& cipher,
+			const OSPPasswordRequest* const requests,
+			size_t count,
+			PasswordVector& passwords,
+			OSPError* error
+		);
+
 		bool PasswordToClipboard(
-			const std::string& name,
+			std::string_view name,
 			const std::string& mnemonic,
 			const OSPCipher& cipher,
 			size_t length,
@@ -124,7 +167,7 @@ namespace OneStrongPassword
 		);
 
 		int32_t ShowPassword(
-			const std::string& name,
+			std::string_view name,
 			const std::string& mnemonic,
 			const OSPCipher& cipher,
 			size_t length,
@@ -142,7 +185,11 @@ namespace OneStrongPassword
 		static size_t SeperatedBlocksNeeded(size_t length);
 
 		SecureStore store;
+		PasswordPool pool;
 		PasswordVector strongPassword;
 		size_t strongPasswordLength;
+
+		uint32_t calibrationFunction = OSP_KDF_LEGACY;
+		uint32_t calibrationTarget = 0;
 	};
 }
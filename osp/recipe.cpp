@@ -1,85 +1,261 @@
 #include "recipe.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define OSP_RECIPE_SIMD
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OSP_TARGET(isa)
+#else
+#define OSP_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 using namespace OneStrongPassword;
 using namespace std;
 
-bool Recipe::HasChar(char ch) const
-{
-	if (ch == 0)
-		return false;
+#ifdef OSP_RECIPE_SIMD
 
-	char position = ch - ' '; // ignore non-printable
-	if (position < 0)
-		return false;
+#pragma region Classification Kernels
 
-	short block = position / 32;
-	position -= block * 32;
-	return charSet[block] & 1 << position;
-}
+// Bytes are looked up by low nibble in each table, the entry holding a bit for
+// every high nibble of a member. Only ASCII bytes can be members.
 
-bool Recipe::Verified(const char* password, size_t length) const
+inline bool cpuSupports(const char* isa)
 {
-	bool numeric = !NumericRequired();
-	bool lowerCase = !LowerCaseRequired();
-	bool upperCase = !UpperCaseRequired();
-	bool special = !SpecialRequired();
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	if (strcmp(isa, "ssse3") == 0)
+		return (info[2] & (1 << 9)) != 0;
 
-	string specials;
-	if (Specials)
-		specials = Specials;
+	bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x06) == 0x06;
+	bool avx512 = avx && (_xgetbv(0) & 0xE6) == 0xE6;
+	__cpuidex(info, 7, 0);
+	if (strcmp(isa, "avx2") == 0)
+		return avx && (info[1] & (1 << 5));
+	if (strcmp(isa, "avx512bw") == 0)
+		return avx512 && (info[1] & (1 << 30));
+	return avx512 && (info[2] & (1 << 6)); // avx512vbmi2
+#else
+	if (strcmp(isa, "ssse3") == 0)
+		return __builtin_cpu_supports("ssse3");
+	if (strcmp(isa, "avx2") == 0)
+		return __builtin_cpu_supports("avx2");
+	if (strcmp(isa, "avx512bw") == 0)
+		return __builtin_cpu_supports("avx512bw");
+	return __builtin_cpu_supports("avx512vbmi2");
+#endif
+}
 
-	bool verified = numeric && lowerCase && upperCase && special;
+template<size_t tables>
+OSP_TARGET("avx2")
+size_t classify32(const uint8_t nibbles[][16], const char* text, size_t length, uint8_t& seen, uint8_t& all)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i low = _mm256_set1_epi8(0x0F);
+	const __m256i highs = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0
+	);
 
-	for (size_t n = 0; !verified && n < length; n++)
+	__m256i lookup[tables];
+	__m256i any[tables];
+	for (size_t t = 0; t < tables; t++)
 	{
-		char ch = password[n];
+		lookup[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)nibbles[t]));
+		any[t] = zero;
+	}
+	__m256i missing = zero;
 
-		numeric = numeric || (ch >= '0' && ch <= '9');
-		lowerCase = lowerCase || (ch >= 'a' && ch <= 'z');
-		upperCase = upperCase || (ch >= 'A' && ch <= 'Z');
-		special = special || (specials.find(ch) < specials.size());
+	size_t n = 0;
+	for (; n + 32 <= length; n += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(text + n));
+		__m256i lo = _mm256_and_si256(v, low);
+		__m256i bit = _mm256_shuffle_epi8(highs, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
 
-		verified = numeric && lowerCase && upperCase && special;
+		missing = _mm256_or_si256(missing,
+			_mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(lookup[0], lo), bit), zero));
+		for (size_t t = 1; t < tables; t++)
+			any[t] = _mm256_or_si256(any[t], _mm256_and_si256(_mm256_shuffle_epi8(lookup[t], lo), bit));
 	}
 
-	return verified;
+	if (!_mm256_testz_si256(missing, missing))
+		all = 0;
+	for (size_t t = 1; t < tables; t++)
+	{
+		if (!_mm256_testz_si256(any[t], any[t]))
+			seen |= uint8_t(OSP_RECIPE_NUMERIC_REQUIRED << (t - 1));
+	}
+
+	return n;
 }
 
-void Recipe::AddFlags(uint32_t flags)
+template<size_t tables>
+OSP_TARGET("ssse3")
+size_t classify16(const uint8_t nibbles[][16], const char* text, size_t length, uint8_t& seen, uint8_t& all)
 {
-	Flags |= flags;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_set1_epi8(0x0F);
+	const __m128i highs = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
 
-	if ((Flags & OSP_RECIPE_SPACE_ALLOWED))
-		setCharBitOn(' ');
-	else
-		setCharBitOff(' ');
+	__m128i lookup[tables];
+	__m128i any[tables];
+	for (size_t t = 0; t < tables; t++)
+	{
+		lookup[t] = _mm_loadu_si128((const __m128i*)nibbles[t]);
+		any[t] = zero;
+	}
+	__m128i missing = zero;
 
-	if (Flags & OSP_RECIPE_NUMERIC)
+	size_t n = 0;
+	for (; n + 16 <= length; n += 16)
 	{
-		for (char ch = '0'; ch <= '9'; ch++)
-			setCharBitOn(ch);
+		__m128i v = _mm_loadu_si128((const __m128i*)(text + n));
+		__m128i lo = _mm_and_si128(v, low);
+		__m128i bit = _mm_shuffle_epi8(highs, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+
+		missing = _mm_or_si128(missing,
+			_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(lookup[0], lo), bit), zero));
+		for (size_t t = 1; t < tables; t++)
+			any[t] = _mm_or_si128(any[t], _mm_and_si128(_mm_shuffle_epi8(lookup[t], lo), bit));
 	}
-	else
-		Flags &= ~OSP_RECIPE_NUMERIC_REQUIRED;
 
-	if (Flags & OSP_RECIPE_LOWERCASE)
+	if (_mm_movemask_epi8(missing))
+		all = 0;
+	for (size_t t = 1; t < tables; t++)
 	{
-		for (char ch = 'a'; ch <= 'z'; ch++)
-			setCharBitOn(ch);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(any[t], zero)) != 0xFFFF)
+			seen |= uint8_t(OSP_RECIPE_NUMERIC_REQUIRED << (t - 1));
 	}
-	else
-		Flags &= ~OSP_RECIPE_LOWERCASE_REQUIRED;
 
-	if (Flags & OSP_RECIPE_UPPERCASE)
+	return n;
+}
+
+#pragma endregion
+
+#pragma region Acceptance Kernels
+
+// Legacy samples are the absolute value of each byte as a char, kept when the
+// recipe has it. abs_epi8 leaves -128 as 0x80, which like abs does is never kept.
+
+// Shuffle indexes that pack the bytes of each 8 bit mask to the front
+struct Compress
+{
+	uint64_t Index[256];
+	uint8_t Count[256];
+
+	constexpr Compress() : Index(), Count()
 	{
-		for (char ch = 'A'; ch <= 'Z'; ch++)
-			setCharBitOn(ch);
+		for (size_t mask = 0; mask < 256; mask++)
+		{
+			for (uint64_t bit = 0; bit < 8; bit++)
+			{
+				if (mask >> bit & 1)
+					Index[mask] |= bit << (8 * Count[mask]++);
+			}
+		}
 	}
-	else
-		Flags &= ~OSP_RECIPE_UPPERCASE_REQUIRED;
+};
+
+static constexpr Compress COMPRESS;
 
-	if (HasChar(Seperator))
-		Seperator = 0;
+OSP_TARGET("avx2")
+size_t accept32(const uint8_t allowed[16], const uint8_t* bytes, char* const packed, uint64_t& mask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i low = _mm256_set1_epi8(0x0F);
+	const __m256i highs = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0
+	);
+	const __m256i lookup = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)allowed));
+
+	__m256i v = _mm256_abs_epi8(_mm256_loadu_si256((const __m256i*)bytes));
+	__m256i in = _mm256_and_si256(
+		_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low)),
+		_mm256_shuffle_epi8(highs, _mm256_and_si256(_mm256_srli_epi16(v, 4), low))
+	);
+	mask = uint32_t(~_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, zero)));
+
+	alignas(32) uint8_t chars[32];
+	_mm256_store_si256((__m256i*)chars, v);
+
+	size_t count = 0;
+	for (size_t group = 0; group < 4; group++)
+	{
+		size_t bits = size_t(mask >> (8 * group)) & 0xFF;
+		__m128i index = _mm_cvtsi64_si128((long long)COMPRESS.Index[bits]);
+		__m128i source = _mm_loadl_epi64((const __m128i*)(chars + 8 * group));
+		_mm_storel_epi64((__m128i*)(packed + count), _mm_shuffle_epi8(source, index));
+		count += COMPRESS.Count[bits];
+	}
+
+	_mm256_store_si256((__m256i*)chars, zero);
+	return count;
+}
+
+OSP_TARGET("avx512bw,avx512vbmi2")
+size_t accept64(const uint8_t allowed[16], const uint8_t* bytes, char* const packed, uint64_t& mask)
+{
+	const __m512i low = _mm512_set1_epi8(0x0F);
+	const __m512i highs = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m512i lookup = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)allowed));
+
+	__m512i v = _mm512_abs_epi8(_mm512_loadu_si512(bytes));
+	__m512i in = _mm512_and_si512(
+		_mm512_shuffle_epi8(lookup, _mm512_and_si512(v, low)),
+		_mm512_shuffle_epi8(highs, _mm512_and_si512(_mm512_srli_epi16(v, 4), low))
+	);
+	__mmask64 accepted = _mm512_test_epi8_mask(in, in);
+	mask = accepted;
+
+	_mm512_storeu_si512(packed, _mm512_maskz_compress_epi8(accepted, v));
+
+	size_t count = 0;
+	for (uint64_t bits = mask; bits; bits &= bits - 1)
+		count++;
+	return count;
+}
+
+#pragma endregion
+
+#endif
+
+uint32_t Recipe::Classes(const Tables& tables, const char* text, size_t length)
+{
+	uint32_t classes;
+	bool allowed;
+	scan(tables, text, length, classes, allowed);
+	return classes;
+}
+
+bool Recipe::Allowed(const char* text, size_t length) const
+{
+	uint32_t classes;
+	bool allowed;
+	scan(tables, text, length, classes, allowed);
+	return allowed;
+}
+
+size_t Recipe::ClassAlphabet(const Tables& tables, uint32_t required, char* const chars)
+{
+	size_t size = 0;
+
+	for (size_t n = 0; n < tables.AlphabetSize; n++)
+	{
+		char ch = tables.Alphabet[n];
+
+		if (tables.Table[byte(ch)] & required)
+			chars[size++] = ch;
+	}
+
+	return size;
 }
 
 void Recipe::SetSpecials(const char * specials, size_t length)
@@ -94,31 +270,158 @@ void Recipe::SetSeperator(char ch)
 
 void Recipe::Reset(const OSPRecipe & recipe)
 {
-	Clear();
 	Specials = recipe.Specials;
 	SpecialsLength = recipe.SpecialsLength;
-	Seperator = recipe.Seperator;
-	for (size_t n = 0; n < SpecialsLength; n++)
-		setCharBitOn(Specials[n]);
-	AddFlags(recipe.Flags);
+	tables = Compile(recipe.Specials, recipe.SpecialsLength, recipe.Flags, recipe.Seperator);
+	Flags = tables.Flags;
+	Seperator = tables.Seperator;
+}
+
+void Recipe::scan(const Tables& tables, const char* text, size_t length, uint32_t& classes, bool& allowed)
+{
+	byte seen = 0;
+	byte all = CLASS_ALLOWED;
+	size_t n = 0;
+
+#ifdef OSP_RECIPE_SIMD
+	static const int level = cpuSupports("avx2") ? 2 : cpuSupports("ssse3") ? 1 : 0;
+
+	if (tables.Ascii && level == 2 && length >= 32)
+		n = classify32<NIBBLE_TABLES>(tables.Nibbles, text, length, seen, all);
+	else if (tables.Ascii && level >= 1 && length >= 16)
+		n = classify16<NIBBLE_TABLES>(tables.Nibbles, text, length, seen, all);
+#endif
+
+	for (; n < length; n++)
+	{
+		byte t = tables.Table[byte(text[n])];
+		seen |= t;
+		all &= t;
+	}
+
+	classes = seen & REQUIRED;
+	allowed = all != 0;
+}
+
+Sampler::Sampler(const Recipe::Tables& tables, uint32_t generator)
+	: tables(tables), uniform(false), alphabet(nullptr), size(0)
+{
+	if (generator >= OSP_GENERATOR_UNIFORM)
+		Reset(tables.Alphabet, tables.AlphabetSize);
+}
+
+void Sampler::Feed(byte b)
+{
+	pool |= uint64_t(b) << pooled;
+	pooled += 8;
+	fed++;
+}
+
+bool Sampler::Next(char& ch)
+{
+	if (!uniform)
+	{
+		ch = abs((char)take());
+		return (tables.Table[byte(ch)] & Recipe::CLASS_ALLOWED) != 0;
+	}
+
+	size_t index;
+	if (!Next(index))
+		return false;
+
+	ch = alphabet[index];
+	return true;
+}
+
+size_t Sampler::Width()
+{
+#ifdef OSP_RECIPE_SIMD
+	static const size_t width =
+		cpuSupports("avx512bw") && cpuSupports("avx512vbmi2") ? 64 : cpuSupports("avx2") ? 32 : 1;
+	return width;
+#else
+	return 1;
+#endif
+}
+
+size_t Sampler::Accept(const byte* bytes, size_t count, char* const out, size_t room, size_t& used, size_t width)
+{
+	assert(!uniform && !pooled);
+
+	char packed[64 + 8];
+	size_t taken = 0;
+	used = 0;
+
+	while (used < count && taken < room)
+	{
+		size_t accepted = 0;
+		size_t step = 0;
+		uint64_t mask = 0;
+
+#ifdef OSP_RECIPE_SIMD
+		// Allowed characters are all ASCII, whatever the specials
+		if (width == 64 && count - used >= 64)
+			step = 64;
+		else if (width >= 32 && count - used >= 32)
+			step = 32;
+
+		if (step == 64)
+			accepted = accept64(tables.Nibbles[0], bytes + used, packed, mask);
+		else if (step == 32)
+			accepted = accept32(tables.Nibbles[0], bytes + used, packed, mask);
+#endif
+
+		if (!step)
+		{
+			char ch = abs((char)bytes[used++]);
+			if (tables.Table[byte(ch)] & Recipe::CLASS_ALLOWED)
+				out[taken++] = ch;
+			continue;
+		}
+
+		// A full password stops right after the byte that filled it
+		size_t block = accepted > room - taken ? room - taken : accepted;
+		memcpy(out + taken, packed, block);
+		taken += block;
+
+		if (taken < room)
+			used += step;
+		else
+		{
+			for (size_t n = 1; n < block; n++)
+				mask &= mask - 1;
+			size_t last = 0;
+			while (!(mask >> last & 1))
+				last++;
+			used += last + 1;
+		}
+	}
+
+	OS::Zero((byte*)packed, sizeof(packed));
+
+	fed += used;
+	return taken;
+}
+
+void Sampler::Reset(const char* alphabet, size_t size)
+{
+	uniform = true;
+	this->alphabet = alphabet;
+	this->size = size;
+	for (bits = 0; (size_t(1) << bits) < size; bits++);
+	assert(bits + 7 <= sizeof(pool) * 8);
 }
 
-void Recipe::setCharBitOn(char ch)
+bool Sampler::Next(size_t& index)
 {
-	char position = ch - ' '; // ignore non-printable
-	if (position < 0)
-		return;
-	short block = position / 32;
-	position -= block * 32;
-	charSet[block] |= 1 << position;
+	index = size_t(take());
+	return index < size;
 }
 
-void Recipe::setCharBitOff(char ch)
+uint64_t Sampler::take()
 {
-	char position = ch - ' '; // ignore non-printable
-	if (position < 0)
-		return;
-	short block = position / 32;
-	position -= block * 32;
-	charSet[block] &= ~(1 << position);
+	uint64_t sample = pool & ((uint64_t(1) << bits) - 1);
+	pool >>= bits;
+	pooled -= bits;
+	return sample;
 }
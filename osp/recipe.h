@@ -35,8 +35,47 @@ namespace OneStrongPassword
 	public:
 		typedef OS::byte byte;
 
+		// Printable characters, space up
+		static constexpr size_t MAX_ALPHABET_SIZE = 96;
+
+		static constexpr uint32_t REQUIRED =
+			OSP_RECIPE_NUMERIC_REQUIRED | OSP_RECIPE_LOWERCASE_REQUIRED |
+			OSP_RECIPE_UPPERCASE_REQUIRED | OSP_RECIPE_SPECIAL_REQUIRED;
+
+		static constexpr byte CLASS_ALLOWED = 0x01;
+
+		// Low nibble tables for the recipe and each class, a byte is in one when
+		// its entry has the bit of the byte's high nibble
+		static constexpr size_t NIBBLE_TABLES = 5;
+
+		// What a recipe is compiled to. Flags and Seperator are as the recipe
+		// keeps them, the character set is a bit per printable character, the
+		// alphabet is its characters in ascending order, and every byte's entry
+		// in the table has CLASS_ALLOWED and the *_REQUIRED flags of its classes.
+		// The nibble tables are the same for the vector kernels, which need
+		// ASCII specials.
+		struct Tables
+		{
+			uint32_t Flags = 0;
+			char Seperator = 0;
+			uint32_t CharSet[3] = { 0, 0, 0 };
+			char Alphabet[MAX_ALPHABET_SIZE] = { };
+			size_t AlphabetSize = 0;
+			byte Table[256] = { };
+			byte Nibbles[NIBBLE_TABLES][16] = { };
+			bool Ascii = true;
+		};
+
+		// Builds the tables, at compile time for a StaticRecipe
+		static constexpr Tables Compile(const char* specials, size_t length, uint32_t flags, char seperator);
+
 		Recipe() { Clear(); }
 		Recipe(const OSPRecipe& recipe) { Reset(recipe); }
+
+		// Takes tables already compiled from recipe
+		Recipe(const OSPRecipe& recipe, const Tables& tables)
+			: OSPRecipe(recipe), tables(tables) { Flags = tables.Flags; Seperator = tables.Seperator; }
+
 		virtual ~Recipe() { }
 
 		bool NumericAllowed() const { return Flags & OSP_RECIPE_NUMERIC; };
@@ -49,29 +88,249 @@ namespace OneStrongPassword
 		bool UpperCaseRequired() const { return Flags & OSP_RECIPE_UPPERCASE_REQUIRED; };
 		bool SpecialRequired() const { return Flags & OSP_RECIPE_SPECIAL_REQUIRED; };
 
-		bool Cleared() const { return OS::Zeroed((byte*)charSet, sizeof(charSet)); }
-		bool HasChar(char ch) const;
+		bool Cleared() const { return OS::Zeroed((byte*)tables.CharSet, sizeof(tables.CharSet)); }
+		bool HasChar(char ch) const { return tables.Table[byte(ch)] & CLASS_ALLOWED; }
+
+		bool Verified(const char* password, size_t length) const
+			{ return (Flags & REQUIRED & ~Classes(tables, password, length)) == 0; }
 
-		bool Verified(const char* password, size_t length) const;
+		// The *_REQUIRED flags of the classes characters of text are in
+		uint32_t Classes(const char* text, size_t length) const { return Classes(tables, text, length); }
+		static uint32_t Classes(const Tables& tables, const char* text, size_t length);
+
+		// Whether every character of text is one of the recipe's
+		bool Allowed(const char* text, size_t length) const;
 
 		char GetSeperator() const { return Seperator; }
 
+		// The recipe's characters in ascending order
+		const char* Alphabet() const { return tables.Alphabet; }
+		size_t AlphabetSize() const { return tables.AlphabetSize; }
+
+		// The characters of the alphabet that meet one *_REQUIRED flag, in
+		// ascending order, returning how many. chars has to hold the alphabet.
+		size_t ClassAlphabet(uint32_t required, char* const chars) const
+			{ return ClassAlphabet(tables, required, chars); }
+		static size_t ClassAlphabet(const Tables& tables, uint32_t required, char* const chars);
+
+		const Tables& Compiled() const { return tables; }
+
 		void Clear() {
 			Specials = 0; 
 			SpecialsLength = Flags = Seperator = 0;
-			OS::Zero((byte*)charSet, sizeof(charSet));
+			tables = Tables();
 		}
 
-		void AddFlags(uint32_t flags);
+		void AddFlags(uint32_t flags) { Reset({ Specials, SpecialsLength, Flags | flags, Seperator }); }
 		void SetSpecials(const char* specials, size_t length);
 		void SetSeperator(char ch);
 		void Reset(const OSPRecipe& recipe);
 
 	private:
-		typedef uint32_t CharSet[3];
-		CharSet charSet = { 0, 0, 0 };
+		Tables tables;
+
+		static constexpr bool hasCharBit(const uint32_t charSet[3], char ch);
+		static constexpr void setCharBit(uint32_t charSet[3], char ch, bool on);
+
+		// One pass over text for the classes in it and whether all are allowed
+		static void scan(const Tables& tables, const char* text, size_t length, uint32_t& classes, bool& allowed);
+	};
+
+	constexpr bool Recipe::hasCharBit(const uint32_t charSet[3], char ch)
+	{
+		if (ch == 0)
+			return false;
+
+		int position = ch - ' '; // ignore non-printable
+		if (position < 0 || position >= 96)
+			return false;
+
+		return (charSet[position / 32] & uint32_t(1) << position % 32) != 0;
+	}
+
+	constexpr void Recipe::setCharBit(uint32_t charSet[3], char ch, bool on)
+	{
+		int position = ch - ' '; // ignore non-printable
+		if (position < 0 || position >= 96)
+			return;
+
+		if (on)
+			charSet[position / 32] |= uint32_t(1) << position % 32;
+		else
+			charSet[position / 32] &= ~(uint32_t(1) << position % 32);
+	}
+
+	constexpr Recipe::Tables Recipe::Compile(const char* specials, size_t length, uint32_t flags, char seperator)
+	{
+		Tables t;
+
+		for (size_t n = 0; n < length; n++)
+			setCharBit(t.CharSet, specials[n], true);
+
+		setCharBit(t.CharSet, ' ', (flags & OSP_RECIPE_SPACE_ALLOWED) != 0);
+
+		if (flags & OSP_RECIPE_NUMERIC)
+		{
+			for (char ch = '0'; ch <= '9'; ch++)
+				setCharBit(t.CharSet, ch, true);
+		}
+		else
+			flags &= ~OSP_RECIPE_NUMERIC_REQUIRED;
+
+		if (flags & OSP_RECIPE_LOWERCASE)
+		{
+			for (char ch = 'a'; ch <= 'z'; ch++)
+				setCharBit(t.CharSet, ch, true);
+		}
+		else
+			flags &= ~OSP_RECIPE_LOWERCASE_REQUIRED;
+
+		if (flags & OSP_RECIPE_UPPERCASE)
+		{
+			for (char ch = 'A'; ch <= 'Z'; ch++)
+				setCharBit(t.CharSet, ch, true);
+		}
+		else
+			flags &= ~OSP_RECIPE_UPPERCASE_REQUIRED;
+
+		t.Flags = flags;
+		t.Seperator = hasCharBit(t.CharSet, seperator) ? 0 : seperator;
+
+		for (size_t n = 0; n < length; n++)
+		{
+			byte ch = byte(specials[n]);
+			if (ch)
+				t.Table[ch] |= byte(OSP_RECIPE_SPECIAL_REQUIRED);
+			t.Ascii = t.Ascii && ch < 0x80;
+		}
+
+		for (char ch = '0'; ch <= '9'; ch++)
+			t.Table[byte(ch)] |= byte(OSP_RECIPE_NUMERIC_REQUIRED);
+		for (char ch = 'a'; ch <= 'z'; ch++)
+			t.Table[byte(ch)] |= byte(OSP_RECIPE_LOWERCASE_REQUIRED);
+		for (char ch = 'A'; ch <= 'Z'; ch++)
+			t.Table[byte(ch)] |= byte(OSP_RECIPE_UPPERCASE_REQUIRED);
+
+		for (int ch = 1; ch < 256; ch++)
+		{
+			if (hasCharBit(t.CharSet, char(ch)))
+			{
+				t.Table[ch] |= CLASS_ALLOWED;
+				t.Alphabet[t.AlphabetSize++] = char(ch);
+			}
+
+			for (size_t n = 0; ch < 0x80 && n < NIBBLE_TABLES; n++)
+			{
+				byte flag = n ? byte(OSP_RECIPE_NUMERIC_REQUIRED << (n - 1)) : CLASS_ALLOWED;
+				if (t.Table[ch] & flag)
+					t.Nibbles[n][ch & 0x0F] |= byte(1 << (ch >> 4));
+			}
+		}
+
+		return t;
+	}
+
+	// A recipe fixed at compile time, StaticRecipe<OSP_RECIPE_NUMERIC> for a PIN
+	// or StaticRecipe<OSP_RECIPE_LOWERCASE, '!', '?'> with specials. Its tables
+	// are built by the compiler and its requirements are constants, so the
+	// generator is specialised for it when it is passed as a template argument.
+	template<uint32_t flags, char... specials>
+	class StaticRecipe
+	{
+	public:
+		typedef Recipe::byte byte;
+
+		static constexpr char SPECIALS[] = { specials..., 0 };
+		static constexpr Recipe::Tables TABLES = Recipe::Compile(SPECIALS, sizeof...(specials), flags, 0);
+		static constexpr uint32_t REQUIRED = TABLES.Flags & Recipe::REQUIRED;
+
+		static constexpr bool NumericRequired() { return (REQUIRED & OSP_RECIPE_NUMERIC_REQUIRED) != 0; }
+		static constexpr bool LowerCaseRequired() { return (REQUIRED & OSP_RECIPE_LOWERCASE_REQUIRED) != 0; }
+		static constexpr bool UpperCaseRequired() { return (REQUIRED & OSP_RECIPE_UPPERCASE_REQUIRED) != 0; }
+		static constexpr bool SpecialRequired() { return (REQUIRED & OSP_RECIPE_SPECIAL_REQUIRED) != 0; }
+
+		static constexpr bool HasChar(char ch) { return (TABLES.Table[byte(ch)] & Recipe::CLASS_ALLOWED) != 0; }
+
+		static bool Verified(const char* password, size_t length)
+		{
+			if constexpr (REQUIRED == 0)
+				return true;
+			else
+				return (REQUIRED & ~Recipe::Classes(TABLES, password, length)) == 0;
+		}
+
+		static constexpr const char* Alphabet() { return TABLES.Alphabet; }
+		static constexpr size_t AlphabetSize() { return TABLES.AlphabetSize; }
+
+		static size_t ClassAlphabet(uint32_t required, char* const chars)
+			{ return Recipe::ClassAlphabet(TABLES, required, chars); }
+
+		static const Recipe::Tables& Compiled() { return TABLES; }
+
+		// The same recipe for calls that take a Recipe, the tables copied rather than built
+		static Recipe Runtime() { return Recipe({ SPECIALS, sizeof...(specials), flags, 0 }, TABLES); }
+	};
+
+	// The policies generation is specialised for, see the bottom of strongpassword.cpp
+	typedef StaticRecipe<OSP_RECIPE_NUMERIC> PinRecipe;
+	typedef StaticRecipe<OSP_RECIPE_ALPHANUMERIC> AlphanumericRecipe;
+	typedef StaticRecipe<
+		OSP_RECIPE_ALPHANUMERIC |
+		OSP_RECIPE_NUMERIC_REQUIRED | OSP_RECIPE_LOWERCASE_REQUIRED |
+		OSP_RECIPE_UPPERCASE_REQUIRED | OSP_RECIPE_SPECIAL_REQUIRED,
+		'!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '-', '+', '=', '[', ']',
+		'{', '}', ';', ':', ',', '.', '<', '>', '/', '?', '`', '~', '\\', '\'', '"'
+	> StrongRecipe;
+
+	// Takes a recipe's characters from a stream of bytes. Legacy samples are a
+	// byte each, kept when the recipe has the character. Uniform samples are the
+	// fewest bits that index the alphabet, kept when inside it, so every
+	// character is as likely and few bits are wasted.
+	class Sampler
+	{
+	public:
+		typedef Recipe::byte byte;
+
+		Sampler(const Recipe::Tables& tables, uint32_t generator);
+		Sampler(const Recipe& recipe, uint32_t generator) : Sampler(recipe.Compiled(), generator) { }
+
+		// Whether Feed has to be called before Next
+		bool Hungry() const { return pooled < bits; }
+		void Feed(byte b);
+
+		// Takes one sample, true when it is a character of the recipe
+		bool Next(char& ch);
+
+		// Samples are uniform from here on, and from alphabet instead of the
+		// recipe's, or just indexes below size when alphabet is null
+		void Reset(const char* alphabet, size_t size);
+
+		// Takes one uniform sample, true when it is below size
+		bool Next(size_t& index);
+
+		// Legacy samples of a run of bytes at once, with nothing fed yet. Takes
+		// up to room characters into out, as many as Next would have from the
+		// same bytes, and sets used to how many bytes that took. width is the
+		// vector kernel's, 64 for AVX-512, 32 for AVX2 or 1 for a byte at a time.
+		size_t Accept(const byte* bytes, size_t count, char* const out, size_t room, size_t& used)
+			{ return Accept(bytes, count, out, room, used, Width()); }
+		size_t Accept(const byte* bytes, size_t count, char* const out, size_t room, size_t& used, size_t width);
+
+		// The widest kernel the CPU has
+		static size_t Width();
+
+		size_t Fed() const { return fed; }
+
+	private:
+		const Recipe::Tables& tables;
+		bool uniform;
+		const char* alphabet;
+		size_t size;
+		unsigned bits = 8;
+		uint64_t pool = 0;
+		unsigned pooled = 0;
+		size_t fed = 0;
 
-		void setCharBitOn(char ch);
-		void setCharBitOff(char ch);
+		uint64_t take();
 	};
 }
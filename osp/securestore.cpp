@@ -22,6 +22,12 @@ Software.
 
 #include "securestore.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#include "kdf.h"
+
 using namespace OneStrongPassword;
 using namespace std;
 
@@ -45,9 +51,14 @@ bool SecureStore::Destroy(OSPError* error)
 
 	 IV.Destroy(error);
 
-	for (auto itr : labeled)
-		success = Destroy(itr.second.Data, itr.second.StoredSize, error) && success;
-	labeled.clear();
+	for (Shard& shard : labeled)
+	{
+		unique_lock<shared_timed_mutex> lock(shard.Lock);
+		shard.Blocks.ForEach([&](Block& block) {
+			success = Destroy(block.Data, block.StoredSize, error) && success;
+		});
+		shard.Blocks.Clear();
+	}
 
 	Cryptography::Destroy(error);
 
@@ -55,12 +66,39 @@ bool SecureStore::Destroy(OSPError* error)
 	return success;
 }
 
-size_t SecureStore::DataSize(const string& name) const
+size_t SecureStore::DataSize(string_view name) const
 {
-	auto block = labeled.find(name);
-	if (block == labeled.end())
+	size_t hash = LabeledStore::Hash(name);
+
+	const Shard& shard = ShardOf(hash);
+	shared_lock<shared_timed_mutex> lock(shard.Lock);
+
+	size_t slot = shard.Blocks.Find(name, hash);
+	if (slot == LabeledStore::NONE)
 		return 0;
-	return block->second.DataSize;
+	return shard.Blocks.Value(slot).DataSize;
+}
+
+size_t SecureStore::EntrySize(size_t dsize)
+{
+	return EntrySize(dsize, storage);
+}
+
+size_t SecureStore::EntrySize(size_t dsize, uint32_t format)
+{
+	if (padding != OSP_PADDING_SIZE_CLASS)
+		return MaxDataSize();
+
+	// GCM entries need no salt, only room for their nonce and tag
+	size_t extra = format == OSP_STORAGE_GCM ? NONCE_SIZE + TAG_SIZE : BlockSize();
+	return min(Cryptography::DataSize(dsize + extra), MaxDataSize());
+}
+
+size_t SecureStore::MaxEntryDataSize() const
+{
+	if (storage != OSP_STORAGE_GCM)
+		return MaxDataSize();
+	return MaxDataSize() > NONCE_SIZE + TAG_SIZE ? MaxDataSize() - NONCE_SIZE - TAG_SIZE : 0;
 }
 
 bool SecureStore::Encrypt(
@@ -68,7 +106,7 @@ bool SecureStore::Encrypt(
 ) {
 	assert(EXPOSED(0));
 
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 	INCREASE_EXPOSURE; // For exisiting data
 
 	if (!cipher.Prepared() && !cipher.Completed())
@@ -82,16 +120,10 @@ bool SecureStore::Encrypt(
 
 	if (ptr == data)
 		success = Cryptography::Encrypt(cipher, IV, data, encrypted, error);
-	else
+	else if (Cryptography::Encrypt(cipher, IV, encrypted, encrypted, error))
 	{
-		ByteVector buffer(this, ptr, encrypted.Size(), false);
-
-		if (Cryptography::Encrypt(cipher, IV, buffer, encrypted, error))
-		{
-			buffer.Destroy(error);
-			DECREASE_EXPOSURE;
-			success = true;
-		}
+		DECREASE_EXPOSURE;
+		success = true;
 	}
 
 	if (success)
@@ -101,7 +133,66 @@ bool SecureStore::Encrypt(
 		assert(EXPOSED(0));
 	}
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
+
+bool SecureStore::Encrypt(
+	const Cipher& cipher, ByteVector* const data[], ByteVector* const encrypted[], size_t count, OSPError* error
+) {
+	assert(EXPOSED(0));
+
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	for (size_t n = 0; n < count; n++)
+	{
+		if (!ParametersValid(data[n]->Size(), encrypted[n]->Size()))
+			return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+	}
+
+	// Handed to Cryptography a group at a time, salted entries from their encrypted buffers
+	const size_t GROUP = 32;
+	ByteVector* plain[GROUP];
+
+	bool success = true;
+
+	for (size_t first = 0; success && first < count; first += GROUP)
+	{
+		size_t group = min(GROUP, count - first);
+		size_t prepared = 0;
+
+		for (; success && prepared < group; prepared++)
+		{
+			INCREASE_EXPOSURE; // For exisiting data
+
+			ByteVector& d = *data[first + prepared];
+			byte* ptr = PrepareEncyption(d, *encrypted[first + prepared], error);
+
+			if (!(success = nullptr != ptr))
+				break;
+			plain[prepared] = ptr == d ? &d : encrypted[first + prepared];
+		}
+
+		success = success && Cryptography::Encrypt(cipher, IV, plain, &encrypted[first], group, error);
+
+		if (success)
+		{
+			for (size_t n = 0; n < group; n++)
+			{
+				if (plain[n] != data[first + n])
+					DECREASE_EXPOSURE;
+				data[first + n]->Zero();
+				DECREASE_EXPOSURE;
+			}
+		}
+	}
+
+	assert(!success || EXPOSED(0));
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
@@ -110,7 +201,7 @@ bool SecureStore::Decrypt(
 ) {
 	assert(EXPOSED(0));
 
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
 	byte* ptr = PrepareDecryption(decrypted, encrypted.Size(), error);
 	if (!ptr)
@@ -143,7 +234,111 @@ bool SecureStore::Decrypt(
 		INCREASE_EXPOSURE;
 	}
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
+
+bool SecureStore::Seal(
+	const Cipher& cipher, string_view name, ByteVector& data, ByteVector& sealed, OSPError* error
+) {
+	assert(EXPOSED(0));
+
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+	INCREASE_EXPOSURE; // For exisiting data
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	if (sealed.Size() < NONCE_SIZE + TAG_SIZE || !ParametersValid(data.Size() + NONCE_SIZE + TAG_SIZE, sealed.Size()))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	sealed.Zero();
+
+	// A fresh nonce already makes every entry differ, so the padding is left
+	// zeros rather than salted
+	size_t size = sealed.Size() - NONCE_SIZE - TAG_SIZE;
+
+	ByteVector nonce(nullptr, &sealed[0], NONCE_SIZE);
+	ByteVector body(nullptr, &sealed[NONCE_SIZE], size);
+	ByteVector tag(nullptr, &sealed[NONCE_SIZE + size], TAG_SIZE);
+
+	INCREASE_EXPOSURE;
+	bool success = nullptr != Randomize(nonce, NONCE_SIZE, error)
+		&& (!data.Size() || data.CopyTo(body, data.Size(), error))
+		&& EncryptGcm(cipher, nonce, body, body, tag, name, error);
+
+	nonce.Release(error);
+	body.Release(error);
+	tag.Release(error);
+
+	if (!success)
+		sealed.Zero();
+	else
+	{
+		DECREASE_EXPOSURE;
+		data.Zero();
+		DECREASE_EXPOSURE;
+		assert(EXPOSED(0));
+	}
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
+
+bool SecureStore::Unseal(
+	const Cipher& cipher, string_view name, ByteVector& sealed, ByteVector& decrypted, OSPError* error
+) {
+	assert(EXPOSED(0));
+
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (sealed.Size() < NONCE_SIZE + TAG_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BAD_POINTER);
+
+	size_t size = sealed.Size() - NONCE_SIZE - TAG_SIZE;
+
+	byte* ptr = PrepareDecryption(decrypted, size, error);
+	if (!ptr)
+		return false;
+
+	// Views of the entry, released rather than zeroed, so an entry that fails
+	// to authenticate is left as it was
+	ByteVector nonce(nullptr, &sealed[0], NONCE_SIZE);
+	ByteVector body(nullptr, &sealed[NONCE_SIZE], size);
+	ByteVector tag(nullptr, &sealed[NONCE_SIZE + size], TAG_SIZE);
+
+	bool success = false;
+
+	if (ptr == decrypted)
+		success = DecryptGcm(cipher, nonce, body, tag, decrypted, name, error);
+	else
+	{
+		ByteVector buffer(this, ptr, size, false);
+
+		if (DecryptGcm(cipher, nonce, body, tag, buffer, name, error))
+		{
+			INCREASE_EXPOSURE;
+			decrypted.CopyFrom(buffer, error);
+			success = true;
+		}
+
+		if (buffer.Destroy(error) && success)
+			DECREASE_EXPOSURE;
+	}
+
+	nonce.Release(error);
+	body.Release(error);
+	tag.Release(error);
+
+	if (!success)
+		decrypted.Destroy(nullptr);
+	else
+	{
+		assert(EXPOSED(0));
+		INCREASE_EXPOSURE;
+	}
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
@@ -158,95 +353,337 @@ bool SecureStore::ReleaseDecrypted(ByteVector& decrypted, OSPError* error)
 }
 
 bool SecureStore::StoreData(
-	const string& name, Cipher& cipher, ByteVector& data, size_t esize, OSPError* error
+	string_view name, Cipher& cipher, ByteVector& data, size_t esize, OSPError* error
 ) {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
 	bool success = false;
 
 	size_t storedsize = 0;
 
-	if (esize == 0)
-		esize = MaxDataSize();
+	uint32_t format = storage;
+
+	// Whole blocks, so the entry is encrypted in place
+	esize = Cryptography::DataSize(esize ? esize : EntrySize(data.Size(), format));
 
 	ByteVector encrypted(*this);
-	if (encrypted.Alloc(esize, error) && Encrypt(cipher, data, encrypted, error))
-		success = 0 <= (storedsize = UpdateStored(name, encrypted, data.Size(), error));
+	if (encrypted.Alloc(esize, error) && (format == OSP_STORAGE_GCM ?
+		Seal(cipher, name, data, encrypted, error) : Encrypt(cipher, data, encrypted, error)
+	))
+		success = (storedsize = UpdateStored(name, encrypted, data.Size(), format, error)) != size_t(-1);
 	else
 		encrypted.Destroy(error);
 
-	END_MEMORY_CHECK(AvailableMemory() + (success ? esize - storedsize : 0));
+	END_MEMORY_CHECK(ThreadAvailableMemory() + (success ? esize - storedsize : 0));
+	return success;
+}
+
+bool SecureStore::StoreData(
+	const string_view names[], Cipher& cipher, ByteVector* const data[], size_t count, OSPError* error
+) {
+	// GCM entries are sealed one at a time, each with its own nonce and name
+	if (storage == OSP_STORAGE_GCM)
+	{
+		bool success = true;
+		for (size_t n = 0; success && n < count; n++)
+			success = StoreData(names[n], cipher, *data[n], 0, error);
+		return success;
+	}
+
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	const size_t GROUP = 32;
+
+	deque<ByteVector> buffers;
+	ByteVector* encrypted[GROUP];
+
+	bool success = true;
+
+	size_t stored = 0;
+	size_t replaced = 0;
+
+	for (size_t first = 0; success && first < count; first += GROUP)
+	{
+		size_t group = min(GROUP, count - first);
+
+		// Every entry is salted in its own buffer and encrypted there, its data
+		// is only zeroed once it is stored, so a failure loses none
+		size_t prepared = 0;
+		for (; success && prepared < group; prepared++)
+		{
+			ByteVector& d = *data[first + prepared];
+
+			size_t esize = Cryptography::DataSize(EntrySize(d.Size(), OSP_STORAGE_CBC));
+			if (!ParametersValid(d.Size(), esize))
+			{
+				success = OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+				break;
+			}
+
+			buffers.emplace_back(*this);
+			encrypted[prepared] = &buffers.back();
+			success = encrypted[prepared]->Alloc(esize, error);
+
+			byte* ptr = success ? PrepareEncyption(d, *encrypted[prepared], error) : nullptr;
+			if (!(success = nullptr != ptr))
+				break;
+
+			// Unsalted, so a copy of the data
+			if (ptr == d)
+			{
+				INCREASE_EXPOSURE;
+				success = d.CopyTo(*encrypted[prepared], d.Size(), error);
+			}
+		}
+
+		success = success && Cryptography::Encrypt(cipher, IV, encrypted, encrypted, group, error);
+
+		// The copies are encrypted, or zeroed with their buffers below
+		for (size_t n = 0; n < prepared; n++)
+			DECREASE_EXPOSURE;
+
+		for (size_t n = 0; success && n < group; n++)
+		{
+			size_t esize = encrypted[n]->Size();
+			size_t storedsize = UpdateStored(
+				names[first + n], *encrypted[n], data[first + n]->Size(), OSP_STORAGE_CBC, error
+			);
+
+			if (!(success = storedsize != size_t(-1)))
+				break;
+
+			data[first + n]->Zero();
+
+			stored += esize;
+			replaced += storedsize;
+		}
+
+		for (ByteVector& buffer : buffers)
+			buffer.Destroy(nullptr);
+		buffers.clear();
+	}
+
+	END_MEMORY_CHECK(ThreadAvailableMemory() + stored - replaced);
 	return success;
 }
 
 bool SecureStore::DispenseData(
-	const string& name, Cipher& cipher, ByteVector& data, OSPError* error
+	string_view name, Cipher& cipher, ByteVector& data, OSPError* error
 ) {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	size_t hash = LabeledStore::Hash(name);
+	Shard& shard = ShardOf(hash);
+
+	// The block stays in the shard marked as dispensing, so it is decrypted
+	// without holding the lock while others changing it wait
+	unique_lock<shared_timed_mutex> lock(shard.Lock);
 
-	auto block = labeled.find(name);
-	if (block == labeled.end())
+	size_t slot = FindSettled(shard, lock, name, hash);
+	if (slot == LabeledStore::NONE)
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_DATA_NOT_FOUND);
 
-	ByteVector encrypted(this, block->second.Data, block->second.StoredSize);
+	Block taken = shard.Blocks.Value(slot);
 
-	if (block->second.DataSize > data.Size())
+	if (taken.DataSize > data.Size())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
 
-	size_t freed = encrypted.Size();
+	shard.Blocks.Value(slot).Dispensing = true;
 
-	bool success = Decrypt(cipher, encrypted, data, error);
+	lock.unlock();
+
+	ByteVector encrypted(this, taken.Data, taken.StoredSize);
+
+	bool success = taken.Format == OSP_STORAGE_GCM ?
+		Unseal(cipher, name, encrypted, data, error) : Decrypt(cipher, encrypted, data, error);
 
 	encrypted.Release(error);
 
-	if (success)
+	lock.lock();
+
+	// Nothing else removes or moves a dispensing block, it is found again as it was
+	slot = shard.Blocks.Find(name, hash);
+	Block& stored = shard.Blocks.Value(slot);
+	stored.Dispensing = false;
+
+	size_t freed = 0;
+
+	if (success && (success = Destroy(stored.Data, stored.StoredSize, error)))
 	{
-		success = DestroyData(name, error);
-		cipher.Zero(error);
+		freed = taken.StoredSize;
+		shard.Blocks.Erase(slot);
 	}
 
-	END_MEMORY_CHECK(AvailableMemory() - (success ? freed : 0));
+	lock.unlock();
+	shard.Settled.notify_all();
+
+	if (success)
+		cipher.Zero(error);
+
+	END_MEMORY_CHECK(ThreadAvailableMemory() - freed);
 	return success;
 }
 
-bool SecureStore::DestroyData(const string& name, OSPError* error)
+bool SecureStore::DestroyData(string_view name, OSPError* error)
 {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	size_t hash = LabeledStore::Hash(name);
+
+	Shard& shard = ShardOf(hash);
+	unique_lock<shared_timed_mutex> lock(shard.Lock);
 
-	auto block = labeled.find(name);
-	if (block == labeled.end())
+	size_t slot = FindSettled(shard, lock, name, hash);
+	if (slot == LabeledStore::NONE)
 		return true;
 
-	Block& stored = block->second;
+	Block& stored = shard.Blocks.Value(slot);
 	size_t freed = stored.StoredSize;
 
 	bool success = false;
 
 	if (Destroy(stored.Data, stored.StoredSize, error))
 	{
-		labeled.erase(block);
+		shard.Blocks.Erase(slot);
 		success = true;
 	}
 
-	END_MEMORY_CHECK(AvailableMemory() - (success ? freed : 0));
+	END_MEMORY_CHECK(ThreadAvailableMemory() - (success ? freed : 0));
 	return success;
 }
 
+bool SecureStore::KdfProfile(const OSPKdfProfile& profile, OSPError* error)
+{
+	if (!Kdf::Valid(profile))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	kdf = profile;
+	return true;
+}
+
+bool SecureStore::CalibrateKdf(uint32_t function, uint32_t milliseconds, OSPError* error)
+{
+	// Cheap starting costs, doubled until a derivation is long enough to time
+	OSPKdfProfile trial;
+	switch (function)
+	{
+	case OSP_KDF_LEGACY:   trial = Kdf::Legacy(1000); break;
+	case OSP_KDF_PBKDF2:   trial = Kdf::Pbkdf2(1000); break;
+	case OSP_KDF_SCRYPT:   trial = Kdf::Scrypt(10, 8, 1); break;
+	case OSP_KDF_ARGON2ID: trial = Kdf::Argon2id(3, 1024, 1); break;
+	default:
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+	}
+
+	if (!milliseconds)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_INVALID_KDF_PROFILE);
+
+	const OSPKdfProfile current = kdf;
+
+	ByteArray<64> data;
+	ByteArray<64> hash;
+	for (size_t n = 0; n < data.Size(); n++)
+		data[n] = byte(n);
+
+	const double least = max(milliseconds / 8.0, 5.0);
+
+	bool success = true;
+	double elapsed = 0;
+
+	while (success)
+	{
+		kdf = trial;
+
+		auto t0 = chrono::steady_clock::now();
+		success = StrongHash(data, hash, error);
+		auto t1 = chrono::steady_clock::now();
+
+		elapsed = chrono::duration<double, milli>(t1 - t0).count();
+		if (elapsed >= least)
+			break;
+
+		OSPKdfProfile larger = Kdf::Scaled(trial, 2 * Kdf::Cost(trial));
+		if (Kdf::Cost(larger) <= Kdf::Cost(trial))
+			break;
+		trial = larger;
+	}
+
+	hash.Zero();
+
+	if (!success)
+	{
+		kdf = current;
+		return false;
+	}
+
+	double rate = Kdf::Cost(trial) * 1000.0 / max(elapsed, 0.001);
+
+	kdf = Kdf::Scaled(trial, uint64_t(rate * milliseconds / 1000.0));
+	kdfRate = uint64_t(rate);
+	return true;
+}
+
 bool SecureStore::StrongHash(const ByteVector& data, ByteVector& hash, OSPError* error)
 {
-	ByteVector tmp(*this);
-	if (!tmp.Alloc(hash.Size(), error))
+	const ByteVector* pdata = &data;
+	ByteVector* phash = &hash;
+	return StrongHash(&pdata, &phash, 1, error);
+}
+
+bool SecureStore::StrongHash(
+	const ByteVector* const data[], ByteVector* const hash[], size_t count, OSPError* error
+) {
+	if (kdf.Kdf != OSP_KDF_LEGACY)
+	{
+		bool success = true;
+		for (size_t n = 0; success && n < count; n++)
+			success = Kdf::Derive(*this, kdf, *data[n], data[n]->Size(), *hash[n], hash[n]->Size(), error);
+		return success;
+	}
+
+	HashSession session(*this);
+	if (!session.Begin(error))
 		return false;
 
-	bool success = Hash(data, hash, error);
-	for (int n = 0; success && n < 10000; n++)
+	size_t hashsize = HashSize(error);
+
+	// Hash sized chains are rehashed together, any other size keeps
+	// alternating between the hash and a buffer of the same size. Either way
+	// a chain is hashed Iterations times after its first hash.
+	vector<byte*> lanes;
+	lanes.reserve(count);
+
+	bool success = true;
+
+	for (size_t n = 0; success && n < count; n++)
 	{
-		success = Hash(hash, tmp, error);
-		if (success)
-			success = Hash(tmp, hash, error);
+		success = session.Hash(*data[n], *hash[n], error);
+		if (!success)
+			break;
+
+		if (hash[n]->Size() == hashsize)
+		{
+			lanes.push_back(*hash[n]);
+			continue;
+		}
+
+		ByteVector tmp(*this);
+		success = tmp.Alloc(hash[n]->Size(), error);
+		for (uint32_t r = 0; success && r < kdf.Iterations / 2; r++)
+		{
+			success = session.Hash(*hash[n], tmp, error);
+			if (success)
+				success = session.Hash(tmp, *hash[n], error);
+		}
+		if (success && kdf.Iterations % 2)
+			success = session.Hash(*hash[n], tmp, error) && hash[n]->CopyFrom(tmp, error);
+		success = tmp.Destroy(error) && success;
 	}
 
-	tmp.Destroy(error);
+	if (success && !lanes.empty())
+		success = session.Rehash(lanes.data(), lanes.size(), kdf.Iterations, error);
+
+	success = session.End(error) && success;
 	return success;
 }
 
@@ -270,15 +707,16 @@ SecureStore::byte* SecureStore::PrepareEncyption(ByteVector& data, ByteVector& e
 
 	size_t saltsize = encrypted.Size() - data.Size();
 
+	// Salted data is put in the encrypted buffer and encrypted in place
 	byte* buffer = data;
 	if (saltsize > 0)
 	{
-		buffer = Alloc(encrypted.Size(), error);
+		buffer = encrypted;
 
 		INCREASE_EXPOSURE;
 		if (!data.CopyTo(buffer, data.Size(), error) || !Randomize(&buffer[data.Size()], saltsize, error))
 		{
-			Destroy(buffer, encrypted.Size(), error);
+			encrypted.Zero();
 			return nullptr;
 		}
 	}
@@ -295,11 +733,29 @@ SecureStore::byte* SecureStore::PrepareDecryption(ByteVector& decrypted, size_t
 	return buffer;
 }
 
-size_t SecureStore::UpdateStored(const string& name, ByteVector& encrypted, size_t dsize, OSPError* error)
+size_t SecureStore::FindSettled(Shard& shard, unique_lock<shared_timed_mutex>& lock, string_view name, size_t hash)
 {
-	bool success = false;
+	size_t slot = LabeledStore::NONE;
+	shard.Settled.wait(lock, [&]() {
+		slot = shard.Blocks.Find(name, hash);
+		return slot == LabeledStore::NONE || !shard.Blocks.Value(slot).Dispensing;
+	});
+	return slot;
+}
+
+size_t SecureStore::UpdateStored(
+	string_view name, ByteVector& encrypted, size_t dsize, uint32_t format, OSPError* error
+) {
+	size_t hash = LabeledStore::Hash(name);
+
+	Shard& shard = ShardOf(hash);
+	unique_lock<shared_timed_mutex> lock(shard.Lock);
+
+	// Replaced only once it is not being dispensed
+	FindSettled(shard, lock, name, hash);
 
-	Block& stored = labeled[name];
+	bool inserted = false;
+	Block& stored = shard.Blocks.Value(shard.Blocks.Insert(name, hash, inserted));
 
 	size_t storedsize = stored.StoredSize;
 
@@ -309,6 +765,7 @@ size_t SecureStore::UpdateStored(const string& name, ByteVector& encrypted, size
 	{
 		encrypted.MoveTo(stored.Data, stored.StoredSize, error);
 		stored.DataSize = dsize;
+		stored.Format = format;
 	}
 
 	return storedsize;
@@ -23,11 +23,18 @@ Software.
 #pragma once
 #include "osp.h"
 
-#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "bytevector.h"
+#include "cipherstream.h"
 #include "cryptography.h"
+#include "nameindex.h"
 
 namespace OneStrongPassword
 {
@@ -40,6 +47,7 @@ namespace OneStrongPassword
 
 		static const int DEFAULT_COUNT = 10;
 		static const int DEFAULT_SIZE = 512;
+		static const int STRONG_HASH_ROUNDS = 20000;
 
 		static bool ReleaseDecrypted(ByteVector& decrypted, OSPError* error = nullptr);
 
@@ -61,7 +69,42 @@ namespace OneStrongPassword
 		bool Destroy(byte*& data, size_t size, OSPError* error = nullptr)
 			{ return Cryptography::Destroy(data, size, error); }
 
-		size_t DataSize(const std::string& name) const;
+		size_t DataSize(std::string_view name) const;
+
+		// How StoreData sizes an entry when not given an encrypted size.
+		// OSP_PADDING_MAX_DATA_SIZE, the default, pads every entry to MaxDataSize
+		// so its length is hidden. OSP_PADDING_SIZE_CLASS rounds it up to the
+		// smallest multiple of the block size with room for a block of salt.
+		uint32_t Padding() const { return padding; }
+		void Padding(uint32_t value) { padding = value; }
+
+		size_t EntrySize(size_t dsize);
+
+		// How StoreData encrypts entries. OSP_STORAGE_CBC, the default, is AES-CBC
+		// with salt, nothing in it tells a changed entry from the one stored.
+		// OSP_STORAGE_GCM is AES-GCM with a fresh nonce per entry and the entry's
+		// name authenticated along with it, so an entry changed, or moved under
+		// another name, is refused with OSP_ERROR_DATA_NOT_AUTHENTIC. Its nonce and
+		// tag are kept within the entry size. Every entry is dispensed the way it
+		// was stored, whatever the storage is by then.
+		uint32_t Storage() const { return storage; }
+		void Storage(uint32_t value) { storage = value; }
+
+		// Most data an entry holds with the current storage
+		size_t MaxEntryDataSize() const;
+
+		// How StrongHash stretches its inputs, the legacy chain of
+		// STRONG_HASH_ROUNDS hashes unless set otherwise. A profile that is not
+		// valid is refused and the current one kept.
+		const OSPKdfProfile& KdfProfile() const { return kdf; }
+		bool KdfProfile(const OSPKdfProfile& profile, OSPError* error = nullptr);
+
+		// Times one of the OSP_KDF functions on this host and takes the profile
+		// whose StrongHash lasts about milliseconds. The profile has to be kept
+		// and set again to reproduce what is derived with it. KdfRate is the
+		// Kdf::Cost per second measured, 0 until calibrated.
+		bool CalibrateKdf(uint32_t function, uint32_t milliseconds, OSPError* error = nullptr);
+		uint64_t KdfRate() const { return kdfRate; }
 
 		bool Encrypt(
 			const Cipher& cipher,
@@ -77,25 +120,77 @@ namespace OneStrongPassword
 			OSPError* error = nullptr
 		);
 
+		// Count entries salted as Encrypt does each, their chains encrypted
+		// together as many at a time as EncryptLanes
+		bool Encrypt(
+			const Cipher& cipher,
+			ByteVector* const data[],
+			ByteVector* const encrypted[],
+			size_t count,
+			OSPError* error = nullptr
+		);
+
+		// Encrypt and Decrypt for payloads of any size, streamed with the store's
+		// init vector through the window of a stream begun on this store. The
+		// ciphertext is not kept as an entry, storing what sink is given is up to
+		// the caller.
+		bool Encrypt(
+			const Cipher& cipher,
+			CipherStream& stream,
+			const CipherStream::Source& source,
+			const CipherStream::Sink& sink,
+			size_t& size,
+			OSPError* error = nullptr
+		) { return stream.Encrypt(cipher, IV, source, sink, size, error); }
+
+		bool Decrypt(
+			const Cipher& cipher,
+			CipherStream& stream,
+			const CipherStream::Source& source,
+			const CipherStream::Sink& sink,
+			size_t size,
+			OSPError* error = nullptr
+		) { return stream.Decrypt(cipher, IV, source, sink, size, error); }
+
 		bool StoreData(
-			const std::string& name,
+			std::string_view name,
 			Cipher& cipher,
 			ByteVector& data,
 			size_t esize = 0,
 			OSPError* error = nullptr
 		);
 		
+		// Stores count entries as StoreData does each, sized by EntrySize and
+		// encrypted in batches. Each entry's data is zeroed once it is stored.
+		// Stops at the first failure, whatever was stored by then stays stored
+		// and the data of every entry not stored is left as it was.
+		bool StoreData(
+			const std::string_view names[],
+			Cipher& cipher,
+			ByteVector* const data[],
+			size_t count,
+			OSPError* error = nullptr
+		);
+
 		bool DispenseData(
-			const std::string& name,
+			std::string_view name,
 			Cipher& cipher,
 			ByteVector& data,
 			OSPError* error = nullptr
 		);
 		
-		bool DestroyData(const std::string& name, OSPError* error = nullptr);
+		bool DestroyData(std::string_view name, OSPError* error = nullptr);
 
 		bool StrongHash(const ByteVector& data, ByteVector& hash, OSPError* error = nullptr);
 
+		// Strong hashes count independent inputs, hash sized chains advance together
+		bool StrongHash(
+			const ByteVector* const data[],
+			ByteVector* const hash[],
+			size_t count,
+			OSPError* error = nullptr
+		);
+
 	protected:
 		virtual bool Initialize(size_t count, size_t maxsize, size_t additional, OSPError* error);
 		virtual bool Reset(size_t count, size_t maxsize, size_t additional, OSPError* error)
@@ -106,13 +201,64 @@ namespace OneStrongPassword
 		byte* PrepareEncyption(ByteVector& data, ByteVector& encrypted, OSPError* error);
 		byte* PrepareDecryption(ByteVector& decrypted, size_t esize, OSPError* error);
 
-		size_t UpdateStored(const std::string& name, ByteVector& encrypted, size_t dsize, OSPError* error);
+		// GCM entries, the nonce, the data encrypted with its padding, then the
+		// tag, authenticated with the name they are stored under
+		bool Seal(const Cipher& cipher, std::string_view name, ByteVector& data, ByteVector& sealed, OSPError* error);
+		bool Unseal(
+			const Cipher& cipher, std::string_view name, ByteVector& sealed, ByteVector& decrypted, OSPError* error
+		);
+
+		// EntrySize for an entry stored with format
+		size_t EntrySize(size_t dsize, uint32_t format);
+
+		size_t UpdateStored(
+			std::string_view name, ByteVector& encrypted, size_t dsize, uint32_t format, OSPError* error
+		);
 
 	private:
-		typedef struct Block { byte* Data; size_t DataSize; size_t StoredSize; } Block;
-		typedef std::map<std::string, Block> LabeledStore;
+		// Format is the OSP_STORAGE the entry was stored with. Dispensing marks an
+		// entry being decrypted outside the lock, it stays until that succeeds.
+		typedef struct Block
+		{
+			byte* Data;
+			size_t DataSize;
+			size_t StoredSize;
+			uint32_t Format;
+			bool Dispensing;
+		} Block;
+		typedef NameIndex<Block> LabeledStore;
+
+		// Names are spread over shards by the top bits of their hash, the index
+		// probes with the bottom ones. Lookups share a shard's lock and changes
+		// hold it only for the shard the name falls in.
+		static const size_t SHARD_BITS = 4;
+		static const size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+
+		// Changes to an entry being dispensed wait on Settled until it is done
+		typedef struct Shard
+		{
+			mutable std::shared_timed_mutex Lock;
+			std::condition_variable_any Settled;
+			LabeledStore Blocks;
+		} Shard;
+
+		Shard labeled[SHARD_COUNT];
+
+		// Set while other threads store, so each store reads them once
+		std::atomic<uint32_t> padding{ OSP_PADDING_MAX_DATA_SIZE };
+		std::atomic<uint32_t> storage{ OSP_STORAGE_CBC };
+
+		OSPKdfProfile kdf = {
+			OSP_KDF_PROFILE_VERSION, OSP_KDF_LEGACY, STRONG_HASH_ROUNDS, 0, 0, 0, OSP_EXPANSION_LEGACY, OSP_GENERATOR_LEGACY
+		};
+		uint64_t kdfRate = 0;
+
+		Shard& ShardOf(size_t hash) { return labeled[hash >> (8 * sizeof(size_t) - SHARD_BITS)]; }
+		const Shard& ShardOf(size_t hash) const { return labeled[hash >> (8 * sizeof(size_t) - SHARD_BITS)]; }
 
-		LabeledStore labeled;
+		// Slot of name, LabeledStore::NONE if not stored, once no dispense of it
+		// is in flight. Lock is held on shard.
+		size_t FindSettled(Shard& shard, std::unique_lock<std::shared_timed_mutex>& lock, std::string_view name, size_t hash);
 
 		class InitVector : public ByteVector
 		{
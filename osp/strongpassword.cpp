@@ -1,9 +1,49 @@
 #include "strongpassword.h"
 #include "hashvector.h"
+#include "kdf.h"
+
+#include <algorithm>
 
 using namespace OneStrongPassword;
 using namespace std;
 
+bool PasswordPool::Start(size_t threads, OSPError* error)
+{
+	if (!ThreadPool::Start(threads, error))
+		return false;
+	for (size_t worker = scratch.size(); worker < Threads(); worker++)
+		scratch.emplace_back();
+	return true;
+}
+
+void PasswordPool::Stop()
+{
+	ThreadPool::Stop();
+	scratch.clear();
+}
+
+bool PasswordPool::Prepare(size_t lanes, size_t size, const OSPKdfProfile& profile, OSPError* error)
+{
+	bool success = true;
+
+	for (auto& store : scratch)
+	{
+		success = success && store.KdfProfile(profile, error);
+
+		size_t maxsize = max(size, store.HashSize());
+		if (success && store.MaxDataSize() < maxsize)
+		{
+			// Add to count for
+			// - a strong mnemonic buffer and a hash per lane
+			// - the two hashes regenerating a hash needs
+
+			success = store.Reset(2 * lanes + 2, maxsize, error);
+		}
+	}
+
+	return success;
+}
+
 bool StrongPassword::Restore(Cipher& cipher, ByteVector& password, OSPError* error)
 {
 	if (cipher.Prepare(error))
@@ -25,6 +65,18 @@ bool StrongPassword::GeneratePassword(
 	size_t length,
 	const Recipe & recipe,
 	OSPError* error
+) {
+	return generatePassword(mnemonic, cipher, password, length, recipe, error);
+}
+
+template<typename R>
+bool StrongPassword::generatePassword(
+	const string& mnemonic,
+	Cipher& cipher,
+	PasswordVector& password,
+	size_t length,
+	const R& recipe,
+	OSPError* error
 ) {
 	assert(EXPOSED(0));
 
@@ -100,11 +152,263 @@ bool StrongPassword::StrongMnemonic(
 	return success;
 }
 
+bool StrongPassword::GeneratePasswords(
+	const vector<string>& mnemonics,
+	Cipher& cipher,
+	PasswordVector* const passwords[],
+	size_t length,
+	const Recipe& recipe,
+	OSPError* error
+) {
+	vector<size_t> lengths(mnemonics.size(), length);
+	vector<const Recipe*> recipes(mnemonics.size(), &recipe);
+	return GeneratePasswords(mnemonics, cipher, passwords, lengths.data(), recipes.data(), error);
+}
+
+bool StrongPassword::GeneratePasswords(
+	const vector<string>& mnemonics,
+	Cipher& cipher,
+	PasswordVector* const passwords[],
+	const size_t lengths[],
+	const Recipe* const recipes[],
+	OSPError* error
+) {
+	return GeneratePasswords(mnemonics, cipher, passwords, lengths, recipes, nullptr, error);
+}
+
+bool StrongPassword::GeneratePasswords(
+	const vector<string>& mnemonics,
+	Cipher& cipher,
+	PasswordVector* const passwords[],
+	const size_t lengths[],
+	const Recipe* const recipes[],
+	PasswordPool& pool,
+	OSPError* error
+) {
+	return GeneratePasswords(mnemonics, cipher, passwords, lengths, recipes, &pool, error);
+}
+
+bool StrongPassword::GeneratePasswords(
+	const vector<string>& mnemonics,
+	Cipher& cipher,
+	PasswordVector* const passwords[],
+	const size_t lengths[],
+	const Recipe* const recipes[],
+	PasswordPool* pool,
+	OSPError* error
+) {
+	assert(EXPOSED(0));
+
+	size_t count = mnemonics.size();
+	size_t largest = 0;
+
+	for (size_t n = 0; n < count; n++)
+	{
+		if (lengths[n] + 1 > passwords[n]->MaxLength())
+			return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+		passwords[n]->Zero();
+		largest = max(largest, mnemonics[n].size() * sizeof(char));
+	}
+
+	size_t size = DataSize();
+	if (!size)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_STRONG_PASSWORD_STORED);
+
+	// Serially each lane gets one strong mnemonic buffer and one hash, allocated
+	// once and reused for every group. Lanes the secure heap has no room for are
+	// dropped, down to the one lane any single generation needs. Pool workers
+	// allocate their own lanes from their scratch stores instead.
+
+	deque<ByteVector> buffers;
+	deque<HashVector> hashes;
+
+	// A pool that was never started generates serially
+	if (pool && !pool->Threads())
+		pool = nullptr;
+
+	size_t lanes = store.HashLanes(error);
+	if (pool && !pool->Prepare(lanes, largest + size, store.KdfProfile(), error))
+		return false;
+	if (!pool && !AllocLanes(store, min(lanes, count), largest + size, buffers, hashes, error))
+		return false;
+	if (!pool)
+		lanes = buffers.size();
+
+	bool success = false;
+
+	ByteVector strongbuff(store);
+	if (strongbuff.Alloc(size, error) && Dispense(cipher, strongbuff, error))
+	{
+		success = true;
+
+		if (pool)
+		{
+			// Each group of lanes is one task, every password lands in its own
+			// slot, so the results match generating them one at a time
+			success = pool->Run((count + lanes - 1) / lanes, [&](size_t worker, size_t group, OSPError* taskError)
+			{
+				size_t first = group * lanes;
+				size_t groupCount = min(lanes, count - first);
+
+				SecureStore& scratch = pool->Scratch(worker);
+
+				deque<ByteVector> workerBuffers;
+				deque<HashVector> workerHashes;
+
+				bool taskSuccess = AllocLanes(
+					scratch, groupCount, largest + size, workerBuffers, workerHashes, taskError
+				);
+
+				size_t workerLanes = workerBuffers.size();
+				for (size_t next = first; taskSuccess && next < first + groupCount; next += workerLanes)
+				{
+					taskSuccess = GenerateLanes(
+						scratch,
+						&mnemonics[next],
+						min(workerLanes, first + groupCount - next),
+						strongbuff,
+						workerBuffers,
+						workerHashes,
+						&passwords[next],
+						&lengths[next],
+						&recipes[next],
+						taskError
+					);
+				}
+
+				return DestroyLanes(workerBuffers, workerHashes, taskError) && taskSuccess;
+			}, error);
+		}
+		else
+		{
+			for (size_t first = 0; success && first < count; first += lanes)
+			{
+				success = GenerateLanes(
+					store,
+					&mnemonics[first],
+					min(lanes, count - first),
+					strongbuff,
+					buffers,
+					hashes,
+					&passwords[first],
+					&lengths[first],
+					&recipes[first],
+					error
+				);
+			}
+		}
+
+		success = Restore(cipher, strongbuff, error) && success;
+	}
+	success = strongbuff.Destroy(error) && success;
+	success = DestroyLanes(buffers, hashes, error) && success;
+
+	for (size_t n = 0; n < count; n++)
+	{
+		if (success)
+		{
+			assert(EXPOSED(int(n)));
+			INCREASE_EXPOSURE;
+		}
+		else
+			passwords[n]->Zero();
+	}
+
+	return success;
+}
+
+bool StrongPassword::AllocLanes(
+	SecureStore& scratch,
+	size_t lanes,
+	size_t size,
+	deque<ByteVector>& buffers,
+	deque<HashVector>& hashes,
+	OSPError* error
+) {
+	for (size_t n = 0; n < lanes; n++)
+	{
+		DECLARE_OSPError(laneError);
+		OSPError* allocError = n ? &laneError : error;
+
+		buffers.emplace_back(scratch);
+		hashes.emplace_back(scratch);
+
+		if (!buffers.back().Alloc(size, allocError) || !hashes.back().Initialize(allocError))
+		{
+			buffers.back().Destroy();
+			hashes.back().Destroy();
+			buffers.pop_back();
+			hashes.pop_back();
+			return n > 0;
+		}
+	}
+	return true;
+}
+
+bool StrongPassword::DestroyLanes(deque<ByteVector>& buffers, deque<HashVector>& hashes, OSPError* error)
+{
+	bool success = true;
+	for (auto& buffer : buffers)
+		success = buffer.Destroy(error) && success;
+	for (auto& hashbuff : hashes)
+		success = hashbuff.Destroy(error) && success;
+	return success;
+}
+
+bool StrongPassword::GenerateLanes(
+	SecureStore& scratch,
+	const string* const mnemonics,
+	size_t count,
+	const ByteVector& strongbuff,
+	deque<ByteVector>& buffers,
+	deque<HashVector>& hashes,
+	PasswordVector* const passwords[],
+	const size_t lengths[],
+	const Recipe* const recipes[],
+	OSPError* error
+) {
+	// Strong mnemonics are fixed views the exact size of each mnemonic over the lane buffers
+	deque<ByteVector> strongmnemonics;
+
+	vector<const ByteVector*> data;
+	vector<ByteVector*> hash;
+
+	bool success = true;
+
+	for (size_t n = 0; success && n < count; n++)
+	{
+		size_t mnemonicsize = mnemonics[n].size() * sizeof(char);
+
+		strongmnemonics.emplace_back(nullptr, buffers[n], mnemonicsize + strongbuff.Size());
+
+		ByteVector& strongmnemonic = strongmnemonics.back();
+		success = strongmnemonic.CopyFrom(mnemonics[n], error);
+		success = success && strongmnemonic.CopyFrom(strongbuff, strongbuff.Size(), mnemonicsize, error);
+
+		data.push_back(&strongmnemonic);
+		hash.push_back(&hashes[n]);
+	}
+
+	success = success && scratch.StrongHash(data.data(), hash.data(), count, error);
+
+	for (auto& strongmnemonic : strongmnemonics)
+		strongmnemonic.Zero();
+
+	for (size_t n = 0; success && n < count; n++)
+		success = PasswordFromHash(scratch, hashes[n], *passwords[n], lengths[n], *recipes[n], error);
+
+	for (size_t n = 0; n < count; n++)
+		hashes[n].Zero();
+
+	return success;
+}
+
+template<typename R>
 bool StrongPassword::GeneratePassword(
 	ByteVector& strongmnemonic,
 	PasswordVector& password,
 	size_t length,
-	const Recipe& recipe,
+	const R& recipe,
 	OSPError* error
 ) {
 	HashVector hashbuff(store);
@@ -116,57 +420,193 @@ bool StrongPassword::GeneratePassword(
 	if (success = store.StrongHash(strongmnemonic, hashbuff, error))
 	{
 		success = strongmnemonic.Destroy(error);
+		success = success && PasswordFromHash(store, hashbuff, password, length, recipe, error);
+	}
+
+	hashbuff.Destroy();
+
+	return success;
+}
+
+// Puts a character of every class the recipe requires at its own position,
+// each position drawn from the ones left and each character from its class,
+// so a password meets the recipe in one pass
+template<typename R, typename Feed>
+inline bool PlaceRequired(
+	Sampler& sampler, Feed& feed, PasswordVector& password, size_t length, const R& recipe, OSPError* error
+) {
+	const uint32_t classes[] = {
+		OSP_RECIPE_NUMERIC_REQUIRED,
+		OSP_RECIPE_LOWERCASE_REQUIRED,
+		OSP_RECIPE_UPPERCASE_REQUIRED,
+		OSP_RECIPE_SPECIAL_REQUIRED
+	};
+
+	const bool required[] = {
+		recipe.NumericRequired(), recipe.LowerCaseRequired(), recipe.UpperCaseRequired(), recipe.SpecialRequired()
+	};
 
-		size_t plen = 0;
-		size_t pos = 0;
-		bool verified = false;
-		int safety = 10000;
+	char chars[Recipe::MAX_ALPHABET_SIZE];
+	size_t taken[sizeof(classes) / sizeof(classes[0])];
+	size_t placed = 0;
 
-		while (success && !verified)
+	bool success = true;
+
+	for (size_t c = 0; success && c < sizeof(classes) / sizeof(classes[0]); c++)
+	{
+		if (!required[c])
+			continue;
+
+		size_t size = recipe.ClassAlphabet(classes[c], chars);
+		if (placed >= length || size == 0)
+			return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS);
+
+		size_t position;
+		sampler.Reset(nullptr, length - placed);
+		while ((success = feed()) == true && !sampler.Next(position));
+		if (!success)
+			break;
+
+		// The drawn index counts only free positions, taken is kept ascending
+		size_t n = 0;
+		for (; n < placed && taken[n] <= position; n++)
+			position++;
+		for (size_t m = placed; m > n; m--)
+			taken[m] = taken[m - 1];
+		taken[n] = position;
+		placed++;
+
+		size_t index;
+		sampler.Reset(chars, size);
+		while ((success = feed()) == true && !sampler.Next(index));
+
+		if (success)
+			password[position] = chars[index];
+	}
+
+	return success;
+}
+
+template<typename R>
+bool StrongPassword::PasswordFromHash(
+	SecureStore& scratch,
+	HashVector& hashbuff,
+	PasswordVector& password,
+	size_t length,
+	const R& recipe,
+	OSPError* error
+) {
+	if (!recipe.AlphabetSize())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS);
+
+	bool success = true;
+
+	// In counter mode the strong hash is only the key of the stream bytes are taken from
+	Expansion expansion(scratch);
+	bool expand = scratch.KdfProfile().Expansion == OSP_EXPANSION_COUNTER;
+	if (expand)
+		success = expansion.Begin(hashbuff, hashbuff.Size(), error) && expansion.Next(hashbuff, error);
+
+	Sampler sampler(recipe.Compiled(), scratch.KdfProfile().Generator);
+
+	size_t pos = 0;
+
+	auto refill = [&]() {
+		if (expand)
+			success = expansion.Next(hashbuff, error);
+		else
 		{
-			while (success && plen < length)
-			{
-				for (; plen < length && pos < store.HashSize(); pos++)
-				{
-					char ch = abs((char)hashbuff[pos]);
-					if (recipe.HasChar(ch))
-						password[plen++] = ch;
-				}
+			// Generate a new hash
+			HashVector tmp(scratch);
+			success = hashbuff.MoveTo(tmp, error);
+			success = success && hashbuff.Realloc(error);
+			success = success && scratch.StrongHash(tmp, hashbuff, error);
+			tmp.Destroy();
+		}
+		pos = 0;
+		return success;
+	};
+
+	auto feed = [&]() {
+		while (success && sampler.Hungry())
+		{
+			if (pos >= scratch.HashSize() && !refill())
+				break;
+			sampler.Feed(hashbuff[pos++]);
+		}
+		return success;
+	};
+
+	// Legacy samples are whole bytes, so they are accepted a block at a time
+	bool blocks = scratch.KdfProfile().Generator == OSP_GENERATOR_LEGACY;
+
+	size_t plen = 0;
+	bool verified = false;
+	int safety = 10000;
 
-				if (pos >= store.HashSize())
+	while (success && !verified)
+	{
+		while (success && plen < length)
+		{
+			if (blocks)
+			{
+				if (pos < scratch.HashSize() || refill())
 				{
-					// Generate a new hash
-					HashVector tmp(store);
-					success = success && hashbuff.MoveTo(tmp, error);
-					success = success && hashbuff.Realloc(error);
-					success = success && store.StrongHash(tmp, hashbuff, error);
-					tmp.Destroy();
-					pos = 0;
+					size_t used;
+					plen += sampler.Accept(
+						&hashbuff[pos], scratch.HashSize() - pos, &password[plen], length - plen, used
+					);
+					pos += used;
 				}
 			}
+			else
+			{
+				char ch;
+				if (feed() && sampler.Next(ch))
+					password[plen++] = ch;
+			}
+		}
 
-			if (success)
+		if (success && scratch.KdfProfile().Generator == OSP_GENERATOR_CONSTRUCTIVE)
+		{
+			success = PlaceRequired(sampler, feed, password, length, recipe, error);
+			verified = success;
+			assert(!success || recipe.Verified(password, length));
+		}
+		else if (success)
+		{
+			verified = recipe.Verified(password, length);
+			if (!verified)
 			{
-				verified = recipe.Verified(password, length);
-				if (!verified)
+				if (--safety < 0)
+					success = OS::SetOSPError(
+						error, OSP_API_Error, OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS
+					);
+				else
 				{
-					if (--safety < 0)
-						success = OS::SetOSPError(
-							error, OSP_API_Error, OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS
-						);
-					else
-					{
-						plen = length - 1;
-						for (size_t n = 0; n < plen; n++)
-							password[n] = password[n + 1];
-						password[plen] = 0;
-					}
+					plen = length - 1;
+					for (size_t n = 0; n < plen; n++)
+						password[n] = password[n + 1];
+					password[plen] = 0;
 				}
 			}
 		}
 	}
 
-	hashbuff.Destroy();
-
+	success = expansion.End(error) && success;
 	return success;
 }
+
+#pragma region Static Recipes
+
+template bool StrongPassword::generatePassword(
+	const string&, Cipher&, PasswordVector&, size_t, const PinRecipe&, OSPError*
+);
+template bool StrongPassword::generatePassword(
+	const string&, Cipher&, PasswordVector&, size_t, const AlphanumericRecipe&, OSPError*
+);
+template bool StrongPassword::generatePassword(
+	const string&, Cipher&, PasswordVector&, size_t, const StrongRecipe&, OSPError*
+);
+
+#pragma endregion
@@ -23,26 +23,52 @@ Software.
 #pragma once
 #include "osp.h"
 
+#include <deque>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "password.h"
 #include "securestore.h"
 #include "recipe.h"
+#include "threadpool.h"
 
 namespace OneStrongPassword
 {
+	// Worker threads for parallel generation. Every worker strong hashes in its
+	// own scratch store, with its own cryptography state and secure heap.
+	class PasswordPool : public ThreadPool
+	{
+	public:
+		PasswordPool() { }
+		virtual ~PasswordPool() { Stop(); }
+
+		bool Start(size_t threads, OSPError* error = nullptr);
+		void Stop();
+
+		SecureStore& Scratch(size_t worker) { return scratch[worker]; }
+
+		// Makes sure every scratch store has room for lanes strong mnemonics of
+		// size bytes and their hashes, and strong hashes with profile. Resetting a
+		// store clears the exposure count, so this is done before anything is dispensed.
+		bool Prepare(size_t lanes, size_t size, const OSPKdfProfile& profile, OSPError* error = nullptr);
+
+	private:
+		std::deque<SecureStore> scratch;
+	};
 
 	class StrongPassword
 	{
 	public:
 		typedef SecureStore::byte byte;
 
-		StrongPassword(SecureStore& store, const std::string& name)
+		// The name is viewed, not copied, and has to outlive the StrongPassword
+		StrongPassword(SecureStore& store, std::string_view name)
 			: store(store), name(name), stored(true) { }
 
 		virtual ~StrongPassword() { if (stored) Destroy(nullptr); }
 
-		const std::string& Name() const { return name; }
+		std::string_view Name() const { return name; }
 
 		size_t DataSize() const { return stored ? store.DataSize(name) : 0; }
 
@@ -68,6 +94,48 @@ namespace OneStrongPassword
 			OSPError* error = nullptr
 		);
 
+		// Same as above for a StaticRecipe, the generator specialised for it.
+		// Policies are instantiated at the bottom of strongpassword.cpp.
+		template<typename Policy>
+		bool GeneratePassword(
+			const std::string& mnemonic,
+			Cipher& cipher,
+			PasswordVector& password,
+			size_t length,
+			OSPError* error = nullptr
+		) { return generatePassword(mnemonic, cipher, password, length, Policy(), error); }
+
+		// One password per mnemonic, all derived with a single dispense of the
+		// strong password and strong hashed as many at a time as the hash lanes allow
+		bool GeneratePasswords(
+			const std::vector<std::string>& mnemonics,
+			Cipher& cipher,
+			PasswordVector* const passwords[],
+			size_t length,
+			const Recipe& recipe,
+			OSPError* error = nullptr
+		);
+
+		bool GeneratePasswords(
+			const std::vector<std::string>& mnemonics,
+			Cipher& cipher,
+			PasswordVector* const passwords[],
+			const size_t lengths[],
+			const Recipe* const recipes[],
+			OSPError* error = nullptr
+		);
+
+		// Same passwords as above, groups of hash lanes spread across the pool's workers
+		bool GeneratePasswords(
+			const std::vector<std::string>& mnemonics,
+			Cipher& cipher,
+			PasswordVector* const passwords[],
+			const size_t lengths[],
+			const Recipe* const recipes[],
+			PasswordPool& pool,
+			OSPError* error = nullptr
+		);
+
 		bool DestroyPassword(PasswordVector& password, OSPError* error = nullptr);
 		bool ReleasePassword(PasswordVector& password, OSPError* error = nullptr);
 
@@ -80,17 +148,75 @@ namespace OneStrongPassword
 			const std::string& mnemonic, Cipher& cipher, ByteVector& retbuff, OSPError* error
 		);
 
+		template<typename R>
 		bool GeneratePassword(
 			ByteVector& strongmnemonic,
 			PasswordVector& password,
 			size_t length,
-			const Recipe& recipe,
+			const R& recipe,
+			OSPError* error
+		);
+
+		bool GeneratePasswords(
+			const std::vector<std::string>& mnemonics,
+			Cipher& cipher,
+			PasswordVector* const passwords[],
+			const size_t lengths[],
+			const Recipe* const recipes[],
+			PasswordPool* pool,
+			OSPError* error
+		);
+
+		// Allocates up to lanes strong mnemonic buffers of size bytes and hashes,
+		// failing only when not even one fits
+		bool AllocLanes(
+			SecureStore& scratch,
+			size_t lanes,
+			size_t size,
+			std::deque<ByteVector>& buffers,
+			std::deque<HashVector>& hashes,
+			OSPError* error
+		);
+
+		bool DestroyLanes(std::deque<ByteVector>& buffers, std::deque<HashVector>& hashes, OSPError* error);
+
+		bool GenerateLanes(
+			SecureStore& scratch,
+			const std::string* const mnemonics,
+			size_t count,
+			const ByteVector& strongbuff,
+			std::deque<ByteVector>& buffers,
+			std::deque<HashVector>& hashes,
+			PasswordVector* const passwords[],
+			const size_t lengths[],
+			const Recipe* const recipes[],
+			OSPError* error
+		);
+
+		// R is a Recipe or a StaticRecipe
+		template<typename R>
+		bool PasswordFromHash(
+			SecureStore& scratch,
+			HashVector& hashbuff,
+			PasswordVector& password,
+			size_t length,
+			const R& recipe,
 			OSPError* error
 		);
 
 	private:
+		template<typename R>
+		bool generatePassword(
+			const std::string& mnemonic,
+			Cipher& cipher,
+			PasswordVector& password,
+			size_t length,
+			const R& recipe,
+			OSPError* error
+		);
+
 		SecureStore& store;
-		const std::string name;
+		const std::string_view name;
 		bool stored;
 	};
 }
@@ -0,0 +1,203 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "threadpool.h"
+#include "os.h"
+
+#include <system_error>
+
+using namespace OneStrongPassword;
+using namespace std;
+
+size_t ThreadPool::MaxThreads()
+{
+	size_t threads = thread::hardware_concurrency();
+	return threads ? threads : 1;
+}
+
+bool ThreadPool::Start(size_t threads, OSPError* error)
+{
+	if (!workers.empty())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_ALREADY_INITIALIZED);
+
+	if (!threads)
+		threads = MaxThreads();
+
+	queues.resize(threads);
+
+	try
+	{
+		for (size_t worker = 0; worker < threads; worker++)
+			workers.emplace_back(&ThreadPool::Work, this, worker);
+	}
+	catch (const system_error& e)
+	{
+		Stop();
+		return OS::SetOSPError(error, OSP_System_Error, e.code().value());
+	}
+
+	return true;
+}
+
+void ThreadPool::Stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	started.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+
+	workers.clear();
+	queues.clear();
+	stopping = false;
+}
+
+bool ThreadPool::Run(size_t count, const Task& task, OSPError* error)
+{
+	lock_guard<mutex> serialized(running);
+
+	if (workers.empty())
+	{
+		// Without workers the tasks run in order on the calling thread
+		bool success = true;
+		for (size_t n = 0; success && n < count; n++)
+			success = task(0, n, error);
+		return success;
+	}
+
+	unique_lock<mutex> guard(lock);
+
+	size_t threads = queues.size();
+	for (size_t worker = 0, first = 0; worker < threads; worker++)
+	{
+		size_t share = count / threads + (worker < count % threads ? 1 : 0);
+
+		lock_guard<mutex> queued(queues[worker].Lock);
+		for (size_t n = first; n < first + share; n++)
+			queues[worker].Tasks.push_back(n);
+		first += share;
+	}
+
+	current = &task;
+	remaining = count;
+	failed = false;
+	CLEAR_OSPError(failure);
+	generation++;
+
+	started.notify_all();
+	finished.wait(guard, [this] { return !remaining && !active; });
+
+	current = nullptr;
+
+	if (failed)
+	{
+		if (error)
+			*error = failure;
+		return false;
+	}
+	return true;
+}
+
+bool ThreadPool::Next(size_t worker, size_t& task)
+{
+	{
+		Queue& own = queues[worker];
+		lock_guard<mutex> guard(own.Lock);
+		if (!own.Tasks.empty())
+		{
+			task = own.Tasks.front();
+			own.Tasks.pop_front();
+			return true;
+		}
+	}
+
+	for (size_t n = 1; n < queues.size(); n++)
+	{
+		Queue& victim = queues[(worker + n) % queues.size()];
+		lock_guard<mutex> guard(victim.Lock);
+		if (!victim.Tasks.empty())
+		{
+			task = victim.Tasks.back();
+			victim.Tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::Work(size_t worker)
+{
+	size_t seen = 0;
+
+	for (;;)
+	{
+		const Task* task = nullptr;
+		{
+			unique_lock<mutex> guard(lock);
+			started.wait(guard, [&] { return stopping || (generation != seen && current); });
+			if (stopping)
+				return;
+			seen = generation;
+			task = current;
+			active++;
+		}
+
+		size_t done = 0;
+		size_t index = 0;
+
+		while (Next(worker, index))
+		{
+			bool skip = false;
+			{
+				lock_guard<mutex> guard(lock);
+				skip = failed;
+			}
+
+			if (!skip)
+			{
+				DECLARE_OSPError(taskError);
+				if (!(*task)(worker, index, &taskError))
+				{
+					lock_guard<mutex> guard(lock);
+					if (!failed)
+					{
+						failed = true;
+						failure = taskError;
+					}
+				}
+			}
+			done++;
+		}
+
+		{
+			lock_guard<mutex> guard(lock);
+			remaining -= done;
+			active--;
+			if (!remaining && !active)
+				finished.notify_all();
+		}
+	}
+}
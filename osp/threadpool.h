@@ -0,0 +1,87 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+#include "osp.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OneStrongPassword
+{
+	// Worker threads that run indexed tasks. Each worker starts on its own
+	// contiguous share of the tasks and, once that runs dry, steals from the
+	// far end of the other workers' shares, so uneven tasks still balance.
+	class ThreadPool
+	{
+	public:
+		// A task reports failure by returning false and setting error
+		typedef std::function<bool(size_t worker, size_t task, OSPError* error)> Task;
+
+		static size_t MaxThreads();
+
+		ThreadPool() { CLEAR_OSPError(failure); }
+		explicit ThreadPool(size_t threads) { CLEAR_OSPError(failure); Start(threads); }
+
+		virtual ~ThreadPool() { Stop(); }
+
+		size_t Threads() const { return workers.size(); }
+
+		// Starts threads workers, 0 for one per core
+		bool Start(size_t threads, OSPError* error = nullptr);
+		void Stop();
+
+		// Runs task for every index below count and waits for all of them. After
+		// a failure no further tasks start and the first failure's error is returned.
+		bool Run(size_t count, const Task& task, OSPError* error = nullptr);
+
+	private:
+		typedef struct Queue
+		{
+			std::mutex Lock;
+			std::deque<size_t> Tasks;
+		} Queue;
+
+		bool Next(size_t worker, size_t& task);
+		void Work(size_t worker);
+
+		std::vector<std::thread> workers;
+		std::deque<Queue> queues;
+
+		std::mutex running;
+		std::mutex lock;
+		std::condition_variable started;
+		std::condition_variable finished;
+
+		const Task* current = nullptr;
+		size_t generation = 0;
+		size_t remaining = 0;
+		size_t active = 0;
+		bool failed = false;
+		bool stopping = false;
+		OSPError failure;
+	};
+}
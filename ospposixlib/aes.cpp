@@ -0,0 +1,934 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "aes.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OSP_AESNI
+#endif
+
+using namespace OneStrongPassword;
+
+const uint8_t SBOX[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+const uint8_t INV_SBOX[256] = {
+	0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+	0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+	0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+	0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+	0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+	0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+	0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+	0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+	0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+	0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+	0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+	0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+	0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+	0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+	0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+	0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
+
+const uint8_t RCON[11] = { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+#pragma region Portable Kernels
+
+inline uint8_t xtime(uint8_t a) { return uint8_t((a << 1) ^ ((a & 0x80) ? 0x1b : 0)); }
+
+inline uint8_t mul(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+	for (; b; b >>= 1, a = xtime(a))
+		if (b & 1)
+			r ^= a;
+	return r;
+}
+
+inline void addRoundKey(uint8_t* s, const uint8_t* k)
+{
+	for (int n = 0; n < 16; n++)
+		s[n] ^= k[n];
+}
+
+void encryptBlock(const uint8_t* rk, size_t rounds, uint8_t* s)
+{
+	uint8_t t[16];
+
+	addRoundKey(s, rk);
+	for (size_t r = 1; r <= rounds; r++)
+	{
+		for (int c = 0; c < 4; c++)
+			for (int row = 0; row < 4; row++)
+				t[row + 4 * c] = SBOX[s[row + 4 * ((c + row) % 4)]];
+
+		if (r < rounds)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				uint8_t* a = t + 4 * c;
+				uint8_t all = a[0] ^ a[1] ^ a[2] ^ a[3];
+				uint8_t a0 = a[0];
+				a[0] ^= all ^ xtime(a[0] ^ a[1]);
+				a[1] ^= all ^ xtime(a[1] ^ a[2]);
+				a[2] ^= all ^ xtime(a[2] ^ a[3]);
+				a[3] ^= all ^ xtime(a[3] ^ a0);
+			}
+		}
+
+		memcpy(s, t, 16);
+		addRoundKey(s, rk + 16 * r);
+	}
+}
+
+void decryptBlock(const uint8_t* rk, size_t rounds, uint8_t* s)
+{
+	uint8_t t[16];
+
+	addRoundKey(s, rk + 16 * rounds);
+	for (size_t r = rounds; r-- > 0;)
+	{
+		for (int c = 0; c < 4; c++)
+			for (int row = 0; row < 4; row++)
+				t[row + 4 * ((c + row) % 4)] = INV_SBOX[s[row + 4 * c]];
+
+		addRoundKey(t, rk + 16 * r);
+
+		if (r > 0)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				uint8_t* a = t + 4 * c;
+				uint8_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+				a[0] = mul(a0, 14) ^ mul(a1, 11) ^ mul(a2, 13) ^ mul(a3, 9);
+				a[1] = mul(a0, 9) ^ mul(a1, 14) ^ mul(a2, 11) ^ mul(a3, 13);
+				a[2] = mul(a0, 13) ^ mul(a1, 9) ^ mul(a2, 14) ^ mul(a3, 11);
+				a[3] = mul(a0, 11) ^ mul(a1, 13) ^ mul(a2, 9) ^ mul(a3, 14);
+			}
+		}
+
+		memcpy(s, t, 16);
+	}
+}
+
+void encryptCbc(const uint8_t* rk, size_t rounds, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size)
+{
+	uint8_t chain[16];
+	memcpy(chain, iv, 16);
+
+	for (size_t pos = 0; pos + 16 <= size; pos += 16)
+	{
+		for (int n = 0; n < 16; n++)
+			chain[n] ^= in[pos + n];
+		encryptBlock(rk, rounds, chain);
+		memcpy(out + pos, chain, 16);
+	}
+}
+
+void decryptCbc(const uint8_t* rk, size_t rounds, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size)
+{
+	uint8_t chain[16], block[16], next[16];
+	memcpy(chain, iv, 16);
+
+	for (size_t pos = 0; pos + 16 <= size; pos += 16)
+	{
+		memcpy(next, in + pos, 16);
+		memcpy(block, next, 16);
+		decryptBlock(rk, rounds, block);
+		for (int n = 0; n < 16; n++)
+			out[pos + n] = block[n] ^ chain[n];
+		memcpy(chain, next, 16);
+	}
+}
+
+inline uint64_t loadBe64(const uint8_t* p)
+{
+	uint64_t v = 0;
+	for (int n = 0; n < 8; n++)
+		v = (v << 8) | p[n];
+	return v;
+}
+
+inline void storeBe64(uint8_t* p, uint64_t v)
+{
+	for (int n = 7; n >= 0; n--, v >>= 8)
+		p[n] = uint8_t(v);
+}
+
+inline void counterBlock(const uint8_t* nonce, uint32_t counter, uint8_t* block)
+{
+	memcpy(block, nonce, 12);
+	block[12] = uint8_t(counter >> 24);
+	block[13] = uint8_t(counter >> 16);
+	block[14] = uint8_t(counter >> 8);
+	block[15] = uint8_t(counter);
+}
+
+// Multiplies x by h in GF(2^128), bits reflected as SP 800-38D has them.
+// Masks rather than branches, so the time taken depends on neither.
+void gfmul(uint8_t* x, const uint8_t* h)
+{
+	uint64_t zh = 0, zl = 0;
+	uint64_t vh = loadBe64(h), vl = loadBe64(h + 8);
+	for (int i = 0; i < 128; i++)
+	{
+		uint64_t bit = 0 - uint64_t((x[i / 8] >> (7 - i % 8)) & 1);
+		zh ^= vh & bit;
+		zl ^= vl & bit;
+
+		uint64_t carry = 0 - (vl & 1);
+		vl = (vl >> 1) | (vh << 63);
+		vh = (vh >> 1) ^ (0xe100000000000000ULL & carry);
+	}
+	storeBe64(x, zh);
+	storeBe64(x + 8, zl);
+}
+
+// Hashes size bytes into y, the last block padded with zeros
+void ghash(const uint8_t* h, uint8_t* y, const uint8_t* data, size_t size)
+{
+	for (size_t pos = 0; pos < size; pos += 16)
+	{
+		size_t n = size - pos < 16 ? size - pos : 16;
+		for (size_t b = 0; b < n; b++)
+			y[b] ^= data[pos + b];
+		gfmul(y, h);
+	}
+}
+
+// Counter mode from counter, each ciphertext block hashed into y as it is had
+void gcmCtr(
+	const uint8_t* rk, size_t rounds, const uint8_t* h, const uint8_t* nonce, uint32_t counter, uint8_t* y,
+	const uint8_t* in, uint8_t* out, size_t size, bool decrypt
+) {
+	uint8_t ks[16];
+	for (size_t pos = 0; pos < size; pos += 16, counter++)
+	{
+		counterBlock(nonce, counter, ks);
+		encryptBlock(rk, rounds, ks);
+
+		size_t n = size - pos < 16 ? size - pos : 16;
+		for (size_t b = 0; b < n; b++)
+		{
+			uint8_t x = in[pos + b];
+			uint8_t o = x ^ ks[b];
+			out[pos + b] = o;
+			y[b] ^= decrypt ? x : o;
+		}
+		gfmul(y, h);
+	}
+	explicit_bzero(ks, sizeof(ks));
+}
+
+#pragma endregion
+
+#ifdef OSP_AESNI
+
+#pragma region AES-NI Kernels
+
+__attribute__((target("aes,sse2")))
+void invertKeysNi(const uint8_t* enc, size_t rounds, uint8_t* dec)
+{
+	_mm_store_si128((__m128i*)dec, _mm_load_si128((const __m128i*)(enc + 16 * rounds)));
+	for (size_t r = 1; r < rounds; r++)
+		_mm_store_si128(
+			(__m128i*)(dec + 16 * r), _mm_aesimc_si128(_mm_load_si128((const __m128i*)(enc + 16 * (rounds - r))))
+		);
+	_mm_store_si128((__m128i*)(dec + 16 * rounds), _mm_load_si128((const __m128i*)enc));
+}
+
+__attribute__((target("aes,sse2")))
+void encryptCbcNi(const uint8_t* rk, size_t rounds, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size)
+{
+	__m128i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm_load_si128((const __m128i*)(rk + 16 * r));
+
+	__m128i chain = _mm_loadu_si128((const __m128i*)iv);
+	for (size_t pos = 0; pos + 16 <= size; pos += 16)
+	{
+		chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i*)(in + pos)));
+		chain = _mm_xor_si128(chain, k[0]);
+		for (size_t r = 1; r < rounds; r++)
+			chain = _mm_aesenc_si128(chain, k[r]);
+		chain = _mm_aesenclast_si128(chain, k[rounds]);
+		_mm_storeu_si128((__m128i*)(out + pos), chain);
+	}
+}
+
+// Independent chains are encrypted eight at a time, one block of each per
+// pass so their rounds overlap in the AES unit. A lane whose chain ends takes
+// the next one waiting; idle lanes encrypt a scratch block nothing keeps.
+__attribute__((target("aes,sse2")))
+void encryptCbcNiLanes(
+	const uint8_t* rk, size_t rounds,
+	const uint8_t* const iv[], const uint8_t* const in[], uint8_t* const out[], const size_t size[], size_t count
+) {
+	__m128i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm_load_si128((const __m128i*)(rk + 16 * r));
+
+	alignas(16) uint8_t scratch[16] = { };
+
+	__m128i chain[8];
+	const uint8_t* src[8];
+	uint8_t* dst[8];
+	size_t step[8], left[8];
+
+	for (int n = 0; n < 8; n++)
+	{
+		chain[n] = _mm_setzero_si128();
+		src[n] = dst[n] = scratch;
+		step[n] = left[n] = 0;
+	}
+
+	size_t next = 0;
+	for (;;)
+	{
+		size_t active = 0, blocks = SIZE_MAX;
+		for (int n = 0; n < 8; n++)
+		{
+			while (!left[n] && next < count)
+			{
+				chain[n] = _mm_loadu_si128((const __m128i*)iv[next]);
+				src[n] = in[next];
+				dst[n] = out[next];
+				step[n] = 16;
+				left[n] = size[next++] / 16;
+			}
+
+			if (!left[n])
+			{
+				src[n] = dst[n] = scratch;
+				step[n] = 0;
+			}
+			else
+			{
+				active++;
+				blocks = blocks < left[n] ? blocks : left[n];
+			}
+		}
+
+		if (!active)
+			break;
+
+		// Until the shortest chain ends every busy lane has a block
+		for (size_t b = 0; b < blocks; b++)
+		{
+#pragma GCC unroll 8
+			for (int n = 0; n < 8; n++)
+				chain[n] = _mm_xor_si128(_mm_xor_si128(chain[n], _mm_loadu_si128((const __m128i*)src[n])), k[0]);
+			for (size_t r = 1; r < rounds; r++)
+			{
+#pragma GCC unroll 8
+				for (int n = 0; n < 8; n++)
+					chain[n] = _mm_aesenc_si128(chain[n], k[r]);
+			}
+#pragma GCC unroll 8
+			for (int n = 0; n < 8; n++)
+			{
+				chain[n] = _mm_aesenclast_si128(chain[n], k[rounds]);
+				_mm_storeu_si128((__m128i*)dst[n], chain[n]);
+				src[n] += step[n];
+				dst[n] += step[n];
+			}
+		}
+
+		for (int n = 0; n < 8; n++)
+			left[n] -= left[n] ? blocks : 0;
+	}
+}
+
+// Blocks decrypt independently, so eight are kept in flight through the AES
+// unit at once, then each is chained to the ciphertext block before it. All
+// ciphertext a group needs is loaded before it is stored, so out may be in.
+// The groups' loops are unrolled so their blocks stay in registers.
+__attribute__((target("aes,sse2")))
+void decryptCbcNi(const uint8_t* rk, size_t rounds, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size)
+{
+	__m128i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm_load_si128((const __m128i*)(rk + 16 * r));
+
+	__m128i chain = _mm_loadu_si128((const __m128i*)iv);
+
+	size_t pos = 0;
+	for (; pos + 8 * 16 <= size; pos += 8 * 16)
+	{
+		__m128i next[8], block[8];
+#pragma GCC unroll 8
+		for (int n = 0; n < 8; n++)
+		{
+			next[n] = _mm_loadu_si128((const __m128i*)(in + pos + 16 * n));
+			block[n] = _mm_xor_si128(next[n], k[0]);
+		}
+		for (size_t r = 1; r < rounds; r++)
+		{
+#pragma GCC unroll 8
+			for (int n = 0; n < 8; n++)
+				block[n] = _mm_aesdec_si128(block[n], k[r]);
+		}
+#pragma GCC unroll 8
+		for (int n = 0; n < 8; n++)
+			block[n] = _mm_aesdeclast_si128(block[n], k[rounds]);
+
+		_mm_storeu_si128((__m128i*)(out + pos), _mm_xor_si128(block[0], chain));
+#pragma GCC unroll 8
+		for (int n = 1; n < 8; n++)
+			_mm_storeu_si128((__m128i*)(out + pos + 16 * n), _mm_xor_si128(block[n], next[n - 1]));
+		chain = next[7];
+	}
+
+	for (; pos + 16 <= size; pos += 16)
+	{
+		__m128i next = _mm_loadu_si128((const __m128i*)(in + pos));
+		__m128i block = _mm_xor_si128(next, k[0]);
+		for (size_t r = 1; r < rounds; r++)
+			block = _mm_aesdec_si128(block, k[r]);
+		block = _mm_aesdeclast_si128(block, k[rounds]);
+		_mm_storeu_si128((__m128i*)(out + pos), _mm_xor_si128(block, chain));
+		chain = next;
+	}
+}
+
+// Same as decryptCbcNi sixteen blocks at a time, four to a 512 bit register.
+// What is left over goes through decryptCbcNi.
+__attribute__((target("aes,vaes,avx512f")))
+void decryptCbcVaes(const uint8_t* rk, size_t rounds, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size)
+{
+	__m512i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)(rk + 16 * r)));
+
+	__m128i chain = _mm_loadu_si128((const __m128i*)iv);
+
+	size_t pos = 0;
+	for (; pos + 16 * 16 <= size; pos += 16 * 16)
+	{
+		__m512i next[4], prev[4], block[4];
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+			next[n] = _mm512_loadu_si512((const void*)(in + pos + 64 * n));
+
+		// The blocks each is chained to, the chain then the ciphertext a block back
+		prev[0] = _mm512_alignr_epi64(next[0], _mm512_broadcast_i32x4(chain), 6);
+#pragma GCC unroll 4
+		for (int n = 1; n < 4; n++)
+			prev[n] = _mm512_loadu_si512((const void*)(in + pos + 64 * n - 16));
+		chain = _mm512_extracti32x4_epi32(next[3], 3);
+
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+			block[n] = _mm512_xor_si512(next[n], k[0]);
+		for (size_t r = 1; r < rounds; r++)
+		{
+#pragma GCC unroll 4
+			for (int n = 0; n < 4; n++)
+				block[n] = _mm512_aesdec_epi128(block[n], k[r]);
+		}
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+			block[n] = _mm512_aesdeclast_epi128(block[n], k[rounds]);
+
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+			_mm512_storeu_si512((void*)(out + pos + 64 * n), _mm512_xor_si512(block[n], prev[n]));
+	}
+
+	if (pos < size)
+	{
+		alignas(16) uint8_t tail[16];
+		_mm_store_si128((__m128i*)tail, chain);
+		decryptCbcNi(rk, rounds, tail, in + pos, out + pos, size - pos);
+	}
+}
+
+// GHASH on PCLMULQDQ works on byte reversed blocks, which makes the field's
+// reflected bits plain carry-less products shifted left by one (Gueron and
+// Kounavis, Intel). Products are summed unreduced, so blocks hashed together
+// take a single reduction.
+__attribute__((target("pclmul,sse2")))
+inline void clmulAdd(__m128i a, __m128i b, __m128i& lo, __m128i& mid, __m128i& hi)
+{
+	lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00));
+	mid = _mm_xor_si128(mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01)));
+	hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11));
+}
+
+__attribute__((target("pclmul,sse2")))
+inline __m128i clmulReduce(__m128i lo, __m128i mid, __m128i hi)
+{
+	lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+	hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+	// The 256 bit product shifted left by one
+	__m128i lc = _mm_srli_epi32(lo, 31);
+	__m128i hc = _mm_srli_epi32(hi, 31);
+	lo = _mm_or_si128(_mm_slli_epi32(lo, 1), _mm_slli_si128(lc, 4));
+	hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(hi, 1), _mm_slli_si128(hc, 4)), _mm_srli_si128(lc, 12));
+
+	// Reduced modulo x^128 + x^7 + x^2 + x + 1
+	__m128i t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+	__m128i carry = _mm_srli_si128(t, 4);
+	lo = _mm_xor_si128(lo, _mm_slli_si128(t, 12));
+
+	__m128i r = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+	r = _mm_xor_si128(_mm_xor_si128(r, carry), lo);
+	return _mm_xor_si128(hi, r);
+}
+
+__attribute__((target("pclmul,sse2")))
+inline __m128i clmulMul(__m128i a, __m128i b)
+{
+	__m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+	clmulAdd(a, b, lo, mid, hi);
+	return clmulReduce(lo, mid, hi);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i byteSwap(__m128i x)
+{
+	return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+// H^16 down to H^1, the order blocks hashed together are multiplied in
+__attribute__((target("pclmul,sse2,ssse3")))
+void gcmPowersNi(const uint8_t* hash, uint8_t* powers)
+{
+	__m128i h = byteSwap(_mm_load_si128((const __m128i*)hash));
+	__m128i p = h;
+	for (int n = 15; n >= 0; n--)
+	{
+		_mm_store_si128((__m128i*)(powers + 16 * n), p);
+		p = clmulMul(p, h);
+	}
+}
+
+// Hashes size bytes into y, the last block padded with zeros
+__attribute__((target("pclmul,sse2,ssse3")))
+__m128i ghashNi(const uint8_t* powers, __m128i y, const uint8_t* data, size_t size)
+{
+	const __m128i h = _mm_load_si128((const __m128i*)(powers + 16 * 15));
+	for (size_t pos = 0; pos < size; pos += 16)
+	{
+		alignas(16) uint8_t block[16] = { };
+		memcpy(block, data + pos, size - pos < 16 ? size - pos : 16);
+		y = clmulMul(_mm_xor_si128(y, byteSwap(_mm_load_si128((const __m128i*)block))), h);
+	}
+	return y;
+}
+
+// Counter mode eight blocks at a time as decryptCbcNi has them in flight,
+// then the eight ciphertext blocks hashed into y with one reduction while the
+// next group's rounds start. The counter is kept byte reversed, its 32 bits
+// in the low lane where a plain add increments them.
+__attribute__((target("aes,pclmul,sse2,ssse3")))
+__m128i gcmCtrNi(
+	const uint8_t* rk, size_t rounds, const uint8_t* powers, const uint8_t* nonce, uint32_t counter, __m128i y,
+	const uint8_t* in, uint8_t* out, size_t size, bool decrypt
+) {
+	__m128i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm_load_si128((const __m128i*)(rk + 16 * r));
+
+	__m128i h[8];
+	for (int n = 0; n < 8; n++)
+		h[n] = _mm_load_si128((const __m128i*)(powers + 16 * (8 + n)));
+
+	alignas(16) uint8_t block[16];
+	counterBlock(nonce, counter, block);
+	__m128i ctr = byteSwap(_mm_load_si128((const __m128i*)block));
+	const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+
+	size_t pos = 0;
+	for (; pos + 8 * 16 <= size; pos += 8 * 16)
+	{
+		__m128i ks[8], c[8];
+#pragma GCC unroll 8
+		for (int n = 0; n < 8; n++)
+		{
+			ks[n] = _mm_xor_si128(byteSwap(ctr), k[0]);
+			ctr = _mm_add_epi32(ctr, one);
+		}
+		for (size_t r = 1; r < rounds; r++)
+		{
+#pragma GCC unroll 8
+			for (int n = 0; n < 8; n++)
+				ks[n] = _mm_aesenc_si128(ks[n], k[r]);
+		}
+#pragma GCC unroll 8
+		for (int n = 0; n < 8; n++)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(in + pos + 16 * n));
+			__m128i o = _mm_xor_si128(_mm_aesenclast_si128(ks[n], k[rounds]), x);
+			_mm_storeu_si128((__m128i*)(out + pos + 16 * n), o);
+			c[n] = byteSwap(decrypt ? x : o);
+		}
+
+		__m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+		c[0] = _mm_xor_si128(c[0], y);
+#pragma GCC unroll 8
+		for (int n = 0; n < 8; n++)
+			clmulAdd(c[n], h[n], lo, mid, hi);
+		y = clmulReduce(lo, mid, hi);
+	}
+
+	for (; pos < size; pos += 16)
+	{
+		__m128i ks = _mm_xor_si128(byteSwap(ctr), k[0]);
+		ctr = _mm_add_epi32(ctr, one);
+		for (size_t r = 1; r < rounds; r++)
+			ks = _mm_aesenc_si128(ks, k[r]);
+		ks = _mm_aesenclast_si128(ks, k[rounds]);
+
+		// The last block may be partial, it is hashed padded with zeros
+		size_t n = size - pos < 16 ? size - pos : 16;
+		alignas(16) uint8_t x[16] = { }, o[16];
+		memcpy(x, in + pos, n);
+		_mm_store_si128((__m128i*)o, _mm_xor_si128(ks, _mm_load_si128((const __m128i*)x)));
+		memcpy(out + pos, o, n);
+		memset(o + n, 0, 16 - n);
+
+		__m128i c = byteSwap(_mm_load_si128((const __m128i*)(decrypt ? x : o)));
+		y = clmulMul(_mm_xor_si128(y, c), h[7]);
+
+		explicit_bzero(x, sizeof(x));
+		explicit_bzero(o, sizeof(o));
+	}
+
+	return y;
+}
+
+// Same as gcmCtrNi sixteen blocks at a time, four to a 512 bit register for
+// both the AES rounds and the carry-less products. Size is whole groups.
+__attribute__((target("aes,pclmul,sse2,ssse3,vaes,vpclmulqdq,avx512f,avx512bw")))
+__m128i gcmCtrVaes(
+	const uint8_t* rk, size_t rounds, const uint8_t* powers, const uint8_t* nonce, uint32_t counter, __m128i y,
+	const uint8_t* in, uint8_t* out, size_t size, bool decrypt
+) {
+	const __m512i swap = _mm512_broadcast_i32x4(
+		_mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+	);
+
+	__m512i k[15];
+	for (size_t r = 0; r <= rounds; r++)
+		k[r] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)(rk + 16 * r)));
+
+	__m512i h[4];
+	for (int n = 0; n < 4; n++)
+		h[n] = _mm512_load_si512((const void*)(powers + 64 * n));
+
+	alignas(16) uint8_t block[16];
+	counterBlock(nonce, counter, block);
+	__m512i ctr = _mm512_add_epi32(
+		_mm512_broadcast_i32x4(byteSwap(_mm_load_si128((const __m128i*)block))),
+		_mm512_set_epi32(0, 0, 0, 3, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0)
+	);
+	const __m512i four = _mm512_set_epi32(0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4);
+
+	for (size_t pos = 0; pos + 16 * 16 <= size; pos += 16 * 16)
+	{
+		__m512i ks[4], c[4];
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+		{
+			ks[n] = _mm512_xor_si512(_mm512_shuffle_epi8(ctr, swap), k[0]);
+			ctr = _mm512_add_epi32(ctr, four);
+		}
+		for (size_t r = 1; r < rounds; r++)
+		{
+#pragma GCC unroll 4
+			for (int n = 0; n < 4; n++)
+				ks[n] = _mm512_aesenc_epi128(ks[n], k[r]);
+		}
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+		{
+			__m512i x = _mm512_loadu_si512((const void*)(in + pos + 64 * n));
+			__m512i o = _mm512_xor_si512(_mm512_aesenclast_epi128(ks[n], k[rounds]), x);
+			_mm512_storeu_si512((void*)(out + pos + 64 * n), o);
+			c[n] = _mm512_shuffle_epi8(decrypt ? x : o, swap);
+		}
+
+		__m512i lo = _mm512_setzero_si512(), mid = _mm512_setzero_si512(), hi = _mm512_setzero_si512();
+		c[0] = _mm512_xor_si512(c[0], _mm512_inserti32x4(_mm512_setzero_si512(), y, 0));
+#pragma GCC unroll 4
+		for (int n = 0; n < 4; n++)
+		{
+			lo = _mm512_xor_si512(lo, _mm512_clmulepi64_epi128(c[n], h[n], 0x00));
+			mid = _mm512_xor_si512(mid, _mm512_xor_si512(
+				_mm512_clmulepi64_epi128(c[n], h[n], 0x10), _mm512_clmulepi64_epi128(c[n], h[n], 0x01)
+			));
+			hi = _mm512_xor_si512(hi, _mm512_clmulepi64_epi128(c[n], h[n], 0x11));
+		}
+
+		// The four lanes' sums folded into one before the reduction
+		__m128i l = _mm_xor_si128(
+			_mm_xor_si128(_mm512_extracti32x4_epi32(lo, 0), _mm512_extracti32x4_epi32(lo, 1)),
+			_mm_xor_si128(_mm512_extracti32x4_epi32(lo, 2), _mm512_extracti32x4_epi32(lo, 3))
+		);
+		__m128i m = _mm_xor_si128(
+			_mm_xor_si128(_mm512_extracti32x4_epi32(mid, 0), _mm512_extracti32x4_epi32(mid, 1)),
+			_mm_xor_si128(_mm512_extracti32x4_epi32(mid, 2), _mm512_extracti32x4_epi32(mid, 3))
+		);
+		__m128i u = _mm_xor_si128(
+			_mm_xor_si128(_mm512_extracti32x4_epi32(hi, 0), _mm512_extracti32x4_epi32(hi, 1)),
+			_mm_xor_si128(_mm512_extracti32x4_epi32(hi, 2), _mm512_extracti32x4_epi32(hi, 3))
+		);
+		y = clmulReduce(l, m, u);
+	}
+
+	return y;
+}
+
+// Whole groups of sixteen go through gcmCtrVaes when wide, the rest through
+// gcmCtrNi. The lengths block and E(J0) finish the tag.
+__attribute__((target("aes,pclmul,sse2,ssse3")))
+void gcmNi(
+	const uint8_t* rk, size_t rounds, const uint8_t* powers, const uint8_t* nonce, const uint8_t* aad, size_t aadsize,
+	const uint8_t* in, uint8_t* out, size_t size, bool decrypt, uint8_t* tag, bool wide
+) {
+	__m128i y = ghashNi(powers, _mm_setzero_si128(), aad, aadsize);
+
+	size_t pos = wide ? size - size % (16 * 16) : 0;
+	if (pos)
+		y = gcmCtrVaes(rk, rounds, powers, nonce, 2, y, in, out, pos, decrypt);
+	y = gcmCtrNi(rk, rounds, powers, nonce, uint32_t(2 + pos / 16), y, in + pos, out + pos, size - pos, decrypt);
+
+	// Lengths in bits, byte reversed as the hashed blocks are
+	__m128i lengths = _mm_set_epi64x(int64_t(aadsize) * 8, int64_t(size) * 8);
+	y = clmulMul(_mm_xor_si128(y, lengths), _mm_load_si128((const __m128i*)(powers + 16 * 15)));
+
+	alignas(16) uint8_t block[16];
+	counterBlock(nonce, 1, block);
+	__m128i j0 = _mm_xor_si128(_mm_load_si128((const __m128i*)block), _mm_load_si128((const __m128i*)rk));
+	for (size_t r = 1; r < rounds; r++)
+		j0 = _mm_aesenc_si128(j0, _mm_load_si128((const __m128i*)(rk + 16 * r)));
+	j0 = _mm_aesenclast_si128(j0, _mm_load_si128((const __m128i*)(rk + 16 * rounds)));
+
+	_mm_storeu_si128((__m128i*)tag, _mm_xor_si128(byteSwap(y), j0));
+}
+
+#pragma endregion
+
+#endif
+
+bool Aes::HardwareSupported()
+{
+#ifdef OSP_AESNI
+	static const bool supported = __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+size_t Aes::EncryptLanes()
+{
+	return HardwareSupported() ? 8 : 1;
+}
+
+size_t Aes::DecryptLanes()
+{
+#ifdef OSP_AESNI
+	static const size_t lanes = !HardwareSupported() ? 1 :
+		__builtin_cpu_supports("vaes") && __builtin_cpu_supports("avx512f") ? 16 : 8;
+	return lanes;
+#else
+	return 1;
+#endif
+}
+
+size_t Aes::GcmLanes()
+{
+#ifdef OSP_AESNI
+	static const size_t lanes =
+		!HardwareSupported() || !__builtin_cpu_supports("pclmul") || !__builtin_cpu_supports("ssse3") ? 1 :
+		__builtin_cpu_supports("vaes") && __builtin_cpu_supports("vpclmulqdq") &&
+		__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ? 16 : 8;
+	return lanes;
+#else
+	return 1;
+#endif
+}
+
+bool Aes::Expand(const byte* key, size_t size)
+{
+	Zero();
+
+	if (size != 16 && size != 24 && size != 32)
+		return false;
+
+	size_t nk = size / 4;
+	rounds = nk + 6;
+
+	memcpy(enc, key, size);
+	for (size_t i = nk; i < 4 * (rounds + 1); i++)
+	{
+		uint8_t t[4];
+		memcpy(t, enc + 4 * (i - 1), 4);
+		if (i % nk == 0)
+		{
+			uint8_t t0 = t[0];
+			t[0] = SBOX[t[1]] ^ RCON[i / nk];
+			t[1] = SBOX[t[2]];
+			t[2] = SBOX[t[3]];
+			t[3] = SBOX[t0];
+		}
+		else if (nk > 6 && i % nk == 4)
+		{
+			for (int n = 0; n < 4; n++)
+				t[n] = SBOX[t[n]];
+		}
+		for (int n = 0; n < 4; n++)
+			enc[4 * i + n] = enc[4 * (i - nk) + n] ^ t[n];
+	}
+
+	hardware = HardwareSupported();
+#ifdef OSP_AESNI
+	if (hardware)
+		invertKeysNi(enc, rounds, dec);
+#endif
+
+	encryptBlock(enc, rounds, hash);
+
+	clmul = GcmLanes() > 1;
+#ifdef OSP_AESNI
+	if (clmul)
+		gcmPowersNi(hash, powers);
+#endif
+
+	return true;
+}
+
+void Aes::Zero()
+{
+	explicit_bzero(enc, sizeof(enc));
+	explicit_bzero(dec, sizeof(dec));
+	explicit_bzero(hash, sizeof(hash));
+	explicit_bzero(powers, sizeof(powers));
+	rounds = 0;
+	hardware = clmul = false;
+}
+
+void Aes::EncryptCbc(const byte* iv, const byte* data, byte* encrypted, size_t size) const
+{
+#ifdef OSP_AESNI
+	if (hardware)
+		return encryptCbcNi(enc, rounds, iv, data, encrypted, size);
+#endif
+	encryptCbc(enc, rounds, iv, data, encrypted, size);
+}
+
+void Aes::EncryptCbc(
+	const byte* const iv[], const byte* const data[], byte* const encrypted[], const size_t size[], size_t count
+) const {
+#ifdef OSP_AESNI
+	if (hardware)
+		return encryptCbcNiLanes(enc, rounds, iv, data, encrypted, size, count);
+#endif
+	for (size_t n = 0; n < count; n++)
+		encryptCbc(enc, rounds, iv[n], data[n], encrypted[n], size[n]);
+}
+
+void Aes::DecryptCbc(const byte* iv, const byte* encrypted, byte* decrypted, size_t size) const
+{
+#ifdef OSP_AESNI
+	if (hardware)
+	{
+		// Short of a full group the wide registers are only overhead
+		if (size >= 16 * BLOCK_SIZE && DecryptLanes() == 16)
+			return decryptCbcVaes(dec, rounds, iv, encrypted, decrypted, size);
+		return decryptCbcNi(dec, rounds, iv, encrypted, decrypted, size);
+	}
+#endif
+	decryptCbc(enc, rounds, iv, encrypted, decrypted, size);
+}
+
+void Aes::EncryptGcm(
+	const byte* nonce, const byte* aad, size_t aadsize, const byte* data, byte* encrypted, size_t size, byte* tag
+) const {
+	Gcm(nonce, aad, aadsize, data, encrypted, size, false, tag);
+}
+
+bool Aes::DecryptGcm(
+	const byte* nonce, const byte* aad, size_t aadsize, const byte* encrypted, byte* decrypted, size_t size,
+	const byte* tag
+) const {
+	byte computed[GCM_TAG_SIZE];
+	Gcm(nonce, aad, aadsize, encrypted, decrypted, size, true, computed);
+
+	// Compared in constant time
+	byte diff = 0;
+	for (size_t n = 0; n < GCM_TAG_SIZE; n++)
+		diff |= computed[n] ^ tag[n];
+	explicit_bzero(computed, sizeof(computed));
+
+	if (diff)
+		explicit_bzero(decrypted, size);
+	return !diff;
+}
+
+void Aes::Gcm(
+	const byte* nonce, const byte* aad, size_t aadsize, const byte* in, byte* out, size_t size, bool decrypt, byte* tag
+) const {
+#ifdef OSP_AESNI
+	if (hardware && clmul)
+		return gcmNi(enc, rounds, powers, nonce, aad, aadsize, in, out, size, decrypt, tag, GcmLanes() == 16);
+#endif
+	uint8_t y[16] = { };
+	ghash(hash, y, aad, aadsize);
+	gcmCtr(enc, rounds, hash, nonce, 2, y, in, out, size, decrypt);
+
+	uint8_t block[16];
+	storeBe64(block, uint64_t(aadsize) * 8);
+	storeBe64(block + 8, uint64_t(size) * 8);
+	ghash(hash, y, block, 16);
+
+	counterBlock(nonce, 1, block);
+	encryptBlock(enc, rounds, block);
+	for (int n = 0; n < 16; n++)
+		tag[n] = y[n] ^ block[n];
+
+	explicit_bzero(y, sizeof(y));
+	explicit_bzero(block, sizeof(block));
+}
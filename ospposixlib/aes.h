@@ -0,0 +1,101 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace OneStrongPassword
+{
+	// FIPS 197 AES with 128, 192 or 256 bit keys, AES-NI when the CPU has it
+	class Aes
+	{
+	public:
+		typedef uint8_t byte;
+
+		static const size_t BLOCK_SIZE = 16;
+		static const size_t MAX_KEY_SIZE = 32;
+
+		static const size_t GCM_NONCE_SIZE = 12;
+		static const size_t GCM_TAG_SIZE = 16;
+
+		static bool HardwareSupported();
+
+		// Chains the batch EncryptCbc advances together, 8 with AES-NI, otherwise 1
+		static size_t EncryptLanes();
+
+		// Blocks DecryptCbc has in flight at once, 16 with VAES on AVX-512, 8
+		// with AES-NI, otherwise 1. CBC encryption is always a block at a time.
+		static size_t DecryptLanes();
+
+		// Blocks GCM encrypts and hashes per pass, 16 with VAES and VPCLMULQDQ on
+		// AVX-512, 8 with AES-NI and PCLMULQDQ, otherwise 1
+		static size_t GcmLanes();
+
+		Aes() : rounds(0), hardware(false), clmul(false) { }
+		~Aes() { Zero(); }
+
+		bool Expand(const byte* key, size_t size);
+		void Zero();
+
+		size_t Rounds() const { return rounds; }
+
+		void EncryptCbc(const byte* iv, const byte* data, byte* encrypted, size_t size) const;
+		// Count independent chains, each from its own iv over its own size bytes.
+		// Same ciphertexts as EncryptCbc on each, out[n] may be data[n].
+		void EncryptCbc(
+			const byte* const iv[], const byte* const data[], byte* const encrypted[], const size_t size[], size_t count
+		) const;
+
+		void DecryptCbc(const byte* iv, const byte* encrypted, byte* decrypted, size_t size) const;
+
+		// NIST SP 800-38D GCM with GCM_NONCE_SIZE byte nonces, each block encrypted
+		// and hashed in the same pass. Authenticates aad without encrypting it.
+		// Out may be in.
+		void EncryptGcm(
+			const byte* nonce, const byte* aad, size_t aadsize, const byte* data, byte* encrypted, size_t size, byte* tag
+		) const;
+
+		// False when tag is not the one the ciphertext and aad hash to, the
+		// decrypted bytes are then not to be trusted and are zeroed.
+		bool DecryptGcm(
+			const byte* nonce, const byte* aad, size_t aadsize, const byte* encrypted, byte* decrypted, size_t size,
+			const byte* tag
+		) const;
+
+	private:
+		alignas(16) byte enc[15 * BLOCK_SIZE];
+		alignas(16) byte dec[15 * BLOCK_SIZE];
+		// GHASH key E(0), then its powers H^16 down to H^1 byte reversed for PCLMULQDQ
+		alignas(16) byte hash[BLOCK_SIZE];
+		alignas(64) byte powers[16 * BLOCK_SIZE];
+		size_t rounds;
+		bool hardware;
+		bool clmul;
+
+		void Gcm(
+			const byte* nonce, const byte* aad, size_t aadsize, const byte* in, byte* out, size_t size, bool decrypt,
+			byte* tag
+		) const;
+	};
+}
@@ -0,0 +1,627 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include <sys/random.h>
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <atomic>
+
+#include "../osp/cryptography.h"
+#include "../osp/bytevector.h"
+#include "../osp/drbg.h"
+#include "../osp/keycache.h"
+
+#include "aes.h"
+#include "sha512.h"
+
+using namespace OneStrongPassword;
+
+#pragma region OS Specific Functions
+
+const uint32_t KEY_BLOB_MAGIC = 0x4B505341; // "ASPK"
+
+typedef struct KeyBlob
+{
+	uint32_t Magic;
+	uint32_t Size;
+	uint8_t Key[Aes::MAX_KEY_SIZE];
+} KeyBlob;
+
+typedef struct KeyHandle
+{
+	Aes Schedule;
+	KeyBlob Blob;
+
+	~KeyHandle() { explicit_bzero(&Blob, sizeof(Blob)); }
+} KeyHandle;
+
+typedef struct CachedKey
+{
+	Aes Schedule;
+
+	void Destroy() { Schedule.Zero(); }
+} CachedKey;
+
+typedef struct StateHandle
+{
+	bool Hardware = Aes::HardwareSupported();
+	mutable KeyCache<CachedKey> Keys;
+} OSPState;
+
+std::atomic<unsigned> forks { 0 };
+pthread_once_t forkonce = PTHREAD_ONCE_INIT;
+
+bool checkErrno(bool success, OSPError* error)
+{
+	if (!success)
+		return OS::SetOSPError(error, OSP_System_Error, errno);
+	return true;
+}
+
+bool RetreiveKey(const Cipher& cipher, Aes& key, OSPError* error)
+{
+	if (!cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	const KeyBlob* blob = reinterpret_cast<const KeyBlob*>(cipher.Key());
+	if (cipher.Size() != sizeof(KeyBlob) || blob->Magic != KEY_BLOB_MAGIC || !key.Expand(blob->Key, blob->Size))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BAD_POINTER);
+
+	return true;
+}
+
+// The key schedule of a cipher, its handle's while Prepared, otherwise leased
+// from the key cache or, when none can be leased, expanded for this use only
+class CipherKey
+{
+public:
+	CipherKey(const Cryptography& cryptography, const Cipher& cipher, OSPError* error)
+	{
+		if (cipher.Handle())
+		{
+			schedule = &static_cast<const KeyHandle*>(cipher.Handle())->Schedule;
+			return;
+		}
+
+		if (!cipher.Completed())
+		{
+			OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+			return;
+		}
+
+		keys = &static_cast<const StateHandle*>(cryptography.State())->Keys;
+		leased = keys->Lease(cipher.Key(), cipher.Size(), [&](CachedKey& key) {
+			return RetreiveKey(cipher, key.Schedule, error);
+		});
+
+		if (leased)
+			schedule = &leased->Schedule;
+		else if (RetreiveKey(cipher, retrieved, error))
+			schedule = &retrieved;
+	}
+
+	~CipherKey() { if (leased) keys->Return(leased); }
+
+	const Aes* Schedule() const { return schedule; }
+
+private:
+	KeyCache<CachedKey>* keys = nullptr;
+	CachedKey* leased = nullptr;
+	Aes retrieved;
+	const Aes* schedule = nullptr;
+};
+
+#pragma endregion
+
+#pragma region Public Constructors, OS and ICryptography Overrides
+
+Cryptography::Cryptography() : OS() { }
+
+Cryptography::Cryptography(size_t count, size_t maxsize, OSPError* error) : OS()
+{
+	Initialize(count, maxsize, 0, error);
+}
+
+Cryptography::byte* const Cryptography::Randomize(byte* const data, size_t size, OSPError* error) const
+{
+	if (!data || !size)
+		return nullptr;
+
+	// A forked child must not repeat what its parent's generators serve next
+	thread_local unsigned seen = 0;
+	pthread_once(&forkonce, [] { pthread_atfork(nullptr, nullptr, [] { forks++; }); });
+	if (seen != forks)
+	{
+		Drbg::Thread().Reseed();
+		seen = forks;
+	}
+
+	if (!Drbg::Thread().Generate(data, size, Entropy, error))
+		return nullptr;
+
+	return data;
+}
+
+bool Cryptography::Entropy(byte* const data, size_t size, OSPError* error)
+{
+	if (!data || !size)
+		return false;
+
+	for (size_t pos = 0; pos < size;)
+	{
+		ssize_t result = getrandom(data + pos, size - pos, 0);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return checkErrno(false, error);
+		}
+		pos += (size_t)result;
+	}
+
+	return true;
+}
+
+bool Cryptography::Initialize(size_t count, size_t maxsize, size_t additional, OSPError* error)
+{
+	if (maxsize < MinDataSize())
+		maxsize = MinDataSize();
+	maxsize = DataSize(maxsize);
+
+	// Add count for
+	// - initialization vector
+
+	return OS::Initialize(count + 1, maxsize, additional, error);
+}
+
+bool Cryptography::Reset(size_t count, size_t maxsize, size_t additional, OSPError* error)
+{
+	if (Destroy(error))
+		return Initialize(count, maxsize, additional, error);
+	return false;
+}
+
+bool Cryptography::Destroy(OSPError* error)
+{
+	bool success = OS::Destroy(error);
+
+	delete static_cast<StateHandle*>(_state);
+	_state = nullptr;
+
+	return success;
+}
+
+#pragma endregion
+
+#pragma region Public Interface
+
+void* Cryptography::State(OSPError* error)
+{
+	std::lock_guard<std::mutex> guard(_statelock);
+	if (!_state)
+		_state = new StateHandle;
+	return _state;
+}
+
+const void* Cryptography::State(OSPError* error) const
+{
+	std::lock_guard<std::mutex> guard(_statelock);
+	if (!_state)
+		_state = new StateHandle;
+	return _state;
+}
+
+size_t Cryptography::EncryptSize(const Cipher& cipher, size_t size, OSPError* error)
+{
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	// CBC without padding never expands block aligned data
+	return DataSize(size);
+}
+
+bool Cryptography::Encrypt(
+	const Cipher& cipher, const ByteVector& iv, ByteVector& data, ByteVector& encrypted, OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (encrypted.Size() < data.Size() || iv.Size() < BlockSize())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	CipherKey lease(*this, cipher, error);
+	const Aes* key = lease.Schedule();
+	if (!key)
+		return false;
+
+	size_t extra = 0;
+	size_t esize = DataSize(data.Size());
+
+	// Growing the encrypted buffer would lose data encrypted in place
+	bool inplace = &data == &encrypted;
+	if (inplace && encrypted.Size() < esize)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	bool success = true;
+
+	if (encrypted.Size() < esize)
+	{
+		if (encrypted.Fixed() || esize > MaxDataSize())
+			success = false;
+		else
+		{
+			extra = esize - encrypted.Size();
+			success = encrypted.Realloc(esize, error);
+		}
+	}
+
+	if (success)
+	{
+		// Unaligned data is padded in place, in the encrypted buffer that holds esize
+		const byte* plain = data;
+		if (data.Size() != esize)
+		{
+			memcpy(encrypted, plain, data.Size());
+			OS::Zero(&encrypted[data.Size()], esize - data.Size());
+			plain = encrypted;
+		}
+		key->EncryptCbc(iv, plain, encrypted, esize);
+	}
+
+	// Encrypted in place the data is the ciphertext
+	if (success && !inplace)
+		data.Zero();
+
+	END_MEMORY_CHECK(ThreadAvailableMemory() + extra);
+	return success;
+}
+
+bool Cryptography::Encrypt(
+	const Cipher& cipher,
+	const ByteVector& iv,
+	ByteVector* const data[],
+	ByteVector* const encrypted[],
+	size_t count,
+	OSPError* error
+) {
+	if (iv.Size() < BlockSize())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	for (size_t n = 0; n < count; n++)
+	{
+		if (encrypted[n]->Size() < DataSize(data[n]->Size()))
+			return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+	}
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	CipherKey lease(*this, cipher, error);
+	const Aes* key = lease.Schedule();
+	if (!key)
+		return false;
+
+	// Handed to the kernel a group at a time, so nothing is allocated
+	const size_t GROUP = 32;
+
+	const byte* ivs[GROUP];
+	const byte* plain[GROUP];
+	byte* out[GROUP];
+	size_t sizes[GROUP];
+
+	for (size_t first = 0; first < count; first += GROUP)
+	{
+		size_t group = count - first < GROUP ? count - first : GROUP;
+
+		for (size_t n = 0; n < group; n++)
+		{
+			ByteVector& d = *data[first + n];
+			ByteVector& e = *encrypted[first + n];
+
+			ivs[n] = iv;
+			plain[n] = d;
+			out[n] = e;
+			sizes[n] = DataSize(d.Size());
+
+			// Unaligned data is padded in place, in the encrypted buffer that holds it
+			if (d.Size() != sizes[n])
+			{
+				memcpy(e, d, d.Size());
+				OS::Zero(&e[d.Size()], sizes[n] - d.Size());
+				plain[n] = e;
+			}
+		}
+
+		key->EncryptCbc(ivs, plain, out, sizes, group);
+
+		for (size_t n = 0; n < group; n++)
+		{
+			if (data[first + n] != encrypted[first + n])
+				data[first + n]->Zero();
+		}
+	}
+
+	return true;
+}
+
+bool Cryptography::Decrypt(
+	const Cipher& cipher, const ByteVector& iv, ByteVector& encrypted, ByteVector& decrypted, OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	size_t size = decrypted.Size();
+	if (size % BlockSize())
+		return OS::SetOSPError(error, OSP_System_Error, EINVAL);
+
+	if (encrypted.Size() < size || iv.Size() < BlockSize())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	CipherKey lease(*this, cipher, error);
+	const Aes* key = lease.Schedule();
+	if (!key)
+		return false;
+
+	key->DecryptCbc(iv, encrypted, decrypted, size);
+
+	// Decrypted in place the encrypted data is gone already
+	if (&encrypted != &decrypted)
+		encrypted.Zero();
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return true;
+}
+
+bool Cryptography::EncryptGcm(
+	const Cipher& cipher,
+	const ByteVector& nonce,
+	ByteVector& data,
+	ByteVector& encrypted,
+	ByteVector& tag,
+	std::string_view aad,
+	OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (encrypted.Size() < data.Size() || nonce.Size() < NONCE_SIZE || tag.Size() < TAG_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	CipherKey lease(*this, cipher, error);
+	const Aes* key = lease.Schedule();
+	if (!key)
+		return false;
+
+	key->EncryptGcm(nonce, (const byte*)aad.data(), aad.size(), data, encrypted, data.Size(), tag);
+
+	// Encrypted in place the data is the ciphertext
+	if (&data != &encrypted)
+		data.Zero();
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return true;
+}
+
+bool Cryptography::DecryptGcm(
+	const Cipher& cipher,
+	const ByteVector& nonce,
+	ByteVector& encrypted,
+	const ByteVector& tag,
+	ByteVector& decrypted,
+	std::string_view aad,
+	OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (decrypted.Size() < encrypted.Size() || nonce.Size() < NONCE_SIZE || tag.Size() < TAG_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	CipherKey lease(*this, cipher, error);
+	const Aes* key = lease.Schedule();
+	if (!key)
+		return false;
+
+	if (!key->DecryptGcm(nonce, (const byte*)aad.data(), aad.size(), encrypted, decrypted, encrypted.Size(), tag))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_DATA_NOT_AUTHENTIC);
+
+	// Decrypted in place the encrypted data is gone already
+	if (&encrypted != &decrypted)
+		encrypted.Zero();
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return true;
+}
+
+bool Cryptography::Hash(const ByteVector& data, ByteVector& hash, OSPError* error)
+{
+	hash.Zero();
+
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	HashSession session(*this);
+	bool success = session.Begin(error) && session.Hash(data, hash, error);
+	success = session.End(error) && success;
+
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
+
+size_t Cryptography::BlockSize(OSPError* error) const
+{
+	return Aes::BLOCK_SIZE;
+}
+
+size_t Cryptography::HashSize(OSPError* error) const
+{
+	return Sha512::HASH_SIZE;
+}
+
+size_t Cryptography::HashLanes(OSPError* error) const
+{
+	return Sha512::Lanes();
+}
+
+size_t Cryptography::EncryptLanes(OSPError* error) const
+{
+	return Aes::EncryptLanes();
+}
+
+size_t Cryptography::DecryptLanes(OSPError* error) const
+{
+	return Aes::DecryptLanes();
+}
+
+size_t Cryptography::GcmLanes(OSPError* error) const
+{
+	return Aes::GcmLanes();
+}
+
+size_t Cryptography::KeyCacheHits() const
+{
+	return static_cast<const StateHandle*>(State())->Keys.Hits();
+}
+
+size_t Cryptography::KeyCacheMisses() const
+{
+	return static_cast<const StateHandle*>(State())->Keys.Misses();
+}
+
+#pragma endregion
+
+#pragma region Hash Session
+
+bool HashSession::Begin(OSPError* error)
+{
+	if (!_session)
+		_session = new Sha512;
+	return true;
+}
+
+bool HashSession::End(OSPError* error)
+{
+	delete static_cast<Sha512*>(_session);
+	_session = nullptr;
+	return true;
+}
+
+bool HashSession::Digest(const byte* const data, size_t size, byte* const hash, OSPError* error)
+{
+	Sha512* sha = static_cast<Sha512*>(_session);
+	if (!sha)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	sha->Update(data, size);
+	sha->Finish(hash);
+	return true;
+}
+
+bool HashSession::Rehash(byte* const hashes[], size_t count, size_t rounds, OSPError* error)
+{
+	if (!_session)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	Sha512::Rehash(hashes, count, rounds);
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Protected Cipher Methods
+
+bool Cryptography::PrepareCipher(const ByteVector& secret, Cipher& cipher, OSPError* error) const
+{
+	if (!cipher.Zeroed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	cipher.Size() = 0;
+
+	KeyHandle* hkey = new KeyHandle;
+	if (!hkey->Schedule.Expand(secret, secret.Size()))
+	{
+		delete hkey;
+		return OS::SetOSPError(error, OSP_System_Error, EINVAL);
+	}
+
+	hkey->Blob.Magic = KEY_BLOB_MAGIC;
+	hkey->Blob.Size = (uint32_t)secret.Size();
+	memcpy(hkey->Blob.Key, (const byte*)secret, secret.Size());
+
+	cipher.Handle() = hkey;
+	cipher.Size() = sizeof(KeyBlob);
+
+	return true;
+}
+
+bool Cryptography::CompleteCipher(Cipher& cipher, OSPError* error) const
+{
+	if (!cipher.Ready() || cipher.Size() != sizeof(KeyBlob))
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	KeyHandle* hkey = static_cast<KeyHandle*>(cipher.Handle());
+	memcpy(cipher.Key(), &hkey->Blob, sizeof(KeyBlob));
+
+	delete hkey;
+	cipher.Handle() = 0;
+	return true;
+}
+
+bool Cryptography::ZeroCipher(Cipher& cipher, OSPError* error) const
+{
+	bool success = false;
+
+	if (cipher.Handle())
+	{
+		delete static_cast<KeyHandle*>(cipher.Handle());
+		success = true;
+	}
+	else
+	{
+		// Only its cached key, if any, has to go, there is nothing to import
+		if (!cipher.Completed())
+			OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+		else
+		{
+			static_cast<const StateHandle*>(State())->Keys.Evict(cipher.Key(), cipher.Size());
+			success = true;
+		}
+	}
+
+	if (success)
+	{
+		cipher.Handle() = 0;
+		Zero(cipher.Key(), cipher.Size());
+	}
+
+	return success;
+}
+
+#pragma endregion
@@ -0,0 +1,522 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "../osp/os.h"
+
+using namespace std;
+using namespace OneStrongPassword;
+
+#pragma region Secure Arena
+
+// The arena is a single mmap'd region excluded from core dumps. Its blocks
+// are power of two multiples of GRANULE (buddy size classes), so alloc and free
+// are bounded by MAX_ORDER steps. The region is only reserved up front, each
+// page is mlock'd the first time a block on it is handed out and stays locked
+// until the arena is destroyed, so the kernel is entered once per page and the
+// locked memory is what the store has used rather than its whole reservation.
+// A page the memlock limit does not allow is used unlocked and counted, which
+// MemoryLocked reports. The requested size of every block is kept in the tag
+// table so accounting does not depend on the caller. Tags hold 32 bit sizes to
+// keep the table at a quarter of the blocks, so a request has to be smaller
+// than 4 GiB.
+
+namespace
+{
+
+const size_t GRANULE = 32;
+const int MAX_ORDER = 27;
+
+const uint16_t TAG_NONE = 0;
+const uint16_t TAG_FREE = 1;
+const uint16_t TAG_USED = 2;
+
+const uint8_t PAGE_RESERVED = 0;
+const uint8_t PAGE_LOCKED = 1;
+const uint8_t PAGE_UNLOCKED = 2;
+
+typedef struct FreeBlock
+{
+	FreeBlock* Next;
+	FreeBlock* Prev;
+} FreeBlock;
+
+typedef struct Tag
+{
+	uint32_t Size;
+	uint16_t Order;
+	uint16_t State;
+} Tag;
+
+typedef struct Arena
+{
+	pthread_mutex_t Lock;
+	size_t Mapped;
+	size_t Page;
+	size_t Unlocked;
+	int Order;
+	OS::byte* Blocks;
+	Tag* Tags;
+	uint8_t* Pages;
+	FreeBlock* Free[MAX_ORDER + 1];
+} Arena;
+
+size_t arenaOffset(const Arena* arena, const void* block)
+{
+	return (const OS::byte*)block - arena->Blocks;
+}
+
+void arenaPush(Arena* arena, OS::byte* block, int order)
+{
+	FreeBlock* free = (FreeBlock*)block;
+	free->Prev = nullptr;
+	free->Next = arena->Free[order];
+	if (free->Next)
+		free->Next->Prev = free;
+	arena->Free[order] = free;
+
+	Tag& tag = arena->Tags[arenaOffset(arena, block) / GRANULE];
+	tag.Size = 0;
+	tag.Order = order;
+	tag.State = TAG_FREE;
+}
+
+void arenaUnlink(Arena* arena, FreeBlock* free, int order)
+{
+	if (free->Prev)
+		free->Prev->Next = free->Next;
+	else
+		arena->Free[order] = free->Next;
+	if (free->Next)
+		free->Next->Prev = free->Prev;
+	explicit_bzero(free, sizeof(FreeBlock));
+}
+
+int arenaOrder(size_t size)
+{
+	int order = 0;
+	while ((GRANULE << order) < size)
+		order++;
+	return order;
+}
+
+Arena* arenaCreate(size_t capacity)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	int order = arenaOrder(max(capacity, page));
+	if (order > MAX_ORDER)
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	size_t blocks = GRANULE << order;
+	size_t tags = (blocks / GRANULE) * sizeof(Tag);
+	size_t pages = blocks / page;
+
+	// Blocks start on a page so each page is locked whole
+	size_t header = sizeof(Arena) + tags + pages;
+	header = ((header + page - 1) / page) * page;
+
+	size_t mapped = header + blocks;
+
+	void* region = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (region == MAP_FAILED)
+		return nullptr;
+
+	if (0 != madvise(region, mapped, MADV_DONTDUMP))
+	{
+		int saved = errno;
+		munmap(region, mapped);
+		errno = saved;
+		return nullptr;
+	}
+
+	Arena* arena = (Arena*)region;
+	pthread_mutex_init(&arena->Lock, nullptr);
+	arena->Mapped = mapped;
+	arena->Page = page;
+	arena->Order = order;
+	arena->Tags = (Tag*)((OS::byte*)region + sizeof(Arena));
+	arena->Pages = (uint8_t*)arena->Tags + tags;
+	arena->Blocks = (OS::byte*)region + header;
+
+	arenaPush(arena, arena->Blocks, order);
+	return arena;
+}
+
+// Locks the pages of a block about to be handed out that are not locked yet
+void arenaLock(Arena* arena, const OS::byte* block, size_t size)
+{
+	size_t first = arenaOffset(arena, block) / arena->Page;
+	size_t last = (arenaOffset(arena, block) + size - 1) / arena->Page;
+
+	for (size_t n = first; n <= last; n++)
+	{
+		if (arena->Pages[n] != PAGE_RESERVED)
+			continue;
+
+		if (0 == mlock(arena->Blocks + n * arena->Page, arena->Page))
+			arena->Pages[n] = PAGE_LOCKED;
+		else
+		{
+			arena->Pages[n] = PAGE_UNLOCKED;
+			arena->Unlocked++;
+		}
+	}
+}
+
+bool arenaDestroy(Arena* arena)
+{
+	size_t mapped = arena->Mapped;
+	pthread_mutex_destroy(&arena->Lock);
+
+	// Only pages blocks were handed out on held data, the rest were never touched
+	size_t pages = (mapped - (size_t)(arena->Blocks - (OS::byte*)arena)) / arena->Page;
+	for (size_t n = 0; n < pages; n++)
+	{
+		if (arena->Pages[n] != PAGE_RESERVED)
+			explicit_bzero(arena->Blocks + n * arena->Page, arena->Page);
+	}
+	explicit_bzero(arena, (size_t)(arena->Blocks - (OS::byte*)arena));
+
+	bool success = (0 == munlock(arena, mapped));
+	return (0 == munmap(arena, mapped)) && success;
+}
+
+OS::byte* arenaAlloc(Arena* arena, size_t size)
+{
+	if (size > UINT32_MAX)
+		return nullptr;
+
+	int order = arenaOrder(size);
+	if (order > arena->Order)
+		return nullptr;
+
+	int found = order;
+	while (found <= arena->Order && !arena->Free[found])
+		found++;
+	if (found > arena->Order)
+		return nullptr;
+
+	FreeBlock* free = arena->Free[found];
+	arenaUnlink(arena, free, found);
+
+	OS::byte* block = (OS::byte*)free;
+	while (found > order)
+	{
+		found--;
+		arenaPush(arena, block + (GRANULE << found), found);
+	}
+
+	Tag& tag = arena->Tags[arenaOffset(arena, block) / GRANULE];
+	tag.Size = (uint32_t)size;
+	tag.Order = order;
+	tag.State = TAG_USED;
+
+	arenaLock(arena, block, GRANULE << order);
+
+	return block;
+}
+
+Tag* arenaFind(Arena* arena, const OS::byte* block)
+{
+	if (block < arena->Blocks || block >= arena->Blocks + (GRANULE << arena->Order))
+		return nullptr;
+
+	size_t offset = arenaOffset(arena, block);
+	if (offset % GRANULE)
+		return nullptr;
+
+	Tag* tag = &arena->Tags[offset / GRANULE];
+	return tag->State == TAG_USED ? tag : nullptr;
+}
+
+void arenaFree(Arena* arena, OS::byte* block, Tag* tag)
+{
+	int order = tag->Order;
+	explicit_bzero(block, GRANULE << order);
+	tag->Size = 0;
+	tag->State = TAG_NONE;
+
+	size_t offset = arenaOffset(arena, block);
+	while (order < arena->Order)
+	{
+		size_t buddy = offset ^ (GRANULE << order);
+		Tag& other = arena->Tags[buddy / GRANULE];
+		if (other.State != TAG_FREE || other.Order != order)
+			break;
+
+		arenaUnlink(arena, (FreeBlock*)(arena->Blocks + buddy), order);
+		other.State = TAG_NONE;
+		offset = min(offset, buddy);
+		order++;
+	}
+
+	arenaPush(arena, arena->Blocks + offset, order);
+}
+
+}
+
+#pragma endregion
+
+bool OS::checkError(bool success, OSPError* ospError)
+{
+	if (!success)
+	{
+		int error = errno;
+		OS::SetOSPError(ospError, OSP_System_Error, error);
+
+#ifdef _DEBUG
+		fprintf(stderr, "%s\n", strerror(error));
+#endif
+
+		return false;
+	}
+	return true;
+}
+
+#pragma region Public Static Methods
+
+bool OS::SetOSPError(OSPError* ospError, OSPErrorType type, uint32_t error)
+{
+	if (ospError && ospError->Type == OSP_No_Error)
+	{
+		ospError->Type = type;
+		ospError->Code = error;
+	}
+	return false;
+}
+
+OS::byte* OS::Zero(byte* const data, size_t size)
+{
+	if (data && size > 0)
+		explicit_bzero(data, size);
+	return data;
+}
+
+bool OS::Zeroed(const byte* const data, size_t size)
+{
+	if (!size)
+		return true;
+
+	for (size_t n = 0; n < size; n++)
+	{
+		if (data[n])
+			return false;
+	}
+	return true;
+}
+
+bool OS::LockMemory(void* const data, size_t size)
+{
+	return data && size > 0 && 0 == mlock(data, size);
+}
+
+void OS::UnlockMemory(void* const data, size_t size)
+{
+	if (data && size > 0)
+		munlock(data, size);
+}
+
+int32_t OS::Show(
+	char* const data, size_t size, size_t width, const string& title, uint32_t type, OSPError* error
+) {
+	// There is no message box, so write straight to the controlling terminal
+	int tty = open("/dev/tty", O_WRONLY | O_NOCTTY);
+	if (!checkError(tty >= 0, error))
+		return 0;
+
+	if (width == 0)
+		width = size;
+
+	string header = title.empty() ? "One Strong Password" : title;
+	header += '\n';
+
+	bool success = (write(tty, header.c_str(), header.size()) >= 0);
+
+	size_t length = strnlen(data, size);
+	for (size_t pos = 0; success && pos < length; pos += width)
+	{
+		size_t line = min(width, length - pos);
+		success = write(tty, data + pos, line) >= 0 && write(tty, "\n", 1) >= 0;
+	}
+
+	success = checkError(success, error);
+	close(tty);
+
+	return success ? 1 : 0;
+}
+
+bool OS::CopyToClipboard(char* const data, size_t size, OSPError* error)
+{
+	errno = ENOTSUP;
+	return checkError(false, error);
+}
+
+bool OS::PasteFromClipboard(char* const data, size_t size, OSPError* error)
+{
+	errno = ENOTSUP;
+	return checkError(false, error);
+}
+
+#pragma endregion
+
+#pragma region Public Overridable Interface
+
+const size_t OS::MAX_HEAP_SIZE = 16 * 1024;
+
+bool OS::Initialize(size_t count, size_t maxsize, size_t additional, OSPError* error)
+{
+	if (_available || heap)
+		return SetOSPError(error, OSP_API_Error, OSP_ERROR_ALREADY_INITIALIZED);
+
+	if (count && maxsize)
+	{
+		_maxdatasize = maxsize;
+		_available = (maxsize * count) + additional;
+
+		// Room for count blocks of maxsize and the additional bytes in their size
+		// classes, only the pages blocks are handed out on are ever locked
+		size_t capacity = count * (GRANULE << arenaOrder(maxsize));
+		if (additional)
+			capacity += GRANULE << arenaOrder(additional);
+		heap = arenaCreate(capacity);
+		if (!heap)
+			_maxdatasize = _available = 0;
+		return checkError(nullptr != heap, error);
+	}
+
+	return true;
+}
+
+bool OS::Reset(size_t blocks, size_t maxsize, size_t additional, OSPError* error)
+{
+	if (Destroy(error))
+	{
+		if (blocks && maxsize)
+			return Initialize(blocks, maxsize, additional, error);
+		return true;
+	}
+	return false;
+}
+
+bool OS::Destroy(OSPError* error)
+{
+	bool success = true;
+
+	if (heap)
+	{
+		success = arenaDestroy(static_cast<Arena*>(heap)) && success;
+		heap = 0;
+		_available = _memory = _allocations = 0;
+	}
+
+	return checkError(success, error);
+}
+
+#pragma endregion
+
+OS::byte* OS::Alloc(size_t size, OSPError* error)
+{
+	if (heap && size > 0)
+	{
+		assert(AvailableMemory() > 0);
+		if (AvailableMemory() <= 0)
+		{
+			SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+			return nullptr;
+		}
+
+		Arena* arena = static_cast<Arena*>(heap);
+
+		pthread_mutex_lock(&arena->Lock);
+		byte* data = arenaAlloc(arena, size);
+		pthread_mutex_unlock(&arena->Lock);
+
+		if (data)
+		{
+			_memory += size;
+			COUNT_MEMORY(size);
+			_allocations++;
+		}
+		else
+			SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+		return data;
+	}
+
+	if (!heap)
+		SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+	else if (!size)
+		SetOSPError(error, OSP_API_Error, OSP_ERROR_SIZE_IS_0);
+	return nullptr;
+}
+
+bool OS::MemoryLocked() const
+{
+	if (!heap)
+		return true;
+
+	Arena* arena = static_cast<Arena*>(heap);
+
+	pthread_mutex_lock(&arena->Lock);
+	bool locked = !arena->Unlocked;
+	pthread_mutex_unlock(&arena->Lock);
+
+	return locked;
+}
+
+bool OS::Destroy(byte*& data, size_t size, OSPError* error)
+{
+	if (heap && data)
+	{
+		Arena* arena = static_cast<Arena*>(heap);
+
+		pthread_mutex_lock(&arena->Lock);
+
+		Tag* tag = arenaFind(arena, data);
+		size_t held = tag ? tag->Size : 0;
+		if (tag)
+			arenaFree(arena, data, tag);
+
+		pthread_mutex_unlock(&arena->Lock);
+
+		if (!tag)
+			return SetOSPError(error, OSP_API_Error, OSP_ERROR_BAD_POINTER);
+
+		_memory -= held;
+		UNCOUNT_MEMORY(held);
+		data = 0;
+	}
+
+	return true;
+}
@@ -0,0 +1,421 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "sha512.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OSP_SHA512_SIMD
+#endif
+
+using namespace OneStrongPassword;
+
+const uint64_t K[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+const uint64_t IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+inline uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+inline uint64_t load64(const uint8_t* p)
+{
+	return
+		(uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) | (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+		(uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) | (uint64_t(p[6]) << 8) | uint64_t(p[7]);
+}
+
+inline void store64(uint8_t* p, uint64_t x)
+{
+	for (int n = 7; n >= 0; n--, x >>= 8)
+		p[n] = uint8_t(x);
+}
+
+// w holds the 16 message words on entry and is used for the schedule
+void compress(uint64_t state[8], uint64_t w[80])
+{
+	for (int t = 16; t < 80; t++)
+	{
+		uint64_t s0 = rotr(w[t - 15], 1) ^ rotr(w[t - 15], 8) ^ (w[t - 15] >> 7);
+		uint64_t s1 = rotr(w[t - 2], 19) ^ rotr(w[t - 2], 61) ^ (w[t - 2] >> 6);
+		w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+	}
+
+	uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int t = 0; t < 80; t++)
+	{
+		uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+		uint64_t t2 = (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// A digest rehashed is always one block, the 64 byte digest followed by
+// fixed padding for a 512 bit message, so only the first 8 words change
+// between rounds and no byte swapping is needed until the end.
+
+const uint64_t PAD_WORD = 0x8000000000000000ULL;
+const uint64_t PAD_BITS = 512;
+
+void rehash(Sha512::byte* const hash, size_t rounds)
+{
+	uint64_t digest[8];
+	uint64_t w[80];
+
+	for (int n = 0; n < 8; n++)
+		digest[n] = load64(hash + n * 8);
+
+	for (size_t r = 0; r < rounds; r++)
+	{
+		memcpy(w, digest, sizeof(digest));
+		w[8] = PAD_WORD;
+		memset(w + 9, 0, 6 * sizeof(uint64_t));
+		w[15] = PAD_BITS;
+
+		memcpy(digest, IV, sizeof(digest));
+		compress(digest, w);
+	}
+
+	for (int n = 0; n < 8; n++)
+		store64(hash + n * 8, digest[n]);
+
+	explicit_bzero(digest, sizeof(digest));
+	explicit_bzero(w, sizeof(w));
+}
+
+#ifdef OSP_SHA512_SIMD
+
+#pragma region AVX2 Kernel
+
+#define ROTR4(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define XOR4(a, b, c) _mm256_xor_si256(_mm256_xor_si256((a), (b)), (c))
+
+__attribute__((target("avx2")))
+void rehash4(Sha512::byte* const hashes[4], size_t rounds)
+{
+	__m256i digest[8];
+	__m256i w[80];
+
+	for (int n = 0; n < 8; n++)
+		digest[n] = _mm256_set_epi64x(
+			load64(hashes[3] + n * 8), load64(hashes[2] + n * 8),
+			load64(hashes[1] + n * 8), load64(hashes[0] + n * 8)
+		);
+
+	for (size_t r = 0; r < rounds; r++)
+	{
+		for (int t = 0; t < 8; t++)
+			w[t] = digest[t];
+		w[8] = _mm256_set1_epi64x(PAD_WORD);
+		for (int t = 9; t < 15; t++)
+			w[t] = _mm256_setzero_si256();
+		w[15] = _mm256_set1_epi64x(PAD_BITS);
+
+		for (int t = 16; t < 80; t++)
+		{
+			__m256i s0 = XOR4(ROTR4(w[t - 15], 1), ROTR4(w[t - 15], 8), _mm256_srli_epi64(w[t - 15], 7));
+			__m256i s1 = XOR4(ROTR4(w[t - 2], 19), ROTR4(w[t - 2], 61), _mm256_srli_epi64(w[t - 2], 6));
+			w[t] = _mm256_add_epi64(_mm256_add_epi64(w[t - 16], s0), _mm256_add_epi64(w[t - 7], s1));
+		}
+
+		__m256i a = _mm256_set1_epi64x(IV[0]), b = _mm256_set1_epi64x(IV[1]);
+		__m256i c = _mm256_set1_epi64x(IV[2]), d = _mm256_set1_epi64x(IV[3]);
+		__m256i e = _mm256_set1_epi64x(IV[4]), f = _mm256_set1_epi64x(IV[5]);
+		__m256i g = _mm256_set1_epi64x(IV[6]), h = _mm256_set1_epi64x(IV[7]);
+
+		for (int t = 0; t < 80; t++)
+		{
+			__m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+			__m256i maj = _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+			__m256i t1 = _mm256_add_epi64(
+				_mm256_add_epi64(h, XOR4(ROTR4(e, 14), ROTR4(e, 18), ROTR4(e, 41))),
+				_mm256_add_epi64(_mm256_add_epi64(ch, _mm256_set1_epi64x(K[t])), w[t])
+			);
+			__m256i t2 = _mm256_add_epi64(XOR4(ROTR4(a, 28), ROTR4(a, 34), ROTR4(a, 39)), maj);
+			h = g; g = f; f = e; e = _mm256_add_epi64(d, t1);
+			d = c; c = b; b = a; a = _mm256_add_epi64(t1, t2);
+		}
+
+		digest[0] = _mm256_add_epi64(a, _mm256_set1_epi64x(IV[0]));
+		digest[1] = _mm256_add_epi64(b, _mm256_set1_epi64x(IV[1]));
+		digest[2] = _mm256_add_epi64(c, _mm256_set1_epi64x(IV[2]));
+		digest[3] = _mm256_add_epi64(d, _mm256_set1_epi64x(IV[3]));
+		digest[4] = _mm256_add_epi64(e, _mm256_set1_epi64x(IV[4]));
+		digest[5] = _mm256_add_epi64(f, _mm256_set1_epi64x(IV[5]));
+		digest[6] = _mm256_add_epi64(g, _mm256_set1_epi64x(IV[6]));
+		digest[7] = _mm256_add_epi64(h, _mm256_set1_epi64x(IV[7]));
+	}
+
+	alignas(32) uint64_t lanes[4];
+	for (int n = 0; n < 8; n++)
+	{
+		_mm256_store_si256((__m256i*)lanes, digest[n]);
+		for (int l = 0; l < 4; l++)
+			store64(hashes[l] + n * 8, lanes[l]);
+	}
+
+	explicit_bzero(lanes, sizeof(lanes));
+	explicit_bzero(digest, sizeof(digest));
+	explicit_bzero(w, sizeof(w));
+}
+
+#undef ROTR4
+#undef XOR4
+
+#pragma endregion
+
+#pragma region AVX-512 Kernel
+
+// Ternary logic immediates: 0x96 = a ^ b ^ c, 0xCA = a ? b : c, 0xE8 = majority
+#define XOR8(a, b, c) _mm512_ternarylogic_epi64((a), (b), (c), 0x96)
+
+__attribute__((target("avx512f")))
+void rehash8(Sha512::byte* const hashes[8], size_t rounds)
+{
+	__m512i digest[8];
+	__m512i w[80];
+
+	for (int n = 0; n < 8; n++)
+		digest[n] = _mm512_set_epi64(
+			load64(hashes[7] + n * 8), load64(hashes[6] + n * 8),
+			load64(hashes[5] + n * 8), load64(hashes[4] + n * 8),
+			load64(hashes[3] + n * 8), load64(hashes[2] + n * 8),
+			load64(hashes[1] + n * 8), load64(hashes[0] + n * 8)
+		);
+
+	for (size_t r = 0; r < rounds; r++)
+	{
+		for (int t = 0; t < 8; t++)
+			w[t] = digest[t];
+		w[8] = _mm512_set1_epi64(PAD_WORD);
+		for (int t = 9; t < 15; t++)
+			w[t] = _mm512_setzero_si512();
+		w[15] = _mm512_set1_epi64(PAD_BITS);
+
+		for (int t = 16; t < 80; t++)
+		{
+			__m512i s0 = XOR8(_mm512_ror_epi64(w[t - 15], 1), _mm512_ror_epi64(w[t - 15], 8), _mm512_srli_epi64(w[t - 15], 7));
+			__m512i s1 = XOR8(_mm512_ror_epi64(w[t - 2], 19), _mm512_ror_epi64(w[t - 2], 61), _mm512_srli_epi64(w[t - 2], 6));
+			w[t] = _mm512_add_epi64(_mm512_add_epi64(w[t - 16], s0), _mm512_add_epi64(w[t - 7], s1));
+		}
+
+		__m512i a = _mm512_set1_epi64(IV[0]), b = _mm512_set1_epi64(IV[1]);
+		__m512i c = _mm512_set1_epi64(IV[2]), d = _mm512_set1_epi64(IV[3]);
+		__m512i e = _mm512_set1_epi64(IV[4]), f = _mm512_set1_epi64(IV[5]);
+		__m512i g = _mm512_set1_epi64(IV[6]), h = _mm512_set1_epi64(IV[7]);
+
+		for (int t = 0; t < 80; t++)
+		{
+			__m512i ch = _mm512_ternarylogic_epi64(e, f, g, 0xCA);
+			__m512i maj = _mm512_ternarylogic_epi64(a, b, c, 0xE8);
+			__m512i t1 = _mm512_add_epi64(
+				_mm512_add_epi64(h, XOR8(_mm512_ror_epi64(e, 14), _mm512_ror_epi64(e, 18), _mm512_ror_epi64(e, 41))),
+				_mm512_add_epi64(_mm512_add_epi64(ch, _mm512_set1_epi64(K[t])), w[t])
+			);
+			__m512i t2 = _mm512_add_epi64(XOR8(_mm512_ror_epi64(a, 28), _mm512_ror_epi64(a, 34), _mm512_ror_epi64(a, 39)), maj);
+			h = g; g = f; f = e; e = _mm512_add_epi64(d, t1);
+			d = c; c = b; b = a; a = _mm512_add_epi64(t1, t2);
+		}
+
+		digest[0] = _mm512_add_epi64(a, _mm512_set1_epi64(IV[0]));
+		digest[1] = _mm512_add_epi64(b, _mm512_set1_epi64(IV[1]));
+		digest[2] = _mm512_add_epi64(c, _mm512_set1_epi64(IV[2]));
+		digest[3] = _mm512_add_epi64(d, _mm512_set1_epi64(IV[3]));
+		digest[4] = _mm512_add_epi64(e, _mm512_set1_epi64(IV[4]));
+		digest[5] = _mm512_add_epi64(f, _mm512_set1_epi64(IV[5]));
+		digest[6] = _mm512_add_epi64(g, _mm512_set1_epi64(IV[6]));
+		digest[7] = _mm512_add_epi64(h, _mm512_set1_epi64(IV[7]));
+	}
+
+	alignas(64) uint64_t lanes[8];
+	for (int n = 0; n < 8; n++)
+	{
+		_mm512_store_si512((__m512i*)lanes, digest[n]);
+		for (int l = 0; l < 8; l++)
+			store64(hashes[l] + n * 8, lanes[l]);
+	}
+
+	explicit_bzero(lanes, sizeof(lanes));
+	explicit_bzero(digest, sizeof(digest));
+	explicit_bzero(w, sizeof(w));
+}
+
+#undef XOR8
+
+#pragma endregion
+
+#endif
+
+void Sha512::Compress(uint64_t state[8], const byte* blocks, size_t count)
+{
+	uint64_t w[80];
+
+	for (; count > 0; count--, blocks += BLOCK_SIZE)
+	{
+		for (int t = 0; t < 16; t++)
+			w[t] = load64(blocks + t * 8);
+		compress(state, w);
+	}
+}
+
+size_t Sha512::Lanes()
+{
+#ifdef OSP_SHA512_SIMD
+	static const size_t lanes =
+		__builtin_cpu_supports("avx512f") ? 8 : __builtin_cpu_supports("avx2") ? 4 : 1;
+	return lanes;
+#else
+	return 1;
+#endif
+}
+
+void Sha512::Rehash(byte* const hashes[], size_t count, size_t rounds)
+{
+	size_t lanes = Lanes();
+
+	// Short groups are filled with scratch lanes, a wide kernel with idle
+	// lanes still beats running the stragglers one at a time
+	while (lanes > 1 && count > 1)
+	{
+		byte scratch[8][HASH_SIZE] = {};
+		byte* group[8];
+
+		size_t used = count < lanes ? count : lanes;
+		for (size_t n = 0; n < lanes; n++)
+			group[n] = n < used ? hashes[n] : scratch[n];
+
+#ifdef OSP_SHA512_SIMD
+		if (lanes == 8)
+			rehash8(group, rounds);
+		else
+			rehash4(group, rounds);
+#endif
+
+		explicit_bzero(scratch, sizeof(scratch));
+
+		hashes += used;
+		count -= used;
+	}
+
+	for (size_t n = 0; n < count; n++)
+		rehash(hashes[n], rounds);
+}
+
+void Sha512::Reset()
+{
+	memcpy(state, IV, sizeof(state));
+	length = 0;
+	buffered = 0;
+}
+
+void Sha512::Update(const byte* data, size_t size)
+{
+	length += size;
+
+	if (buffered)
+	{
+		size_t fill = BLOCK_SIZE - buffered;
+		if (size < fill)
+		{
+			memcpy(buffer + buffered, data, size);
+			buffered += size;
+			return;
+		}
+		memcpy(buffer + buffered, data, fill);
+		Compress(state, buffer, 1);
+		data += fill;
+		size -= fill;
+		buffered = 0;
+	}
+
+	size_t blocks = size / BLOCK_SIZE;
+	if (blocks)
+	{
+		Compress(state, data, blocks);
+		data += blocks * BLOCK_SIZE;
+		size -= blocks * BLOCK_SIZE;
+	}
+
+	if (size)
+	{
+		memcpy(buffer, data, size);
+		buffered = size;
+	}
+}
+
+void Sha512::Finish(byte* const hash)
+{
+	uint64_t bits = length << 3;
+
+	buffer[buffered++] = 0x80;
+	if (buffered > BLOCK_SIZE - 16)
+	{
+		memset(buffer + buffered, 0, BLOCK_SIZE - buffered);
+		Compress(state, buffer, 1);
+		buffered = 0;
+	}
+	memset(buffer + buffered, 0, BLOCK_SIZE - 8 - buffered);
+	store64(buffer + BLOCK_SIZE - 8, bits);
+	buffer[BLOCK_SIZE - 9] = uint8_t(length >> 61);
+	Compress(state, buffer, 1);
+
+	for (int n = 0; n < 8; n++)
+		store64(hash + n * 8, state[n]);
+
+	Zero();
+	Reset();
+}
+
+void Sha512::Zero()
+{
+	explicit_bzero(this, sizeof(*this));
+}
@@ -0,0 +1,61 @@
+/*
+One Strong Password Generator POSIX library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace OneStrongPassword
+{
+	// FIPS 180-4 SHA-512
+	class Sha512
+	{
+	public:
+		typedef uint8_t byte;
+
+		static const size_t HASH_SIZE = 64;
+		static const size_t BLOCK_SIZE = 128;
+
+		static void Compress(uint64_t state[8], const byte* blocks, size_t count);
+
+		// Digests Rehash advances together, 8 with AVX-512, 4 with AVX2, otherwise 1
+		static size_t Lanes();
+
+		// Replaces each of count HASH_SIZE digests with the digest of itself, rounds times
+		static void Rehash(byte* const hashes[], size_t count, size_t rounds);
+
+		Sha512() { Reset(); }
+		~Sha512() { Zero(); }
+
+		void Reset();
+		void Update(const byte* data, size_t size);
+		void Finish(byte* const hash);
+		void Zero();
+
+	private:
+		uint64_t state[8];
+		uint64_t length;
+		byte buffer[BLOCK_SIZE];
+		size_t buffered;
+	};
+}
@@ -0,0 +1,192 @@
+/*
+One Strong Password POSIX Unit Tests
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+// The part of the Visual Studio C++ unit test framework the tests in
+// ospwintst.native use, so they run unchanged against the POSIX backend.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// The Windows projects build with _HAS_STD_BYTE=0, which libstdc++ has no
+// equivalent for. Tests name the library's byte unqualified under
+// using namespace std, so it is declared ahead of them here.
+namespace OneStrongPassword { typedef unsigned char byte; }
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework
+{
+	class AssertFailure : public std::runtime_error
+	{
+	public:
+		explicit AssertFailure(const std::string& message) : std::runtime_error(message) { }
+	};
+
+	inline std::string Narrow(const wchar_t* message)
+	{
+		std::string narrow;
+		for (; message && *message; message++)
+			narrow += char(*message);
+		return narrow;
+	}
+
+	class Assert
+	{
+	public:
+		static void Fail(const wchar_t* message = nullptr) { throw AssertFailure(Narrow(message)); }
+
+		static void IsTrue(bool condition, const wchar_t* message = nullptr)
+			{ if (!condition) Fail(message); }
+
+		static void IsFalse(bool condition, const wchar_t* message = nullptr)
+			{ if (condition) Fail(message); }
+
+		// By value, so static const members the tests compare need no definition
+		template<typename T>
+		static void AreEqual(T expected, T actual, const wchar_t* message = nullptr)
+		{
+			if (!(expected == actual))
+				throw AssertFailure(Narrow(message) + describe(expected, actual));
+		}
+
+		static void AreEqual(const char* expected, const char* actual, const wchar_t* message = nullptr)
+		{
+			if (strcmp(expected, actual) != 0)
+				throw AssertFailure(Narrow(message) + " expected " + expected + ", was " + actual);
+		}
+
+		template<typename T>
+		static void AreNotEqual(T notExpected, T actual, const wchar_t* message = nullptr)
+			{ if (notExpected == actual) Fail(message); }
+
+	private:
+		template<typename T>
+		static std::string describe(const T& expected, const T& actual)
+		{
+			if constexpr (std::is_arithmetic_v<T>)
+			{
+				std::ostringstream values;
+				values << " expected " << +expected << ", was " << +actual;
+				return values.str();
+			}
+			else
+				return std::string();
+		}
+	};
+
+	class Logger
+	{
+	public:
+		static void WriteMessage(const char* message) { Messages() += message; }
+		static void WriteMessage(const wchar_t* message) { Messages() += Narrow(message); }
+
+		// What the running test wrote, printed after it
+		static std::string& Messages() { static std::string messages; return messages; }
+	};
+
+	struct TestMethodEntry
+	{
+		const char* Class;
+		const char* Method;
+		std::function<void()> Run;
+	};
+
+	inline std::vector<TestMethodEntry>& TestMethods()
+	{
+		static std::vector<TestMethodEntry> methods;
+		return methods;
+	}
+
+	template<typename T, typename Name>
+	class TestClass
+	{
+	public:
+		typedef T Self;
+
+		virtual ~TestClass() { }
+
+		virtual void MethodInitialize_() { }
+		virtual void MethodCleanup_() { }
+
+		static void (*&ClassInitialize_())() { static void (*initialize)() = nullptr; return initialize; }
+
+		// A new instance for every method, initialized and cleaned up around it
+		// as Visual Studio does. The class initializer runs before the first.
+		static void Register(const char* method, void (T::*run)())
+		{
+			TestMethods().push_back({ Name::Value, method, [run]() {
+				static bool initialized = false;
+				if (!initialized && ClassInitialize_())
+					ClassInitialize_()();
+				initialized = true;
+
+				// Value initialized, fixtures count on members they do not clear being zero
+				std::unique_ptr<T> test(new T());
+				test->MethodInitialize_();
+				try
+				{
+					((*test).*run)();
+				}
+				catch (...)
+				{
+					test->MethodCleanup_();
+					throw;
+				}
+				test->MethodCleanup_();
+			} });
+		}
+	};
+}}}
+
+#define TEST_CLASS(className) \
+struct className##_Name { static constexpr const char* Value = #className; };\
+class className : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<className, className##_Name>
+
+#define TEST_METHOD(methodName) \
+struct methodName##_Registrar { methodName##_Registrar() { Self::Register(#methodName, &Self::methodName); } };\
+inline static methodName##_Registrar methodName##_registrar;\
+public: void methodName()
+
+#define TEST_METHOD_INITIALIZE(methodName) \
+public: void MethodInitialize_() override { methodName(); }\
+void methodName()
+
+#define TEST_METHOD_CLEANUP(methodName) \
+public: void MethodCleanup_() override { methodName(); }\
+void methodName()
+
+#define TEST_CLASS_INITIALIZE(methodName) \
+struct methodName##_Registrar { methodName##_Registrar() { Self::ClassInitialize_() = &Self::methodName; } };\
+inline static methodName##_Registrar methodName##_registrar;\
+public: static void methodName()
+
+#define BEGIN_TEST_METHOD_ATTRIBUTE(methodName)
+#define END_TEST_METHOD_ATTRIBUTE()
+#define TEST_DESCRIPTION(description)
+#define TEST_OWNER(owner)
+#define TEST_PRIORITY(priority)
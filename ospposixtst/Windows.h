@@ -0,0 +1,39 @@
+/*
+One Strong Password POSIX Unit Tests
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+// The few Windows calls the tests in ospwintst.native time themselves with
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+typedef uint32_t DWORD;
+
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+
+inline DWORD GetTickCount()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return DWORD(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
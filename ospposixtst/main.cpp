@@ -0,0 +1,91 @@
+/*
+One Strong Password POSIX Unit Tests
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "CppUnitTest.h"
+
+#include <stdio.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+// Runs the tests whose Class::Method contains one of the patterns, all of them
+// without any, skipping those containing a pattern given with a leading '-'.
+// Exits with the number of failures.
+int main(int argc, char* argv[])
+{
+	vector<string> included, excluded;
+	for (int n = 1; n < argc; n++)
+	{
+		if (argv[n][0] == '-')
+			excluded.push_back(argv[n] + 1);
+		else
+			included.push_back(argv[n]);
+	}
+
+	auto matches = [](const vector<string>& patterns, const string& name) {
+		for (const string& pattern : patterns)
+		{
+			if (name.find(pattern) != string::npos)
+				return true;
+		}
+		return false;
+	};
+
+	int ran = 0, failed = 0;
+
+	for (const TestMethodEntry& entry : TestMethods())
+	{
+		string name = string(entry.Class) + "::" + entry.Method;
+		if ((!included.empty() && !matches(included, name)) || matches(excluded, name))
+			continue;
+
+		string failure;
+		try
+		{
+			entry.Run();
+		}
+		catch (const exception& e)
+		{
+			failure = e.what();
+			if (failure.empty())
+				failure = "failed";
+		}
+
+		ran++;
+		if (failure.empty())
+			printf("PASS %s\n", name.c_str());
+		else
+		{
+			printf("FAIL %s: %s\n", name.c_str(), failure.c_str());
+			failed++;
+		}
+
+		if (!Logger::Messages().empty())
+			printf("     %s\n", Logger::Messages().c_str());
+		Logger::Messages().clear();
+
+		fflush(stdout);
+	}
+
+	printf("%d of %d tests failed\n", failed, ran);
+	return ran > 0 ? failed : 1;
+}
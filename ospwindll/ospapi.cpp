@@ -20,94 +20,374 @@ out of or in connection with the Software or the use or other dealings in the
 Software.
 */
 
+#ifdef _WIN32
 #include <windows.h>
 #include <bcrypt.h>
+#endif
 
 #define OSPDLL_EXPORT
 #include "ospapi.h"
 
+#include <mutex>
+#include <new>
+
 #include "../osp/passwordmanager.h"
 
 using namespace OneStrongPassword;
 using namespace std;
 
-PasswordManager Manager;
+// A context is one password manager with its own secure store. Calls on the
+// same context take turns, calls on different contexts run concurrently.
+struct OSPContext
+{
+	PasswordManager Manager;
+	mutex Lock;
+};
+
+// A null context fails the export with OSP_ERROR_NULL_POINTER, returning failed
+#define LOCK_CONTEXT(context, error, failed) \
+if (!context)\
+{\
+	OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);\
+	return failed;\
+}\
+lock_guard<mutex> _CONTEXT_LOCK_(context->Lock);\
+PasswordManager& Manager = context->Manager;
+
+// The context the exports without one use
+OSPContext Default;
+
+OSPContext* OSPAPI OSPCreateContext(OSPError* error)
+{
+	OSPContext* context = new (nothrow) OSPContext;
+	if (!context)
+		OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NO_AVAILABLE_HEAP_MEMORY);
+	return context;
+}
+
+int32_t OSPAPI OSPDestroyContext(OSPContext* context, OSPError* error)
+{
+	if (!context)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+	if (context == &Default)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BAD_POINTER);
+
+	bool success = false;
+	{
+		LOCK_CONTEXT(context, error, false);
+		success = Manager.Destroy(error);
+	}
+	delete context;
+	return success;
+}
+
+OSPContext* OSPAPI OSPDefaultContext()
+{
+	return &Default;
+}
+
 
 int32_t OSPAPI OSPSetError(OSPErrorType type, uint32_t code, OSPError* error)
 {
 	return OS::SetOSPError(error, type, code);
 }
 
-int32_t OSPAPI OSPInit(size_t count, size_t length, OSPError* error)
+int32_t OSPAPI OSPCtxInit(OSPContext* context, size_t count, size_t length, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.Initialize(count, length, error);
 }
 
-int32_t OSPAPI OSPReset(size_t count, size_t length, OSPError* error)
+int32_t OSPAPI OSPInit(size_t count, size_t length, OSPError* error)
+{
+	return OSPCtxInit(&Default, count, length, error);
+}
+
+int32_t OSPAPI OSPCtxReset(OSPContext* context, size_t count, size_t length, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.Reset(count, length, error);
 }
 
-int32_t OSPAPI OSPDestroy(OSPError* error)
+int32_t OSPAPI OSPReset(size_t count, size_t length, OSPError* error)
+{
+	return OSPCtxReset(&Default, count, length, error);
+}
+
+int32_t OSPAPI OSPCtxDestroy(OSPContext* context, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.Destroy(error);
 }
 
-int32_t OSPAPI OSPDestroyed()
+int32_t OSPAPI OSPDestroy(OSPError* error)
 {
+	return OSPCtxDestroy(&Default, error);
+}
+
+int32_t OSPAPI OSPCtxDestroyed(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, false);
 	return Manager.Destroyed();
 }
 
-size_t OSPAPI OSPMinLength()
+int32_t OSPAPI OSPDestroyed()
 {
+	return OSPCtxDestroyed(&Default);
+}
+
+size_t OSPAPI OSPCtxMinLength(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
 	return Manager.MinLength();
 }
 
-size_t OSPAPI OSPMaxLength()
+size_t OSPAPI OSPMinLength()
 {
+	return OSPCtxMinLength(&Default);
+}
+
+size_t OSPAPI OSPCtxMaxLength(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
 	return Manager.MaxLength();
 }
 
-size_t OSPAPI OSPBlockLength(OSPError* error)
+size_t OSPAPI OSPMaxLength()
+{
+	return OSPCtxMaxLength(&Default);
+}
+
+size_t OSPAPI OSPCtxBlockLength(OSPContext* context, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, 0);
 	return Manager.BlockLength(error);
 }
 
-int32_t OSPAPI OSPPrepareCipher(OSPCipher* cipher, OSPError* error)
+size_t OSPAPI OSPBlockLength(OSPError* error)
+{
+	return OSPCtxBlockLength(&Default, error);
+}
+
+uint32_t OSPAPI OSPCtxPadding(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.Padding();
+}
+
+uint32_t OSPAPI OSPPadding()
+{
+	return OSPCtxPadding(&Default);
+}
+
+void OSPAPI OSPCtxSetPadding(OSPContext* context, uint32_t padding)
+{
+	LOCK_CONTEXT(context, nullptr, );
+	Manager.Padding(padding);
+}
+
+void OSPAPI OSPSetPadding(uint32_t padding)
+{
+	OSPCtxSetPadding(&Default, padding);
+}
+
+uint32_t OSPAPI OSPCtxStorage(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.Storage();
+}
+
+uint32_t OSPAPI OSPStorage()
+{
+	return OSPCtxStorage(&Default);
+}
+
+void OSPAPI OSPCtxSetStorage(OSPContext* context, uint32_t storage)
+{
+	LOCK_CONTEXT(context, nullptr, );
+	Manager.Storage(storage);
+}
+
+void OSPAPI OSPSetStorage(uint32_t storage)
+{
+	OSPCtxSetStorage(&Default, storage);
+}
+
+int32_t OSPAPI OSPCtxGetKdfProfile(OSPContext* context, OSPKdfProfile* profile, OSPError* error)
+{
+	if (!profile)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	LOCK_CONTEXT(context, error, false);
+	*profile = Manager.KdfProfile();
+	return true;
+}
+
+int32_t OSPAPI OSPGetKdfProfile(OSPKdfProfile* profile, OSPError* error)
+{
+	return OSPCtxGetKdfProfile(&Default, profile, error);
+}
+
+int32_t OSPAPI OSPCtxSetKdfProfile(OSPContext* context, const OSPKdfProfile* profile, OSPError* error)
+{
+	if (!profile)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NULL_POINTER);
+
+	LOCK_CONTEXT(context, error, false);
+	return Manager.KdfProfile(*profile, error);
+}
+
+int32_t OSPAPI OSPSetKdfProfile(const OSPKdfProfile* profile, OSPError* error)
+{
+	return OSPCtxSetKdfProfile(&Default, profile, error);
+}
+
+int32_t OSPAPI OSPCtxSetKdfCalibration(
+	OSPContext* context, uint32_t function, uint32_t milliseconds, OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
+	return Manager.KdfCalibration(function, milliseconds, error);
+}
+
+int32_t OSPAPI OSPSetKdfCalibration(uint32_t function, uint32_t milliseconds, OSPError* error)
+{
+	return OSPCtxSetKdfCalibration(&Default, function, milliseconds, error);
+}
+
+int32_t OSPAPI OSPCtxCalibrateKdf(OSPContext* context, uint32_t function, uint32_t milliseconds, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
+	return Manager.CalibrateKdf(function, milliseconds, error);
+}
+
+int32_t OSPAPI OSPCalibrateKdf(uint32_t function, uint32_t milliseconds, OSPError* error)
+{
+	return OSPCtxCalibrateKdf(&Default, function, milliseconds, error);
+}
+
+uint64_t OSPAPI OSPCtxKdfRate(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.KdfRate();
+}
+
+uint64_t OSPAPI OSPKdfRate()
+{
+	return OSPCtxKdfRate(&Default);
+}
+
+size_t OSPAPI OSPCtxKeyCacheHits(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.KeyCacheHits();
+}
+
+size_t OSPAPI OSPKeyCacheHits()
+{
+	return OSPCtxKeyCacheHits(&Default);
+}
+
+size_t OSPAPI OSPCtxKeyCacheMisses(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.KeyCacheMisses();
+}
+
+size_t OSPAPI OSPKeyCacheMisses()
+{
+	return OSPCtxKeyCacheMisses(&Default);
+}
+
+int32_t OSPAPI OSPCtxPrepareCipher(OSPContext* context, OSPCipher* cipher, OSPError* error)
+{
+	LOCK_CONTEXT(context, error, false);
 	return Manager.PrepareCipher(*cipher, error);
 }
 
-int32_t OSPAPI OSPCompleteCipher(OSPCipher* cipher, OSPError* error)
+int32_t OSPAPI OSPPrepareCipher(OSPCipher* cipher, OSPError* error)
+{
+	return OSPCtxPrepareCipher(&Default, cipher, error);
+}
+
+int32_t OSPAPI OSPCtxCompleteCipher(OSPContext* context, OSPCipher* cipher, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.CompleteCipher(*cipher, error);
 }
 
-int32_t OSPAPI OSPZeroCipher(OSPCipher* cipher, OSPError* error)
+int32_t OSPAPI OSPCompleteCipher(OSPCipher* cipher, OSPError* error)
+{
+	return OSPCtxCompleteCipher(&Default, cipher, error);
+}
+
+int32_t OSPAPI OSPCtxZeroCipher(OSPContext* context, OSPCipher* cipher, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.ZeroCipher(*cipher, error);
 }
 
-int32_t OSPAPI OSPCipherPrepared(const OSPCipher* const cipher)
+int32_t OSPAPI OSPZeroCipher(OSPCipher* cipher, OSPError* error)
 {
+	return OSPCtxZeroCipher(&Default, cipher, error);
+}
+
+int32_t OSPAPI OSPCtxCipherPrepared(OSPContext* context, const OSPCipher* const cipher)
+{
+	LOCK_CONTEXT(context, nullptr, false);
 	return Manager.CipherPrepared(*cipher);
 }
 
-int32_t OSPAPI OSPCipherReady(const OSPCipher* const cipher)
+int32_t OSPAPI OSPCipherPrepared(const OSPCipher* const cipher)
 {
+	return OSPCtxCipherPrepared(&Default, cipher);
+}
+
+int32_t OSPAPI OSPCtxCipherReady(OSPContext* context, const OSPCipher* const cipher)
+{
+	LOCK_CONTEXT(context, nullptr, false);
 	return Manager.CipherReady(*cipher);
 }
 
-int32_t OSPAPI OSPCipherCompleted(const OSPCipher* const cipher)
+int32_t OSPAPI OSPCipherReady(const OSPCipher* const cipher)
+{
+	return OSPCtxCipherReady(&Default, cipher);
+}
+
+int32_t OSPAPI OSPCtxCipherCompleted(OSPContext* context, const OSPCipher* const cipher)
 {
+	LOCK_CONTEXT(context, nullptr, false);
 	return Manager.CipherCompleted(*cipher);
 }
 
-int32_t OSPAPI OSPCipherZeroed(const OSPCipher* const cipher)
+int32_t OSPAPI OSPCipherCompleted(const OSPCipher* const cipher)
 {
+	return OSPCtxCipherCompleted(&Default, cipher);
+}
+
+int32_t OSPAPI OSPCtxCipherZeroed(OSPContext* context, const OSPCipher* const cipher)
+{
+	LOCK_CONTEXT(context, nullptr, false);
 	return Manager.CipherZeroed(*cipher);
 }
 
+int32_t OSPAPI OSPCipherZeroed(const OSPCipher* const cipher)
+{
+	return OSPCtxCipherZeroed(&Default, cipher);
+}
+
+int32_t OSPAPI OSPCtxStoreStrongPassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	char* const password,
+	size_t length,
+	OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
+	return Manager.Store(string_view(name, nlen), *cipher, password, length, error);
+}
+
 int32_t OSPAPI OSPStoreStrongPassword(
 	const char* name,
 	size_t nlen,
@@ -116,10 +396,11 @@ int32_t OSPAPI OSPStoreStrongPassword(
 	size_t length,
 	OSPError* error
 ) {
-	return Manager.Store(string(name, nlen), *cipher, password, length, error);
+	return OSPCtxStoreStrongPassword(&Default, name, nlen, cipher, password, length, error);
 }
 
-int32_t OSPAPI OSPDispenseStrongPassword(
+int32_t OSPAPI OSPCtxDispenseStrongPassword(
+	OSPContext* context,
 	const char* name,
 	size_t nlen,
 	OSPCipher* cipher,
@@ -127,7 +408,8 @@ int32_t OSPAPI OSPDispenseStrongPassword(
 	size_t length,
 	OSPError* error
 ) {
-	if (Manager.Dispense(string(name, nlen), *cipher, password, length, error))
+	LOCK_CONTEXT(context, error, false);
+	if (Manager.Dispense(string_view(name, nlen), *cipher, password, length, error))
 	{
 		DECREASE_EXPOSURE; // Increased by DispenseData. Now the caller's responsbility.
 		return true;
@@ -135,38 +417,89 @@ int32_t OSPAPI OSPDispenseStrongPassword(
 	return false;
 }
 
+int32_t OSPAPI OSPDispenseStrongPassword(
+	const char* name,
+	size_t nlen,
+	OSPCipher* cipher,
+	char* const password,
+	size_t length,
+	OSPError* error
+) {
+	return OSPCtxDispenseStrongPassword(&Default, name, nlen, cipher, password, length, error);
+}
+
+int32_t OSPAPI OSPCtxDestroyStrongPassword(
+	OSPContext* context, const char* name, size_t nlen, OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
+	return Manager.Destroy(string_view(name, nlen), error);
+}
+
 int32_t OSPAPI OSPDestroyStrongPassword(const char* name, size_t nlen, OSPError* error)
 {
-	return Manager.Destroy(string(name, nlen), error);
+	return OSPCtxDestroyStrongPassword(&Default, name, nlen, error);
+}
+
+size_t OSPAPI OSPCtxStrongPasswordSize(OSPContext* context, const char* name, size_t nlen)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.DataSize(string_view(name, nlen));
 }
 
 size_t OSPAPI OSPStrongPasswordSize(const char* name, size_t nlen)
 {
-	return Manager.DataSize(string(name, nlen));
+	return OSPCtxStrongPasswordSize(&Default, name, nlen);
 }
 
-int32_t OSPAPI OSPStrongPasswordStart(size_t length, OSPError* error)
+int32_t OSPAPI OSPCtxStrongPasswordStart(OSPContext* context, size_t length, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.StrongPasswordStart(length, error);
 }
 
-int32_t OSPAPI OSPStrongPasswordPut(char ch, OSPError* error)
+int32_t OSPAPI OSPStrongPasswordStart(size_t length, OSPError* error)
+{
+	return OSPCtxStrongPasswordStart(&Default, length, error);
+}
+
+int32_t OSPAPI OSPCtxStrongPasswordPut(OSPContext* context, char ch, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.StrongPasswordPut(ch, error);
 }
 
+int32_t OSPAPI OSPStrongPasswordPut(char ch, OSPError* error)
+{
+	return OSPCtxStrongPasswordPut(&Default, ch, error);
+}
+
+int32_t OSPAPI OSPCtxStrongPasswordFinish(
+	OSPContext* context,
+	const char* name, size_t length, OSPCipher* const cipher, OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
+	return Manager.StrongPasswordFinish(string_view(name, length), *cipher, error);
+}
+
 int32_t OSPAPI OSPStrongPasswordFinish(
 	const char* name, size_t length, OSPCipher* const cipher, OSPError* error
 ) {
-	return Manager.StrongPasswordFinish(string(name, length), *cipher, error);
+	return OSPCtxStrongPasswordFinish(&Default, name, length, cipher, error);
 }
 
-int32_t OSPAPI OSPStrongPasswordAbort(OSPError* error)
+int32_t OSPAPI OSPCtxStrongPasswordAbort(OSPContext* context, OSPError* error)
 {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.StrongPasswordAbort(error);
 }
 
-int32_t OSPAPI OSPShowStrongPassword(
+int32_t OSPAPI OSPStrongPasswordAbort(OSPError* error)
+{
+	return OSPCtxStrongPasswordAbort(&Default, error);
+}
+
+int32_t OSPAPI OSPCtxShowStrongPassword(
+	OSPContext* context,
 	const char* name,
 	size_t nlen,
 	OSPCipher* cipher,
@@ -176,12 +509,27 @@ int32_t OSPAPI OSPShowStrongPassword(
 	uint32_t type,
 	OSPError* error
 ) {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.ShowStrongPassword(
-		string(name, strnlen(name, nlen)), *cipher, width, string(title, strnlen(title, tlen)), type, error
+		string_view(name, strnlen(name, nlen)), *cipher, width, string(title, strnlen(title, tlen)), type, error
 	);
 }
 
-int32_t OSPAPI OSPGeneratePassword(
+int32_t OSPAPI OSPShowStrongPassword(
+	const char* name,
+	size_t nlen,
+	OSPCipher* cipher,
+	size_t width,
+	const char* title,
+	size_t tlen,
+	uint32_t type,
+	OSPError* error
+) {
+	return OSPCtxShowStrongPassword(&Default, name, nlen, cipher, width, title, tlen, type, error);
+}
+
+int32_t OSPAPI OSPCtxGeneratePassword(
+	OSPContext* context,
 	const char* name,
 	size_t nlen,
 	const char* mnemonic,
@@ -192,10 +540,11 @@ int32_t OSPAPI OSPGeneratePassword(
 	const OSPRecipe* recipe,
 	OSPError* error
 ) {
+	LOCK_CONTEXT(context, error, false);
 	PasswordVector buffer(nullptr, password, (length + 1)*sizeof(char));
 
 	bool success = Manager.GeneratePassword(
-		string(name, strnlen(name, nlen)),
+		string_view(name, strnlen(name, nlen)),
 		string(mnemonic, strnlen(mnemonic, mlen)),
 		*cipher,
 		buffer,
@@ -209,18 +558,115 @@ int32_t OSPAPI OSPGeneratePassword(
 	return success && buffer.Release(error);
 }
 
-int32_t OSPAPI OSPPasswordToClipboard(
+int32_t OSPAPI OSPGeneratePassword(
 	const char* name,
 	size_t nlen,
 	const char* mnemonic,
 	size_t mlen,
 	const OSPCipher* cipher,
+	char* const password,
 	size_t length,
 	const OSPRecipe* recipe,
 	OSPError* error
 ) {
+	return OSPCtxGeneratePassword(
+		&Default, name, nlen, mnemonic, mlen, cipher, password, length, recipe, error
+	);
+}
+
+int32_t OSPAPI OSPCtxStartThreads(OSPContext* context, size_t threads, OSPError* error)
+{
+	LOCK_CONTEXT(context, error, false);
+	return Manager.StartThreads(threads, error);
+}
+
+int32_t OSPAPI OSPStartThreads(size_t threads, OSPError* error)
+{
+	return OSPCtxStartThreads(&Default, threads, error);
+}
+
+void OSPAPI OSPCtxStopThreads(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, );
+	Manager.StopThreads();
+}
+
+void OSPAPI OSPStopThreads()
+{
+	OSPCtxStopThreads(&Default);
+}
+
+size_t OSPAPI OSPCtxThreads(OSPContext* context)
+{
+	LOCK_CONTEXT(context, nullptr, 0);
+	return Manager.Threads();
+}
+
+size_t OSPAPI OSPThreads()
+{
+	return OSPCtxThreads(&Default);
+}
+
+size_t OSPAPI OSPPasswordsLength(const OSPPasswordRequest* requests, size_t count)
+{
+	return PasswordManager::PasswordsLength(requests, count);
+}
+
+int32_t OSPAPI OSPCtxGeneratePasswords(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	const OSPPasswordRequest* requests,
+	size_t count,
+	char* const passwords,
+	size_t size,
+	OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
+	PasswordVector buffer(nullptr, passwords, size*sizeof(char));
+
+	bool success = Manager.GeneratePasswords(
+		string_view(name, strnlen(name, nlen)),
+		*cipher,
+		requests,
+		count,
+		buffer,
+		error
+	);
+
+	if (success)
+		DECREASE_EXPOSURE; // Increased by GeneratePasswords.
+	return success && buffer.Release(error);
+}
+
+int32_t OSPAPI OSPGeneratePasswords(
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	const OSPPasswordRequest* requests,
+	size_t count,
+	char* const passwords,
+	size_t size,
+	OSPError* error
+) {
+	return OSPCtxGeneratePasswords(&Default, name, nlen, cipher, requests, count, passwords, size, error);
+}
+
+int32_t OSPAPI OSPCtxPasswordToClipboard(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	size_t length,
+	const OSPRecipe* recipe,
+	OSPError* error
+) {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.PasswordToClipboard(
-		string(name, strnlen(name, nlen)),
+		string_view(name, strnlen(name, nlen)),
 		string(mnemonic, strnlen(mnemonic, mlen)),
 		*cipher,
 		length,
@@ -229,7 +675,21 @@ int32_t OSPAPI OSPPasswordToClipboard(
 	);
 }
 
-int32_t OSPAPI OSPShowPassword(
+int32_t OSPAPI OSPPasswordToClipboard(
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	size_t length,
+	const OSPRecipe* recipe,
+	OSPError* error
+) {
+	return OSPCtxPasswordToClipboard(&Default, name, nlen, mnemonic, mlen, cipher, length, recipe, error);
+}
+
+int32_t OSPAPI OSPCtxShowPassword(
+	OSPContext* context,
 	const char* name,
 	size_t nlen,
 	const char* mnemonic,
@@ -243,8 +703,9 @@ int32_t OSPAPI OSPShowPassword(
 	uint32_t type,
 	OSPError* error
 ) {
+	LOCK_CONTEXT(context, error, false);
 	return Manager.ShowPassword(
-		string(name, strnlen(name, nlen)),
+		string_view(name, strnlen(name, nlen)),
 		string(mnemonic, strnlen(mnemonic, mlen)),
 		*cipher,
 		length,
@@ -255,3 +716,22 @@ int32_t OSPAPI OSPShowPassword(
 		error
 	);
 }
+
+int32_t OSPAPI OSPShowPassword(
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	size_t length,
+	const OSPRecipe* recipe,
+	size_t width,
+	const char* title,
+	size_t tlen,
+	uint32_t type,
+	OSPError* error
+) {
+	return OSPCtxShowPassword(
+		&Default, name, nlen, mnemonic, mlen, cipher, length, recipe, width, title, tlen, type, error
+	);
+}
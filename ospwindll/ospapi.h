@@ -26,7 +26,11 @@ Software.
 
 #include "../osp/osp.h"
 
-#ifdef OSPDLL_EXPORT
+#if !defined(_WIN32)
+
+#define OSPAPI
+
+#elif defined(OSPDLL_EXPORT)
 
 #define OSPAPI __declspec(dllexport) __stdcall
 
@@ -36,40 +40,144 @@ Software.
 
 #endif
 
+// Context
+
+// Every export that takes a context has a twin without one that uses the
+// default context. A context may be used from any thread, calls on one
+// context take turns. Given a null context, exports fail with
+// OSP_ERROR_NULL_POINTER and return 0.
+
+typedef struct OSPContext OSPContext;
+
+extern "C" OSPContext* OSPAPI OSPCreateContext(OSPError* error);
+
+extern "C" int32_t OSPAPI OSPDestroyContext(OSPContext* context, OSPError* error);
+
+extern "C" OSPContext* OSPAPI OSPDefaultContext();
+
 // Global
 
 extern "C" int32_t OSPAPI OSPSetError(OSPErrorType type, uint32_t code, OSPError* error);
 
 extern "C" int32_t OSPAPI OSPInit(size_t count, size_t length, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxInit(OSPContext* context, size_t count, size_t length, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPReset(size_t count, size_t length, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxReset(OSPContext* context, size_t count, size_t length, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPDestroy(OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxDestroy(OSPContext* context, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPDestroyed();
 
+extern "C" int32_t OSPAPI OSPCtxDestroyed(OSPContext* context);
+
 extern "C" size_t OSPAPI OSPMinLength();
 
+extern "C" size_t OSPAPI OSPCtxMinLength(OSPContext* context);
+
 extern "C" size_t OSPAPI OSPMaxLength();
 
+extern "C" size_t OSPAPI OSPCtxMaxLength(OSPContext* context);
+
 extern "C" size_t OSPAPI OSPBlockLength(OSPError* error);
 
+extern "C" size_t OSPAPI OSPCtxBlockLength(OSPContext* context, OSPError* error);
+
+// How stored strong passwords are padded, one of the OSP_PADDING values
+
+extern "C" uint32_t OSPAPI OSPPadding();
+
+extern "C" uint32_t OSPAPI OSPCtxPadding(OSPContext* context);
+
+extern "C" void OSPAPI OSPSetPadding(uint32_t padding);
+
+extern "C" void OSPAPI OSPCtxSetPadding(OSPContext* context, uint32_t padding);
+
+// How stored strong passwords are encrypted, one of the OSP_STORAGE values.
+// With OSP_STORAGE_GCM a changed entry fails with OSP_ERROR_DATA_NOT_AUTHENTIC.
+
+extern "C" uint32_t OSPAPI OSPStorage();
+
+extern "C" uint32_t OSPAPI OSPCtxStorage(OSPContext* context);
+
+extern "C" void OSPAPI OSPSetStorage(uint32_t storage);
+
+extern "C" void OSPAPI OSPCtxSetStorage(OSPContext* context, uint32_t storage);
+
+// How strong mnemonics are stretched, passwords are only reproduced with the
+// profile they were generated with
+
+extern "C" int32_t OSPAPI OSPGetKdfProfile(OSPKdfProfile* profile, OSPError* error);
+
+extern "C" int32_t OSPAPI OSPCtxGetKdfProfile(OSPContext* context, OSPKdfProfile* profile, OSPError* error);
+
+extern "C" int32_t OSPAPI OSPSetKdfProfile(const OSPKdfProfile* profile, OSPError* error);
+
+extern "C" int32_t OSPAPI OSPCtxSetKdfProfile(OSPContext* context, const OSPKdfProfile* profile, OSPError* error);
+
+// Calibrating the profile to a latency on this host, at the next OSPInit or
+// now. The rate is what was measured, in Kdf cost units per second.
+
+extern "C" int32_t OSPAPI OSPSetKdfCalibration(uint32_t function, uint32_t milliseconds, OSPError* error);
+
+extern "C" int32_t OSPAPI OSPCtxSetKdfCalibration(
+	OSPContext* context, uint32_t function, uint32_t milliseconds, OSPError* error
+);
+
+extern "C" int32_t OSPAPI OSPCalibrateKdf(uint32_t function, uint32_t milliseconds, OSPError* error);
+
+extern "C" int32_t OSPAPI OSPCtxCalibrateKdf(
+	OSPContext* context, uint32_t function, uint32_t milliseconds, OSPError* error
+);
+
+extern "C" uint64_t OSPAPI OSPKdfRate();
+
+extern "C" uint64_t OSPAPI OSPCtxKdfRate(OSPContext* context);
+
+// Completed ciphers' keys found in the key cache and made on a miss
+
+extern "C" size_t OSPAPI OSPKeyCacheHits();
+
+extern "C" size_t OSPAPI OSPCtxKeyCacheHits(OSPContext* context);
+
+extern "C" size_t OSPAPI OSPKeyCacheMisses();
+
+extern "C" size_t OSPAPI OSPCtxKeyCacheMisses(OSPContext* context);
+
 // Cipher
 
 extern "C" int32_t OSPAPI OSPPrepareCipher(OSPCipher* const cipher, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxPrepareCipher(OSPContext* context, OSPCipher* const cipher, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPCompleteCipher(OSPCipher* const cipher, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxCompleteCipher(OSPContext* context, OSPCipher* const cipher, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPZeroCipher(OSPCipher* const cipher, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxZeroCipher(OSPContext* context, OSPCipher* const cipher, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPCipherPrepared(const OSPCipher* const cipher);
 
+extern "C" int32_t OSPAPI OSPCtxCipherPrepared(OSPContext* context, const OSPCipher* const cipher);
+
 extern "C" int32_t OSPAPI OSPCipherReady(const OSPCipher* const cipher);
 
+extern "C" int32_t OSPAPI OSPCtxCipherReady(OSPContext* context, const OSPCipher* const cipher);
+
 extern "C" int32_t OSPAPI OSPCipherCompleted(const OSPCipher* const cipher);
 
+extern "C" int32_t OSPAPI OSPCtxCipherCompleted(OSPContext* context, const OSPCipher* const cipher);
+
 extern "C" int32_t OSPAPI OSPCipherZeroed(const OSPCipher* const cipher);
 
+extern "C" int32_t OSPAPI OSPCtxCipherZeroed(OSPContext* context, const OSPCipher* const cipher);
+
 // Strong Password
 
 extern "C" int32_t OSPAPI OSPStoreStrongPassword(
@@ -81,6 +189,16 @@ extern "C" int32_t OSPAPI OSPStoreStrongPassword(
 	OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxStoreStrongPassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	char* const password,
+	size_t length,
+	OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPDispenseStrongPassword(
 	const char* name,
 	size_t nlen,
@@ -90,18 +208,43 @@ extern "C" int32_t OSPAPI OSPDispenseStrongPassword(
 	OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxDispenseStrongPassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	OSPCipher* cipher,
+	char* const password,
+	size_t length,
+	OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPDestroyStrongPassword(const char* name, size_t nlen, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxDestroyStrongPassword(
+	OSPContext* context, const char* name, size_t nlen, OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPStrongPasswordStart(size_t length, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxStrongPasswordStart(OSPContext* context, size_t length, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPStrongPasswordPut(char ch, OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxStrongPasswordPut(OSPContext* context, char ch, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPStrongPasswordFinish(
 	const char* name, size_t length, OSPCipher* const cipher, OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxStrongPasswordFinish(
+	OSPContext* context,
+	const char* name, size_t length, OSPCipher* const cipher, OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPStrongPasswordAbort(OSPError* error);
 
+extern "C" int32_t OSPAPI OSPCtxStrongPasswordAbort(OSPContext* context, OSPError* error);
+
 extern "C" int32_t OSPAPI OSPShowStrongPassword(
 	const char* name,
 	size_t nlen,
@@ -113,8 +256,22 @@ extern "C" int32_t OSPAPI OSPShowStrongPassword(
 	OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxShowStrongPassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	OSPCipher* cipher,
+	size_t width,
+	const char* title,
+	size_t tlen,
+	uint32_t type,
+	OSPError* error
+);
+
 extern "C" size_t OSPAPI OSPStrongPasswordSize(const char* name, size_t nlen);
 
+extern "C" size_t OSPAPI OSPCtxStrongPasswordSize(OSPContext* context, const char* name, size_t nlen);
+
 // Generate Password
 
 extern "C" int32_t OSPAPI OSPGeneratePassword(
@@ -129,6 +286,57 @@ extern "C" int32_t OSPAPI OSPGeneratePassword(
 	OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxGeneratePassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	char* const password,
+	size_t length,
+	const OSPRecipe* recipe,
+	OSPError* error
+);
+
+// Threads OSPGeneratePasswords spreads its work across, 0 for one per core
+
+extern "C" int32_t OSPAPI OSPStartThreads(size_t threads, OSPError* error);
+extern "C" int32_t OSPAPI OSPCtxStartThreads(OSPContext* context, size_t threads, OSPError* error);
+extern "C" void OSPAPI OSPStopThreads();
+extern "C" void OSPAPI OSPCtxStopThreads(OSPContext* context);
+extern "C" size_t OSPAPI OSPThreads();
+extern "C" size_t OSPAPI OSPCtxThreads(OSPContext* context);
+
+// Passwords are written consecutively, each followed by a terminator,
+// into a buffer of at least OSPPasswordsLength characters. That is SIZE_MAX
+// when the lengths do not fit in a size_t, and generating them fails.
+
+extern "C" size_t OSPAPI OSPPasswordsLength(const OSPPasswordRequest* requests, size_t count);
+
+extern "C" int32_t OSPAPI OSPGeneratePasswords(
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	const OSPPasswordRequest* requests,
+	size_t count,
+	char* const passwords,
+	size_t size,
+	OSPError* error
+);
+
+extern "C" int32_t OSPAPI OSPCtxGeneratePasswords(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const OSPCipher* cipher,
+	const OSPPasswordRequest* requests,
+	size_t count,
+	char* const passwords,
+	size_t size,
+	OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPPasswordToClipboard(
 	const char* name,
 	size_t nlen,
@@ -140,6 +348,18 @@ extern "C" int32_t OSPAPI OSPPasswordToClipboard(
 	OSPError* error
 );
 
+extern "C" int32_t OSPAPI OSPCtxPasswordToClipboard(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	size_t length,
+	const OSPRecipe* recipe,
+	OSPError* error
+);
+
 extern "C" int32_t OSPAPI OSPShowPassword(
 	const char* name,
 	size_t nlen,
@@ -154,3 +374,19 @@ extern "C" int32_t OSPAPI OSPShowPassword(
 	uint32_t type,
 	OSPError* error
 );
+
+extern "C" int32_t OSPAPI OSPCtxShowPassword(
+	OSPContext* context,
+	const char* name,
+	size_t nlen,
+	const char* mnemonic,
+	size_t mlen,
+	const OSPCipher* cipher,
+	size_t length,
+	const OSPRecipe* recipe,
+	size_t width,
+	const char* title,
+	size_t tlen,
+	uint32_t type,
+	OSPError* error
+);
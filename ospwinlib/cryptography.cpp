@@ -27,13 +27,32 @@ Software.
 #include <safeint.h>
 
 #include "..\osp\bytevector.h"
+#include "..\osp\drbg.h"
 #include "..\osp\hashvector.h"
+#include "..\osp\keycache.h"
 
 using namespace msl::utilities;
 using namespace OneStrongPassword;
 
 #pragma region OS Specific Functions
 
+// AES, the working IV is copied here since BCrypt updates it
+const size_t MAX_BLOCK_SIZE = 16;
+
+#ifndef STATUS_AUTH_TAG_MISMATCH
+#define STATUS_AUTH_TAG_MISMATCH ((NTSTATUS)0xC000A002L)
+#endif
+
+void DestroyKey(BCRYPT_KEY_HANDLE& hkey, PUCHAR& keyobj, OSPError* error);
+
+typedef struct CachedKey
+{
+	BCRYPT_KEY_HANDLE Handle = NULL;
+	PUCHAR Object = NULL;
+
+	void Destroy() { DestroyKey(Handle, Object, nullptr); }
+} CachedKey;
+
 typedef struct StateHandle
 {
 	mutable BCRYPT_ALG_HANDLE Encrypt = NULL;
@@ -41,6 +60,7 @@ typedef struct StateHandle
 	mutable size_t BlockSize = 0;
 	mutable size_t KeySize = 0;
 	mutable size_t HashSize = 0;
+	mutable KeyCache<CachedKey> Keys;
 } OSPState;
 
 bool checkStatus(NTSTATUS status, OSPError* error)
@@ -115,12 +135,28 @@ size_t KeySize(const StateHandle* state, OSPError* error)
 	return NULL;
 }
 
+// Everything the state caches is looked up as soon as it is created, so
+// threads sharing the cryptography afterwards only ever read it
+void FillState(const StateHandle* state, OSPError* error)
+{
+	ULONG result;
+
+	KeySize(state, error);
+
+	checkStatus(BCryptGetProperty(
+		EncryptAlgorithm(state, error), BCRYPT_BLOCK_LENGTH, (PUCHAR)&(state->BlockSize), sizeof(state->BlockSize), &result, 0
+	), error);
+
+	checkStatus(BCryptGetProperty(
+		HashAlgorithm(state, error), BCRYPT_HASH_LENGTH, (PUCHAR)&(state->HashSize), sizeof(state->HashSize), &result, 0
+	), error);
+}
+
 void DestroyKey(BCRYPT_KEY_HANDLE& hkey, PUCHAR& keyobj, OSPError* error)
 {
 	if (hkey)
 		checkStatus(BCryptDestroyKey(hkey), error);
-	else if (keyobj)
-		delete[] keyobj;
+	delete[] keyobj;
 	hkey = keyobj = 0;
 }
 
@@ -157,61 +193,135 @@ bool RetreiveKey(
 	return success;
 }
 
-size_t EncryptSize(BCRYPT_KEY_HANDLE hkey, size_t data_size, size_t size, OSPError* error)
+// The key of a cipher, its handle while Prepared, otherwise leased from the
+// key cache or, when none can be leased, imported for this use only
+class CipherKey
 {
-	DWORD result = 0;
+public:
+	CipherKey(const Cryptography& cryptography, const Cipher& cipher, OSPError* error)
+	{
+		handle = cipher.Handle();
+		if (handle)
+			return;
 
-	if (checkStatus(BCryptEncrypt(
-		hkey, NULL, SafeInt<ULONG>(data_size), NULL, NULL, 0, NULL, 0, &result, 0
-	), error))
-		return result;
+		const StateHandle* state = static_cast<const StateHandle*>(cryptography.State());
 
-	return 0;
-}
+		if (!cipher.Completed())
+		{
+			OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+			return;
+		}
 
-bool BeginHashing(Cryptography& cryptography, BCRYPT_HASH_HANDLE& hhash, PUCHAR& hashobj, ULONG flags, OSPError* error)
+		keys = &state->Keys;
+		leased = keys->Lease(cipher.Key(), cipher.Size(), [&](CachedKey& key) {
+			return RetreiveKey(state, cipher, key.Handle, key.Object, error);
+		});
+
+		if (leased)
+			handle = leased->Handle;
+		else if (RetreiveKey(state, cipher, retrieved.Handle, retrieved.Object, error))
+			handle = retrieved.Handle;
+	}
+
+	~CipherKey()
+	{
+		if (leased)
+			keys->Return(leased);
+		else
+			retrieved.Destroy();
+	}
+
+	BCRYPT_KEY_HANDLE Handle() const { return handle; }
+
+private:
+	KeyCache<CachedKey>* keys = nullptr;
+	CachedKey* leased = nullptr;
+	CachedKey retrieved;
+	BCRYPT_KEY_HANDLE handle = NULL;
+};
+
+// A duplicate of a cipher's key chaining with GCM. The cipher's own key, or
+// the one the cache lends, stays CBC for everyone else sharing it.
+class GcmKey
+{
+public:
+	GcmKey(const Cryptography& cryptography, const Cipher& cipher, OSPError* error)
+	{
+		CipherKey key(cryptography, cipher, error);
+		if (!key.Handle())
+			return;
+
+		size_t keysz = KeySize(static_cast<const StateHandle*>(cryptography.State()), error);
+		object = new byte[keysz];
+
+		if (!checkStatus(BCryptDuplicateKey(key.Handle(), &handle, object, SafeInt<ULONG>(keysz), 0), error) ||
+			!checkStatus(BCryptSetProperty(
+				handle, BCRYPT_CHAINING_MODE, (PBYTE)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0
+			), error)
+		) {
+			DestroyKey(handle, object, error);
+		}
+	}
+
+	~GcmKey() { DestroyKey(handle, object, nullptr); }
+
+	BCRYPT_KEY_HANDLE Handle() const { return handle; }
+
+private:
+	BCRYPT_KEY_HANDLE handle = NULL;
+	PUCHAR object = NULL;
+};
+
+typedef struct HashHandle
+{
+	BCRYPT_HASH_HANDLE Hash = NULL;
+	PUCHAR Object = NULL;
+} HashHandle;
+
+bool BeginHashing(Cryptography& cryptography, HashHandle& handle, ULONG flags, OSPError* error)
 {
 	ULONG result;
 	unsigned int osize = 0;
 
-	BEGIN_MEMORY_CHECK(cryptography.AvailableMemory());
-
 	BCRYPT_ALG_HANDLE halg = HashAlgorithm(static_cast<StateHandle*>(cryptography.State()), error);
 
 	bool success = checkStatus(BCryptGetProperty(halg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&osize, sizeof(osize), &result, 0), error);
 	if (success)
 	{
-		hashobj = new UCHAR[osize];
-		if (hashobj)
+		handle.Object = new UCHAR[osize];
+		if (handle.Object)
 			success = checkStatus(
-				BCryptCreateHash(halg, &hhash, hashobj, osize, NULL, 0, flags), error
+				BCryptCreateHash(halg, &handle.Hash, handle.Object, osize, NULL, 0, flags), error
 			);
 	}
 
-	if (!success && hashobj)
-		cryptography.Destroy(hashobj, osize, error);
-
-	END_MEMORY_CHECK(cryptography.AvailableMemory());
+	if (!success)
+	{
+		delete[] handle.Object;
+		handle.Object = NULL;
+	}
 
 	return success;
 }
 
 bool DoHashing(
-	const OS& os, BCRYPT_HASH_HANDLE hhash, const byte* const data, size_t dsize, byte* const hash, size_t hsize, OSPError* error
+	BCRYPT_HASH_HANDLE hhash, const byte* const data, size_t dsize, byte* const hash, size_t hsize, OSPError* error
 ) {
 	bool success = false;
-	os.Zero(hash, hsize);
+	OS::Zero(hash, hsize);
 	if (success = checkStatus(BCryptHashData(hhash, (PUCHAR)data, SafeInt<ULONG>(dsize), 0), error))
 		success = checkStatus(BCryptFinishHash(hhash, hash, SafeInt<ULONG>(hsize), 0), error);
 	return success;
 }
 
-bool EndHashing(BCRYPT_HASH_HANDLE& hhash, OSPError* error)
+bool EndHashing(HashHandle& handle, OSPError* error)
 {
 	bool success = true;
-	if (hhash)
-		success = checkStatus(BCryptDestroyHash(hhash), error);
-	hhash = 0;
+	if (handle.Hash)
+		success = checkStatus(BCryptDestroyHash(handle.Hash), error);
+	delete[] handle.Object;
+	handle.Hash = NULL;
+	handle.Object = NULL;
 	return success;
 }
 
@@ -228,14 +338,17 @@ Cryptography::Cryptography(size_t count, size_t maxsize, OSPError* error) : OS()
 
 Cryptography::byte* const Cryptography::Randomize(byte* const data, size_t size, OSPError* error) const
 {
-	if (
-		data && size &&
-		checkStatus(BCryptGenRandom(NULL, data, (ULONG)size, BCRYPT_USE_SYSTEM_PREFERRED_RNG), error)
-	)
+	if (data && size && Drbg::Thread().Generate(data, size, Entropy, error))
 		return data;
 	return nullptr;
 }
 
+bool Cryptography::Entropy(byte* const data, size_t size, OSPError* error)
+{
+	return data && size &&
+		checkStatus(BCryptGenRandom(NULL, data, SafeInt<ULONG>(size), BCRYPT_USE_SYSTEM_PREFERRED_RNG), error);
+}
+
 bool Cryptography::Initialize(size_t count, size_t maxsize, size_t additional, OSPError* error)
 {
 	if (maxsize < MinDataSize())
@@ -262,6 +375,8 @@ bool Cryptography::Destroy(OSPError* error)
 	StateHandle* state = (StateHandle*)(State(error));
 	if (state)
 	{
+		state->Keys.Clear();
+
 		if (state->Encrypt)
 		{
 			success = checkStatus(BCryptCloseAlgorithmProvider(state->Encrypt, 0), error) && success;
@@ -274,7 +389,7 @@ bool Cryptography::Destroy(OSPError* error)
 			state->Hash = 0;
 		}
 
-		delete _state;
+		delete state;
 		_state = nullptr;
 	}
 
@@ -287,229 +402,296 @@ bool Cryptography::Destroy(OSPError* error)
 
 void* Cryptography::State(OSPError* error)
 {
+	std::lock_guard<std::mutex> guard(_statelock);
 	if (!_state)
+	{
 		_state = new StateHandle;
+		FillState(static_cast<StateHandle*>(_state), error);
+	}
 	return _state;
 }
 
 const void* Cryptography::State(OSPError* error) const
 {
+	std::lock_guard<std::mutex> guard(_statelock);
 	if (!_state)
+	{
 		_state = new StateHandle;
+		FillState(static_cast<StateHandle*>(_state), error);
+	}
 	return _state;
 }
 
 size_t Cryptography::EncryptSize(const Cipher& cipher, size_t size, OSPError* error)
 {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
-
-	size_t esize = 0;
-
 	if (!cipher.Prepared() && !cipher.Completed())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
 
-	StateHandle* state = static_cast<StateHandle*>(State());
-	BCRYPT_ALG_HANDLE halg = EncryptAlgorithm(state, error);
-	BCRYPT_KEY_HANDLE hkey = cipher.Handle();
-	PBYTE keyobj = NULL;
-	if (!hkey && !RetreiveKey(state, cipher, hkey, keyobj, error))
-		return false;
-
-	esize = ::EncryptSize(hkey, DataSize(size), DataSize(size), error);
-
-	if (hkey != cipher.Handle())
-		::DestroyKey(hkey, keyobj, error);
-
-	END_MEMORY_CHECK(AvailableMemory());
-	return esize;
+	// CBC without padding never expands block aligned data
+	return DataSize(size);
 }
 
 bool Cryptography::Encrypt(
 	const Cipher& cipher, const ByteVector& iv, ByteVector& data, ByteVector& encrypted, OSPError* error
 ) {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
-	if (encrypted.Size() < data.Size())
+	if (encrypted.Size() < data.Size() || iv.Size() < BlockSize() || BlockSize() > MAX_BLOCK_SIZE)
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
 
 	if (!cipher.Prepared() && !cipher.Completed())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
 
-	StateHandle* state = static_cast<StateHandle*>(State());
-	BCRYPT_KEY_HANDLE hkey = cipher.Handle();
-	PBYTE keyobj = NULL;
-	if (!hkey && !RetreiveKey(state, cipher, hkey, keyobj, error))
+	CipherKey key(*this, cipher, error);
+	BCRYPT_KEY_HANDLE hkey = key.Handle();
+	if (!hkey)
 		return false;
 
 	size_t extra = 0;
-	size_t esize = ::EncryptSize(hkey, DataSize(data.Size()), data.Size(), error);
+	size_t esize = DataSize(data.Size());
+
+	// Growing the encrypted buffer would lose data encrypted in place
+	bool inplace = &data == &encrypted;
+	if (inplace && encrypted.Size() < esize)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
 
 	ULONG result;
-	ByteVector vector(*this);
+	ByteArray<MAX_BLOCK_SIZE> vector;
 
-	bool success = vector.Alloc(iv.Size(), error);
-	if (success)
-	{
-		vector.CopyFrom(iv, error);
+	bool success = vector.CopyFrom(iv, BlockSize(), 0, error);
 
-		if (encrypted.Size() < esize)
+	if (success && encrypted.Size() < esize)
+	{
+		if (encrypted.Fixed() || esize > MaxDataSize())
+			success = false;
+		else
 		{
-			if (encrypted.Fixed() || esize > MaxDataSize())
-				success = false;
-			else
-			{
-				extra = esize - encrypted.Size();
-				success = encrypted.Realloc(esize, error);
-			}
+			extra = esize - encrypted.Size();
+			success = encrypted.Realloc(esize, error);
 		}
+	}
 
-		if (success)
+	if (success)
+	{
+		// Unaligned data is padded in place, in the encrypted buffer that holds esize
+		PUCHAR plain = data;
+		if (data.Size() != esize)
 		{
-			size_t dsize = DataSize(data.Size());
-			if (data.Size() == dsize)
-			{
-				success = checkStatus(BCryptEncrypt(
-					hkey,
-					data,
-					SafeInt<ULONG>(data.Size()),
-					NULL,
-					vector,
-					SafeInt<ULONG>(vector.Size()),
-					encrypted,
-					SafeInt<ULONG>(data.Size()),
-					&result,
-					0
-				), error);
-			}
-			else
-			{
-				ByteVector buffer(*this);
-				if (success = buffer.Alloc(dsize, error))
-				{
-					success = checkStatus(BCryptEncrypt(
-						hkey,
-						buffer,
-						SafeInt<ULONG>(buffer.Size()),
-						NULL,
-						vector,
-						SafeInt<ULONG>(vector.Size()),
-						encrypted,
-						SafeInt<ULONG>(encrypted.Size()),
-						&result,
-						0
-					), error);
-					data.CopyFrom(buffer, error);
-					buffer.Destroy(error);
-				}
-			}
+			memcpy(encrypted, plain, data.Size());
+			OS::Zero(&encrypted[data.Size()], esize - data.Size());
+			plain = encrypted;
 		}
 
-		if (success)
-			data.Zero();
-
-		vector.Destroy(error);
+		success = checkStatus(BCryptEncrypt(
+			hkey,
+			plain,
+			SafeInt<ULONG>(esize),
+			NULL,
+			vector,
+			SafeInt<ULONG>(BlockSize()),
+			encrypted,
+			SafeInt<ULONG>(esize),
+			&result,
+			0
+		), error);
 	}
 
-	if (hkey != cipher.Handle())
-		DestroyKey(hkey, keyobj, error);
+	// Encrypted in place the data is the ciphertext
+	if (success && !inplace)
+		data.Zero();
+
+	END_MEMORY_CHECK(ThreadAvailableMemory() + extra);
+	return success;
+}
+
+bool Cryptography::Encrypt(
+	const Cipher& cipher,
+	const ByteVector& iv,
+	ByteVector* const data[],
+	ByteVector* const encrypted[],
+	size_t count,
+	OSPError* error
+) {
+	for (size_t n = 0; n < count; n++)
+	{
+		if (encrypted[n]->Size() < DataSize(data[n]->Size()))
+			return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+	}
 
-	END_MEMORY_CHECK(AvailableMemory() + extra);
+	// CNG chains one buffer per call, each finding the key in the key cache
+	bool success = true;
+	for (size_t n = 0; success && n < count; n++)
+		success = Encrypt(cipher, iv, *data[n], *encrypted[n], error);
 	return success;
 }
 
 bool Cryptography::Decrypt(
 	const Cipher& cipher, const ByteVector& iv, ByteVector& encrypted, ByteVector& decrypted, OSPError* error
 ) {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
 	if (!cipher.Prepared() && !cipher.Completed())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
 
-	StateHandle* state = static_cast<StateHandle*>(State());
-	BCRYPT_KEY_HANDLE hkey = cipher.Handle();
-	PBYTE keyobj = NULL;
-	if (!hkey && !RetreiveKey(state, cipher, hkey, keyobj, error))
+	if (encrypted.Size() < decrypted.Size() || iv.Size() < BlockSize() || BlockSize() > MAX_BLOCK_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	CipherKey key(*this, cipher, error);
+	BCRYPT_KEY_HANDLE hkey = key.Handle();
+	if (!hkey)
 		return false;
 
 	ULONG result = 0;
-	ByteVector vector(*this);
+	ByteArray<MAX_BLOCK_SIZE> vector;
 
-	bool success = vector.Alloc(iv.Size(), error);
-	if (success)
-		vector.CopyFrom(iv, error);
-
-	success = checkStatus(BCryptDecrypt(
+	bool success = vector.CopyFrom(iv, BlockSize(), 0, error) && checkStatus(BCryptDecrypt(
 		hkey,
 		encrypted,
 		SafeInt<ULONG>(decrypted.Size()),
 		NULL,
 		vector,
-		SafeInt<ULONG>(vector.Size()),
+		SafeInt<ULONG>(BlockSize()),
 		decrypted,
 		SafeInt<ULONG>(decrypted.Size()),
 		&result,
 		0
 	), error);
 
-	if (success)
+	// Decrypted in place the encrypted data is gone already
+	if (success && &encrypted != &decrypted)
 		encrypted.Zero();
 
-	vector.Destroy(error);
-	if (hkey != cipher.Handle())
-		DestroyKey(hkey, keyobj, error);
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
+
+bool Cryptography::EncryptGcm(
+	const Cipher& cipher,
+	const ByteVector& nonce,
+	ByteVector& data,
+	ByteVector& encrypted,
+	ByteVector& tag,
+	std::string_view aad,
+	OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
+
+	if (encrypted.Size() < data.Size() || nonce.Size() < NONCE_SIZE || tag.Size() < TAG_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	GcmKey key(*this, cipher, error);
+	BCRYPT_KEY_HANDLE hkey = key.Handle();
+	if (!hkey)
+		return false;
+
+	BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+	BCRYPT_INIT_AUTH_MODE_INFO(info);
+	info.pbNonce = (PUCHAR)(const byte*)nonce;
+	info.cbNonce = SafeInt<ULONG>(NONCE_SIZE);
+	info.pbAuthData = (PUCHAR)aad.data();
+	info.cbAuthData = SafeInt<ULONG>(aad.size());
+	info.pbTag = tag;
+	info.cbTag = SafeInt<ULONG>(TAG_SIZE);
+
+	ULONG result = 0;
+	bool success = checkStatus(BCryptEncrypt(
+		hkey,
+		data,
+		SafeInt<ULONG>(data.Size()),
+		&info,
+		NULL,
+		0,
+		encrypted,
+		SafeInt<ULONG>(data.Size()),
+		&result,
+		0
+	), error);
+
+	// Encrypted in place the data is the ciphertext
+	if (success && &data != &encrypted)
+		data.Zero();
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
-bool Cryptography::Hash(const ByteVector& data, ByteVector& hash, OSPError* error)
-{
-	hash.Zero();
+bool Cryptography::DecryptGcm(
+	const Cipher& cipher,
+	const ByteVector& nonce,
+	ByteVector& encrypted,
+	const ByteVector& tag,
+	ByteVector& decrypted,
+	std::string_view aad,
+	OSPError* error
+) {
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
-	bool success = false;
+	if (decrypted.Size() < encrypted.Size() || nonce.Size() < NONCE_SIZE || tag.Size() < TAG_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
 
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	if (!cipher.Prepared() && !cipher.Completed())
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+
+	GcmKey key(*this, cipher, error);
+	BCRYPT_KEY_HANDLE hkey = key.Handle();
+	if (!hkey)
+		return false;
 
-	BCRYPT_HASH_HANDLE hhash = 0;
-	PUCHAR hashobj = 0;
+	BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+	BCRYPT_INIT_AUTH_MODE_INFO(info);
+	info.pbNonce = (PUCHAR)(const byte*)nonce;
+	info.cbNonce = SafeInt<ULONG>(NONCE_SIZE);
+	info.pbAuthData = (PUCHAR)aad.data();
+	info.cbAuthData = SafeInt<ULONG>(aad.size());
+	info.pbTag = (PUCHAR)(const byte*)tag;
+	info.cbTag = SafeInt<ULONG>(TAG_SIZE);
 
-	if (success = BeginHashing(*this, hhash, hashobj, BCRYPT_HASH_REUSABLE_FLAG, error))
+	ULONG result = 0;
+	NTSTATUS status = BCryptDecrypt(
+		hkey,
+		encrypted,
+		SafeInt<ULONG>(encrypted.Size()),
+		&info,
+		NULL,
+		0,
+		decrypted,
+		SafeInt<ULONG>(encrypted.Size()),
+		&result,
+		0
+	);
+
+	bool success = false;
+
+	if (status == STATUS_AUTH_TAG_MISMATCH)
 	{
-		const byte* dpart = data;
-		byte* hpart = hash;
+		OS::Zero(decrypted, encrypted.Size());
+		OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_DATA_NOT_AUTHENTIC);
+	}
+	else
+		success = checkStatus(status, error);
 
-		size_t hashsize = HashSize();
-		size_t datasize = data.Size();
+	// Decrypted in place the encrypted data is gone already
+	if (success && &encrypted != &decrypted)
+		encrypted.Zero();
 
-		size_t count = hash.Size() / hashsize;
+	END_MEMORY_CHECK(ThreadAvailableMemory());
+	return success;
+}
 
-		for (size_t n = 0; success && n < count; n++)
-		{
-			if (success = DoHashing(*this, hhash, dpart, datasize, hpart, hashsize, error))
-			{
-				dpart = hpart;
-				datasize = hashsize;
-				hpart += hashsize;
-			}
-		}
+bool Cryptography::Hash(const ByteVector& data, ByteVector& hash, OSPError* error)
+{
+	hash.Zero();
 
-		size_t remaining = hash.Size() % hashsize;
-		if (success && remaining)
-		{
-			HashVector tmp(*this);
-			if (tmp.Initialize())
-			{
-				success = DoHashing(*this, hhash, dpart, datasize, tmp, hashsize, error);
-				if (success)
-					tmp.CopyTo(hpart, remaining, error);
-				tmp.Destroy();
-			}
-		}
-	}
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
-	success = EndHashing(hhash, error) && success;
+	HashSession session(*this);
+	bool success = session.Begin(error) && session.Hash(data, hash, error);
+	success = session.End(error) && success;
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
@@ -551,13 +733,116 @@ size_t Cryptography::HashSize(OSPError* error) const
 	return NULL;
 }
 
+size_t Cryptography::HashLanes(OSPError* error) const
+{
+	// CNG hashes one message at a time
+	return 1;
+}
+
+size_t Cryptography::EncryptLanes(OSPError* error) const
+{
+	// CNG encrypts one buffer at a time
+	return 1;
+}
+
+size_t Cryptography::DecryptLanes(OSPError* error) const
+{
+	// CNG picks its own kernels, blocks in flight are not visible here
+	return 1;
+}
+
+size_t Cryptography::GcmLanes(OSPError* error) const
+{
+	return 1;
+}
+
+size_t Cryptography::KeyCacheHits() const
+{
+	return static_cast<const StateHandle*>(State())->Keys.Hits();
+}
+
+size_t Cryptography::KeyCacheMisses() const
+{
+	return static_cast<const StateHandle*>(State())->Keys.Misses();
+}
+
+#pragma endregion
+
+#pragma region Hash Session
+
+bool HashSession::Begin(OSPError* error)
+{
+	if (_session)
+		return true;
+
+	HashHandle* handle = new HashHandle;
+	if (!BeginHashing(cryptography, *handle, BCRYPT_HASH_REUSABLE_FLAG, error))
+	{
+		delete handle;
+		return false;
+	}
+
+	_session = handle;
+	return true;
+}
+
+bool HashSession::End(OSPError* error)
+{
+	bool success = true;
+
+	HashHandle* handle = static_cast<HashHandle*>(_session);
+	if (handle)
+	{
+		success = EndHashing(*handle, error);
+		delete handle;
+		_session = nullptr;
+	}
+
+	return success;
+}
+
+bool HashSession::Digest(const byte* const data, size_t size, byte* const hash, OSPError* error)
+{
+	HashHandle* handle = static_cast<HashHandle*>(_session);
+	if (!handle)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	return DoHashing(handle->Hash, data, size, hash, cryptography.HashSize(error), error);
+}
+
+bool HashSession::Rehash(byte* const hashes[], size_t count, size_t rounds, OSPError* error)
+{
+	HashHandle* handle = static_cast<HashHandle*>(_session);
+	if (!handle)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_NOT_INITIALIZED);
+
+	size_t hashsize = cryptography.HashSize(error);
+	if (hashsize > MAX_HASH_SIZE)
+		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_BUFFER_TOO_SMALL);
+
+	ByteArray<MAX_HASH_SIZE> tmp;
+
+	bool success = true;
+	for (size_t n = 0; success && n < count; n++)
+	{
+		for (size_t r = 0; success && r < rounds; r++)
+		{
+			success = DoHashing(handle->Hash, hashes[n], hashsize, tmp, hashsize, error);
+			if (success)
+				tmp.CopyTo(hashes[n], hashsize, error);
+		}
+	}
+
+	return success;
+}
+
 #pragma endregion
 
 #pragma region Protected Cipher Methods
 
 bool Cryptography::PrepareCipher(const ByteVector& secret, Cipher& cipher, OSPError* error) const
 {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
 	if (!cipher.Zeroed())
 		return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
@@ -605,7 +890,7 @@ bool Cryptography::PrepareCipher(const ByteVector& secret, Cipher& cipher, OSPEr
 		cipher.Size() = size;
 	}
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
@@ -631,7 +916,7 @@ bool Cryptography::CompleteCipher(Cipher& cipher, OSPError* error) const
 
 bool Cryptography::ZeroCipher(Cipher& cipher, OSPError* error) const
 {
-	BEGIN_MEMORY_CHECK(AvailableMemory());
+	BEGIN_MEMORY_CHECK(ThreadAvailableMemory());
 
 	bool success = false;
 
@@ -639,10 +924,14 @@ bool Cryptography::ZeroCipher(Cipher& cipher, OSPError* error) const
 		success = checkStatus(BCryptDestroyKey(cipher.Handle()), error);
 	else
 	{
-		BCRYPT_KEY_HANDLE hkey = 0;
-		PBYTE keyobj = NULL;
-		if (checkStatus(RetreiveKey(static_cast<const StateHandle*>(State()), cipher, hkey, keyobj, error), error))
-			success = checkStatus(BCryptDestroyKey(hkey), error);
+		// Only its cached key, if any, has to go, there is nothing to import
+		if (!cipher.Completed())
+			OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_CIPHER_NOT_IN_THE_RIGHT_STATE);
+		else
+		{
+			static_cast<const StateHandle*>(State())->Keys.Evict(cipher.Key(), cipher.Size());
+			success = true;
+		}
 	}
 
 	if (success)
@@ -651,7 +940,7 @@ bool Cryptography::ZeroCipher(Cipher& cipher, OSPError* error) const
 		Zero(cipher.Key(), cipher.Size());
 	}
 
-	END_MEMORY_CHECK(AvailableMemory());
+	END_MEMORY_CHECK(ThreadAvailableMemory());
 	return success;
 }
 
@@ -118,6 +118,17 @@ bool OS::Zeroed(const byte* const data, size_t size)
 	return true;
 }
 
+bool OS::LockMemory(void* const data, size_t size)
+{
+	return data && size > 0 && VirtualLock(data, size) != FALSE;
+}
+
+void OS::UnlockMemory(void* const data, size_t size)
+{
+	if (data && size > 0)
+		VirtualUnlock(data, size);
+}
+
 int32_t OS::Show(
 	char* const data, size_t size, size_t width, const string& title, uint32_t type, OSPError* error
 ) {
@@ -263,7 +274,7 @@ bool OS::Destroy(OSPError* error)
 	{
 		success = HeapDestroy(heap) && success;
 		heap = 0;
-		_available = _memory = 0;
+		_available = _memory = _allocations = 0;
 	}
 
 	return checkError(success, error);
@@ -288,7 +299,12 @@ OS::byte* OS::Alloc(size_t size, OSPError* error)
 	#endif
 		assert(data);
 		if (data)
-			_memory += HeapSize(heap, 0, data);
+		{
+			size_t held = HeapSize(heap, 0, data);
+			_memory += held;
+			COUNT_MEMORY(held);
+			_allocations++;
+		}
 		return (byte*)data;
 	}
 	
@@ -299,13 +315,21 @@ OS::byte* OS::Alloc(size_t size, OSPError* error)
 	return nullptr;
 }
 
+bool OS::MemoryLocked() const
+{
+	// The private heap is not locked, LockMemory pins individual buffers instead
+	return !heap;
+}
+
 bool OS::Destroy(byte*& data, size_t size, OSPError* error)
 {
 	bool success = true;
 
 	if (heap && data)
 	{
-		_memory -= HeapSize(heap, 0, data);
+		size_t held = HeapSize(heap, 0, data);
+		_memory -= held;
+		UNCOUNT_MEMORY(held);
 		success = HeapFree(heap, 0, Zero(data, size));
 		data = 0;
 	}
@@ -0,0 +1,417 @@
+/*
+One Strong Password Generator Windows library
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stack>
+#include <vector>
+
+#include "../osp/cipherstream.h"
+#include "../osp/securestore.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(CipherStream_Test)
+	{
+	public:
+		typedef CipherStream::byte byte;
+
+		static const size_t WINDOW_SIZE = 64;
+		static const size_t MAX_DATA_SIZE = 1 << 16;
+
+		OSPError TestError;
+
+		ByteArray<16> IV0;
+
+		stack<byte*> ciphercleanup;
+
+		void Setup(Cipher& cipher)
+		{
+			bool success = cipher.Prepare(&TestError);
+			if (success)
+			{
+				cipher.Key() = new byte[cipher.Size()];
+				ciphercleanup.push(cipher.Key());
+				success = cipher.Complete(&TestError);
+			}
+			Assert::IsTrue(success, L"Creating a cipher failed, see Cipher_Test0");
+		}
+
+		// Hands out data a part of at most step bytes at a time
+		static CipherStream::Source From(const vector<byte>& data, size_t& pos, size_t step = SIZE_MAX)
+		{
+			return [&data, &pos, step](byte* const bytes, size_t size, size_t& filled, OSPError*) {
+				filled = min(min(size, step), data.size() - pos);
+				memcpy(bytes, data.data() + pos, filled);
+				pos += filled;
+				return true;
+			};
+		}
+
+		static CipherStream::Sink To(vector<byte>& data)
+		{
+			return [&data](const byte* const bytes, size_t size, OSPError*) {
+				data.insert(data.end(), bytes, bytes + size);
+				return true;
+			};
+		}
+
+		static vector<byte> Payload(size_t size)
+		{
+			vector<byte> data(size);
+			for (size_t n = 0; n < size; n++)
+				data[n] = byte(n * 7 + 3);
+			return data;
+		}
+
+		TEST_METHOD_INITIALIZE(MethodInitialize)
+		{
+			CLEAR_OSPError(TestError);
+			for (size_t n = 1; n <= IV0.Size(); n++)
+				IV0[n - 1] = (byte)n;
+		}
+
+		TEST_METHOD_CLEANUP(MethodCleanup)
+		{
+			while (!ciphercleanup.empty())
+			{
+				delete[] ciphercleanup.top();
+				ciphercleanup.pop();
+			}
+			Assert::IsTrue(EXPOSED(0), L"Something is exposed");
+			Assert::AreEqual(TestError.Code, OSP_NO_ERROR, L"There was an undected error");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_Begin_End_Test0)
+			TEST_DESCRIPTION(L"The window is rounded to the block size and limited to MaxDataSize.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_Begin_End_Test0)
+		{
+			Cryptography cryptography(2, MAX_DATA_SIZE);
+			size_t available = cryptography.AvailableMemory();
+
+			CipherStream stream(cryptography);
+			Assert::IsFalse(stream.Active(), L"Active before Begin");
+
+			Assert::IsTrue(stream.Begin(WINDOW_SIZE + 5, &TestError), L"Begin failed");
+			Assert::AreEqual(WINDOW_SIZE, stream.WindowSize(), L"Window not rounded down");
+			Assert::IsFalse(stream.Begin(WINDOW_SIZE, nullptr), L"Begin twice");
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+			Assert::AreEqual(available, cryptography.AvailableMemory(), L"End did not free the window");
+
+			Assert::IsTrue(stream.Begin(0, &TestError), L"Begin failed");
+			Assert::AreEqual(size_t(MAX_DATA_SIZE), stream.WindowSize(), L"Window not MaxDataSize");
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+
+			Assert::IsTrue(stream.Begin(4 * MAX_DATA_SIZE, &TestError), L"Begin failed");
+			Assert::AreEqual(size_t(MAX_DATA_SIZE), stream.WindowSize(), L"Window past MaxDataSize");
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+
+			Assert::IsFalse(stream.Begin(cryptography.BlockSize() - 1, nullptr), L"Window smaller than a block");
+			Assert::IsFalse(stream.Active(), L"Active after a failed Begin");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_Encrypt_Decrypt_Test0)
+			TEST_DESCRIPTION(L"Streamed in chunks, payloads around the window and block sizes encrypt to what encrypting them whole does, and decrypt back.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_Encrypt_Decrypt_Test0)
+		{
+			Cryptography cryptography(4, MAX_DATA_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			CipherStream stream(cryptography);
+			Assert::IsTrue(stream.Begin(WINDOW_SIZE, &TestError), L"Begin failed");
+
+			const size_t block = cryptography.BlockSize();
+			const size_t sizes[] = {
+				0, 1, block - 1, block, block + 1, WINDOW_SIZE - 1, WINDOW_SIZE, WINDOW_SIZE + 1,
+				2 * WINDOW_SIZE, 3 * WINDOW_SIZE + 5, 1000, 4096
+			};
+
+			for (size_t size : sizes)
+			{
+				// Parts shorter than the window have to be gathered into whole chunks
+				for (size_t step : { size_t(7), size_t(SIZE_MAX) })
+				{
+					vector<byte> payload = Payload(size);
+
+					vector<byte> encrypted;
+					size_t pos = 0, taken = 0;
+					bool success = stream.Encrypt(cipher, IV0, From(payload, pos, step), To(encrypted), taken, &TestError);
+
+					Assert::IsTrue(success, L"Encrypt failed");
+					Assert::AreEqual(size, taken, L"Wrong plaintext size");
+					Assert::AreEqual(cryptography.DataSize(size), encrypted.size(), L"Wrong ciphertext size");
+
+					if (size)
+					{
+						ByteVector whole(cryptography);
+						Assert::IsTrue(whole.Alloc(size, &TestError), L"Alloc failed");
+						whole.CopyFrom(payload.data(), size, 0, &TestError);
+						ByteVector expected(cryptography);
+						Assert::IsTrue(expected.Alloc(encrypted.size(), &TestError), L"Alloc failed");
+
+						success = cryptography.Encrypt(cipher, IV0, whole, expected, &TestError);
+						Assert::IsTrue(success, L"Whole Encrypt failed");
+						Assert::IsTrue(0 == memcmp(expected, encrypted.data(), encrypted.size()), L"Chunks not chained as one payload");
+					}
+
+					vector<byte> decrypted;
+					pos = 0;
+					success = stream.Decrypt(cipher, IV0, From(encrypted, pos, step), To(decrypted), size, &TestError);
+
+					Assert::IsTrue(success, L"Decrypt failed");
+					Assert::IsTrue(payload == decrypted, L"Decrypt did not return the payload");
+				}
+			}
+
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_Encrypt_Decrypt_Test1)
+			TEST_DESCRIPTION(L"Bad streams are refused, the window zeroed either way.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_Encrypt_Decrypt_Test1)
+		{
+			Cryptography cryptography(2, MAX_DATA_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			CipherStream stream(cryptography);
+
+			vector<byte> payload = Payload(3 * WINDOW_SIZE);
+			vector<byte> encrypted;
+			size_t pos = 0, taken = 0;
+
+			Assert::IsFalse(stream.Encrypt(cipher, IV0, From(payload, pos), To(encrypted), taken, nullptr), L"Encrypt before Begin");
+			Assert::IsTrue(stream.Begin(WINDOW_SIZE, &TestError), L"Begin failed");
+
+			ByteArray<8> shortiv;
+			Assert::IsFalse(stream.Encrypt(cipher, shortiv, From(payload, pos), To(encrypted), taken, nullptr), L"Short init vector");
+
+			Assert::IsTrue(stream.Encrypt(cipher, IV0, From(payload, pos), To(encrypted), taken, &TestError), L"Encrypt failed");
+
+			// A sink that fails stops the stream
+			size_t chunks = 0;
+			pos = 0;
+			bool success = stream.Encrypt(cipher, IV0, From(payload, pos), [&chunks](const byte* const, size_t, OSPError*) {
+				return ++chunks < 2;
+			}, taken, nullptr);
+			Assert::IsFalse(success, L"Sink failure ignored");
+			Assert::AreEqual(size_t(2), chunks, L"Stream went on after the sink failed");
+
+			vector<byte> decrypted;
+
+			// Cut inside a block
+			vector<byte> truncated(encrypted.begin(), encrypted.end() - 1);
+			pos = 0;
+			Assert::IsFalse(stream.Decrypt(cipher, IV0, From(truncated, pos), To(decrypted), payload.size(), &TestError), L"Truncated block decrypted");
+			Assert::AreEqual(OSP_ERROR_MALFORMED_CIPHERTEXT, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			// Cut at a block, short of the size asked for
+			truncated.resize(encrypted.size() - cryptography.BlockSize());
+			decrypted.clear();
+			pos = 0;
+			Assert::IsFalse(stream.Decrypt(cipher, IV0, From(truncated, pos), To(decrypted), payload.size(), &TestError), L"Missing blocks not noticed");
+			Assert::AreEqual(OSP_ERROR_MALFORMED_CIPHERTEXT, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_Memory_Test0)
+			TEST_DESCRIPTION(L"Locked memory held while streaming is the window and chain, whatever the payload size.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_Memory_Test0)
+		{
+			Cryptography cryptography(2, MAX_DATA_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t available = cryptography.AvailableMemory();
+
+			CipherStream stream(cryptography);
+			Assert::IsTrue(stream.Begin(MAX_DATA_SIZE, &TestError), L"Begin failed");
+
+			const size_t held = available - cryptography.AvailableMemory();
+			Assert::AreEqual(MAX_DATA_SIZE + 2 * cryptography.BlockSize(), held, L"Window and chain not all that is held");
+
+			for (size_t size : { size_t(1) << 10, size_t(1) << 20, size_t(1) << 24 })
+			{
+				size_t least = available, most = 0, left = size;
+
+				CipherStream::Source source = [&left](byte* const data, size_t size, size_t& filled, OSPError*) {
+					filled = min(size, left);
+					memset(data, 0x5A, filled);
+					left -= filled;
+					return true;
+				};
+
+				CipherStream::Sink sink = [&](const byte* const, size_t, OSPError*) {
+					least = min(least, cryptography.AvailableMemory());
+					most = max(most, cryptography.AvailableMemory());
+					return true;
+				};
+
+				size_t taken = 0;
+				Assert::IsTrue(stream.Encrypt(cipher, IV0, source, sink, taken, &TestError), L"Encrypt failed");
+				Assert::AreEqual(size, taken, L"Wrong plaintext size");
+				Assert::AreEqual(available - held, least, L"Locked memory grew while encrypting");
+				Assert::AreEqual(available - held, most, L"Locked memory changed while encrypting");
+
+				left = cryptography.DataSize(size);
+				least = available, most = 0;
+				Assert::IsTrue(stream.Decrypt(cipher, IV0, source, sink, size, &TestError), L"Decrypt failed");
+				Assert::AreEqual(available - held, least, L"Locked memory grew while decrypting");
+				Assert::AreEqual(available - held, most, L"Locked memory changed while decrypting");
+			}
+
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+			Assert::AreEqual(available, cryptography.AvailableMemory(), L"End did not free the window");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_SecureStore_Test0)
+			TEST_DESCRIPTION(L"A store streams payloads many times MaxDataSize with its own init vector.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_SecureStore_Test0)
+		{
+			SecureStore store(2, 1024, &TestError);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			CipherStream stream(store);
+			Assert::IsTrue(stream.Begin(0, &TestError), L"Begin failed");
+
+			vector<byte> payload = Payload(100 * store.MaxDataSize() + 11);
+			vector<byte> encrypted, decrypted;
+			size_t pos = 0, taken = 0;
+
+			bool success = store.Encrypt(cipher, stream, From(payload, pos), To(encrypted), taken, &TestError);
+			Assert::IsTrue(success, L"Encrypt failed");
+			Assert::AreEqual(payload.size(), taken, L"Wrong plaintext size");
+
+			pos = 0;
+			success = store.Decrypt(cipher, stream, From(encrypted, pos), To(decrypted), taken, &TestError);
+			Assert::IsTrue(success, L"Decrypt failed");
+			Assert::IsTrue(payload == decrypted, L"Decrypt did not return the payload");
+
+			// Only the store's init vector decrypts it
+			decrypted.clear();
+			pos = 0;
+			success = stream.Decrypt(cipher, IV0, From(encrypted, pos), To(decrypted), taken, &TestError);
+			Assert::IsTrue(success, L"Decrypt failed");
+			Assert::IsFalse(equal(payload.begin(), payload.begin() + 16, decrypted.begin()), L"First block decrypted without the store's init vector");
+
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(CipherStream_Throughput_Benchmark0)
+			TEST_DESCRIPTION(L"Streamed encrypt and decrypt throughput from 1 KB to 1 GB through a MaxDataSize window.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(CipherStream_Throughput_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			Cryptography cryptography(2, MAX_DATA_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			CipherStream stream(cryptography);
+			Assert::IsTrue(stream.Begin(0, &TestError), L"Begin failed");
+
+			string message = "Streamed MB/s encrypt/decrypt through a " + to_string(stream.WindowSize() >> 10) + " KB window:";
+
+			// Sizes are repeated up to about 64 MB so small payloads are timed long enough
+			for (size_t size = size_t(1) << 10; size <= size_t(1) << 30; size <<= 4)
+			{
+				const size_t rounds = max(size_t(1), (size_t(1) << 26) / size);
+
+				size_t left = 0;
+
+				// Fills as a file read would, the window is the only copy locked
+				CipherStream::Source source = [&left](byte* const data, size_t size, size_t& filled, OSPError*) {
+					filled = min(size, left);
+					memset(data, byte(left), filled);
+					left -= filled;
+					return true;
+				};
+
+				CipherStream::Sink sink = [](const byte* const, size_t, OSPError*) { return true; };
+
+				bool success = true;
+
+				auto t0 = Clock::now();
+				for (size_t r = 0; success && r < rounds; r++)
+				{
+					size_t taken = 0;
+					left = size;
+					success = stream.Encrypt(cipher, IV0, source, sink, taken, &TestError) && taken == size;
+				}
+				auto t1 = Clock::now();
+				for (size_t r = 0; success && r < rounds; r++)
+				{
+					left = size;
+					success = stream.Decrypt(cipher, IV0, source, sink, size, &TestError);
+				}
+				auto t2 = Clock::now();
+
+				Assert::IsTrue(success, L"Streaming failed");
+
+				double bytes = double(size) * rounds;
+				double encrypt = std::chrono::duration<double>(t1 - t0).count();
+				double decrypt = std::chrono::duration<double>(t2 - t1).count();
+
+				message += " " + (size < (1 << 20) ? to_string(size >> 10) + " KB " : to_string(size >> 20) + " MB ") +
+					to_string(size_t(bytes / (1 << 20) / max(encrypt, 1e-9))) + "/" +
+					to_string(size_t(bytes / (1 << 20) / max(decrypt, 1e-9)));
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+
+			Assert::IsTrue(stream.End(&TestError), L"End failed");
+		}
+	};
+}
@@ -22,15 +22,60 @@ Software.
 
 #include "CppUnitTest.h"
 
+#include <chrono>
 #include <stack>
+#include <vector>
 
 #include "../osp/cryptography.h"
+#include "../osp/hashsession.h"
+#include "../osp/keycache.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std;
 
 namespace OneStrongPassword
 {
+	// AES-128 CBC of 33 blocks, byte n * 13 + 5 at n, under the key and init
+	// vector of NIST SP 800-38A F.2.2. Made with OpenSSL.
+	const Cryptography::byte CBC_KEY[] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+	};
+	const Cryptography::byte CBC_ENCRYPTED[] = {
+		0x2d, 0xf9, 0x96, 0x7c, 0xac, 0x7e, 0x82, 0xf3, 0xdd, 0xc6, 0x26, 0x04, 0x55, 0xd8, 0xfb, 0x97,
+		0xd2, 0x14, 0x44, 0xf6, 0x9b, 0xdb, 0x95, 0x3f, 0xe8, 0x2c, 0xc3, 0x6c, 0x8b, 0x3a, 0x4e, 0x8f,
+		0x8e, 0x83, 0xd3, 0x9a, 0xf7, 0x9f, 0x11, 0xec, 0x32, 0x54, 0x69, 0x21, 0xf7, 0xe6, 0xfd, 0x13,
+		0x6f, 0x47, 0x7a, 0xcc, 0x12, 0xee, 0x4a, 0x87, 0xa1, 0x90, 0xf7, 0xaf, 0x01, 0xd1, 0xc0, 0xa9,
+		0x16, 0xb3, 0xbf, 0xa5, 0x1f, 0x6e, 0xd0, 0xd8, 0x96, 0x06, 0xa4, 0x3c, 0xe0, 0x5f, 0x74, 0x5e,
+		0x83, 0x42, 0xb9, 0x2d, 0xc2, 0xca, 0x69, 0x9d, 0xef, 0x40, 0xa5, 0xe2, 0xca, 0x9c, 0x42, 0xbd,
+		0x50, 0x3e, 0x1c, 0x16, 0x32, 0x55, 0x31, 0x20, 0x47, 0xb9, 0xd0, 0xdc, 0xed, 0x27, 0xb0, 0x35,
+		0x0d, 0x60, 0x4c, 0x21, 0x0a, 0x53, 0x84, 0x12, 0x94, 0x7a, 0x6f, 0xa3, 0xd6, 0xd8, 0xa0, 0xcd,
+		0xf8, 0xa4, 0xd9, 0x46, 0xaf, 0x75, 0xb1, 0x04, 0x13, 0xbc, 0xd9, 0xed, 0x29, 0xcb, 0x5f, 0x15,
+		0xf3, 0x7c, 0x4f, 0x86, 0x99, 0xc9, 0x49, 0x67, 0xab, 0x51, 0x8c, 0xe5, 0xc3, 0xbb, 0xc6, 0x69,
+		0x96, 0xb4, 0x42, 0xcb, 0xd3, 0x44, 0x23, 0x8a, 0xa8, 0x31, 0xec, 0xdc, 0x8f, 0xdc, 0x50, 0xdd,
+		0xa2, 0x0e, 0x9f, 0x53, 0x8e, 0x13, 0xbc, 0x0a, 0xba, 0x6f, 0xed, 0x97, 0x1d, 0xc9, 0x6d, 0xdf,
+		0xa7, 0xae, 0x3d, 0xf6, 0x39, 0x8e, 0x2f, 0x44, 0x7c, 0x1a, 0x7c, 0xd0, 0x9a, 0x92, 0x06, 0x96,
+		0x6d, 0x82, 0x02, 0x37, 0x6c, 0x2d, 0x82, 0x48, 0x5f, 0x6a, 0x8f, 0xd1, 0x67, 0x8d, 0x6c, 0x14,
+		0x59, 0x84, 0xc1, 0xca, 0x7d, 0xed, 0x02, 0x43, 0x76, 0xef, 0xe5, 0x72, 0x55, 0x71, 0x7c, 0x3e,
+		0x37, 0x18, 0xbb, 0x98, 0xd6, 0xe0, 0xb8, 0x41, 0x56, 0xe8, 0x85, 0x9e, 0x20, 0xfd, 0xb9, 0x17,
+		0x13, 0xf8, 0xda, 0x74, 0x8b, 0xc6, 0xfa, 0x1d, 0xe3, 0x31, 0x71, 0xc8, 0xa8, 0x1b, 0xfb, 0x4c,
+		0xb4, 0x5d, 0xbb, 0x52, 0x23, 0xb0, 0x04, 0x74, 0x71, 0x8e, 0x55, 0x5e, 0x37, 0xc6, 0x92, 0x29,
+		0x37, 0xd9, 0x91, 0x50, 0x41, 0x6b, 0x75, 0x7f, 0x11, 0x8c, 0x5f, 0xf0, 0xc7, 0xd0, 0xbb, 0xa0,
+		0x5e, 0x12, 0xaa, 0x36, 0xec, 0x35, 0xef, 0xa1, 0x0e, 0x1c, 0x9e, 0xc6, 0x19, 0xec, 0x9c, 0x80,
+		0xeb, 0x61, 0xfd, 0xfd, 0x04, 0x64, 0x24, 0x37, 0xc0, 0x6b, 0x4d, 0x2e, 0x83, 0x87, 0x41, 0x27,
+		0xfc, 0x4f, 0xea, 0x93, 0x47, 0x25, 0xb4, 0x56, 0x64, 0xfd, 0x75, 0xd3, 0x52, 0x02, 0xec, 0x31,
+		0xc2, 0xd3, 0x19, 0x2a, 0x5f, 0x49, 0xe6, 0x47, 0x1c, 0x8e, 0x59, 0x28, 0xfe, 0x73, 0x54, 0x8a,
+		0x11, 0xf7, 0xfe, 0xb0, 0xb4, 0x31, 0x12, 0x48, 0x6d, 0xa3, 0x5e, 0xc9, 0xf1, 0xcf, 0x9c, 0xf9,
+		0xb4, 0xd4, 0xbb, 0x26, 0x75, 0xe8, 0x62, 0x5d, 0xd7, 0x07, 0x44, 0x4c, 0xb9, 0x33, 0x07, 0xc0,
+		0xd4, 0xf3, 0xec, 0x53, 0x6b, 0x4c, 0x33, 0xad, 0x81, 0x75, 0x50, 0xc3, 0x66, 0xc8, 0xc0, 0x0a,
+		0xc9, 0x91, 0xcf, 0x58, 0xf7, 0x1b, 0xe5, 0xe0, 0x69, 0xc6, 0x39, 0x4d, 0x5f, 0x9d, 0x40, 0x8e,
+		0xd2, 0x4f, 0xb5, 0x9a, 0x6c, 0x43, 0xaf, 0x46, 0x4a, 0x88, 0xbe, 0xfa, 0x11, 0x93, 0xab, 0x35,
+		0xcf, 0x5b, 0xff, 0x0b, 0x27, 0x9d, 0x47, 0xdd, 0xde, 0x9a, 0x82, 0xf9, 0xb7, 0x60, 0xfa, 0x48,
+		0x9b, 0x0c, 0x04, 0x7a, 0x45, 0xf9, 0x8b, 0xab, 0xec, 0x9c, 0x40, 0xda, 0x96, 0x3a, 0x31, 0x54,
+		0x7c, 0x4c, 0x51, 0x61, 0x39, 0xd0, 0xe6, 0x49, 0xc8, 0x46, 0x3e, 0x67, 0x95, 0x62, 0x12, 0x2f,
+		0x7b, 0xd8, 0x53, 0x8a, 0x76, 0xf7, 0x6c, 0x27, 0x9c, 0xf9, 0x60, 0xfe, 0x22, 0xe1, 0xfe, 0xf2,
+		0x92, 0xe8, 0xeb, 0xb5, 0x56, 0xbd, 0x32, 0xab, 0x2c, 0x99, 0x56, 0x49, 0x90, 0xe7, 0x79, 0x24,
+	};
+
 	TEST_CLASS(Cryptography_Test)
 	{
 	public:
@@ -59,6 +104,29 @@ namespace OneStrongPassword
 			Assert::IsTrue(success, L"Creating a cipher failed, see Cipher_Test0");
 		}
 
+		void Setup(Cipher& cipher, const Cryptography::byte* key, size_t size)
+		{
+			vector<Cryptography::byte> copy(key, key + size);
+			ByteVector secret(nullptr, copy.data(), size);
+			bool success = cipher.Prepare(secret, &TestError);
+			if (success)
+			{
+				cipher.Key() = new Cryptography::byte[cipher.Size()];
+				ciphercleanup.push(cipher.Key());
+				success = cipher.Complete(&TestError);
+			}
+			Assert::IsTrue(success, L"Creating a cipher failed");
+		}
+
+		// The plaintext of CBC_ENCRYPTED
+		static vector<Cryptography::byte> CbcPlaintext()
+		{
+			vector<Cryptography::byte> plain(sizeof(CBC_ENCRYPTED));
+			for (size_t n = 0; n < plain.size(); n++)
+				plain[n] = Cryptography::byte(n * 13 + 5);
+			return plain;
+		}
+
 		void EncryptTestA(Cryptography& cryptography, const Cipher& cipher, ByteVector& encrypted)
 		{
 			ByteArray<DATA_SIZE> data;
@@ -84,6 +152,19 @@ namespace OneStrongPassword
 			Assert::IsTrue(success, L"1st Encryption failed, see Cryptography_Encrypt_Decrypt_Test1");
 		}
 
+		// The bytes of hex, two digits each
+		static vector<Cryptography::byte> FromHex(const char* hex)
+		{
+			vector<Cryptography::byte> bytes(strlen(hex) / 2);
+			for (size_t n = 0; n < bytes.size(); n++)
+			{
+				unsigned int value = 0;
+				sscanf(hex + 2 * n, "%2x", &value);
+				bytes[n] = Cryptography::byte(value);
+			}
+			return bytes;
+		}
+
 		template<size_t sz> void TestHashing()
 		{
 			bool success = true;
@@ -629,5 +710,1110 @@ namespace OneStrongPassword
 			}
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Hash_Vector_Test0)
+			TEST_DESCRIPTION(L"SHA-512 known answer, FIPS 180-4 \"abc\".")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Hash_Vector_Test0)
+		{
+			const Cryptography::byte expected[] = {
+				0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+				0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+				0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+				0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f,
+			};
+
+			ByteArray<3> data;
+			data.CopyFrom(string("abc"), &TestError);
+
+			Cryptography cryptography(0);
+
+			ByteArray<sizeof(expected)> hash;
+			bool success = cryptography.Hash(data, hash, &TestError);
+
+			Assert::IsTrue(success, L"Hash failed");
+			Assert::IsTrue(memcmp(expected, hash, hash.Size()) == 0, L"Hash does not match known answer");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Hash_Vector_Test1)
+			TEST_DESCRIPTION(L"Hashes longer than the digest chain, each part the hash of the one before.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Hash_Vector_Test1)
+		{
+			const Cryptography::byte expected[] = {
+				0x77, 0x78, 0x8f, 0x1a, 0x0c, 0xea, 0x00, 0x1a, 0x26, 0x31, 0xda, 0xe5, 0xd0, 0x5d, 0xbd, 0x06,
+				0x20, 0x08, 0xd5, 0xb3, 0x0f, 0x50, 0xb9, 0xe2, 0x9b, 0xeb, 0x2a, 0x78, 0x22, 0x28, 0x90, 0x04,
+				0x57, 0x3d, 0xfc, 0x9b, 0x6f, 0xfe, 0xb1, 0xc7, 0x86, 0xa1, 0x63, 0x49, 0xe7, 0x0f, 0x98, 0x36,
+				0x87, 0x6a, 0x74, 0x3c, 0x31, 0xc0, 0xa7, 0xa2, 0xa7, 0x07, 0x27, 0xa8, 0x52, 0xee, 0xc3, 0x72,
+				0xf7, 0x01, 0x05, 0x0c, 0x75, 0x96, 0x89, 0xc7, 0x8d, 0xc2, 0xb8, 0x02, 0xe0, 0x70, 0x27, 0x35,
+				0xcb, 0xd5, 0x99, 0x14, 0xf1, 0x51, 0xd9, 0x73, 0x73, 0xc0, 0x52, 0x65, 0x9b, 0xe4, 0x5e, 0xcf,
+				0x4d, 0xac, 0x89, 0xb8, 0xec, 0xbb, 0x02, 0x02, 0x96, 0x5a, 0x76, 0xaf, 0x38, 0x41, 0x5f, 0xee,
+				0xb2, 0xf9, 0xe9, 0xa4, 0x6b, 0x89, 0xa0, 0xe1, 0x3f, 0xda, 0xd7, 0xf1, 0xd5, 0x96, 0x98, 0x8a,
+			};
+
+			Cryptography cryptography(0);
+
+			ByteArray<sizeof(expected)> hash;
+			bool success = cryptography.Hash(TestDataA, hash, &TestError);
+
+			Assert::IsTrue(success, L"Hash failed");
+			Assert::IsTrue(memcmp(expected, hash, hash.Size()) == 0, L"Hash does not match known answer");
+
+			ByteArray<sizeof(expected) - 3> partial;
+			success = cryptography.Hash(TestDataA, partial, &TestError);
+
+			Assert::IsTrue(success, L"Partial hash failed");
+			Assert::IsTrue(memcmp(expected, partial, partial.Size()) == 0, L"Partial hash does not match known answer");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Rehash_Lanes_Test0)
+			TEST_DESCRIPTION(L"Digests rehashed together match chains rehashed one digest at a time, and a known answer.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Rehash_Lanes_Test0)
+		{
+			// SHA-512 of "abc" rehashed 1000 times
+			const Cryptography::byte expected[] = {
+				0x15, 0xaf, 0x50, 0xc5, 0x96, 0xc7, 0x05, 0x5e, 0x8f, 0xd4, 0x87, 0x2b, 0x39, 0x2c, 0xb6, 0x35,
+				0x98, 0x58, 0x15, 0x18, 0x49, 0xeb, 0x06, 0x26, 0xac, 0x40, 0x04, 0x66, 0xbe, 0xd1, 0x81, 0x92,
+				0x89, 0xa2, 0x63, 0x94, 0x87, 0x95, 0x4c, 0x0b, 0xb0, 0x9d, 0x41, 0x0a, 0x9f, 0x70, 0xb1, 0x6d,
+				0x28, 0x4e, 0xb0, 0xf3, 0x57, 0x24, 0xbc, 0xdb, 0xb3, 0x1a, 0xc9, 0x9a, 0x91, 0xba, 0xb6, 0xc1,
+			};
+
+			const size_t HASH_SIZE = sizeof(expected);
+			const size_t ROUNDS = 1000;
+
+			// Two full groups of 8 lanes, or four of 4, and a short group after them
+			const size_t COUNT = 19;
+
+			Cryptography cryptography(0);
+			HashSession session(cryptography);
+
+			bool success = session.Begin(&TestError);
+
+			Cryptography::byte together[COUNT][HASH_SIZE];
+			Cryptography::byte serial[COUNT][HASH_SIZE];
+			Cryptography::byte* hashes[COUNT];
+
+			// Lane 0 starts from "abc", the others from a byte of their own
+			for (size_t n = 0; success && n < COUNT; n++)
+			{
+				Cryptography::byte seed[3] = { 'a', 'b', 'c' };
+				if (n > 0)
+					seed[0] = Cryptography::byte(n);
+				success = session.Digest(seed, n == 0 ? 3 : 1, together[n], &TestError);
+				hashes[n] = together[n];
+			}
+
+			memcpy(serial, together, sizeof(serial));
+
+			success = success && session.Rehash(hashes, COUNT, ROUNDS, &TestError);
+
+			for (size_t n = 0; success && n < COUNT; n++)
+			{
+				for (size_t round = 0; success && round < ROUNDS; round++)
+				{
+					Cryptography::byte digest[HASH_SIZE];
+					success = session.Digest(serial[n], HASH_SIZE, digest, &TestError);
+					memcpy(serial[n], digest, HASH_SIZE);
+				}
+			}
+
+			session.End(&TestError);
+
+			Assert::IsTrue(success, L"Rehash failed");
+			Assert::IsTrue(memcmp(expected, together[0], HASH_SIZE) == 0, L"Rehash does not match known answer");
+			for (size_t n = 0; n < COUNT; n++)
+				Assert::IsTrue(memcmp(serial[n], together[n], HASH_SIZE) == 0, L"Lane does not match its serial chain");
+
+			string message = "Rehash lanes " + to_string(cryptography.HashLanes()) + "\n";
+			Logger::WriteMessage(message.c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_Vector_Test0)
+			TEST_DESCRIPTION(L"AES-128 CBC known answer, NIST SP 800-38A F.2.1.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_Vector_Test0)
+		{
+			const Cryptography::byte key[] = {
+				0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+			};
+			const Cryptography::byte plain[] = {
+				0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+				0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+			};
+			const Cryptography::byte expected[] = {
+				0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+				0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+			};
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			ByteArray<sizeof(key)> secret;
+			secret.CopyFrom(key, sizeof(key), 0, &TestError);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+
+			bool success = cipher.Prepare(secret, &TestError);
+			if (success)
+			{
+				cipher.Key() = new Cryptography::byte[cipher.Size()];
+				ciphercleanup.push(cipher.Key());
+				success = cipher.Complete(&TestError);
+			}
+			Assert::IsTrue(success, L"Creating a cipher failed");
+
+			ByteArray<16> iv;
+			for (size_t n = 0; n < iv.Size(); n++)
+				iv[n] = (Cryptography::byte)n;
+
+			ByteArray<sizeof(plain)> data;
+			data.CopyFrom(plain, sizeof(plain), 0, &TestError);
+
+			ByteArray<sizeof(expected)> encrypted;
+			success = cryptography.Encrypt(cipher, iv, data, encrypted, &TestError);
+
+			Assert::IsTrue(success, L"Encryption failed");
+			Assert::IsTrue(memcmp(expected, encrypted, encrypted.Size()) == 0, L"Encryption does not match known answer");
+
+			ByteArray<sizeof(plain)> decrypted;
+			success = cryptography.Decrypt(cipher, iv, encrypted, decrypted, &TestError);
+
+			Assert::IsTrue(success, L"Decryption failed");
+			Assert::IsTrue(memcmp(plain, decrypted, decrypted.Size()) == 0, L"Decryption does not match known answer");
+		}
+
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_Unaligned_Test0)
+			TEST_DESCRIPTION(L"Data short of a block is padded with zeroes in the encrypted buffer.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_Unaligned_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t size = DATA_SIZE - 12;
+
+			ByteArray<size> data;
+			data.CopyFrom(TestDataA, size, 0, &TestError);
+
+			ByteArray<DATA_SIZE> encrypted;
+			success = cryptography.Encrypt(cipher, IV0, data, encrypted, &TestError);
+			Assert::IsTrue(success, L"Encrypt failed");
+			Assert::IsTrue(data.Zeroed(), L"Data not zeroed");
+			Assert::AreEqual(size_t(DATA_SIZE), cryptography.EncryptSize(cipher, size, &TestError), L"Wrong size");
+
+			ByteArray<DATA_SIZE> decrypted;
+			success = cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+			Assert::IsTrue(success, L"Decrypt failed");
+			Assert::IsTrue(memcmp(TestDataA, decrypted, size) == 0, L"Decrypt did not return data");
+			Assert::IsTrue(OS::Zeroed(&decrypted[size], DATA_SIZE - size), L"Padding not zeroes");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_InPlace_Test0)
+			TEST_DESCRIPTION(L"Encrypting and decrypting a buffer over itself.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_InPlace_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			ByteArray<DATA_SIZE> expected;
+			EncryptTestA(cryptography, cipher, expected);
+
+			ByteArray<DATA_SIZE> buffer;
+			buffer.CopyFrom(TestDataA, &TestError);
+
+			success = cryptography.Encrypt(cipher, IV0, buffer, buffer, &TestError);
+			Assert::IsTrue(success, L"Encrypt in place failed");
+			Assert::IsTrue(buffer == expected, L"Encrypted in place differs");
+
+			success = cryptography.Decrypt(cipher, IV0, buffer, buffer, &TestError);
+			Assert::IsTrue(success, L"Decrypt in place failed");
+			Assert::IsTrue(memcmp(TestDataA, buffer, DATA_SIZE) == 0, L"Decrypt in place did not return data");
+
+			// Too small to pad in place
+			ByteArray<DATA_SIZE - 1> unaligned;
+			success = cryptography.Encrypt(cipher, IV0, unaligned, unaligned, &TestError);
+			Assert::IsFalse(success, L"Unaligned buffer encrypted in place");
+			Assert::AreEqual(OSP_ERROR_BUFFER_TOO_SMALL, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_Benchmark0)
+			TEST_DESCRIPTION(L"Encrypt and decrypt unaligned data, counting heap allocations per call.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_Benchmark0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t rounds = 20000;
+			const size_t size = DATA_SIZE - 12;
+
+			size_t allocations = cryptography.Allocations();
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t n = 0; success && n < rounds; n++)
+			{
+				ByteArray<size> data;
+				data.CopyFrom(TestDataA, size, 0, &TestError);
+				ByteArray<DATA_SIZE> encrypted;
+				ByteArray<DATA_SIZE> decrypted;
+				success = cryptography.Encrypt(cipher, IV0, data, encrypted, &TestError)
+					&& cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+			}
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+			allocations = cryptography.Allocations() - allocations;
+
+			Assert::IsTrue(success, L"Encrypt/Decrypt failed");
+
+			Logger::WriteMessage((
+				to_string(rounds) + " unaligned encrypt/decrypt pairs in " + to_string(ms) + " ms, " +
+				to_string(double(allocations) / (2 * rounds)) + " allocations per call\n"
+			).c_str());
+
+			Assert::AreEqual(size_t(0), allocations, L"Encrypt/Decrypt allocated");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_Lanes_Test0)
+			TEST_DESCRIPTION(L"Entries of every length encrypted as a batch match encrypting them one by one.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_Lanes_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			// More than a group, so lanes are refilled as their chains end
+			const size_t count = 3 * max(size_t(16), cryptography.EncryptLanes()) + 5;
+			const size_t block = cryptography.BlockSize();
+
+			vector<vector<Cryptography::byte>> plain(count), expected(count), buffers(count), encrypted(count);
+			vector<ByteVector> data, outputs;
+			vector<ByteVector*> datap, outputp;
+			data.reserve(count);
+			outputs.reserve(count);
+
+			for (size_t n = 0; n < count; n++)
+			{
+				// Unaligned, empty and whole block entries, every third encrypted in place
+				size_t size = (n * 7) % 41 * block / 2 + (n % 5 == 0 ? 3 : 0);
+				size_t esize = cryptography.DataSize(size);
+
+				plain[n].resize(size);
+				for (size_t b = 0; b < size; b++)
+					plain[n][b] = Cryptography::byte(n * 31 + b);
+
+				expected[n].resize(esize);
+				if (size)
+				{
+					// Fixed vectors zero what they view as they go, so the result is copied out first
+					vector<Cryptography::byte> copy(plain[n]), result(esize);
+					ByteVector d(nullptr, copy.data(), size);
+					ByteVector e(nullptr, result.data(), esize);
+					success = cryptography.Encrypt(cipher, IV0, d, e, &TestError);
+					Assert::IsTrue(success, L"Encrypt failed");
+					expected[n] = result;
+				}
+
+				bool inplace = n % 3 == 0 && size == esize;
+
+				buffers[n] = plain[n];
+				encrypted[n].resize(esize);
+				data.emplace_back(nullptr, buffers[n].data(), size);
+				if (inplace)
+					outputp.push_back(&data.back());
+				else
+				{
+					outputs.emplace_back(nullptr, encrypted[n].data(), esize);
+					outputp.push_back(&outputs.back());
+				}
+				datap.push_back(&data.back());
+			}
+
+			success = cryptography.Encrypt(cipher, IV0, datap.data(), outputp.data(), count, &TestError);
+			Assert::IsTrue(success, L"Batch Encrypt failed");
+
+			for (size_t n = 0; n < count; n++)
+			{
+				const ByteVector& out = *outputp[n];
+				Assert::AreEqual(expected[n].size(), out.Size(), L"Wrong encrypted size");
+				Assert::IsTrue(memcmp(expected[n].data(), &out[0], out.Size()) == 0, L"Batch differs from one by one");
+				if (outputp[n] != datap[n])
+					Assert::IsTrue(data[n].Zeroed(), L"Data not cleared");
+			}
+
+			// Too small for its data padded to a block
+			ByteArray<DATA_SIZE - 1> unaligned;
+			ByteArray<DATA_SIZE - 1> small;
+			ByteVector* d[] = { &unaligned };
+			ByteVector* e[] = { &small };
+			success = cryptography.Encrypt(cipher, IV0, d, e, 1, &TestError);
+			Assert::IsFalse(success, L"Encrypted into a buffer too small");
+			Assert::AreEqual(OSP_ERROR_BUFFER_TOO_SMALL, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Encrypt_Lanes_Test1)
+			TEST_DESCRIPTION(L"A batch of uneven entries, each a prefix of the 33 block CBC known answer, encrypts to that known answer's prefix.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Encrypt_Lanes_Test1)
+		{
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher, CBC_KEY, sizeof(CBC_KEY));
+
+			ByteArray<16> iv;
+			for (size_t n = 0; n < iv.Size(); n++)
+				iv[n] = (Cryptography::byte)n;
+
+			const size_t block = cryptography.BlockSize();
+			const vector<Cryptography::byte> plain = CbcPlaintext();
+
+			// Blocks per entry, more entries than lanes so chains end and lanes
+			// are refilled at different passes
+			const size_t blocks[] = { 33, 1, 7, 9, 15, 17, 23, 31, 2, 3, 5, 11, 13, 19, 29, 33, 4, 1, 21 };
+			const size_t count = sizeof(blocks) / sizeof(blocks[0]);
+
+			vector<vector<Cryptography::byte>> buffers(count), encrypted(count);
+			vector<ByteVector> data, outputs;
+			vector<ByteVector*> datap, outputp;
+			data.reserve(count);
+			outputs.reserve(count);
+
+			for (size_t n = 0; n < count; n++)
+			{
+				size_t size = blocks[n] * block;
+
+				buffers[n].assign(plain.begin(), plain.begin() + size);
+				encrypted[n].resize(size);
+				data.emplace_back(nullptr, buffers[n].data(), size);
+				datap.push_back(&data.back());
+
+				// Every other entry encrypted in place
+				if (n % 2)
+					outputp.push_back(&data.back());
+				else
+				{
+					outputs.emplace_back(nullptr, encrypted[n].data(), size);
+					outputp.push_back(&outputs.back());
+				}
+			}
+
+			bool success = cryptography.Encrypt(cipher, iv, datap.data(), outputp.data(), count, &TestError);
+			Assert::IsTrue(success, L"Batch Encrypt failed");
+
+			for (size_t n = 0; n < count; n++)
+			{
+				const ByteVector& out = *outputp[n];
+				Assert::AreEqual(blocks[n] * block, out.Size(), L"Wrong encrypted size");
+				Assert::IsTrue(memcmp(CBC_ENCRYPTED, &out[0], out.Size()) == 0, L"Batch does not match known answer");
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Decrypt_Vector_Test0)
+			TEST_DESCRIPTION(L"AES-128 CBC known answer decrypted, NIST SP 800-38A F.2.2.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Decrypt_Vector_Test0)
+		{
+			const Cryptography::byte key[] = {
+				0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+			};
+			const Cryptography::byte encrypted[] = {
+				0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+				0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+				0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+				0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7,
+			};
+			const Cryptography::byte expected[] = {
+				0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+				0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+				0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+				0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+			};
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			ByteArray<sizeof(key)> secret;
+			secret.CopyFrom(key, sizeof(key), 0, &TestError);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+
+			bool success = cipher.Prepare(secret, &TestError);
+			if (success)
+			{
+				cipher.Key() = new Cryptography::byte[cipher.Size()];
+				ciphercleanup.push(cipher.Key());
+				success = cipher.Complete(&TestError);
+			}
+			Assert::IsTrue(success, L"Creating a cipher failed");
+
+			ByteArray<16> iv;
+			for (size_t n = 0; n < iv.Size(); n++)
+				iv[n] = (Cryptography::byte)n;
+
+			ByteArray<sizeof(encrypted)> data;
+			data.CopyFrom(encrypted, sizeof(encrypted), 0, &TestError);
+
+			ByteArray<sizeof(expected)> decrypted;
+			success = cryptography.Decrypt(cipher, iv, data, decrypted, &TestError);
+
+			Assert::IsTrue(success, L"Decryption failed");
+			Assert::IsTrue(memcmp(expected, decrypted, decrypted.Size()) == 0, L"Decryption does not match known answer");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Decrypt_Vector_Test1)
+			TEST_DESCRIPTION(L"AES-128 CBC known answer of 33 blocks, with the key and init vector of NIST SP 800-38A F.2.2, decrypted in runs that are not a multiple of the decrypt lanes.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Decrypt_Vector_Test1)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher, CBC_KEY, sizeof(CBC_KEY));
+
+			const size_t block = cryptography.BlockSize();
+			const size_t blocks = sizeof(CBC_ENCRYPTED) / block;
+
+			vector<Cryptography::byte> expected = CbcPlaintext();
+
+			// A run of CBC ciphertext decrypts alone, its init vector the block before it
+			vector<Cryptography::byte> chained(block + sizeof(CBC_ENCRYPTED));
+			for (size_t n = 0; n < block; n++)
+				chained[n] = Cryptography::byte(n);
+			memcpy(&chained[block], CBC_ENCRYPTED, sizeof(CBC_ENCRYPTED));
+
+			// Decrypt zeroes what it decrypted, so each run is copied out first
+			vector<Cryptography::byte> run(block + sizeof(CBC_ENCRYPTED));
+			vector<Cryptography::byte> buffer(sizeof(CBC_ENCRYPTED));
+
+			for (size_t count : { 1, 7, 9, 15, 17, 23, 31, 33 })
+			{
+				// From the start and up to the end, so the runs start at different lanes
+				for (size_t first : { size_t(0), blocks - count })
+				{
+					size_t size = count * block;
+
+					ByteVector iv(nullptr, &run[0], block);
+					ByteVector data(nullptr, &run[block], size);
+					ByteVector decrypted(nullptr, buffer.data(), size);
+
+					memcpy(run.data(), &chained[first * block], block + size);
+					success = cryptography.Decrypt(cipher, iv, data, decrypted, &TestError);
+					Assert::IsTrue(success, L"Decryption failed");
+					Assert::IsTrue(
+						memcmp(&expected[first * block], buffer.data(), size) == 0, L"Decryption does not match known answer"
+					);
+
+					// And over itself
+					memcpy(run.data(), &chained[first * block], block + size);
+					success = cryptography.Decrypt(cipher, iv, data, data, &TestError);
+					Assert::IsTrue(success, L"Decryption in place failed");
+					Assert::IsTrue(
+						memcmp(&expected[first * block], &run[block], size) == 0, L"Decryption in place does not match known answer"
+					);
+				}
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Decrypt_Lanes_Test0)
+			TEST_DESCRIPTION(L"Every length around the decrypt lanes, in place and not, decrypts to what was encrypted a block at a time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Decrypt_Lanes_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t block = cryptography.BlockSize();
+			const size_t blocks = 3 * max(size_t(16), cryptography.DecryptLanes()) + 1;
+
+			vector<Cryptography::byte> plain(blocks * block);
+			for (size_t n = 0; n < plain.size(); n++)
+				plain[n] = Cryptography::byte(n * 13 + 5);
+
+			vector<Cryptography::byte> expected(plain.size());
+			vector<Cryptography::byte> buffer(plain.size());
+
+			for (size_t count = 1; success && count <= blocks; count++)
+			{
+				size_t size = count * block;
+
+				memcpy(buffer.data(), plain.data(), size);
+				ByteVector data(nullptr, buffer.data(), size);
+				ByteVector encrypted(nullptr, expected.data(), size);
+				success = cryptography.Encrypt(cipher, IV0, data, encrypted, &TestError);
+				Assert::IsTrue(success, L"Encrypt failed");
+
+				ByteVector decrypted(nullptr, buffer.data(), size);
+				success = cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+				Assert::IsTrue(success, L"Decrypt failed");
+				Assert::IsTrue(memcmp(plain.data(), buffer.data(), size) == 0, L"Decrypt differs");
+
+				// Encrypted again, this time decrypted over itself
+				memcpy(buffer.data(), plain.data(), size);
+				success = cryptography.Encrypt(cipher, IV0, data, data, &TestError)
+					&& cryptography.Decrypt(cipher, IV0, data, data, &TestError);
+				Assert::IsTrue(success, L"Encrypt/Decrypt in place failed");
+				Assert::IsTrue(memcmp(plain.data(), buffer.data(), size) == 0, L"Decrypt in place differs");
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Decrypt_Benchmark0)
+			TEST_DESCRIPTION(L"GB/s of Decrypt, its blocks in flight together, against Encrypt a block at a time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Decrypt_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			string message = "Decrypt lanes " + to_string(cryptography.DecryptLanes()) + ", GB/s encrypt/decrypt:";
+
+			// A strong mnemonic's worth up to a bulk export's
+			for (size_t size : { size_t(64), size_t(1) << 10, size_t(1) << 16 })
+			{
+				const size_t rounds = (size_t(1) << 28) / size;
+
+				vector<Cryptography::byte> buffer(size, 0x5A);
+				ByteVector data(nullptr, buffer.data(), size);
+
+				auto t0 = Clock::now();
+				for (size_t n = 0; success && n < rounds; n++)
+					success = cryptography.Encrypt(cipher, IV0, data, data, &TestError);
+				auto t1 = Clock::now();
+				for (size_t n = 0; success && n < rounds; n++)
+					success = cryptography.Decrypt(cipher, IV0, data, data, &TestError);
+				auto t2 = Clock::now();
+
+				Assert::IsTrue(success, L"Encrypt/Decrypt failed");
+
+				// Hundredths of a GB/s
+				auto rate = [size, rounds](Clock::duration elapsed) {
+					size_t cents = size_t(double(size) * rounds / 1e7 / std::chrono::duration<double>(elapsed).count());
+					return to_string(cents / 100) + "." + to_string(cents / 10 % 10) + to_string(cents % 10);
+				};
+				message += " " + to_string(size) + " B " + rate(t1 - t0) + "/" + rate(t2 - t1);
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Gcm_Vector_Test0)
+			TEST_DESCRIPTION(L"AES-128 GCM known answer with authenticated data and a partial block, test case 4 of the GCM specification.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Gcm_Vector_Test0)
+		{
+			const Cryptography::byte key[] = {
+				0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+			};
+			const Cryptography::byte nonce[] = {
+				0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+			};
+			const char aad[] = {
+				'\xfe', '\xed', '\xfa', '\xce', '\xde', '\xad', '\xbe', '\xef', '\xfe', '\xed', '\xfa', '\xce',
+				'\xde', '\xad', '\xbe', '\xef', '\xab', '\xad', '\xda', '\xd2',
+			};
+			const Cryptography::byte plain[] = {
+				0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+				0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+				0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+				0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39,
+			};
+			const Cryptography::byte expected[] = {
+				0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+				0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+				0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+				0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91,
+			};
+			const Cryptography::byte expectedtag[] = {
+				0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47,
+			};
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			ByteArray<sizeof(key)> secret;
+			secret.CopyFrom(key, sizeof(key), 0, &TestError);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+
+			bool success = cipher.Prepare(secret, &TestError);
+			if (success)
+			{
+				cipher.Key() = new Cryptography::byte[cipher.Size()];
+				ciphercleanup.push(cipher.Key());
+				success = cipher.Complete(&TestError);
+			}
+			Assert::IsTrue(success, L"Creating a cipher failed");
+
+			ByteArray<Cryptography::NONCE_SIZE> iv;
+			iv.CopyFrom(nonce, sizeof(nonce), 0, &TestError);
+
+			ByteArray<sizeof(plain)> data;
+			data.CopyFrom(plain, sizeof(plain), 0, &TestError);
+
+			ByteArray<sizeof(expected)> encrypted;
+			ByteArray<Cryptography::TAG_SIZE> tag;
+			success = cryptography.EncryptGcm(cipher, iv, data, encrypted, tag, string_view(aad, sizeof(aad)), &TestError);
+
+			Assert::IsTrue(success, L"Encryption failed");
+			Assert::IsTrue(data.Zeroed(), L"Data not zeroed");
+			Assert::IsTrue(memcmp(expected, encrypted, encrypted.Size()) == 0, L"Encryption does not match known answer");
+			Assert::IsTrue(memcmp(expectedtag, tag, tag.Size()) == 0, L"Tag does not match known answer");
+
+			ByteArray<sizeof(plain)> decrypted;
+			success = cryptography.DecryptGcm(cipher, iv, encrypted, tag, decrypted, string_view(aad, sizeof(aad)), &TestError);
+
+			Assert::IsTrue(success, L"Decryption failed");
+			Assert::IsTrue(memcmp(plain, decrypted, decrypted.Size()) == 0, L"Decryption does not match known answer");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Gcm_Vector_Test1)
+			TEST_DESCRIPTION(L"AES GCM known answers with an empty body, with only authenticated data and with 128 and 256 bit keys, test cases 1 to 3, 13 and 14 of the GCM specification and a NIST CAVS case.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Gcm_Vector_Test1)
+		{
+			struct Vector { const char* Key; const char* Nonce; const char* Aad; const char* Plain; const char* Encrypted; const char* Tag; };
+
+			const char* const zero128 = "00000000000000000000000000000000";
+			const char* const zero256 = "0000000000000000000000000000000000000000000000000000000000000000";
+			const char* const zero96 = "000000000000000000000000";
+
+			const Vector vectors[] = {
+				// Nothing but the tag
+				{ zero128, zero96, "", "", "", "58e2fccefa7e3061367f1d57a4e7455a" },
+				{ zero128, zero96, "", zero128, "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf" },
+				{
+					"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "",
+					"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+					"1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+					"42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+					"21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+					"4d5c2af327cd64a62cf35abd2ba6fab4"
+				},
+				{ zero256, zero96, "", "", "", "530f8afbc74536b9a963b4f1c4cb738b" },
+				{ zero256, zero96, "", zero128, "cea7403d4d606b6e074ec5d3baf39d18", "d0d1c8a799996bf0265b98b5d48ab919" },
+				// Authenticated data and an empty body, gcmEncryptExtIV128 PTlen 0 AADlen 128 Count 0
+				{
+					"77be63708971c4e240d1cb79e8d77feb", "e0e00f19fed7ba0136a797f3", "7a43ec1d9c0a5a78a0b16533a6213cab",
+					"", "", "209fcc8d3675ed938e9c7166709dd946"
+				},
+			};
+
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			for (const Vector& v : vectors)
+			{
+				DECLARE_OSPCipher(c);
+				Cipher cipher(cryptography, c);
+				vector<Cryptography::byte> key = FromHex(v.Key);
+				Setup(cipher, key.data(), key.size());
+
+				vector<Cryptography::byte> noncebytes = FromHex(v.Nonce), aadbytes = FromHex(v.Aad);
+				vector<Cryptography::byte> plain = FromHex(v.Plain), expected = FromHex(v.Encrypted);
+				vector<Cryptography::byte> expectedtag = FromHex(v.Tag);
+				string_view aad((const char*)aadbytes.data(), aadbytes.size());
+
+				ByteVector nonce(nullptr, noncebytes.data(), noncebytes.size());
+
+				vector<Cryptography::byte> buffer(plain), encrypted(plain.size());
+				ByteVector data(nullptr, buffer.data(), buffer.size());
+				ByteVector e(nullptr, encrypted.data(), encrypted.size());
+				ByteArray<Cryptography::TAG_SIZE> tag;
+
+				success = cryptography.EncryptGcm(cipher, nonce, data, e, tag, aad, &TestError);
+				Assert::IsTrue(success, L"Encryption failed");
+				Assert::IsTrue(encrypted == expected, L"Encryption does not match known answer");
+				Assert::IsTrue(memcmp(expectedtag.data(), tag, tag.Size()) == 0, L"Tag does not match known answer");
+
+				ByteVector decrypted(nullptr, buffer.data(), buffer.size());
+
+				// Without a body the tag is all that is checked
+				tag[0] ^= 0x01;
+				success = cryptography.DecryptGcm(cipher, nonce, e, tag, decrypted, aad, &TestError);
+				Assert::IsFalse(success, L"Changed tag not refused");
+				Assert::AreEqual(OSP_ERROR_DATA_NOT_AUTHENTIC, TestError.Code, L"Wrong error");
+				CLEAR_OSPError(TestError);
+				tag[0] ^= 0x01;
+
+				success = cryptography.DecryptGcm(cipher, nonce, e, tag, decrypted, aad, &TestError);
+				Assert::IsTrue(success, L"Decryption failed");
+				Assert::IsTrue(buffer == plain, L"Decryption does not match known answer");
+
+				data.Release();
+				e.Release();
+				decrypted.Release();
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Gcm_Tamper_Test0)
+			TEST_DESCRIPTION(L"A changed ciphertext, tag or authenticated data fails, leaving the ciphertext and nothing decrypted.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Gcm_Tamper_Test0)
+		{
+			const string_view aad = "test";
+
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			ByteArray<Cryptography::NONCE_SIZE> nonce;
+			cryptography.Randomize(nonce, nonce.Size(), &TestError);
+
+			ByteArray<DATA_SIZE> encrypted;
+			ByteArray<Cryptography::TAG_SIZE> tag;
+			{
+				ByteArray<DATA_SIZE> data;
+				data.CopyFrom(TestDataA, &TestError);
+				success = cryptography.EncryptGcm(cipher, nonce, data, encrypted, tag, aad, &TestError);
+				Assert::IsTrue(success, L"Encryption failed");
+			}
+
+			ByteArray<DATA_SIZE> original;
+			original.CopyFrom(encrypted, &TestError);
+
+			auto refused = [&](string_view with) {
+				ByteArray<DATA_SIZE> decrypted;
+				CLEAR_OSPError(TestError);
+				bool failed = !cryptography.DecryptGcm(cipher, nonce, encrypted, tag, decrypted, with, &TestError);
+				return failed && TestError.Code == OSP_ERROR_DATA_NOT_AUTHENTIC && decrypted.Zeroed();
+			};
+
+			encrypted[DATA_SIZE / 2] ^= 0x01;
+			Assert::IsTrue(refused(aad), L"Changed ciphertext not refused");
+			encrypted[DATA_SIZE / 2] ^= 0x01;
+
+			tag[Cryptography::TAG_SIZE - 1] ^= 0x80;
+			Assert::IsTrue(refused(aad), L"Changed tag not refused");
+			tag[Cryptography::TAG_SIZE - 1] ^= 0x80;
+
+			nonce[0] ^= 0x01;
+			Assert::IsTrue(refused(aad), L"Changed nonce not refused");
+			nonce[0] ^= 0x01;
+
+			Assert::IsTrue(refused("tesT"), L"Changed authenticated data not refused");
+			Assert::IsTrue(encrypted == original, L"Ciphertext changed by a refused decryption");
+
+			CLEAR_OSPError(TestError);
+
+			ByteArray<DATA_SIZE> decrypted;
+			success = cryptography.DecryptGcm(cipher, nonce, encrypted, tag, decrypted, aad, &TestError);
+			Assert::IsTrue(success, L"Decryption failed");
+			Assert::IsTrue(memcmp(TestDataA, decrypted, TestDataA.Size()) == 0, L"Decryption did not return data");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Gcm_Lengths_Test0)
+			TEST_DESCRIPTION(L"Every length around the GCM lanes, in place and not, encrypts the same and decrypts to the data.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Gcm_Lengths_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			ByteArray<Cryptography::NONCE_SIZE> nonce;
+			cryptography.Randomize(nonce, nonce.Size(), &TestError);
+
+			// Up to two groups of sixteen blocks and a partial block past them
+			const size_t most = 2 * 16 * 16 + 17;
+			vector<Cryptography::byte> plain(most), data(most), encrypted(most), inplace(most);
+			for (size_t n = 0; n < most; n++)
+				plain[n] = Cryptography::byte(n * 7 + 1);
+
+			for (size_t size = 1; success && size <= most; size++)
+			{
+				memcpy(data.data(), plain.data(), size);
+				memcpy(inplace.data(), plain.data(), size);
+
+				ByteVector d(nullptr, data.data(), size);
+				ByteVector e(nullptr, encrypted.data(), size);
+				ByteVector p(nullptr, inplace.data(), size);
+
+				ByteArray<Cryptography::TAG_SIZE> tag0, tag1;
+				success = cryptography.EncryptGcm(cipher, nonce, d, e, tag0, "", &TestError)
+					&& cryptography.EncryptGcm(cipher, nonce, p, p, tag1, "", &TestError);
+
+				Assert::IsTrue(success, L"Encryption failed");
+				Assert::IsTrue(memcmp(encrypted.data(), inplace.data(), size) == 0, L"Encrypted in place differently");
+				Assert::IsTrue(tag0 == tag1, L"Tag in place differs");
+
+				success = cryptography.DecryptGcm(cipher, nonce, p, tag1, p, "", &TestError);
+				Assert::IsTrue(success, L"Decryption failed");
+				Assert::IsTrue(memcmp(plain.data(), inplace.data(), size) == 0, L"Decryption did not return data");
+
+				d.Release();
+				e.Release();
+				p.Release();
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_Gcm_Benchmark0)
+			TEST_DESCRIPTION(L"GB/s of GCM encrypted and decrypted against CBC, and against CBC with an HMAC-SHA512 of the ciphertext.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_Gcm_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			ByteArray<Cryptography::NONCE_SIZE> nonce;
+			ByteArray<Cryptography::TAG_SIZE> tag;
+			cryptography.Randomize(nonce, nonce.Size(), &TestError);
+
+			// HMAC-SHA512 hashes its inner padded key and the ciphertext, then its
+			// outer padded key and that hash. The keys are random, what an HMAC costs
+			// does not depend on them.
+			const size_t PAD_SIZE = 128;
+			const size_t HASH_SIZE = 64;
+
+			ByteArray<PAD_SIZE + HASH_SIZE> outer;
+			ByteArray<HASH_SIZE> mac;
+			cryptography.Randomize(outer, PAD_SIZE, &TestError);
+
+			HashSession session(cryptography);
+			success = session.Begin(&TestError);
+
+			string message = "GCM lanes " + to_string(cryptography.GcmLanes()) + ", GB/s GCM/CBC/CBC+HMAC:";
+
+			// A strong mnemonic's worth up to a bulk export's
+			for (size_t size : { size_t(64), size_t(1) << 10, size_t(1) << 16 })
+			{
+				const size_t rounds = (size_t(1) << 27) / size;
+
+				// The data right after the inner padded key, so it is hashed where it is encrypted
+				vector<Cryptography::byte> buffer(PAD_SIZE + size, 0x5A);
+				cryptography.Randomize(buffer.data(), PAD_SIZE, &TestError);
+				ByteVector data(nullptr, buffer.data() + PAD_SIZE, size);
+
+				auto authenticate = [&]() {
+					return session.Digest(buffer.data(), buffer.size(), &outer[PAD_SIZE], &TestError)
+						&& session.Digest(outer, outer.Size(), mac, &TestError);
+				};
+
+				// Every round encrypts and then decrypts, which GCM needs to authenticate
+				auto t0 = Clock::now();
+				for (size_t n = 0; success && n < rounds; n++)
+				{
+					success = cryptography.EncryptGcm(cipher, nonce, data, data, tag, "", &TestError)
+						&& cryptography.DecryptGcm(cipher, nonce, data, tag, data, "", &TestError);
+				}
+				auto t1 = Clock::now();
+				for (size_t n = 0; success && n < rounds; n++)
+				{
+					success = cryptography.Encrypt(cipher, IV0, data, data, &TestError)
+						&& cryptography.Decrypt(cipher, IV0, data, data, &TestError);
+				}
+				auto t2 = Clock::now();
+				for (size_t n = 0; success && n < rounds; n++)
+				{
+					success = cryptography.Encrypt(cipher, IV0, data, data, &TestError) && authenticate()
+						&& authenticate() && cryptography.Decrypt(cipher, IV0, data, data, &TestError);
+				}
+				auto t3 = Clock::now();
+
+				data.Release();
+
+				Assert::IsTrue(success, L"Encrypt/Decrypt failed");
+
+				// Hundredths of a GB/s
+				auto rate = [size, rounds](Clock::duration elapsed) {
+					size_t cents = size_t(double(size) * rounds / 1e7 / std::chrono::duration<double>(elapsed).count());
+					return to_string(cents / 100) + "." + to_string(cents / 10 % 10) + to_string(cents % 10);
+				};
+				message += " " + to_string(size) + " B " + rate(t1 - t0) + "/" + rate(t2 - t1) + "/" + rate(t3 - t2);
+			}
+
+			session.End(&TestError);
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_KeyCache_Test0)
+			TEST_DESCRIPTION(L"A Completed cipher's key is made once, then found in the key cache until the cipher is zeroed.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_KeyCache_Test0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t rounds = 5;
+			for (size_t n = 0; n < rounds; n++)
+			{
+				ByteArray<DATA_SIZE> encrypted;
+				EncryptTestA(cryptography, cipher, encrypted);
+
+				ByteArray<DATA_SIZE> decrypted;
+				success = cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+				Assert::IsTrue(success, L"Decrypt failed");
+				Assert::IsTrue(memcmp(TestDataA, decrypted, TestDataA.Size()) == 0, L"Decrypt did not return data");
+			}
+
+			Assert::AreEqual(size_t(1), cryptography.KeyCacheMisses(), L"Key made more than once");
+			Assert::AreEqual(2 * rounds - 1, cryptography.KeyCacheHits(), L"Key not found in the cache");
+
+			// The same key buffer completed with a new key must not find the old one
+			success = cipher.Zero(&TestError) && cipher.Prepare(&TestError) && cipher.Complete(&TestError);
+			Assert::IsTrue(success, L"Recreating the cipher failed");
+
+			ByteArray<DATA_SIZE> encrypted;
+			EncryptTestA(cryptography, cipher, encrypted);
+			Assert::AreEqual(size_t(2), cryptography.KeyCacheMisses(), L"Zeroed cipher's key still cached");
+
+			ByteArray<DATA_SIZE> decrypted;
+			success = cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+			Assert::IsTrue(success, L"Decrypt with the new key failed");
+			Assert::IsTrue(memcmp(TestDataA, decrypted, TestDataA.Size()) == 0, L"New key did not decrypt data");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_KeyCache_Test1)
+			TEST_DESCRIPTION(L"More ciphers than the key cache holds still encrypt and decrypt correctly.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_KeyCache_Test1)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			const size_t count = 3 * KeyCache<int>::SLOTS;
+
+			vector<OSPCipher> c(count);
+			for (size_t n = 0; n < count; n++)
+			{
+				c[n].Handle = nullptr;
+				c[n].Key = nullptr;
+				c[n].Size = 0;
+				Cipher cipher(cryptography, c[n]);
+				Setup(cipher);
+			}
+
+			vector<ByteArray<DATA_SIZE>> encrypted(count);
+			for (size_t n = 0; n < count; n++)
+				EncryptTestA(cryptography, Cipher(cryptography, c[n]), encrypted[n]);
+
+			for (size_t n = count; n > 0; n--)
+			{
+				ByteArray<DATA_SIZE> decrypted;
+				success = cryptography.Decrypt(Cipher(cryptography, c[n - 1]), IV0, encrypted[n - 1], decrypted, &TestError);
+				Assert::IsTrue(success, L"Decrypt failed");
+				Assert::IsTrue(memcmp(TestDataA, decrypted, TestDataA.Size()) == 0, L"Decrypt did not return data");
+			}
+
+			Assert::AreEqual(2 * count, cryptography.KeyCacheHits() + cryptography.KeyCacheMisses(), L"Lookups not counted");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Cryptography_KeyCache_Benchmark0)
+			TEST_DESCRIPTION(L"Encrypt and decrypt with one Completed cipher, its key found in the key cache.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Cryptography_KeyCache_Benchmark0)
+		{
+			bool success = true;
+
+			Cryptography cryptography(0, BLOCK_SIZE);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(cryptography, c);
+			Setup(cipher);
+
+			const size_t rounds = 20000;
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t n = 0; success && n < rounds; n++)
+			{
+				ByteArray<DATA_SIZE> data;
+				data.CopyFrom(TestDataA, &TestError);
+				ByteArray<DATA_SIZE> encrypted;
+				ByteArray<DATA_SIZE> decrypted;
+				success = cryptography.Encrypt(cipher, IV0, data, encrypted, &TestError)
+					&& cryptography.Decrypt(cipher, IV0, encrypted, decrypted, &TestError);
+			}
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+			Assert::IsTrue(success, L"Encrypt/Decrypt failed");
+
+			Logger::WriteMessage((
+				to_string(rounds) + " encrypt/decrypt pairs in " + to_string(ms) + " ms, key cache hits " +
+				to_string(cryptography.KeyCacheHits()) + ", misses " + to_string(cryptography.KeyCacheMisses()) + "\n"
+			).c_str());
+		}
+
 	};
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+/*
+One Strong Password
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../osp/cryptography.h"
+#include "../osp/drbg.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(Drbg_Test)
+	{
+		typedef Drbg::byte byte;
+
+		OSPError TestError;
+
+		static size_t Seeds;
+
+		static bool FixedEntropy(byte* const data, size_t size, OSPError* error)
+		{
+			Seeds++;
+			for (size_t n = 0; n < size; n++)
+				data[n] = byte(n + 1);
+			return true;
+		}
+
+		static bool FailingEntropy(byte* const data, size_t size, OSPError* error)
+		{
+			return OS::SetOSPError(error, OSP_System_Error, 5);
+		}
+
+		TEST_METHOD_INITIALIZE(MethodInitialize)
+		{
+			CLEAR_OSPError(TestError);
+			Seeds = 0;
+		}
+
+		TEST_METHOD_CLEANUP(MethodCleanup)
+		{
+			Assert::AreEqual(TestError.Code, OSP_NO_ERROR, L"There was an undected error");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_ChaCha20_Test0)
+			TEST_DESCRIPTION(L"ChaCha20 block function, RFC 8439 test vector 2.3.2.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_ChaCha20_Test0)
+		{
+			byte key[Drbg::KEY_SIZE];
+			for (size_t n = 0; n < sizeof(key); n++)
+				key[n] = byte(n);
+
+			const byte nonce[Drbg::NONCE_SIZE] = { 0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0 };
+
+			const byte expected[Drbg::BLOCK_SIZE] = {
+				0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+				0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+				0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+				0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+			};
+
+			byte block[Drbg::BLOCK_SIZE];
+			Drbg::ChaCha20(key, nonce, 1, block, 1);
+
+			Assert::IsTrue(memcmp(expected, block, sizeof(block)) == 0, L"Wrong keystream");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_Generate_Test0)
+			TEST_DESCRIPTION(L"Output follows from the seed, never repeats and consumed output is zeroed.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_Generate_Test0)
+		{
+			Drbg drbg0;
+			Drbg drbg1;
+
+			byte data0[16];
+			byte data1[16];
+
+			bool success = drbg0.Generate(data0, sizeof(data0), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"1st Generate failed");
+			Assert::AreEqual(size_t(1), Seeds, L"Not seeded once");
+			Assert::IsFalse(OS::Zeroed(data0, sizeof(data0)), L"Nothing generated");
+
+			success = drbg1.Generate(data1, sizeof(data1), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"2nd Generate failed");
+			Assert::IsTrue(memcmp(data0, data1, sizeof(data0)) == 0, L"Same seed, different output");
+
+			success = drbg0.Generate(data1, sizeof(data1), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"3rd Generate failed");
+			Assert::IsFalse(memcmp(data0, data1, sizeof(data0)) == 0, L"Output repeated");
+
+			// Across refills
+			byte large[3 * Drbg::BUFFER_SIZE];
+			success = drbg0.Generate(large, sizeof(large), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"Large Generate failed");
+			Assert::IsFalse(memcmp(large, &large[Drbg::BUFFER_SIZE], Drbg::BUFFER_SIZE) == 0, L"Refill repeated");
+			Assert::AreEqual(size_t(2), Seeds, L"Reseeded early");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_Reseed_Test0)
+			TEST_DESCRIPTION(L"Reseeding when asked to and every RESEED_SIZE bytes.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_Reseed_Test0)
+		{
+			Drbg drbg0;
+			Drbg drbg1;
+
+			byte data0[16];
+			byte data1[16];
+
+			bool success = drbg0.Generate(data0, sizeof(data0), FixedEntropy, &TestError)
+				&& drbg1.Generate(data1, sizeof(data1), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"Generate failed");
+
+			drbg0.Reseed();
+			success = drbg0.Generate(data0, sizeof(data0), FixedEntropy, &TestError)
+				&& drbg1.Generate(data1, sizeof(data1), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"Generate after reseed failed");
+			Assert::AreEqual(size_t(2), drbg0.Reseeds(), L"Not reseeded");
+			Assert::IsFalse(memcmp(data0, data1, sizeof(data0)) == 0, L"Reseed did not change output");
+
+			byte chunk[Drbg::BUFFER_SIZE];
+			for (size_t n = 0; success && n < Drbg::RESEED_SIZE / sizeof(chunk) + 1; n++)
+				success = drbg1.Generate(chunk, sizeof(chunk), FixedEntropy, &TestError);
+			Assert::IsTrue(success, L"Generate failed");
+			Assert::AreEqual(size_t(2), drbg1.Reseeds(), L"Not reseeded after RESEED_SIZE");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_Generate_Test1)
+			TEST_DESCRIPTION(L"Nothing is generated without entropy.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_Generate_Test1)
+		{
+			Drbg drbg;
+
+			byte data[16];
+			memset(data, 0xFF, sizeof(data));
+
+			bool success = drbg.Generate(data, sizeof(data), FailingEntropy, &TestError);
+			Assert::IsFalse(success, L"Generated without entropy");
+			Assert::IsTrue(OS::Zeroed(data, sizeof(data)), L"Data not zeroed");
+			Assert::AreEqual(uint32_t(5), TestError.Code, L"Entropy error not returned");
+			CLEAR_OSPError(TestError);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_Thread_Test0)
+			TEST_DESCRIPTION(L"Every thread has a generator of its own.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_Thread_Test0)
+		{
+			Drbg* mine = &Drbg::Thread();
+			Assert::IsTrue(mine == &Drbg::Thread(), L"Thread's generator changed");
+
+			Drbg* other = nullptr;
+			thread([&other] { other = &Drbg::Thread(); }).join();
+			Assert::IsTrue(other != mine, L"Generator shared between threads");
+
+			Cryptography cryptography;
+
+			byte data0[16];
+			byte data1[16];
+			Assert::IsTrue(cryptography.Randomize(data0, sizeof(data0), &TestError) != nullptr, L"Randomize failed");
+			thread([&] { cryptography.Randomize(data1, sizeof(data1), &TestError); }).join();
+			Assert::IsFalse(memcmp(data0, data1, sizeof(data0)) == 0, L"Threads served the same bytes");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Drbg_Randomize_Benchmark0)
+			TEST_DESCRIPTION(L"Small requests served by the generator versus the system's random number generator.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Drbg_Randomize_Benchmark0)
+		{
+			const size_t rounds = 100000;
+
+			Cryptography cryptography;
+
+			bool success = true;
+			byte data[16];
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t n = 0; success && n < rounds; n++)
+				success = cryptography.Randomize(data, sizeof(data), &TestError) != nullptr;
+			auto drbg = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+			Assert::IsTrue(success, L"Randomize failed");
+
+			start = std::chrono::steady_clock::now();
+			for (size_t n = 0; success && n < rounds; n++)
+				success = Cryptography::Entropy(data, sizeof(data), &TestError);
+			auto system = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+			Assert::IsTrue(success, L"Entropy failed");
+
+			Logger::WriteMessage((
+				to_string(rounds) + " requests of " + to_string(sizeof(data)) + " bytes, generator " +
+				to_string(drbg) + " ms, system " + to_string(system) + " ms\n"
+			).c_str());
+		}
+	};
+
+	size_t Drbg_Test::Seeds = 0;
+}
@@ -0,0 +1,473 @@
+/*
+One Strong Password
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <string>
+
+#include "../osp/kdf.h"
+#include "../osp/securestore.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(Kdf_Test)
+	{
+		typedef Kdf::byte byte;
+
+		OSPError TestError;
+
+		static bool Matches(const byte* data, const char* hex, size_t size)
+		{
+			for (size_t n = 0; n < size; n++)
+			{
+				unsigned int value = 0;
+				if (sscanf(hex + 2 * n, "%2x", &value) != 1 || data[n] != byte(value))
+					return false;
+			}
+			return true;
+		}
+
+		TEST_METHOD_INITIALIZE(MethodInitialize)
+		{
+			CLEAR_OSPError(TestError);
+		}
+
+		TEST_METHOD_CLEANUP(MethodCleanup)
+		{
+			Assert::AreEqual(TestError.Code, OSP_NO_ERROR, L"There was an undected error");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Digest_Test0)
+			TEST_DESCRIPTION(L"BLAKE2b and SHA-256 of \"abc\".")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Digest_Test0)
+		{
+			const byte abc[] = { 'a', 'b', 'c' };
+			byte hash[64];
+
+			Kdf::Blake2b(abc, sizeof(abc), hash, 64);
+			Assert::IsTrue(Matches(hash,
+				"ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+				"7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923", 64
+			), L"Wrong BLAKE2b-512");
+
+			Kdf::Blake2b(abc, sizeof(abc), hash, 32);
+			Assert::IsTrue(Matches(hash,
+				"bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319", 32
+			), L"Wrong BLAKE2b-256");
+
+			Kdf::Sha256(abc, sizeof(abc), hash);
+			Assert::IsTrue(Matches(hash,
+				"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", 32
+			), L"Wrong SHA-256");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Pbkdf2_Test0)
+			TEST_DESCRIPTION(L"PBKDF2-HMAC-SHA512 of \"password\" and \"salt\", 1 and 2 iterations.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Pbkdf2_Test0)
+		{
+			SecureStore store;
+			bool success = store.Initialize(1, 64, &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			const byte password[] = { 'p', 'a', 's', 's', 'w', 'o', 'r', 'd' };
+			const byte salt[] = { 's', 'a', 'l', 't' };
+			byte derived[64];
+
+			success = Kdf::Pbkdf2(store, password, sizeof(password), salt, sizeof(salt), 1, derived, 64, &TestError);
+			Assert::IsTrue(success, L"1 iteration failed");
+			Assert::IsTrue(Matches(derived,
+				"867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+				"c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce", 64
+			), L"Wrong key, 1 iteration");
+
+			success = Kdf::Pbkdf2(store, password, sizeof(password), salt, sizeof(salt), 2, derived, 64, &TestError);
+			Assert::IsTrue(success, L"2 iterations failed");
+			Assert::IsTrue(Matches(derived,
+				"e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+				"f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e", 64
+			), L"Wrong key, 2 iterations");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Scrypt_Test0)
+			TEST_DESCRIPTION(L"scrypt, RFC 7914 test vectors 1 and 2.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Scrypt_Test0)
+		{
+			byte derived[64];
+
+			bool success = Kdf::Scrypt((const byte*)"", 0, (const byte*)"", 0, 4, 1, 1, derived, 64, &TestError);
+			Assert::IsTrue(success, L"1st scrypt failed");
+			Assert::IsTrue(Matches(derived,
+				"77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+				"fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906", 64
+			), L"Wrong 1st key");
+
+			success = Kdf::Scrypt((const byte*)"password", 8, (const byte*)"NaCl", 4, 10, 8, 16, derived, 64, &TestError);
+			Assert::IsTrue(success, L"2nd scrypt failed");
+			Assert::IsTrue(Matches(derived,
+				"fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+				"2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640", 64
+			), L"Wrong 2nd key");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Argon2id_Test0)
+			TEST_DESCRIPTION(L"Argon2id, RFC 9106 test vector 5.3.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Argon2id_Test0)
+		{
+			byte password[32], salt[16], secret[8], associated[12];
+			memset(password, 0x01, sizeof(password));
+			memset(salt, 0x02, sizeof(salt));
+			memset(secret, 0x03, sizeof(secret));
+			memset(associated, 0x04, sizeof(associated));
+
+			byte derived[32];
+
+			bool success = Kdf::Argon2id(
+				password, sizeof(password), salt, sizeof(salt),
+				secret, sizeof(secret), associated, sizeof(associated),
+				3, 32, 4, derived, sizeof(derived), &TestError
+			);
+			Assert::IsTrue(success, L"Argon2id failed");
+			Assert::IsTrue(Matches(derived,
+				"0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659", 32
+			), L"Wrong tag");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Expansion_Test0)
+			TEST_DESCRIPTION(L"Counter mode blocks are HMAC-SHA512 of the counter and label.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Expansion_Test0)
+		{
+			SecureStore store;
+			bool success = store.Initialize(1, 64, &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			byte key[64];
+			for (size_t n = 0; n < sizeof(key); n++)
+				key[n] = byte(n);
+
+			byte block[64];
+
+			Expansion expansion(store);
+			success = expansion.Next(block, &TestError);
+			Assert::IsFalse(success, L"Expanded without a key");
+			Assert::AreEqual(OSP_ERROR_NOT_INITIALIZED, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			success = expansion.Begin(key, sizeof(key), &TestError) && expansion.Next(block, &TestError);
+			Assert::IsTrue(success, L"1st block failed");
+			Assert::IsTrue(Matches(block,
+				"e5eab9aeda58c741f22deaa82b663b84afedacbeb13210b2fe8398a64a3e0a37"
+				"0ab227ee19088d3130e836b849ade5c7bc5a2429e3e1542aa511a9e68cf82491", 64
+			), L"Wrong 1st block");
+
+			success = expansion.Next(block, &TestError);
+			Assert::IsTrue(success, L"2nd block failed");
+			Assert::IsTrue(Matches(block,
+				"8c22eeb4e765cee9e061cef2e172df3f22e601580855dbedcc3b821d3cdff425"
+				"21b841114b0479f62cb17f55b1a01a3a6c322ff50ea17fa5b8c0e080830db979", 64
+			), L"Wrong 2nd block");
+			Assert::AreEqual(uint32_t(2), expansion.Blocks(), L"Wrong block count");
+
+			success = expansion.End(&TestError);
+			Assert::IsTrue(success, L"End failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Profile_Test0)
+			TEST_DESCRIPTION(L"Only valid profiles are taken, an invalid one keeps the current profile.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Profile_Test0)
+		{
+			Assert::IsTrue(Kdf::Valid(Kdf::Legacy()), L"Legacy not valid");
+			Assert::IsTrue(Kdf::Valid(Kdf::Pbkdf2(1000)), L"PBKDF2 not valid");
+			Assert::IsTrue(Kdf::Valid(Kdf::Scrypt(14, 8, 1)), L"scrypt not valid");
+			Assert::IsTrue(Kdf::Valid(Kdf::Argon2id(3, 64 * 1024, 4)), L"Argon2id not valid");
+
+			Assert::IsFalse(Kdf::Valid(Kdf::Pbkdf2(0)), L"No iterations");
+			Assert::IsFalse(Kdf::Valid(Kdf::Scrypt(0, 8, 1)), L"No scrypt N");
+			Assert::IsFalse(Kdf::Valid(Kdf::Scrypt(Kdf::MAX_SCRYPT_LOG2_N + 1, 8, 1)), L"scrypt N too large");
+			Assert::IsFalse(Kdf::Valid(Kdf::Scrypt(14, 0, 1)), L"No scrypt r");
+			Assert::IsFalse(Kdf::Valid(Kdf::Argon2id(0, 1024, 1)), L"No Argon2id passes");
+			Assert::IsFalse(Kdf::Valid(Kdf::Argon2id(1, 31, 4)), L"Argon2id memory under 8 blocks a lane");
+			Assert::IsFalse(Kdf::Valid(Kdf::Argon2id(1, 1024, 0)), L"No Argon2id lanes");
+
+			OSPKdfProfile versioned = Kdf::Pbkdf2(1000);
+			versioned.Version = OSP_KDF_PROFILE_VERSION + 1;
+			Assert::IsFalse(Kdf::Valid(versioned), L"Unknown version");
+
+			OSPKdfProfile expanded = Kdf::Pbkdf2(1000);
+			expanded.Expansion = OSP_EXPANSION_COUNTER;
+			Assert::IsTrue(Kdf::Valid(expanded), L"Counter expansion not valid");
+			expanded.Expansion = OSP_EXPANSION_COUNTER + 1;
+			Assert::IsFalse(Kdf::Valid(expanded), L"Unknown expansion");
+
+			SecureStore store;
+			Assert::AreEqual(OSP_KDF_LEGACY, store.KdfProfile().Kdf, L"Not legacy by default");
+			Assert::AreEqual(uint32_t(SecureStore::STRONG_HASH_ROUNDS), store.KdfProfile().Iterations, L"Wrong rounds");
+
+			bool success = store.KdfProfile(Kdf::Argon2id(0, 1024, 1), &TestError);
+			Assert::IsFalse(success, L"Invalid profile taken");
+			Assert::AreEqual(OSP_ERROR_INVALID_KDF_PROFILE, TestError.Code, L"Wrong error");
+			Assert::AreEqual(OSP_KDF_LEGACY, store.KdfProfile().Kdf, L"Profile changed");
+			CLEAR_OSPError(TestError);
+
+			success = store.KdfProfile(Kdf::Scrypt(10, 8, 1), &TestError);
+			Assert::IsTrue(success, L"Valid profile refused");
+			Assert::AreEqual(OSP_KDF_SCRYPT, store.KdfProfile().Kdf, L"Profile not changed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Scaled_Test0)
+			TEST_DESCRIPTION(L"Scaled profiles stay valid and cost about what was asked.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Scaled_Test0)
+		{
+			const OSPKdfProfile profiles[] = {
+				Kdf::Legacy(), Kdf::Pbkdf2(1000), Kdf::Scrypt(10, 8, 1), Kdf::Argon2id(3, 1024, 4)
+			};
+
+			for (const OSPKdfProfile& profile : profiles)
+			{
+				for (uint64_t cost : { uint64_t(0), uint64_t(1000), uint64_t(100000), uint64_t(1) << 40 })
+				{
+					OSPKdfProfile scaled = Kdf::Scaled(profile, cost);
+					Assert::IsTrue(Kdf::Valid(scaled), L"Scaled profile not valid");
+					Assert::AreEqual(profile.Kdf, scaled.Kdf, L"Function changed");
+				}
+
+				OSPKdfProfile doubled = Kdf::Scaled(profile, 2 * Kdf::Cost(profile));
+				Assert::AreEqual(2 * Kdf::Cost(profile), Kdf::Cost(doubled), L"Cost not doubled");
+			}
+
+			// Iterations never scale below the floor, and the legacy chain keeps to even counts
+			for (uint64_t cost : { uint64_t(0), uint64_t(1), uint64_t(1001), uint64_t(123457), uint64_t(1) << 40 })
+			{
+				OSPKdfProfile legacy = Kdf::Scaled(Kdf::Legacy(), cost);
+				Assert::IsTrue(legacy.Iterations >= Kdf::MIN_SCALED_ITERATIONS, L"Legacy iterations too few");
+				Assert::IsTrue(legacy.Iterations % 2 == 0, L"Legacy iterations odd");
+
+				OSPKdfProfile pbkdf2 = Kdf::Scaled(Kdf::Pbkdf2(1000), cost);
+				Assert::IsTrue(pbkdf2.Iterations >= Kdf::MIN_SCALED_ITERATIONS, L"PBKDF2 iterations too few");
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Scaled_Test1)
+			TEST_DESCRIPTION(L"Scaling fixed costs gives the exact profiles calibration ends with.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Scaled_Test1)
+		{
+			Assert::AreEqual(uint64_t(20000), Kdf::Cost(Kdf::Legacy()), L"Wrong legacy cost");
+			Assert::AreEqual(uint64_t(1024), Kdf::Cost(Kdf::Scrypt(10, 8, 1)), L"Wrong scrypt cost");
+			Assert::AreEqual(uint64_t(3 * 1024), Kdf::Cost(Kdf::Argon2id(3, 1024, 4)), L"Wrong Argon2id cost");
+
+			// Rounded up to even for the legacy chain only, never below the floor
+			Assert::AreEqual(uint32_t(5002), Kdf::Scaled(Kdf::Legacy(), 5001).Iterations, L"Wrong legacy iterations");
+			Assert::AreEqual(uint32_t(5001), Kdf::Scaled(Kdf::Pbkdf2(1000), 5001).Iterations, L"Wrong PBKDF2 iterations");
+			Assert::AreEqual(Kdf::MIN_SCALED_ITERATIONS, Kdf::Scaled(Kdf::Pbkdf2(1000), 10).Iterations, L"Below the floor");
+
+			// The largest N not over the cost, other parameters kept
+			OSPKdfProfile scrypt = Kdf::Scaled(Kdf::Scrypt(10, 8, 1), 3000);
+			Assert::AreEqual(uint32_t(11), scrypt.Memory, L"Wrong scrypt N");
+			Assert::AreEqual(uint32_t(8), scrypt.BlockSize, L"Block size changed");
+			Assert::AreEqual(uint64_t(2048), Kdf::Cost(scrypt), L"Wrong scaled scrypt cost");
+
+			// Memory per pass, whole segments in each of the 4 lanes
+			OSPKdfProfile argon2 = Kdf::Scaled(Kdf::Argon2id(3, 1024, 4), 15000);
+			Assert::AreEqual(uint32_t(4992), argon2.Memory, L"Wrong Argon2id memory");
+			Assert::AreEqual(uint32_t(3), argon2.Iterations, L"Passes changed");
+			Assert::AreEqual(uint64_t(3 * 4992), Kdf::Cost(argon2), L"Wrong scaled Argon2id cost");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Calibrate_Test0)
+			TEST_DESCRIPTION(L"Calibration gives a valid profile of the function asked for, costlier than the one it starts from.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Calibrate_Test0)
+		{
+			SecureStore store;
+			bool success = store.Initialize(1, 64, &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			success = store.CalibrateKdf(OSP_KDF_ARGON2ID + 1, OSP_KDF_TARGET_BATCH, &TestError);
+			Assert::IsFalse(success, L"Unknown function calibrated");
+			Assert::AreEqual(OSP_ERROR_INVALID_KDF_PROFILE, TestError.Code, L"Wrong error");
+			Assert::AreEqual(uint64_t(0), store.KdfRate(), L"Rate without calibration");
+			CLEAR_OSPError(TestError);
+
+			// The cheap profiles CalibrateKdf starts from, an interactive target is
+			// several times their cost on any machine
+			const OSPKdfProfile starts[] = {
+				Kdf::Legacy(1000), Kdf::Pbkdf2(1000), Kdf::Scrypt(10, 8, 1), Kdf::Argon2id(3, 1024, 1)
+			};
+
+			for (const OSPKdfProfile& start : starts)
+			{
+				success = store.CalibrateKdf(start.Kdf, OSP_KDF_TARGET_INTERACTIVE, &TestError);
+				Assert::IsTrue(success, L"Calibration failed");
+				Assert::AreEqual(start.Kdf, store.KdfProfile().Kdf, L"Wrong function");
+				Assert::IsTrue(Kdf::Valid(store.KdfProfile()), L"Calibrated profile not valid");
+				Assert::IsTrue(Kdf::Cost(store.KdfProfile()) > Kdf::Cost(start), L"Calibrated cost not larger");
+				Assert::IsTrue(store.KdfRate() > 0, L"No rate");
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Calibrate_Benchmark0)
+			TEST_DESCRIPTION(L"Latency of a strong hash with each function calibrated to the batch target.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Calibrate_Benchmark0)
+		{
+			ByteArray<64> test;
+			for (size_t b = 1; b <= test.Size(); b++)
+				test[b - 1] = (Cryptography::byte)b;
+
+			SecureStore store;
+			bool success = store.Initialize(1, test.Size(), &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			for (uint32_t function : { OSP_KDF_LEGACY, OSP_KDF_PBKDF2, OSP_KDF_SCRYPT, OSP_KDF_ARGON2ID })
+			{
+				success = store.CalibrateKdf(function, OSP_KDF_TARGET_BATCH, &TestError);
+				Assert::IsTrue(success, L"Calibration failed");
+
+				ByteArray<64> hash;
+				auto t0 = chrono::steady_clock::now();
+				success = store.StrongHash(test, hash, &TestError);
+				auto t1 = chrono::steady_clock::now();
+				Assert::IsTrue(success, L"Strong Hash failed");
+
+				double ms = chrono::duration<double, milli>(t1 - t0).count();
+				Logger::WriteMessage((
+					"Kdf calibrated " + to_string(function) + " to " + to_string(OSP_KDF_TARGET_BATCH) + " ms: cost " +
+					to_string(Kdf::Cost(store.KdfProfile())) + ", rate " + to_string(store.KdfRate()) + " per second, " +
+					to_string(ms) + " ms\n"
+				).c_str());
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_StrongHash_Test0)
+			TEST_DESCRIPTION(L"Every profile strong hashes reproducibly and differently from the others.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_StrongHash_Test0)
+		{
+			const OSPKdfProfile profiles[] = {
+				Kdf::Legacy(), Kdf::Legacy(1000), Kdf::Pbkdf2(1000), Kdf::Scrypt(10, 8, 1), Kdf::Argon2id(1, 256, 2)
+			};
+			const size_t count = sizeof(profiles) / sizeof(profiles[0]);
+
+			ByteArray<64> test;
+			for (size_t b = 1; b <= test.Size(); b++)
+				test[b - 1] = (Cryptography::byte)b;
+
+			SecureStore store;
+			bool success = store.Initialize(1, test.Size(), &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			ByteArray<64> legacy;
+			success = store.StrongHash(test, legacy, &TestError);
+			Assert::IsTrue(success, L"Default Strong Hash failed");
+
+			ByteArray<64> hashes[count];
+
+			for (size_t n = 0; n < count; n++)
+			{
+				success = store.KdfProfile(profiles[n], &TestError);
+				Assert::IsTrue(success, L"Profile refused");
+
+				ByteArray<64> again;
+				success = store.StrongHash(test, hashes[n], &TestError) && store.StrongHash(test, again, &TestError);
+				Assert::IsTrue(success, L"Strong Hash failed");
+				Assert::IsFalse(hashes[n].Zeroed(), L"Strong Hash not created");
+				Assert::IsTrue(hashes[n] == again, L"Strong Hash not reproduced");
+
+				for (size_t m = 0; m < n; m++)
+					Assert::IsFalse(hashes[n] == hashes[m], L"Two profiles, same Strong Hash");
+			}
+
+			Assert::IsTrue(hashes[0] == legacy, L"Legacy profile changed the default Strong Hash");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Kdf_Benchmark0)
+			TEST_DESCRIPTION(L"Latency and throughput of each function per parameter set.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Kdf_Benchmark0)
+		{
+			typedef struct Case { const char* Name; OSPKdfProfile Profile; } Case;
+
+			const Case cases[] = {
+				{ "legacy 20000", Kdf::Legacy() },
+				{ "PBKDF2 10000", Kdf::Pbkdf2(10000) },
+				{ "PBKDF2 100000", Kdf::Pbkdf2(100000) },
+				{ "scrypt N=2^14 r=8 p=1", Kdf::Scrypt(14, 8, 1) },
+				{ "scrypt N=2^16 r=8 p=1", Kdf::Scrypt(16, 8, 1) },
+				{ "Argon2id t=3 m=16MiB p=1", Kdf::Argon2id(3, 16 * 1024, 1) },
+				{ "Argon2id t=1 m=64MiB p=4", Kdf::Argon2id(1, 64 * 1024, 4) }
+			};
+
+			ByteArray<64> test;
+			for (size_t b = 1; b <= test.Size(); b++)
+				test[b - 1] = (Cryptography::byte)b;
+
+			SecureStore store;
+			bool success = store.Initialize(1, test.Size(), &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			ByteArray<64> hash;
+			const int count = 2;
+
+			for (const Case& c : cases)
+			{
+				success = store.KdfProfile(c.Profile, &TestError);
+				Assert::IsTrue(success, L"Profile refused");
+
+				auto t0 = chrono::steady_clock::now();
+				for (int n = 0; success && n < count; n++)
+					success = store.StrongHash(test, hash, &TestError);
+				auto t1 = chrono::steady_clock::now();
+
+				Assert::IsTrue(success, L"Strong Hash failed");
+
+				double ms = chrono::duration<double, milli>(t1 - t0).count() / count;
+				Logger::WriteMessage((
+					"Kdf " + string(c.Name) + ": " + to_string(ms) + " ms per derivation, " +
+					to_string(1000.0 / ms) + " derivations per second\n"
+				).c_str());
+			}
+		}
+	};
+}
@@ -0,0 +1,208 @@
+/*
+One Strong Password
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include "CppUnitTest.h"
+
+#include <string.h>
+
+#include "../osp/keycache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(KeyCache_Test)
+	{
+		typedef OS::byte byte;
+
+		struct TestKey
+		{
+			int Made = 0;
+			int Destroyed = 0;
+			byte First = 0;
+
+			void Destroy() { Destroyed++; First = 0; }
+		};
+
+		typedef KeyCache<TestKey> TestCache;
+
+		static const size_t BLOB_SIZE = 16;
+
+		static void Blob(byte* blob, byte first)
+		{
+			memset(blob, 0x5A, BLOB_SIZE);
+			blob[0] = first;
+		}
+
+		static TestKey* Lease(TestCache& cache, const byte* blob)
+		{
+			return cache.Lease(blob, BLOB_SIZE, [blob](TestKey& key) { key.Made++; key.First = blob[0]; return true; });
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(KeyCache_Lease_Test0)
+			TEST_DESCRIPTION(L"A key is made on the first lease and found on the next.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(KeyCache_Lease_Test0)
+		{
+			TestCache cache;
+
+			byte blob[BLOB_SIZE];
+			Blob(blob, 1);
+
+			TestKey* key = Lease(cache, blob);
+			Assert::IsTrue(key != nullptr, L"First lease failed");
+			Assert::AreEqual(1, key->Made, L"Key not made");
+			cache.Return(key);
+
+			TestKey* again = Lease(cache, blob);
+			Assert::IsTrue(again == key, L"Key not found");
+			Assert::AreEqual(1, again->Made, L"Key made twice");
+			cache.Return(again);
+
+			Assert::AreEqual(size_t(1), cache.Hits(), L"Hit not counted");
+			Assert::AreEqual(size_t(1), cache.Misses(), L"Miss not counted");
+
+			// A blob differing in one byte is another key
+			byte other[BLOB_SIZE];
+			Blob(other, 2);
+			TestKey* otherkey = Lease(cache, other);
+			Assert::IsTrue(otherkey != nullptr && otherkey != key, L"Different blob found the same key");
+			Assert::AreEqual(byte(2), otherkey->First, L"Key not made from its blob");
+			cache.Return(otherkey);
+
+			Assert::AreEqual(size_t(2), cache.Misses(), L"Miss not counted");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(KeyCache_Lease_Test1)
+			TEST_DESCRIPTION(L"A leased key is not leased again until it is returned.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(KeyCache_Lease_Test1)
+		{
+			TestCache cache;
+
+			byte blob[BLOB_SIZE];
+			Blob(blob, 1);
+
+			TestKey* key = Lease(cache, blob);
+			Assert::IsTrue(key != nullptr, L"First lease failed");
+
+			Assert::IsTrue(Lease(cache, blob) == nullptr, L"Leased key leased again");
+			Assert::AreEqual(size_t(2), cache.Misses(), L"Leased key not a miss");
+
+			cache.Return(key);
+			Assert::IsTrue(Lease(cache, blob) == key, L"Returned key not found");
+			cache.Return(key);
+
+			// With every slot leased there is nothing to lease
+			TestKey* keys[TestCache::SLOTS];
+			for (size_t n = 0; n < TestCache::SLOTS; n++)
+			{
+				Blob(blob, byte(n + 10));
+				keys[n] = Lease(cache, blob);
+				Assert::IsTrue(keys[n] != nullptr, L"Lease failed");
+			}
+
+			Blob(blob, 100);
+			Assert::IsTrue(Lease(cache, blob) == nullptr, L"Leased with every slot leased");
+
+			for (size_t n = 0; n < TestCache::SLOTS; n++)
+				cache.Return(keys[n]);
+
+			Assert::IsTrue(Lease(cache, blob) != nullptr, L"Lease failed after return");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(KeyCache_Evict_Test0)
+			TEST_DESCRIPTION(L"The least recently used key is destroyed when the cache is full.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(KeyCache_Evict_Test0)
+		{
+			TestCache cache;
+
+			byte blob[BLOB_SIZE];
+			TestKey* keys[TestCache::SLOTS];
+			for (size_t n = 0; n < TestCache::SLOTS; n++)
+			{
+				Blob(blob, byte(n + 1));
+				keys[n] = Lease(cache, blob);
+				cache.Return(keys[n]);
+			}
+
+			// Use the first again, so the second is least recent
+			Blob(blob, 1);
+			Assert::IsTrue(Lease(cache, blob) == keys[0], L"First key not found");
+			cache.Return(keys[0]);
+
+			Blob(blob, 100);
+			TestKey* key = Lease(cache, blob);
+			Assert::IsTrue(key == keys[1], L"Least recently used key not evicted");
+			Assert::AreEqual(1, key->Destroyed, L"Evicted key not destroyed");
+			Assert::AreEqual(byte(100), key->First, L"Key not made from its blob");
+			cache.Return(key);
+
+			Blob(blob, 2);
+			key = Lease(cache, blob);
+			Assert::AreEqual(size_t(TestCache::SLOTS + 2), cache.Misses(), L"Evicted blob still found");
+			cache.Return(key);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(KeyCache_Evict_Test1)
+			TEST_DESCRIPTION(L"Evicting a blob destroys its key, when leased once it is returned.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(KeyCache_Evict_Test1)
+		{
+			TestCache cache;
+
+			byte blob[BLOB_SIZE];
+			Blob(blob, 1);
+
+			TestKey* key = Lease(cache, blob);
+			cache.Return(key);
+
+			cache.Evict(blob, BLOB_SIZE);
+			Assert::AreEqual(1, key->Destroyed, L"Evicted key not destroyed");
+
+			key = Lease(cache, blob);
+			Assert::AreEqual(size_t(2), cache.Misses(), L"Evicted key found");
+
+			int destroyed = key->Destroyed;
+			cache.Evict(blob, BLOB_SIZE);
+			Assert::AreEqual(destroyed, key->Destroyed, L"Leased key destroyed");
+
+			cache.Return(key);
+			Assert::AreEqual(destroyed + 1, key->Destroyed, L"Stale key not destroyed on return");
+
+			key = Lease(cache, blob);
+			Assert::AreEqual(size_t(3), cache.Misses(), L"Stale key found");
+			cache.Return(key);
+
+			destroyed = key->Destroyed;
+			cache.Clear();
+			Assert::AreEqual(destroyed + 1, key->Destroyed, L"Clear did not destroy key");
+			Assert::IsTrue(Lease(cache, blob) != nullptr, L"Lease failed after clear");
+			Assert::AreEqual(size_t(4), cache.Misses(), L"Cleared key found");
+		}
+	};
+}
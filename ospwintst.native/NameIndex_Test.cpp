@@ -0,0 +1,204 @@
+/*
+One Strong Password
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+#include <Windows.h>
+#include "CppUnitTest.h"
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../osp/nameindex.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(NameIndex_Test)
+	{
+		typedef NameIndex<size_t> Index;
+
+		static size_t Insert(Index& index, string_view name, size_t hash, size_t value)
+		{
+			bool inserted = false;
+			size_t slot = index.Insert(name, hash, inserted);
+			Assert::IsTrue(inserted, L"Name already indexed");
+			index.Value(slot) = value;
+			return slot;
+		}
+
+		static vector<string> Names(size_t count)
+		{
+			vector<string> names;
+			names.reserve(count);
+			for (size_t n = 0; n < count; n++)
+				names.push_back("name " + to_string(n * 7919));
+			return names;
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(NameIndex_Insert_Find_Test0)
+			TEST_DESCRIPTION(L"Indexed names are found, others are not.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(NameIndex_Insert_Find_Test0)
+		{
+			Index index;
+			Assert::IsTrue(index.Find("missing", Index::Hash("missing")) == Index::NONE, L"Found in an empty index");
+
+			vector<string> names = Names(1000);
+			for (size_t n = 0; n < names.size(); n++)
+				Insert(index, names[n], Index::Hash(names[n]), n);
+
+			Assert::AreEqual(names.size(), index.Size(), L"Wrong size");
+
+			for (size_t n = 0; n < names.size(); n++)
+			{
+				size_t slot = index.Find(names[n], Index::Hash(names[n]));
+				Assert::IsTrue(slot != Index::NONE, L"Name not found");
+				Assert::AreEqual(n, index.Value(slot), L"Wrong value");
+			}
+
+			Assert::IsTrue(index.Find("missing", Index::Hash("missing")) == Index::NONE, L"Missing name found");
+
+			bool inserted = true;
+			size_t slot = index.Insert(names[5], Index::Hash(names[5]), inserted);
+			Assert::IsFalse(inserted, L"Name indexed twice");
+			Assert::AreEqual(size_t(5), index.Value(slot), L"Value replaced");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(NameIndex_Erase_Test0)
+			TEST_DESCRIPTION(L"Erasing from a run of colliding names keeps the rest of the run found.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(NameIndex_Erase_Test0)
+		{
+			Index index;
+
+			// Every name shares one hash, then a few more share the next slot
+			const size_t count = 8;
+			for (size_t n = 0; n < count; n++)
+				Insert(index, "same " + to_string(n), 32, n);
+			for (size_t n = 0; n < count / 2; n++)
+				Insert(index, "next " + to_string(n), 33, count + n);
+
+			for (size_t n = 0; n < count; n += 2)
+			{
+				size_t slot = index.Find("same " + to_string(n), 32);
+				Assert::IsTrue(slot != Index::NONE, L"Name not found before erase");
+				index.Erase(slot);
+			}
+
+			Assert::AreEqual(count, index.Size(), L"Wrong size after erase");
+
+			for (size_t n = 0; n < count; n++)
+			{
+				size_t slot = index.Find("same " + to_string(n), 32);
+				if (n % 2 == 0)
+					Assert::IsTrue(slot == Index::NONE, L"Erased name found");
+				else
+				{
+					Assert::IsTrue(slot != Index::NONE, L"Name lost by erase");
+					Assert::AreEqual(n, index.Value(slot), L"Wrong value after erase");
+				}
+			}
+
+			for (size_t n = 0; n < count / 2; n++)
+			{
+				size_t slot = index.Find("next " + to_string(n), 33);
+				Assert::IsTrue(slot != Index::NONE, L"Colliding name lost by erase");
+				Assert::AreEqual(count + n, index.Value(slot), L"Wrong colliding value after erase");
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(NameIndex_Clear_Test0)
+			TEST_DESCRIPTION(L"Every value is visited, then the index is emptied.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(NameIndex_Clear_Test0)
+		{
+			Index index;
+
+			vector<string> names = Names(100);
+			for (size_t n = 0; n < names.size(); n++)
+				Insert(index, names[n], Index::Hash(names[n]), n + 1);
+
+			size_t sum = 0;
+			index.ForEach([&](size_t& value) { sum += value; });
+			Assert::AreEqual(names.size() * (names.size() + 1) / 2, sum, L"Not every value visited");
+
+			index.Clear();
+			Assert::AreEqual(size_t(0), index.Size(), L"Not cleared");
+			Assert::IsTrue(index.Find(names[0], Index::Hash(names[0])) == Index::NONE, L"Found after clear");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(NameIndex_Find_Benchmark0)
+			TEST_DESCRIPTION(L"Lookups by pointer and length, the index versus a map of strings.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(NameIndex_Find_Benchmark0)
+		{
+			const size_t counts[] = { 10000, 100000, 1000000 };
+			const size_t lookups = 1000000;
+
+			for (size_t count : counts)
+			{
+				vector<string> names = Names(count);
+
+				Index index;
+				map<string, size_t> tree;
+				for (size_t n = 0; n < count; n++)
+				{
+					Insert(index, names[n], Index::Hash(names[n]), n);
+					tree[names[n]] = n;
+				}
+
+				size_t found = 0;
+
+				// As the C API sees names, a pointer and a length
+				auto t0 = GetTickCount();
+				for (size_t n = 0; n < lookups; n++)
+				{
+					const string& name = names[(n * 2654435761u) % count];
+					auto itr = tree.find(string(name.c_str(), name.size()));
+					found += itr != tree.end() ? 1 : 0;
+				}
+				auto t1 = GetTickCount();
+				for (size_t n = 0; n < lookups; n++)
+				{
+					const string& name = names[(n * 2654435761u) % count];
+					string_view view(name.c_str(), name.size());
+					found += index.Find(view, Index::Hash(view)) != Index::NONE ? 1 : 0;
+				}
+				auto t2 = GetTickCount();
+
+				Assert::AreEqual(2 * lookups, found, L"Lookups failed");
+
+				Logger::WriteMessage((
+					to_string(lookups) + " lookups in " + to_string(count) + " names, ms: map " +
+					to_string(t1 - t0) + ", index " + to_string(t2 - t1) + "\n"
+				).c_str());
+			}
+		}
+	};
+}
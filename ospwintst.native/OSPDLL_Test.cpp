@@ -24,6 +24,8 @@ Software.
 
 #include <stack>
 #include <algorithm>
+#include <thread>
+#include <vector>
 
 #include "../ospwindll/ospapi.h"
 #include "../osp/os.h"
@@ -269,6 +271,145 @@ namespace OneStrongPassword
 			Assert::IsTrue(PasswordA.compare(password) == 0, L"Password not dispensed");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Padding_Test0)
+			TEST_DESCRIPTION(L"Store and dispense with size class padding.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_Padding_Test0)
+		{
+			const string name = "test";
+
+			bool success;
+
+			Assert::AreEqual(OSP_PADDING_MAX_DATA_SIZE, OSPPadding(), L"Not padded to MaxDataSize by default");
+
+			OSPSetPadding(OSP_PADDING_SIZE_CLASS);
+			Assert::AreEqual(OSP_PADDING_SIZE_CLASS, OSPPadding(), L"Padding not set");
+
+			DECLARE_OSPCipher(cipher);
+			Setup(cipher);
+
+			{
+				char password[SizeA];
+				memset(password, 0, sizeof(password));
+				memcpy(password, PasswordA.c_str(), std::min(sizeof(password) - 1, PasswordA.size()));
+
+				success = OSPStoreStrongPassword(
+					name.c_str(), name.size(), &cipher, password, sizeof(password), &TestError
+				);
+			}
+
+			char password[SizeA];
+
+			if (success)
+			{
+				success = OSPDispenseStrongPassword(
+					name.c_str(), name.size(), &cipher, password, sizeof(password), &TestError
+				);
+			}
+
+			OSPSetPadding(OSP_PADDING_MAX_DATA_SIZE);
+
+			Assert::IsTrue(success, L"Store/Dispense failed");
+			Assert::IsTrue(PasswordA.compare(password) == 0, L"Password not dispensed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Storage_Test0)
+			TEST_DESCRIPTION(L"Store and dispense with GCM storage, which leaves room for its nonce and tag.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_Storage_Test0)
+		{
+			const string name = "test";
+
+			bool success;
+
+			Assert::AreEqual(OSP_STORAGE_CBC, OSPStorage(), L"Not CBC by default");
+
+			// Room for the password with the nonce and tag
+			success = OSPInit(2, 2 * OSPMinLength(), &TestError);
+			Assert::IsTrue(success, L"Initialize failed, see OSPDLL_Initialize_Test0");
+
+			size_t maxlength = OSPMaxLength();
+
+			OSPSetStorage(OSP_STORAGE_GCM);
+			Assert::AreEqual(OSP_STORAGE_GCM, OSPStorage(), L"Storage not set");
+			// A 12 byte nonce and a 16 byte tag
+			Assert::AreEqual(maxlength - 28 / sizeof(char), OSPMaxLength(), L"Wrong max length");
+
+			DECLARE_OSPCipher(cipher);
+			Setup(cipher);
+
+			{
+				char password[SizeA];
+				memset(password, 0, sizeof(password));
+				memcpy(password, PasswordA.c_str(), std::min(sizeof(password) - 1, PasswordA.size()));
+
+				success = OSPStoreStrongPassword(
+					name.c_str(), name.size(), &cipher, password, sizeof(password), &TestError
+				);
+			}
+
+			char password[SizeA];
+
+			if (success)
+			{
+				success = OSPDispenseStrongPassword(
+					name.c_str(), name.size(), &cipher, password, sizeof(password), &TestError
+				);
+			}
+
+			OSPSetStorage(OSP_STORAGE_CBC);
+
+			Assert::IsTrue(success, L"Store/Dispense failed");
+			Assert::IsTrue(PasswordA.compare(password) == 0, L"Password not dispensed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_KdfProfile_Test0)
+			TEST_DESCRIPTION(L"Legacy profile by default, invalid profiles refused, calibrated profiles set.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_KdfProfile_Test0)
+		{
+			DECLARE_OSPKdfProfile(legacy);
+			OSPKdfProfile profile;
+
+			bool success = OSPGetKdfProfile(&profile, &TestError);
+			Assert::IsTrue(success, L"1st Get failed");
+			Assert::IsTrue(0 == memcmp(&legacy, &profile, sizeof(profile)), L"Not legacy by default");
+
+			profile.Kdf = OSP_KDF_ARGON2ID;
+			profile.Iterations = 1;
+			profile.Memory = 1024;
+			profile.Parallelism = 0;
+
+			success = OSPSetKdfProfile(&profile, &TestError);
+			Assert::IsFalse(success, L"Invalid profile set");
+			Assert::AreEqual(OSP_ERROR_INVALID_KDF_PROFILE, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			profile.Parallelism = 1;
+
+			success = OSPSetKdfProfile(&profile, &TestError);
+			Assert::IsTrue(success, L"Set failed");
+
+			OSPKdfProfile current;
+			success = OSPGetKdfProfile(&current, &TestError);
+			Assert::IsTrue(success, L"2nd Get failed");
+			Assert::IsTrue(0 == memcmp(&profile, &current, sizeof(profile)), L"Profile not set");
+
+			success = OSPCalibrateKdf(OSP_KDF_PBKDF2, OSP_KDF_TARGET_BATCH, &TestError);
+			Assert::IsTrue(success, L"Calibration failed");
+			Assert::IsTrue(OSPKdfRate() > 0, L"No rate measured");
+
+			success = OSPGetKdfProfile(&current, &TestError);
+			Assert::IsTrue(success, L"3rd Get failed");
+			Assert::AreEqual(OSP_KDF_PBKDF2, current.Kdf, L"Not calibrated");
+
+			success = OSPSetKdfProfile(&legacy, &TestError);
+			Assert::IsTrue(success, L"Reset to legacy failed");
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_StrongPassword_Start_Finish_Test0)
 			TEST_DESCRIPTION(L"Add strong password one key at a time.")
 		END_TEST_METHOD_ATTRIBUTE()
@@ -377,6 +518,197 @@ namespace OneStrongPassword
 			Assert::IsTrue(strlen(gen) == 8, L"Password not the right length");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Generate_Batch_Test0)
+			TEST_DESCRIPTION(L"Generate a batch of passwords with mnemonics.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_Generate_Batch_Test0)
+		{
+			bool success = true;
+
+			DECLARE_OSPCipher(cipher);
+
+			const char name[] = "test";
+
+			StoreA(cipher, name);
+
+			DECLARE_OSPRecipe(recipe);
+			recipe.Specials = OSP_RECIPE_ALL_SUPPORTED_SPECIALS;
+			recipe.SpecialsLength = strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS);
+			recipe.Flags = OSP_RECIPE_ALPHANUMERIC;
+
+			const char mnemonic0[] = "stinkin";
+			const char mnemonic1[] = "not stinkin";
+
+			char gen0[9];
+			char gen1[17];
+
+			success = OSPGeneratePassword(
+				name, sizeof(name), mnemonic0, sizeof(mnemonic0), &cipher, gen0, sizeof(gen0) - 1, &recipe, &TestError
+			);
+			Assert::IsTrue(success, L"1st GeneratePassword failed");
+
+			success = OSPGeneratePassword(
+				name, sizeof(name), mnemonic1, sizeof(mnemonic1), &cipher, gen1, sizeof(gen1) - 1, &recipe, &TestError
+			);
+			Assert::IsTrue(success, L"2nd GeneratePassword failed");
+
+			OSPPasswordRequest requests[2];
+
+			CLEAR_OSPPasswordRequest(requests[0]);
+			requests[0].Mnemonic = mnemonic0;
+			requests[0].MnemonicLength = sizeof(mnemonic0);
+			requests[0].Length = sizeof(gen0) - 1;
+			requests[0].Recipe = recipe;
+
+			CLEAR_OSPPasswordRequest(requests[1]);
+			requests[1].Mnemonic = mnemonic1;
+			requests[1].MnemonicLength = sizeof(mnemonic1);
+			requests[1].Length = sizeof(gen1) - 1;
+			requests[1].Recipe = recipe;
+
+			char gen[sizeof(gen0) + sizeof(gen1)];
+
+			Assert::IsTrue(OSPPasswordsLength(requests, 2) == sizeof(gen), L"PasswordsLength not the right size");
+
+			success = OSPGeneratePasswords(name, sizeof(name), &cipher, requests, 2, gen, sizeof(gen), &TestError);
+
+			Assert::IsTrue(success, L"GeneratePasswords failed");
+			Assert::IsTrue(strcmp(gen, gen0) == 0, L"1st batch password differs");
+			Assert::IsTrue(strcmp(gen + sizeof(gen0), gen1) == 0, L"2nd batch password differs");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Context_Test0)
+			TEST_DESCRIPTION(L"Contexts keep separate stores and generate concurrently.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_Context_Test0)
+		{
+			bool success = true;
+
+			DECLARE_OSPCipher(cipher);
+
+			const char name[] = "test";
+
+			StoreA(cipher, name);
+
+			OSPContext* context = OSPCreateContext(&TestError);
+			Assert::IsTrue(context != nullptr, L"CreateContext failed");
+
+			success = OSPCtxInit(context, 2, OSPCtxMinLength(context), &TestError);
+			Assert::IsTrue(success, L"Context initialize failed");
+
+			DECLARE_OSPCipher(ctxcipher);
+			vector<char> ctxkey;
+
+			success = OSPCtxPrepareCipher(context, &ctxcipher, &TestError);
+			if (success)
+			{
+				ctxkey.resize(ctxcipher.Size / sizeof(char));
+				ctxcipher.Key = ctxkey.data();
+				success = OSPCtxCompleteCipher(context, &ctxcipher, &TestError);
+			}
+			Assert::IsTrue(success, L"Context cipher failed");
+
+			const string PasswordB = "This is another password, not so stinkin";
+
+			success = OSPCtxStrongPasswordStart(context, PasswordB.size(), &TestError);
+			for (size_t n = 0; success && n < PasswordB.size(); n++)
+				success = OSPCtxStrongPasswordPut(context, PasswordB[n], &TestError);
+			success = success && OSPCtxStrongPasswordFinish(context, name, strlen(name), &ctxcipher, &TestError);
+			Assert::IsTrue(success, L"Context Start/Finish failed");
+
+			const char other[] = "other";
+			Assert::IsTrue(OSPCtxStrongPasswordSize(context, other, strlen(other)) == 0, L"Other found in context");
+			Assert::IsTrue(OSPStrongPasswordSize(name, strlen(name)) != 0, L"Default context lost its password");
+
+			DECLARE_OSPRecipe(recipe);
+			recipe.Specials = OSP_RECIPE_ALL_SUPPORTED_SPECIALS;
+			recipe.SpecialsLength = strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS);
+			recipe.Flags = OSP_RECIPE_ALPHANUMERIC;
+
+			const char mnemonic[] = "stinkin";
+
+			OSPContext* contexts[] = { OSPDefaultContext(), context };
+			const OSPCipher* ciphers[] = { &cipher, &ctxcipher };
+
+			char expected[2][13];
+			for (size_t c = 0; c < 2; c++)
+			{
+				success = OSPCtxGeneratePassword(
+					contexts[c], name, sizeof(name), mnemonic, sizeof(mnemonic), ciphers[c],
+					expected[c], sizeof(expected[c]) - 1, &recipe, &TestError
+				);
+				Assert::IsTrue(success, L"GeneratePassword failed");
+			}
+			Assert::IsTrue(strcmp(expected[0], expected[1]) != 0, L"Different strong passwords, same password");
+
+			const size_t threads = 4;
+			const size_t rounds = 3;
+
+			vector<int> results(threads, 1);
+			vector<thread> workers;
+
+			for (size_t t = 0; t < threads; t++)
+			{
+				workers.emplace_back([&, t]
+				{
+					size_t c = t % 2;
+					for (size_t r = 0; results[t] && r < rounds; r++)
+					{
+						DECLARE_OSPError(error);
+						char gen[13];
+						results[t] = OSPCtxGeneratePassword(
+							contexts[c], name, sizeof(name), mnemonic, sizeof(mnemonic), ciphers[c],
+							gen, sizeof(gen) - 1, &recipe, &error
+						) && strcmp(gen, expected[c]) == 0;
+					}
+				});
+			}
+
+			for (auto& worker : workers)
+				worker.join();
+
+			for (size_t t = 0; t < threads; t++)
+				Assert::IsTrue(results[t] != 0, L"Concurrent GeneratePassword failed or differs");
+
+			success = OSPDestroyContext(OSPDefaultContext(), &TestError);
+			Assert::IsFalse(success, L"Destroying the default context should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_BAD_POINTER, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			success = OSPDestroyContext(context, &TestError);
+			Assert::IsTrue(success, L"DestroyContext failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Context_Test1)
+			TEST_DESCRIPTION(L"A null context fails with a null pointer error instead of crashing.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OSPDLL_Context_Test1)
+		{
+			bool success = OSPCtxInit(nullptr, 2, OSPMinLength(), &TestError);
+			Assert::IsFalse(success, L"Initializing a null context should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_NULL_POINTER, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			DECLARE_OSPCipher(cipher);
+			success = OSPCtxPrepareCipher(nullptr, &cipher, &TestError);
+			Assert::IsFalse(success, L"Preparing a cipher in a null context should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_NULL_POINTER, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			success = OSPDestroyContext(nullptr, &TestError);
+			Assert::IsFalse(success, L"Destroying a null context should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_NULL_POINTER, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			Assert::IsTrue(OSPCtxMaxLength(nullptr) == 0, L"Null context has a max length");
+			Assert::IsTrue(OSPCtxThreads(nullptr) == 0, L"Null context has threads");
+			OSPCtxSetPadding(nullptr, OSP_PADDING_SIZE_CLASS);
+			OSPCtxStopThreads(nullptr);
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(OSPDLL_Clipboard_Test0)
 			TEST_DESCRIPTION(L"Generate password to clipboard.")
 		END_TEST_METHOD_ATTRIBUTE()
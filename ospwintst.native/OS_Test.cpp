@@ -23,6 +23,14 @@ Software.
 #include "CppUnitTest.h"
 
 #include <stack>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/capability.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "../osp/os.h"
 
@@ -198,6 +206,61 @@ namespace OneStrongPassword
 			Logger::WriteMessage("\n");
 		}
 
+#ifdef __linux__
+		BEGIN_TEST_METHOD_ATTRIBUTE(OS_Alloc_Memlock_Test0)
+			TEST_DESCRIPTION(L"Initialize and Alloc past a small memlock limit without CAP_IPC_LOCK")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(OS_Alloc_Memlock_Test0)
+		{
+			const size_t maxsize = 64 * 1024;
+			const size_t count = 64;
+
+			// Drop CAP_IPC_LOCK from the effective set, it stays permitted so it can come back
+			__user_cap_header_struct header = { _LINUX_CAPABILITY_VERSION_3, 0 };
+			__user_cap_data_struct caps[_LINUX_CAPABILITY_U32S_3] = {};
+			Assert::AreEqual(0L, syscall(SYS_capget, &header, caps), L"capget failed");
+			__user_cap_data_struct dropped[_LINUX_CAPABILITY_U32S_3];
+			memcpy(dropped, caps, sizeof(caps));
+			dropped[CAP_TO_INDEX(CAP_IPC_LOCK)].effective &= ~CAP_TO_MASK(CAP_IPC_LOCK);
+			Assert::AreEqual(0L, syscall(SYS_capset, &header, dropped), L"capset failed");
+
+			rlimit limit;
+			getrlimit(RLIMIT_MEMLOCK, &limit);
+			rlimit small = limit;
+			small.rlim_cur = 64 * 1024;
+			Assert::AreEqual(0, setrlimit(RLIMIT_MEMLOCK, &small), L"setrlimit failed");
+
+			{
+				OS os;
+				bool success = os.Initialize(count, maxsize, &TestError);
+				Assert::IsTrue(success, L"Initialize failed under the memlock limit");
+				Assert::IsTrue(os.MemoryLocked(), L"Nothing handed out yet");
+
+				std::vector<OS::byte*> ptrs;
+				for (size_t n = 0; n < count; n++)
+				{
+					OS::byte* ptr = os.Alloc(maxsize, &TestError);
+					Assert::IsTrue(nullptr != ptr, L"Alloc failed under the memlock limit");
+					memset(ptr, 0x5A, maxsize);
+					ptrs.push_back(ptr);
+				}
+				Assert::AreEqual((size_t)0, os.AvailableMemory(), L"Memory not allocated");
+				Assert::IsFalse(os.MemoryLocked(), L"Blocks past the limit reported as locked");
+
+				for (OS::byte*& ptr : ptrs)
+					os.Destroy(ptr, maxsize, &TestError);
+				Assert::AreEqual(count*maxsize, os.AvailableMemory(), L"Memory not freed");
+
+				success = os.Destroy(&TestError);
+				Assert::IsTrue(success, L"Destroy failed");
+			}
+
+			setrlimit(RLIMIT_MEMLOCK, &limit);
+			syscall(SYS_capset, &header, caps);
+		}
+#endif
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(OS_Clipboard_Test0)
 			TEST_DESCRIPTION(L"Copy to and Paste from clipboard")
 		END_TEST_METHOD_ATTRIBUTE()
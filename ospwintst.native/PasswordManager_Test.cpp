@@ -152,6 +152,38 @@ namespace OneStrongPassword
 			Assert::AreEqual(maxlength, manager.MaxLength(), L"Wrong max length");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(PasswordManager_Initialize_Calibrate_Test0)
+			TEST_DESCRIPTION(L"Initialize calibrates the KDF profile once.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(PasswordManager_Initialize_Calibrate_Test0)
+		{
+			bool success;
+
+			PasswordManager manager;
+
+			success = manager.KdfCalibration(OSP_KDF_ARGON2ID + 1, OSP_KDF_TARGET_BATCH, &TestError);
+			Assert::IsFalse(success, L"Unknown function taken");
+			Assert::AreEqual(OSP_ERROR_INVALID_KDF_PROFILE, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			success = manager.KdfCalibration(OSP_KDF_PBKDF2, OSP_KDF_TARGET_BATCH, &TestError);
+			Assert::IsTrue(success, L"Calibration not set");
+
+			success = manager.Initialize(2, manager.MinLength(), &TestError);
+			Assert::IsTrue(success, L"Initialize failed");
+			Assert::AreEqual(OSP_KDF_PBKDF2, manager.KdfProfile().Kdf, L"Not calibrated");
+			Assert::IsTrue(manager.KdfRate() > 0, L"No rate measured");
+
+			const OSPKdfProfile calibrated = manager.KdfProfile();
+
+			success = manager.Destroy(&TestError) && manager.Initialize(2, manager.MinLength(), &TestError);
+			Assert::IsTrue(success, L"2nd Initialize failed");
+			Assert::IsTrue(
+				0 == memcmp(&calibrated, &manager.KdfProfile(), sizeof(calibrated)), L"Calibrated again"
+			);
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(PasswordManager_Reset_Test0)
 			TEST_DESCRIPTION(L"Initialize then Reset")
 		END_TEST_METHOD_ATTRIBUTE()
@@ -553,6 +585,145 @@ namespace OneStrongPassword
 			}
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(PasswordManager_Generate_Batch_Test0)
+			TEST_DESCRIPTION(L"Generate a batch of passwords with mixed lengths and recipes, serially and on threads.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(PasswordManager_Generate_Batch_Test0)
+		{
+			bool success = true;
+
+			PasswordManager manager;
+
+			DECLARE_OSPCipher(cipher);
+
+			const char* name = "test";
+
+			StoreA(manager, cipher, name);
+
+			DECLARE_OSPRecipe(recipe);
+			recipe.Specials = OSP_RECIPE_ALL_SUPPORTED_SPECIALS;
+			recipe.SpecialsLength = strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS);
+			recipe.Flags = OSP_RECIPE_ALPHANUMERIC;
+
+			DECLARE_OSPRecipe(numeric);
+			numeric.Flags = OSP_RECIPE_NUMERIC;
+
+			const char* mnemonics[] = { "password", "secret", "stinkin", "not stinkin", "password" };
+			const size_t lengths[] = { 8, 8, 12, 20, 6 };
+			const OSPRecipe* recipes[] = { &recipe, &recipe, &recipe, &recipe, &numeric };
+			const size_t count = _countof(mnemonics);
+
+			OSPPasswordRequest requests[count];
+			for (size_t n = 0; n < count; n++)
+			{
+				CLEAR_OSPPasswordRequest(requests[n]);
+				requests[n].Mnemonic = mnemonics[n];
+				requests[n].MnemonicLength = strlen(mnemonics[n]);
+				requests[n].Length = lengths[n];
+				requests[n].Recipe = *recipes[n];
+			}
+
+			vector<string> expected;
+			for (size_t n = 0; n < count; n++)
+			{
+				PasswordArray<32> gen;
+				success = manager.GeneratePassword(name, mnemonics[n], cipher, gen, lengths[n], *recipes[n], &TestError);
+				Assert::IsTrue(success, L"GeneratePassword failed");
+				expected.push_back(string(gen));
+				manager.DestroyPassword(gen, &TestError);
+			}
+
+			Assert::IsTrue(expected[0] == "KF>DQr}Q", L"Password not as expected");
+			Assert::IsTrue(expected[1] == "\\G8?eY2#", L"Password not as expected");
+
+			size_t size = PasswordManager::PasswordsLength(requests, count);
+			Assert::IsTrue(size == 59, L"PasswordsLength not the right size");
+
+			{
+				PasswordArray<58> gen;
+				success = manager.GeneratePasswords(name, cipher, requests, count, gen, &TestError);
+				Assert::IsFalse(success, L"GeneratePasswords should not have succeeded");
+				Assert::IsTrue(TestError.Code == OSP_ERROR_BUFFER_TOO_SMALL, L"Wrong error");
+				CLEAR_OSPError(TestError);
+			}
+
+			char pw[64];
+
+			for (size_t threads = 0; threads <= 2; threads += 2)
+			{
+				if (threads)
+				{
+					success = manager.StartThreads(threads, &TestError);
+					Assert::IsTrue(success, L"StartThreads failed");
+					Assert::IsTrue(manager.Threads() == threads, L"Wrong number of threads");
+				}
+
+				PasswordVector gen(nullptr, pw, size);
+
+				success = manager.GeneratePasswords(name, cipher, requests, count, gen, &TestError);
+				Assert::IsTrue(success, L"GeneratePasswords failed");
+
+				const char* password = pw;
+				for (size_t n = 0; n < count; n++)
+				{
+					Assert::IsTrue(strlen(password) == lengths[n], L"Password not the right length");
+					Assert::IsTrue(expected[n] == password, L"Batch password differs from single password");
+					password += lengths[n] + 1;
+				}
+
+				manager.ReleasePassword(gen, &TestError);
+			}
+
+			manager.StopThreads();
+			Assert::IsTrue(manager.Threads() == 0, L"Threads not stopped");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(PasswordManager_Generate_Batch_Test1)
+			TEST_DESCRIPTION(L"Batches whose lengths wrap a size_t are refused, not written past the buffer.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(PasswordManager_Generate_Batch_Test1)
+		{
+			bool success = true;
+
+			PasswordManager manager;
+
+			DECLARE_OSPCipher(cipher);
+
+			const char* name = "test";
+
+			StoreA(manager, cipher, name);
+
+			DECLARE_OSPRecipe(recipe);
+			recipe.Flags = OSP_RECIPE_ALPHANUMERIC;
+
+			// Lengths that wrap to a total that fits, and a length with no room for its terminator
+			const size_t lengths[][2] = { { SIZE_MAX / 2, SIZE_MAX / 2 + 3 }, { 8, SIZE_MAX } };
+
+			for (auto& pair : lengths)
+			{
+				OSPPasswordRequest requests[2];
+				for (size_t n = 0; n < 2; n++)
+				{
+					CLEAR_OSPPasswordRequest(requests[n]);
+					requests[n].Mnemonic = "password";
+					requests[n].MnemonicLength = strlen(requests[n].Mnemonic);
+					requests[n].Length = pair[n];
+					requests[n].Recipe = recipe;
+				}
+
+				Assert::IsTrue(PasswordManager::PasswordsLength(requests, 2) == SIZE_MAX, L"PasswordsLength wrapped");
+
+				PasswordArray<64> gen;
+				success = manager.GeneratePasswords(name, cipher, requests, 2, gen, &TestError);
+				Assert::IsFalse(success, L"GeneratePasswords should not have succeeded");
+				Assert::IsTrue(TestError.Code == OSP_ERROR_BUFFER_TOO_SMALL, L"Wrong error");
+				Assert::IsTrue(gen.Zeroed(), L"Passwords written");
+				CLEAR_OSPError(TestError);
+			}
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(PasswordManager_Clipboard_Test0)
 			TEST_DESCRIPTION(L"Generate password to clipboard.")
 		END_TEST_METHOD_ATTRIBUTE()
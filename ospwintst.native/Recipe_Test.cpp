@@ -22,8 +22,12 @@ Software.
 
 #include "CppUnitTest.h"
 
+#include <chrono>
 #include <stack>
+#include <string>
+#include <vector>
 
+#include "../osp/drbg.h"
 #include "../osp/strongpassword.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -69,6 +73,89 @@ namespace OneStrongPassword
 			generated.Release();
 		 }
 
+		// Verified the way it was before recipes were compiled
+		static bool ReferenceVerified(const OSPRecipe& recipe, const char* password, size_t length)
+		{
+			bool numeric = !(recipe.Flags & OSP_RECIPE_NUMERIC_REQUIRED);
+			bool lowerCase = !(recipe.Flags & OSP_RECIPE_LOWERCASE_REQUIRED);
+			bool upperCase = !(recipe.Flags & OSP_RECIPE_UPPERCASE_REQUIRED);
+			bool special = !(recipe.Flags & OSP_RECIPE_SPECIAL_REQUIRED);
+
+			std::string specials;
+			if (recipe.Specials)
+				specials = recipe.Specials;
+
+			bool verified = numeric && lowerCase && upperCase && special;
+
+			for (size_t n = 0; !verified && n < length; n++)
+			{
+				char ch = password[n];
+
+				numeric = numeric || (ch >= '0' && ch <= '9');
+				lowerCase = lowerCase || (ch >= 'a' && ch <= 'z');
+				upperCase = upperCase || (ch >= 'A' && ch <= 'Z');
+				special = special || (specials.find(ch) < specials.size());
+
+				verified = numeric && lowerCase && upperCase && special;
+			}
+
+			return verified;
+		}
+
+		// Fills text from a fixed keystream, mostly characters a recipe may have
+		static void Text(uint32_t counter, char* const text, size_t length)
+		{
+			Drbg::byte key[Drbg::KEY_SIZE] = { 1 };
+			Drbg::byte nonce[Drbg::NONCE_SIZE] = { 0 };
+			Drbg::byte block[Drbg::BLOCK_SIZE];
+
+			for (size_t n = 0; n < length; n++)
+			{
+				if (n % sizeof(block) == 0)
+					Drbg::ChaCha20(key, nonce, counter++, block, 1);
+
+				Drbg::byte b = block[n % sizeof(block)];
+				text[n] = b < 0xF0 ? char(' ' + b % 95) : char(b);
+			}
+		}
+
+		// Samples count characters from a fixed keystream, returning the bytes it took
+		size_t Sample(const Recipe& recipe, uint32_t generator, size_t count, std::vector<size_t>& counts)
+		{
+			Drbg::byte key[Drbg::KEY_SIZE] = { 0 };
+			Drbg::byte nonce[Drbg::NONCE_SIZE] = { 0 };
+			Drbg::byte block[Drbg::BLOCK_SIZE];
+
+			counts.assign(128, 0);
+
+			Sampler sampler(recipe, generator);
+			uint32_t counter = 0;
+			size_t pos = sizeof(block);
+
+			for (size_t n = 0; n < count; )
+			{
+				while (sampler.Hungry())
+				{
+					if (pos == sizeof(block))
+					{
+						Drbg::ChaCha20(key, nonce, counter++, block, 1);
+						pos = 0;
+					}
+					sampler.Feed(block[pos++]);
+				}
+
+				char ch;
+				if (sampler.Next(ch))
+				{
+					Assert::IsTrue(recipe.HasChar(ch), L"Sampled a character not in the recipe");
+					counts[size_t(ch)]++;
+					n++;
+				}
+			}
+
+			return sampler.Fed();
+		}
+
 		TEST_METHOD_CLEANUP(MethodCleanup)
 		{
 			if (ciphercleanup)
@@ -275,5 +362,393 @@ namespace OneStrongPassword
 			Assert::IsTrue(strncmp(gen0, gen1, sizeof(gen0)) == 0, L"Different passwords created");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Alphabet_Test0)
+			TEST_DESCRIPTION(L"The alphabet is the recipe's characters in order.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Alphabet_Test0)
+		{
+			Recipe recipe({ "!", 1, OSP_RECIPE_NUMERIC | OSP_RECIPE_UPPERCASE });
+			Assert::AreEqual(size_t(37), recipe.AlphabetSize(), L"Wrong alphabet size");
+			Assert::AreEqual('!', recipe.Alphabet()[0], L"Wrong first character");
+			Assert::AreEqual('0', recipe.Alphabet()[1], L"Wrong digit");
+			Assert::AreEqual('Z', recipe.Alphabet()[36], L"Wrong last character");
+
+			recipe.AddFlags(OSP_RECIPE_SPACE_ALLOWED);
+			Assert::AreEqual(size_t(38), recipe.AlphabetSize(), L"Space not added");
+			Assert::AreEqual(' ', recipe.Alphabet()[0], L"Space not first");
+
+			recipe.Clear();
+			Assert::AreEqual(size_t(0), recipe.AlphabetSize(), L"Alphabet not cleared");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Sampler_Test0)
+			TEST_DESCRIPTION(L"Uniform sampling is uniform and takes fewer bytes per character than legacy.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Sampler_Test0)
+		{
+			// Chi-square critical values at p = 0.001 for the alphabet size less one
+			typedef struct Case { const char* Name; OSPRecipe Recipe; double Critical; } Case;
+
+			const Case cases[] = {
+				{ "numeric", { nullptr, 0, OSP_RECIPE_NUMERIC }, 27.88 },
+				{ "lowercase", { nullptr, 0, OSP_RECIPE_LOWERCASE }, 54.05 },
+				{ "alphanumeric", { nullptr, 0, OSP_RECIPE_ALPHANUMERIC }, 100.89 },
+				{ "all", {
+					OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				}, 140.17 }
+			};
+
+			const size_t count = 100000;
+
+			std::string message = "Hash bytes per character legacy/uniform:";
+
+			for (const Case& c : cases)
+			{
+				Recipe recipe(c.Recipe);
+				std::vector<size_t> counts;
+
+				size_t legacy = Sample(recipe, OSP_GENERATOR_LEGACY, count, counts);
+				size_t uniform = Sample(recipe, OSP_GENERATOR_UNIFORM, count, counts);
+
+				Assert::IsTrue(uniform < legacy, L"Uniform took more bytes");
+
+				double expected = double(count) / recipe.AlphabetSize();
+				double chi = 0;
+				for (size_t n = 0; n < recipe.AlphabetSize(); n++)
+				{
+					double d = counts[size_t(recipe.Alphabet()[n])] - expected;
+					chi += d * d / expected;
+				}
+				Assert::IsTrue(chi < c.Critical, L"Uniform sampling is not uniform");
+
+				message += std::string(" ") + c.Name + " " +
+					std::to_string(double(legacy) / count) + "/" + std::to_string(double(uniform) / count);
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Classes_Test0)
+			TEST_DESCRIPTION(L"Compiled classification agrees with checking a character at a time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Classes_Test0)
+		{
+			const uint32_t required =
+				OSP_RECIPE_NUMERIC_REQUIRED | OSP_RECIPE_LOWERCASE_REQUIRED |
+				OSP_RECIPE_UPPERCASE_REQUIRED | OSP_RECIPE_SPECIAL_REQUIRED;
+
+			const OSPRecipe recipes[] = {
+				{ nullptr, 0, OSP_RECIPE_NUMERIC | OSP_RECIPE_NUMERIC_REQUIRED },
+				{ "!?", 2, OSP_RECIPE_LOWERCASE | OSP_RECIPE_SPECIAL_REQUIRED },
+				{ "!?", 2, OSP_RECIPE_ALPHANUMERIC | required },
+				{ "~", 1, OSP_RECIPE_UPPERCASE | OSP_RECIPE_SPACE_ALLOWED | OSP_RECIPE_SPECIAL_REQUIRED },
+				{ OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC | required },
+				{ "!\xE9", 2, OSP_RECIPE_ALPHANUMERIC | required }
+			};
+
+			char text[300];
+			uint32_t counter = 0;
+
+			for (const OSPRecipe& r : recipes)
+			{
+				Recipe recipe(r);
+
+				for (size_t length = 0; length <= sizeof(text); length += 1 + length / 8)
+				{
+					for (int round = 0; round < 8; round++)
+					{
+						Text(counter, text, length);
+						counter += 8;
+
+						// Short and long runs of the recipe's own characters as well
+						if (round & 1)
+						{
+							for (size_t n = 0; n < length; n++)
+								text[n] = recipe.Alphabet()[size_t(text[n] & 0x7F) % recipe.AlphabetSize()];
+						}
+
+						bool allowed = true;
+						uint32_t classes = 0;
+						for (size_t n = 0; n < length; n++)
+						{
+							char ch = text[n];
+							allowed = allowed && recipe.HasChar(ch);
+							classes |= ch >= '0' && ch <= '9' ? OSP_RECIPE_NUMERIC_REQUIRED : 0;
+							classes |= ch >= 'a' && ch <= 'z' ? OSP_RECIPE_LOWERCASE_REQUIRED : 0;
+							classes |= ch >= 'A' && ch <= 'Z' ? OSP_RECIPE_UPPERCASE_REQUIRED : 0;
+							classes |= ch && memchr(r.Specials, ch, r.SpecialsLength) ? OSP_RECIPE_SPECIAL_REQUIRED : 0;
+						}
+
+						Assert::AreEqual(classes, recipe.Classes(text, length), L"Classes differ");
+						Assert::AreEqual(allowed, recipe.Allowed(text, length), L"Allowed differs");
+						Assert::AreEqual(
+							ReferenceVerified(r, text, length), recipe.Verified(text, length), L"Verified differs"
+						);
+					}
+				}
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Verified_Benchmark0)
+			TEST_DESCRIPTION(L"Verified compiled versus a string search per character, 8 to 4096 characters.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Verified_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			OSPRecipe r = {
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS,
+				strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS),
+				OSP_RECIPE_ALPHANUMERIC | OSP_RECIPE_SPECIAL_REQUIRED
+			};
+			Recipe recipe(r);
+
+			// Nothing special, so every character is looked at
+			const char* alphanumerics = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+			std::vector<char> text(4096);
+			for (size_t n = 0; n < text.size(); n++)
+				text[n] = alphanumerics[(n * 7) % 62];
+
+			std::string message = "Verified ns reference/compiled:";
+
+			for (size_t length = 8; length <= text.size(); length *= 8)
+			{
+				const size_t rounds = (1 << 22) / length;
+				size_t verified[2] = { 0, 0 };
+				double ns[2];
+
+				auto t0 = Clock::now();
+				for (size_t n = 0; n < rounds; n++)
+					verified[0] += ReferenceVerified(r, text.data(), length);
+				auto t1 = Clock::now();
+				for (size_t n = 0; n < rounds; n++)
+					verified[1] += recipe.Verified(text.data(), length);
+				auto t2 = Clock::now();
+
+				Assert::AreEqual(verified[0], verified[1], L"Verified differs");
+
+				ns[0] = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+				ns[1] = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds;
+
+				message += " " + std::to_string(length) + " " +
+					std::to_string(int(ns[0])) + "/" + std::to_string(int(ns[1]));
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		template<typename Policy> void TestStatic(const OSPRecipe& r)
+		{
+			const Recipe::Tables& compiled = Policy::Compiled();
+			Recipe recipe(r);
+			const Recipe::Tables& built = recipe.Compiled();
+
+			Assert::AreEqual(built.Flags, compiled.Flags, L"Flags differ");
+			Assert::AreEqual(built.AlphabetSize, compiled.AlphabetSize, L"Alphabets differ");
+			Assert::IsTrue(memcmp(built.CharSet, compiled.CharSet, sizeof(built.CharSet)) == 0, L"Char sets differ");
+			Assert::IsTrue(memcmp(built.Alphabet, compiled.Alphabet, sizeof(built.Alphabet)) == 0, L"Alphabets differ");
+			Assert::IsTrue(memcmp(built.Table, compiled.Table, sizeof(built.Table)) == 0, L"Tables differ");
+			Assert::IsTrue(memcmp(built.Nibbles, compiled.Nibbles, sizeof(built.Nibbles)) == 0, L"Nibbles differ");
+
+			Recipe runtime = Policy::Runtime();
+			Assert::AreEqual(built.Flags, runtime.Compiled().Flags, L"Runtime recipe differs");
+			Assert::IsTrue(Policy::Verified("a1B!", 4) == runtime.Verified("a1B!", 4), L"Verified differs");
+			Assert::IsTrue(Policy::Verified("abcd", 4) == runtime.Verified("abcd", 4), L"Verified differs");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Static_Test0)
+			TEST_DESCRIPTION(L"Recipes compiled at compile time match recipes built at run time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Static_Test0)
+		{
+			static_assert(PinRecipe::AlphabetSize() == 10, "PIN alphabet");
+			static_assert(PinRecipe::Alphabet()[0] == '0', "PIN alphabet");
+			static_assert(AlphanumericRecipe::AlphabetSize() == 62, "Alphanumeric alphabet");
+			static_assert(StrongRecipe::REQUIRED == Recipe::REQUIRED, "Strong requirements");
+			static_assert(StrongRecipe::HasChar('~') && !StrongRecipe::HasChar(' '), "Strong specials");
+			static_assert(
+				sizeof(StrongRecipe::SPECIALS) == sizeof(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), "Strong specials"
+			);
+
+			Assert::IsTrue(
+				strcmp(OSP_RECIPE_ALL_SUPPORTED_SPECIALS, StrongRecipe::SPECIALS) == 0, L"Strong specials differ"
+			);
+
+			TestStatic<PinRecipe>({ nullptr, 0, OSP_RECIPE_NUMERIC });
+			TestStatic<AlphanumericRecipe>({ nullptr, 0, OSP_RECIPE_ALPHANUMERIC });
+			TestStatic<StrongRecipe>({
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS,
+				strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS),
+				OSP_RECIPE_ALPHANUMERIC | Recipe::REQUIRED
+			});
+
+			// Requirements without the classes are dropped the same way
+			TestStatic<StaticRecipe<OSP_RECIPE_LOWERCASE | OSP_RECIPE_NUMERIC_REQUIRED, ' ', '!'>>({
+				" !", 2, OSP_RECIPE_LOWERCASE | OSP_RECIPE_NUMERIC_REQUIRED
+			});
+		}
+
+		// Legacy samples a byte at a time, the way Accept has to match
+		static size_t ReferenceAccept(
+			const Recipe& recipe, const Recipe::byte* bytes, size_t count, char* const out, size_t room, size_t& used
+		) {
+			Sampler sampler(recipe, OSP_GENERATOR_LEGACY);
+			size_t taken = 0;
+			for (used = 0; used < count && taken < room; used++)
+			{
+				char ch;
+				sampler.Feed(bytes[used]);
+				if (sampler.Next(ch))
+					out[taken++] = ch;
+			}
+			return taken;
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Accept_Test0)
+			TEST_DESCRIPTION(L"Accepting a block at a time matches legacy sampling a byte at a time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Accept_Test0)
+		{
+			const char* all = OSP_RECIPE_ALL_SUPPORTED_SPECIALS;
+			const size_t blocks = 1 << 21;
+
+			std::vector<size_t> widths = { 1 };
+			for (size_t width : { 32, 64 })
+			{
+				if (width <= Sampler::Width())
+					widths.push_back(width);
+			}
+
+			Drbg::byte key[Drbg::KEY_SIZE] = { 2 };
+			Drbg::byte nonce[Drbg::NONCE_SIZE] = { 0 };
+			Drbg::byte hash[Drbg::BLOCK_SIZE];
+			Drbg::byte pick[Drbg::BLOCK_SIZE];
+
+			Recipe recipe;
+			std::string specials;
+
+			char expected[Drbg::BLOCK_SIZE + 8];
+			char got[Drbg::BLOCK_SIZE + 8];
+
+			for (uint32_t n = 0; n < blocks; n++)
+			{
+				Drbg::ChaCha20(key, nonce, 2 * n, hash, 1);
+				Drbg::ChaCha20(key, nonce, 2 * n + 1, pick, 1);
+
+				// A new recipe every so often, any flags and any of the specials
+				if (n % 64 == 0)
+				{
+					specials.clear();
+					for (size_t c = 0; c < strlen(all); c++)
+					{
+						if (pick[8 + c] & 1)
+							specials += all[c];
+					}
+					recipe.Reset({ specials.data(), specials.size(), uint32_t(pick[0]) });
+				}
+
+				size_t start = pick[1] % 16 == 0 ? pick[2] % sizeof(hash) : 0;
+				size_t room = 1 + pick[3] % (sizeof(hash) + 4);
+
+				size_t used0;
+				size_t taken0 = ReferenceAccept(recipe, hash + start, sizeof(hash) - start, expected, room, used0);
+
+				for (size_t width : widths)
+				{
+					Sampler sampler(recipe, OSP_GENERATOR_LEGACY);
+
+					size_t used;
+					size_t taken = sampler.Accept(hash + start, sizeof(hash) - start, got, room, used, width);
+
+					Assert::AreEqual(taken0, taken, L"Accepted a different number of characters");
+					Assert::AreEqual(used0, used, L"Used a different number of bytes");
+					Assert::IsTrue(memcmp(expected, got, taken) == 0, L"Accepted different characters");
+					Assert::AreEqual(used, sampler.Fed(), L"Fed count differs");
+				}
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(Recipe_Accept_Benchmark0)
+			TEST_DESCRIPTION(L"Legacy acceptance of 64 byte hashes, a byte at a time versus the vector kernels.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(Recipe_Accept_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			typedef struct Density { const char* Name; OSPRecipe Recipe; } Density;
+
+			const Density densities[] = {
+				{ "numeric", { nullptr, 0, OSP_RECIPE_NUMERIC } },
+				{ "alphanumeric", { nullptr, 0, OSP_RECIPE_ALPHANUMERIC } },
+				{ "all", {
+					OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				} }
+			};
+
+			const size_t blocks = 1 << 12;
+			const size_t rounds = 64;
+
+			std::vector<Drbg::byte> hashes(blocks * Drbg::BLOCK_SIZE);
+			Drbg::byte key[Drbg::KEY_SIZE] = { 3 };
+			Drbg::byte nonce[Drbg::NONCE_SIZE] = { 0 };
+			Drbg::ChaCha20(key, nonce, 0, hashes.data(), blocks);
+
+			char out[Drbg::BLOCK_SIZE];
+
+			std::string message = "Legacy acceptance ns per hash, widths";
+
+			std::vector<size_t> widths = { 1 };
+			for (size_t width : { 32, 64 })
+			{
+				if (width <= Sampler::Width())
+					widths.push_back(width);
+			}
+			for (size_t width : widths)
+				message += " " + std::to_string(width);
+			message += ":";
+
+			for (const Density& density : densities)
+			{
+				Recipe recipe(density.Recipe);
+				message += std::string(" ") + density.Name;
+
+				size_t check = 0;
+				for (size_t width : widths)
+				{
+					size_t taken = 0;
+
+					auto t0 = Clock::now();
+					for (size_t r = 0; r < rounds; r++)
+					{
+						for (size_t b = 0; b < blocks; b++)
+						{
+							Sampler sampler(recipe, OSP_GENERATOR_LEGACY);
+							size_t used;
+							taken += sampler.Accept(
+								&hashes[b * Drbg::BLOCK_SIZE], Drbg::BLOCK_SIZE, out, sizeof(out), used, width
+							);
+						}
+					}
+					auto t1 = Clock::now();
+
+					Assert::IsTrue(check == 0 || check == taken, L"Kernels accepted different counts");
+					check = taken;
+
+					double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (rounds * blocks);
+					message += (width == 1 ? " " : "/") + std::to_string(int(ns + 0.5));
+				}
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
 	};
 }
\ No newline at end of file
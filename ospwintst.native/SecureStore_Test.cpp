@@ -23,7 +23,13 @@ Software.
 #include <Windows.h>
 #include "CppUnitTest.h"
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <stack>
+#include <thread>
+#include <vector>
 
 #include "../osp/securestore.h"
 
@@ -1021,6 +1027,507 @@ namespace OneStrongPassword
 			Logger::WriteMessage("\n");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Padding_Test0)
+			TEST_DESCRIPTION(L"Size class padding stores an entry in the smallest block multiple with room for salt.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Padding_Test0)
+		{
+			bool success = true;
+
+			string name = "test";
+
+			SecureStore store(2, 4 * BLOCK_SIZE, &TestError);
+			Assert::AreEqual(OSP_PADDING_MAX_DATA_SIZE, store.Padding(), L"Not padded to MaxDataSize by default");
+			Assert::AreEqual(store.MaxDataSize(), store.EntrySize(DATA_SIZE), L"Entry not MaxDataSize");
+
+			store.Padding(OSP_PADDING_SIZE_CLASS);
+			size_t entrysize = store.EntrySize(DATA_SIZE);
+			Assert::IsTrue(entrysize >= DATA_SIZE + store.BlockSize(), L"No room for salt");
+			Assert::IsTrue(entrysize < DATA_SIZE + 2 * store.BlockSize(), L"Entry not the smallest size class");
+			Assert::IsTrue(entrysize % store.BlockSize() == 0, L"Entry not a block multiple");
+			Assert::AreEqual(store.MaxDataSize(), store.EntrySize(store.MaxDataSize()), L"Entry larger than MaxDataSize");
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			size_t available = store.AvailableMemory();
+
+			StoreTestA(store, cipher, name);
+
+			Assert::AreEqual(available - entrysize, store.AvailableMemory(), L"Entry not right sized");
+			Assert::AreEqual(size_t(DATA_SIZE), store.DataSize(name), L"Size not stored");
+
+			{
+				ByteArray<DATA_SIZE> dispensed;
+				success = store.DispenseData(name, cipher, dispensed, &TestError);
+				Assert::IsTrue(success, L"Dispense failed");
+				Assert::IsTrue(memcmp(TestDataA, (byte*)dispensed, TestDataA.Size()) == 0, L"Dispense did not return data");
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+			}
+
+			Assert::AreEqual(available, store.AvailableMemory(), L"Entry not freed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Storage_Test0)
+			TEST_DESCRIPTION(L"CBC and GCM entries kept in the same store are each dispensed the way they were stored.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Storage_Test0)
+		{
+			bool success = true;
+
+			string name0 = "test0";
+			string name1 = "test1";
+
+			SecureStore store(2, BLOCK_SIZE, &TestError);
+			Assert::AreEqual(OSP_STORAGE_CBC, store.Storage(), L"Not CBC by default");
+			Assert::AreEqual(store.MaxDataSize(), store.MaxEntryDataSize(), L"CBC entry not MaxDataSize");
+
+			DECLARE_OSPCipher(c0);
+			Cipher cipher0(store, c0);
+			Setup(cipher0);
+
+			DECLARE_OSPCipher(c1);
+			Cipher cipher1(store, c1);
+			Setup(cipher1);
+
+			size_t available = store.AvailableMemory();
+
+			store.Storage(OSP_STORAGE_GCM);
+			Assert::AreEqual(OSP_STORAGE_GCM, store.Storage(), L"Storage not set");
+			Assert::AreEqual(
+				store.MaxDataSize() - SecureStore::NONCE_SIZE - SecureStore::TAG_SIZE,
+				store.MaxEntryDataSize(),
+				L"No room for nonce and tag"
+			);
+
+			StoreTestA(store, cipher0, name0);
+
+			store.Storage(OSP_STORAGE_CBC);
+			StoreTestB(store, cipher1, name1);
+
+			Assert::AreEqual(available - 2 * store.EntrySize(DATA_SIZE), store.AvailableMemory(), L"Entries not right sized");
+
+			{
+				ByteArray<DATA_SIZE> dispensed;
+				success = store.DispenseData(name0, cipher0, dispensed, &TestError);
+				Assert::IsTrue(success, L"Dispensing GCM entry failed");
+				Assert::IsTrue(memcmp(TestDataA, (byte*)dispensed, TestDataA.Size()) == 0, L"Dispense did not return data");
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+			}
+
+			{
+				ByteArray<DATA_SIZE> dispensed;
+				success = store.DispenseData(name1, cipher1, dispensed, &TestError);
+				Assert::IsTrue(success, L"Dispensing CBC entry failed");
+				Assert::IsTrue(memcmp(TestDataB, (byte*)dispensed, TestDataB.Size()) == 0, L"Dispense did not return data");
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+			}
+
+			Assert::AreEqual(available, store.AvailableMemory(), L"Entries not freed");
+		}
+
+		// Seal and Unseal are protected, nothing public changes a stored entry
+		class SealingStore : public SecureStore
+		{
+		public:
+			SealingStore(size_t count, size_t maxsize, OSPError* error) : SecureStore(count, maxsize, error) { }
+
+			using SecureStore::Seal;
+			using SecureStore::Unseal;
+		};
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Storage_Test1)
+			TEST_DESCRIPTION(L"A GCM entry changed, unsealed under another name or with another cipher is refused and left stored.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Storage_Test1)
+		{
+			bool success = true;
+
+			string name = "test";
+
+			SealingStore store(4, BLOCK_SIZE, &TestError);
+			store.Storage(OSP_STORAGE_GCM);
+
+			DECLARE_OSPCipher(c0);
+			Cipher cipher0(store, c0);
+			Setup(cipher0);
+
+			ByteArray<BLOCK_SIZE> sealed;
+			{
+				ByteArray<DATA_SIZE> data;
+				data.CopyFrom(TestDataA, &TestError);
+				success = store.Seal(cipher0, name, data, sealed, &TestError);
+				Assert::IsTrue(success, L"Seal failed");
+				Assert::IsTrue(data.Zeroed(), L"Data not zeroed");
+			}
+
+			ByteArray<BLOCK_SIZE> original;
+			original.CopyFrom(sealed, &TestError);
+
+			auto refused = [&](string_view with) {
+				ByteArray<BLOCK_SIZE> decrypted;
+				CLEAR_OSPError(TestError);
+				bool failed = !store.Unseal(cipher0, with, sealed, decrypted, &TestError);
+				return failed && TestError.Code == OSP_ERROR_DATA_NOT_AUTHENTIC && decrypted.Zeroed();
+			};
+
+			// The nonce, the data, the padding and the tag
+			for (size_t pos : { size_t(0), SecureStore::NONCE_SIZE, BLOCK_SIZE - SecureStore::TAG_SIZE - 1, BLOCK_SIZE - 1 })
+			{
+				sealed[pos] ^= 0x01;
+				Assert::IsTrue(refused(name), L"Changed entry not refused");
+				sealed[pos] ^= 0x01;
+			}
+
+			Assert::IsTrue(refused("other"), L"Entry under another name not refused");
+			Assert::IsTrue(sealed == original, L"Entry changed by a refused Unseal");
+
+			CLEAR_OSPError(TestError);
+
+			{
+				ByteArray<BLOCK_SIZE> decrypted;
+				success = store.Unseal(cipher0, name, sealed, decrypted, &TestError);
+				Assert::IsTrue(success, L"Unseal failed");
+				Assert::IsTrue(memcmp(TestDataA, (byte*)decrypted, TestDataA.Size()) == 0, L"Unseal did not return data");
+				SecureStore::ReleaseDecrypted(decrypted, &TestError);
+			}
+
+			// Dispensing with the wrong cipher keeps the entry for the right one
+			StoreTestA(store, cipher0, name);
+
+			DECLARE_OSPCipher(c1);
+			Cipher cipher1(store, c1);
+			Setup(cipher1);
+
+			{
+				ByteArray<DATA_SIZE> dispensed;
+				CLEAR_OSPError(TestError);
+				success = store.DispenseData(name, cipher1, dispensed, &TestError);
+				Assert::IsFalse(success, L"Dispensed with another cipher");
+				Assert::AreEqual(OSP_ERROR_DATA_NOT_AUTHENTIC, TestError.Code, L"Wrong error");
+				Assert::AreEqual(size_t(DATA_SIZE), store.DataSize(name), L"Entry not kept");
+			}
+
+			CLEAR_OSPError(TestError);
+
+			{
+				ByteArray<DATA_SIZE> dispensed;
+				success = store.DispenseData(name, cipher0, dispensed, &TestError);
+				Assert::IsTrue(success, L"Dispense failed");
+				Assert::IsTrue(memcmp(TestDataA, (byte*)dispensed, TestDataA.Size()) == 0, L"Dispense did not return data");
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Padding_Benchmark0)
+			TEST_DESCRIPTION(L"Memory per stored entry, padded to MaxDataSize versus size class.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Padding_Benchmark0)
+		{
+			const size_t maxsize = 128;
+			const size_t entries[] = { 1000, 10000, 100000 };
+			const uint32_t paddings[] = { OSP_PADDING_MAX_DATA_SIZE, OSP_PADDING_SIZE_CLASS };
+
+			for (size_t count : entries)
+			{
+				for (uint32_t padding : paddings)
+				{
+					SecureStore store(count + 2, maxsize, &TestError);
+					store.Padding(padding);
+
+					DECLARE_OSPCipher(c);
+					Cipher cipher(store, c);
+					Setup(cipher);
+
+					bool success = true;
+
+					size_t available = store.AvailableMemory();
+
+					auto t0 = GetTickCount();
+					for (size_t n = 0; success && n < count; n++)
+					{
+						ByteArray<16> data;
+						data.CopyFrom(TestDataA, 16, 0, &TestError);
+						success = store.StoreData(to_string(n), cipher, data, 0, &TestError);
+					}
+					auto t1 = GetTickCount();
+
+					Assert::IsTrue(success, L"Store failed");
+
+					Logger::WriteMessage((
+						to_string(count) + " entries " + (padding == OSP_PADDING_SIZE_CLASS ? "size class" : "max data size") +
+						": " + to_string((available - store.AvailableMemory()) / count) + " bytes per entry, " +
+						to_string(t1 - t0) + " ms\n"
+					).c_str());
+
+					delete[] (SecureStore::byte*)ciphercleanup;
+					ciphercleanup = 0;
+				}
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Store_Benchmark0)
+			TEST_DESCRIPTION(L"Heap allocations per store and dispense of salted data.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Store_Benchmark0)
+		{
+			const size_t count = 10000;
+
+			SecureStore store(2, 128, &TestError);
+
+			bool success = true;
+
+			size_t stores = 0;
+			size_t dispenses = 0;
+
+			auto t0 = GetTickCount();
+			for (size_t n = 0; success && n < count; n++)
+			{
+				DECLARE_OSPCipher(c);
+				Cipher cipher(store, c);
+				Setup(cipher);
+
+				ByteArray<DATA_SIZE> data;
+				data.CopyFrom(TestDataA, &TestError);
+
+				size_t allocations = store.Allocations();
+				success = store.StoreData("Test", cipher, data, 0, &TestError);
+				stores += store.Allocations() - allocations;
+
+				ByteArray<DATA_SIZE> dispensed;
+				allocations = store.Allocations();
+				success = success && store.DispenseData("Test", cipher, dispensed, &TestError);
+				dispenses += store.Allocations() - allocations;
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+
+				delete[] (SecureStore::byte*)ciphercleanup;
+				ciphercleanup = 0;
+			}
+			auto t1 = GetTickCount();
+
+			Assert::IsTrue(success, L"Store/Dispense failed");
+
+			Logger::WriteMessage((
+				to_string(count) + " stores and dispenses in " + to_string(t1 - t0) + " ms, allocations per store " +
+				to_string(double(stores) / count) + ", per dispense " + to_string(double(dispenses) / count) + "\n"
+			).c_str());
+
+			Assert::AreEqual(count, stores, L"Store allocated more than the entry");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Store_Batch_Test0)
+			TEST_DESCRIPTION(L"Entries stored as a batch are salted, sized and dispensed as if stored one by one.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Store_Batch_Test0)
+		{
+			bool success = true;
+
+			const size_t count = 70;
+
+			SecureStore store(count + 2, BLOCK_SIZE, &TestError);
+			store.Padding(OSP_PADDING_SIZE_CLASS);
+
+			// Every entry is dispensed with its own cipher made from the one secret
+			vector<unique_ptr<SecureStore::byte[]>> keys;
+			auto setup = [&](Cipher& cipher) {
+				bool success = cipher.Prepare(SECRET, &TestError);
+				if (success)
+				{
+					keys.emplace_back(new SecureStore::byte[cipher.Size()]);
+					cipher.Key() = keys.back().get();
+					success = cipher.Complete(&TestError);
+				}
+				Assert::IsTrue(success, L"Creating a cipher failed, see Cipher_Test0");
+			};
+
+			vector<string> names;
+			vector<string_view> views;
+			vector<vector<SecureStore::byte>> plain(count), buffers(count);
+			deque<ByteVector> data;
+			vector<ByteVector*> datap;
+
+			size_t entries = 0;
+			for (size_t n = 0; n < count; n++)
+			{
+				names.push_back("entry" + to_string(n));
+
+				size_t size = 1 + (n * 11) % (BLOCK_SIZE - store.BlockSize());
+				plain[n].resize(size);
+				for (size_t b = 0; b < size; b++)
+					plain[n][b] = SecureStore::byte(n + 3 * b);
+				buffers[n] = plain[n];
+
+				data.emplace_back(nullptr, buffers[n].data(), size);
+				datap.push_back(&data.back());
+				entries += store.EntrySize(size);
+			}
+			for (const string& name : names)
+				views.push_back(name);
+
+			size_t available = store.AvailableMemory();
+
+			{
+				DECLARE_OSPCipher(c);
+				Cipher cipher(store, c);
+				setup(cipher);
+
+				success = store.StoreData(views.data(), cipher, datap.data(), count, &TestError);
+				Assert::IsTrue(success, L"Batch store failed");
+			}
+
+			Assert::AreEqual(available - entries, store.AvailableMemory(), L"Entries not sized as one by one");
+
+			for (size_t n = 0; n < count; n++)
+			{
+				Assert::IsTrue(data[n].Zeroed(), L"Data not cleared");
+				Assert::AreEqual(plain[n].size(), store.DataSize(names[n]), L"Size not stored");
+
+				DECLARE_OSPCipher(c);
+				Cipher cipher(store, c);
+				setup(cipher);
+
+				// No larger than the entry, so it is decrypted whole and copied out
+				vector<SecureStore::byte> buffer(plain[n].size());
+				ByteVector dispensed(nullptr, buffer.data(), buffer.size());
+				success = store.DispenseData(names[n], cipher, dispensed, &TestError);
+				Assert::IsTrue(success, L"Dispense failed");
+				Assert::IsTrue(memcmp(plain[n].data(), dispensed, plain[n].size()) == 0, L"Dispense did not return data");
+				SecureStore::ReleaseDecrypted(dispensed, &TestError);
+			}
+
+			Assert::AreEqual(available, store.AvailableMemory(), L"Entries not freed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Store_Batch_Test1)
+			TEST_DESCRIPTION(L"A batch that fails keeps the entries stored before the failure and leaves the data of the rest.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Store_Batch_Test1)
+		{
+			// Past the first group of 32, the one too large for an entry in the second
+			const size_t count = 40;
+			const size_t large = 35;
+
+			SecureStore store(count + 2, BLOCK_SIZE, &TestError);
+			store.Padding(OSP_PADDING_SIZE_CLASS);
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			vector<string> names;
+			vector<string_view> views;
+			vector<vector<SecureStore::byte>> buffers(count);
+			deque<ByteVector> data;
+			vector<ByteVector*> datap;
+
+			for (size_t n = 0; n < count; n++)
+			{
+				names.push_back("entry" + to_string(n));
+				buffers[n].assign(n == large ? store.MaxDataSize() + 1 : DATA_SIZE, SecureStore::byte(n + 1));
+				data.emplace_back(nullptr, buffers[n].data(), buffers[n].size());
+				datap.push_back(&data.back());
+			}
+			for (const string& name : names)
+				views.push_back(name);
+
+			size_t available = store.AvailableMemory();
+
+			bool success = store.StoreData(views.data(), cipher, datap.data(), count, &TestError);
+			Assert::IsFalse(success, L"Entry larger than the store taken");
+			Assert::AreEqual(OSP_ERROR_BUFFER_TOO_SMALL, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			for (size_t n = 0; n < count; n++)
+			{
+				if (n < 32)
+				{
+					Assert::IsTrue(data[n].Zeroed(), L"Stored data not cleared");
+					Assert::AreEqual(size_t(DATA_SIZE), store.DataSize(names[n]), L"Entry not stored");
+				}
+				else
+				{
+					Assert::IsTrue(
+						buffers[n] == vector<SecureStore::byte>(buffers[n].size(), SecureStore::byte(n + 1)),
+						L"Data not stored was changed"
+					);
+					Assert::AreEqual(size_t(0), store.DataSize(names[n]), L"Entry stored after the failure");
+				}
+			}
+
+			for (size_t n = 0; n < 32; n++)
+				store.DestroyData(names[n], &TestError);
+
+			Assert::AreEqual(available, store.AvailableMemory(), L"Entries not freed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Store_Batch_Benchmark0)
+			TEST_DESCRIPTION(L"Entries per second importing 10k entries one by one versus as a batch.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Store_Batch_Benchmark0)
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			const size_t count = 10000;
+			const size_t maxsize = 256;
+
+			vector<string> names;
+			vector<string_view> views;
+			for (size_t n = 0; n < count; n++)
+				names.push_back("entry" + to_string(n));
+			for (const string& name : names)
+				views.push_back(name);
+
+			string message = to_string(count) + " entries of " + to_string(maxsize) + " bytes imported, entries/s";
+
+			for (bool batch : { false, true })
+			{
+				SecureStore store(count + 2, maxsize, &TestError);
+
+				DECLARE_OSPCipher(c);
+				Cipher cipher(store, c);
+				Setup(cipher);
+
+				vector<ByteArray<DATA_SIZE>> data(count);
+				vector<ByteVector*> datap;
+				for (ByteArray<DATA_SIZE>& d : data)
+				{
+					d.CopyFrom(TestDataA, &TestError);
+					datap.push_back(&d);
+				}
+
+				bool success = true;
+
+				auto t0 = Clock::now();
+				if (batch)
+					success = store.StoreData(views.data(), cipher, datap.data(), count, &TestError);
+				else
+				{
+					for (size_t n = 0; success && n < count; n++)
+						success = store.StoreData(views[n], cipher, data[n], 0, &TestError);
+				}
+				auto t1 = Clock::now();
+
+				Assert::IsTrue(success, L"Import failed");
+
+				message += string(batch ? ", batch of " + to_string(store.EncryptLanes()) + " lanes " : " one by one ") +
+					to_string(size_t(count / std::chrono::duration<double>(t1 - t0).count()));
+
+				delete[] (SecureStore::byte*)ciphercleanup;
+				ciphercleanup = 0;
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_StrongHash_Test0)
 			TEST_DESCRIPTION(L"StrongHash takes enough time.")
 		END_TEST_METHOD_ATTRIBUTE()
@@ -1048,6 +1555,107 @@ namespace OneStrongPassword
 			Assert::AreNotEqual(t0, t1, L"Strong Hash went to fast");
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_StrongHash_Benchmark0)
+			TEST_DESCRIPTION(L"StrongHash latency, a hash per call versus one hash session.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_StrongHash_Benchmark0)
+		{
+			bool success = true;
+
+			const int count = 8;
+
+			ByteArray<64> test;
+			for (size_t b = 1; b <= test.Size(); b++)
+				test[b - 1] = (Cryptography::byte)b;
+
+			SecureStore store;
+			success = store.Initialize(1, test.Size(), &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			ByteArray<64> before;
+			ByteArray<64> tmp;
+
+			auto t0 = GetTickCount();
+			for (int n = 0; success && n < count; n++)
+			{
+				success = store.Hash(test, before, &TestError);
+				for (int m = 0; success && m < 10000; m++)
+					success = store.Hash(before, tmp, &TestError) && store.Hash(tmp, before, &TestError);
+			}
+			auto t1 = GetTickCount();
+
+			Assert::IsTrue(success, L"Hash per call failed");
+
+			ByteArray<64> after;
+
+			auto t2 = GetTickCount();
+			for (int n = 0; success && n < count; n++)
+				success = store.StrongHash(test, after, &TestError);
+			auto t3 = GetTickCount();
+
+			Assert::IsTrue(success, L"Strong Hash failed");
+			Assert::IsTrue(0 == memcmp(before, after, after.Size()), L"Hash session changed the Strong Hash");
+
+			Logger::WriteMessage((
+				"StrongHash ms per derivation: hash per call " + std::to_string(double(t1 - t0) / count) +
+				", hash session " + std::to_string(double(t3 - t2) / count) + "\n"
+			).c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_StrongHash_Benchmark1)
+			TEST_DESCRIPTION(L"StrongHash throughput, one chain at a time versus all hash lanes together.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_StrongHash_Benchmark1)
+		{
+			bool success = true;
+
+			SecureStore store;
+			success = store.Initialize(1, 64, &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			const size_t lanes = store.HashLanes();
+			const size_t maxlanes = 8;
+			Assert::IsTrue(lanes <= maxlanes, L"More lanes than the test allows for");
+
+			ByteArray<64> test[maxlanes];
+			ByteArray<64> serial[maxlanes];
+			ByteArray<64> batch[maxlanes];
+
+			const ByteVector* data[maxlanes];
+			ByteVector* hash[maxlanes];
+
+			for (size_t n = 0; n < lanes; n++)
+			{
+				for (size_t b = 0; b < test[n].Size(); b++)
+					test[n][b] = (Cryptography::byte)(n + b);
+				data[n] = &test[n];
+				hash[n] = &batch[n];
+			}
+
+			auto t0 = GetTickCount();
+			for (size_t n = 0; success && n < lanes; n++)
+				success = store.StrongHash(test[n], serial[n], &TestError);
+			auto t1 = GetTickCount();
+
+			Assert::IsTrue(success, L"Strong Hash failed");
+
+			auto t2 = GetTickCount();
+			success = store.StrongHash(data, hash, lanes, &TestError);
+			auto t3 = GetTickCount();
+
+			Assert::IsTrue(success, L"Batched Strong Hash failed");
+
+			for (size_t n = 0; n < lanes; n++)
+				Assert::IsTrue(0 == memcmp(serial[n], batch[n], batch[n].Size()), L"Lane differs from Strong Hash");
+
+			Logger::WriteMessage((
+				std::to_string(lanes) + " StrongHash lanes, ms: one at a time " + std::to_string(t1 - t0) +
+				", together " + std::to_string(t3 - t2) + "\n"
+			).c_str());
+		}
+
 		static const size_t stronghash_size = 4;
 
 		void StrongHashCheck(SecureStore& store, const byte input[stronghash_size], const byte expected[stronghash_size])
@@ -1101,5 +1709,280 @@ namespace OneStrongPassword
 			}
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_StrongHash_Test2)
+			TEST_DESCRIPTION(L"Legacy StrongHash rehashes Iterations times, odd or even, hash sized or not.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_StrongHash_Test2)
+		{
+			bool success = true;
+
+			SecureStore store;
+			success = store.Initialize(4, 2 * store.HashSize(), &TestError);
+			Assert::IsTrue(success, L"Initialization failed");
+
+			DECLARE_OSPKdfProfile(profile);
+
+			for (uint32_t iterations : { 1, 2, 3, 6, 7 })
+			{
+				profile.Iterations = iterations;
+				success = store.KdfProfile(profile, &TestError);
+				Assert::IsTrue(success, L"Setting the profile failed");
+
+				// The size of a hash, rehashed in lanes, and any other size
+				for (size_t size : { store.HashSize(), size_t(stronghash_size) })
+				{
+					ByteVector hash(store), chain(store), tmp(store);
+					success = hash.Alloc(size, &TestError) && chain.Alloc(size, &TestError) && tmp.Alloc(size, &TestError);
+
+					success = success && store.StrongHash(TestDataA, hash, &TestError);
+
+					success = success && store.Hash(TestDataA, chain, &TestError);
+					for (uint32_t r = 0; success && r < iterations; r++)
+						success = store.Hash(chain, tmp, &TestError) && chain.CopyFrom(tmp, &TestError);
+
+					Assert::IsTrue(success, L"Hashing failed");
+					Assert::IsTrue(hash == chain, L"StrongHash did not rehash Iterations times");
+
+					hash.Destroy(&TestError);
+					chain.Destroy(&TestError);
+					tmp.Destroy(&TestError);
+				}
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Concurrent_Dispense_Test0)
+			TEST_DESCRIPTION(L"An entry being dispensed with the wrong cipher stays stored for other threads sizing and storing it again.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Concurrent_Dispense_Test0)
+		{
+			// Large, so most of a dispense is the decryption outside the lock
+			const size_t size = 16 * 1024;
+			const size_t rounds = 5000;
+			const string name = "shared";
+
+			SecureStore store(4, size + 64, &TestError);
+			store.Storage(OSP_STORAGE_GCM);
+
+			vector<unique_ptr<byte[]>> keys;
+			auto setup = [&](Cipher& cipher, const ByteVector& secret) {
+				bool success = cipher.Prepare(secret, &TestError);
+				if (success)
+				{
+					keys.emplace_back(new byte[cipher.Size()]);
+					cipher.Key() = keys.back().get();
+					success = cipher.Complete(&TestError);
+				}
+				Assert::IsTrue(success, L"Creating a cipher failed, see Cipher_Test0");
+			};
+
+			ByteArray<16> other;
+			other.CopyFrom(SECRET, &TestError);
+			other[0] ^= 0xFF;
+
+			DECLARE_OSPCipher(r);
+			Cipher right(store, r);
+			setup(right, SECRET);
+
+			DECLARE_OSPCipher(w);
+			Cipher wrong(store, w);
+			setup(wrong, other);
+
+			auto restore = [&](OSPError* error) {
+				vector<byte> buffer(size, 0x5A);
+				ByteVector data(nullptr, buffer.data(), size);
+				return store.StoreData(name, right, data, 0, error);
+			};
+			Assert::IsTrue(restore(&TestError), L"Store failed");
+
+			atomic<size_t> failures(0);
+			atomic<bool> done(false);
+
+			// Refused every time, with the entry put back as it was
+			thread dispensing([&]() {
+				OSPError error;
+				vector<byte> buffer(size);
+				for (size_t n = 0; n < rounds; n++)
+				{
+					CLEAR_OSPError(error);
+					ByteVector dispensed(nullptr, buffer.data(), size);
+					if (store.DispenseData(name, wrong, dispensed, &error) || error.Code != OSP_ERROR_DATA_NOT_AUTHENTIC)
+						failures++;
+				}
+				done = true;
+			});
+
+			// Never finds it gone, and stores it again meanwhile
+			thread storing([&]() {
+				OSPError error;
+				CLEAR_OSPError(error);
+				for (size_t n = 0; !done; n++)
+				{
+					if (store.DataSize(name) != size)
+						failures++;
+					if (n % 64 == 0 && !restore(&error))
+						failures++;
+				}
+				if (error.Code != OSP_NO_ERROR)
+					failures++;
+			});
+
+			dispensing.join();
+			storing.join();
+
+			Assert::AreEqual(size_t(0), failures.load(), L"Entry lost or not refused while dispensed");
+
+			vector<byte> buffer(size);
+			ByteVector dispensed(nullptr, buffer.data(), size);
+			bool success = store.DispenseData(name, right, dispensed, &TestError);
+			Assert::IsTrue(success, L"Dispense failed");
+			Assert::IsTrue(buffer == vector<byte>(size, 0x5A), L"Dispense did not return data");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(SecureStore_Concurrent_Stress_Test0)
+			TEST_DESCRIPTION(L"Threads storing, dispensing and destroying thousands of names share one store.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(SecureStore_Concurrent_Stress_Test0)
+		{
+			const size_t names = 2048;
+			const size_t threads = 8;
+			const size_t rounds = 24;
+
+			SecureStore store(names + 64, BLOCK_SIZE, &TestError);
+			size_t available = store.AvailableMemory();
+
+			std::vector<OSPCipher> ciphers(names);
+			std::vector<std::unique_ptr<byte[]>> keys(names);
+			for (size_t n = 0; n < names; n++)
+			{
+				ciphers[n].Handle = nullptr;
+				ciphers[n].Key = nullptr;
+				ciphers[n].Size = 0;
+			}
+
+			std::atomic<size_t> failures(0);
+			std::atomic<size_t> ops(0);
+
+			auto data = [](size_t n, ByteVector& bytes)
+			{
+				for (size_t b = 0; b < bytes.Size(); b++)
+					bytes[b] = (byte)(n + b * 7);
+			};
+
+			// Every thread owns the names n % threads == t and looks at the others' sizes
+			auto worker = [&](size_t t)
+			{
+				OSPError error;
+				CLEAR_OSPError(error);
+
+				std::vector<bool> stored(names, false);
+				std::vector<size_t> storedIn(names, 0);
+				uint32_t seed = (uint32_t)(t * 2654435761u + 1);
+
+				for (size_t r = 0; r < rounds; r++)
+				{
+					for (size_t n = t; n < names; n += threads)
+					{
+						seed = seed * 1664525u + 1013904223u;
+
+						Cipher cipher(store, ciphers[n]);
+						if (cipher.Zeroed())
+						{
+							bool ready = cipher.Prepare(&error);
+							if (ready)
+							{
+								if (!keys[n])
+									keys[n].reset(new byte[cipher.Size()]);
+								cipher.Key() = keys[n].get();
+								ready = cipher.Complete(&error);
+							}
+							if (!ready)
+							{
+								failures++;
+								continue;
+							}
+						}
+
+						size_t other = (seed >> 8) % names;
+						size_t size = store.DataSize(to_string(other));
+						if (size != 0 && size != DATA_SIZE)
+							failures++;
+
+						string name = to_string(n);
+
+						switch (stored[n] ? (seed >> 24) % 3 : 0)
+						{
+						case 0:
+						{
+							ByteArray<DATA_SIZE> bytes;
+							data(n + r, bytes);
+							if (store.StoreData(name, cipher, bytes, 0, &error))
+							{
+								stored[n] = true;
+								storedIn[n] = r;
+							}
+							else
+								failures++;
+							break;
+						}
+						case 1:
+						{
+							ByteArray<DATA_SIZE> dispensed;
+							if (!store.DispenseData(name, cipher, dispensed, &error))
+								failures++;
+							else
+							{
+								stored[n] = false;
+								ByteArray<DATA_SIZE> bytes;
+								data(n + storedIn[n], bytes);
+								if (memcmp(bytes, dispensed, bytes.Size()) != 0)
+									failures++;
+								SecureStore::ReleaseDecrypted(dispensed, &error);
+							}
+							break;
+						}
+						default:
+							if (store.DestroyData(name, &error))
+								stored[n] = false;
+							else
+								failures++;
+							break;
+						}
+
+						ops += 2;
+					}
+				}
+
+				if (error.Code != OSP_NO_ERROR || !EXPOSED(0))
+					failures++;
+			};
+
+			auto start = std::chrono::steady_clock::now();
+
+			std::vector<std::thread> running;
+			for (size_t t = 0; t < threads; t++)
+				running.emplace_back(worker, t);
+			for (auto& thread : running)
+				thread.join();
+
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+			Assert::IsTrue(failures == 0, L"Concurrent operations failed");
+
+			for (size_t n = 0; n < names; n++)
+			{
+				bool success = store.DestroyData(to_string(n), &TestError);
+				Assert::IsTrue(success, L"Destroy failed");
+				Assert::IsTrue(store.DataSize(to_string(n)) == 0, L"Size not cleared");
+			}
+
+			Assert::IsTrue(store.AvailableMemory() == available, L"Memory not returned");
+
+			Logger::WriteMessage(("Stress: " + to_string(ops.load()) + " operations on " + to_string(threads) + " threads in "
+				+ to_string(ms) + " ms, " + to_string(ops.load() / (ms ? ms : 1)) + " ops/ms\n").c_str());
+		}
+
 	};
 }
\ No newline at end of file
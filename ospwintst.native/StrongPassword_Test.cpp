@@ -20,9 +20,12 @@ out of or in connection with the Software or the use or other dealings in the
 Software.
 */
 
+#include <Windows.h>
 #include "CppUnitTest.h"
 
 #include <stack>
+#include <string>
+#include <vector>
 
 #include "../osp/strongpassword.h"
 
@@ -55,11 +58,13 @@ namespace OneStrongPassword
 			Assert::IsTrue(success, L"Creating a cipher failed, see Cipher_Test0");
 		}
 
-		template<size_t sz> void TestGeneratePassword(const Recipe& recipe)
+		template<size_t sz> void TestGeneratePassword(const Recipe& recipe, const OSPKdfProfile* profile = nullptr)
 		{
 			char password[] = "This is a password. Just a stinkin password.";
 
 			SecureStore store(1, sizeof(password), &TestError);
+			if (profile)
+				Assert::IsTrue(store.KdfProfile(*profile, &TestError), L"Profile refused");
 
 			const char* name = "test";
 
@@ -310,6 +315,42 @@ namespace OneStrongPassword
 			TestGeneratePassword<5>(recipe);
 		}
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Expansion_Test0)
+			TEST_DESCRIPTION(L"Generate with counter mode expansion.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Expansion_Test0)
+		{
+			Recipe recipe({ nullptr, 0, OSP_RECIPE_NUMERIC });
+
+			DECLARE_OSPKdfProfile(profile);
+			profile.Expansion = OSP_EXPANSION_COUNTER;
+
+			// A PIN long enough to run through several hashes
+			TestGeneratePassword<129>(recipe, &profile);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Uniform_Test0)
+			TEST_DESCRIPTION(L"Generate with the uniform generator.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Uniform_Test0)
+		{
+			Recipe recipe({
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS,
+				strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS),
+				OSP_RECIPE_ALPHANUMERIC | OSP_RECIPE_NUMERIC_REQUIRED | OSP_RECIPE_SPECIAL_REQUIRED
+			});
+
+			DECLARE_OSPKdfProfile(profile);
+			profile.Generator = OSP_GENERATOR_UNIFORM;
+
+			TestGeneratePassword<16>(recipe, &profile);
+
+			profile.Expansion = OSP_EXPANSION_COUNTER;
+			TestGeneratePassword<129>(recipe, &profile);
+		}
+
 		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Test3)
 			TEST_DESCRIPTION(L"Generate with different StrongPasswords.")
 		END_TEST_METHOD_ATTRIBUTE()
@@ -370,5 +411,504 @@ namespace OneStrongPassword
 			Assert::IsTrue(strncmp(gen0, gen1, gen0.Size()) == 0, L"Different passwords created");
 		}
 
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Batch_Test0)
+			TEST_DESCRIPTION(L"Batched generation matches one at a time, across more mnemonics than hash lanes.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Batch_Test0)
+		{
+			bool success = true;
+
+			Recipe recipe({
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				});
+
+			char password[] = "This is a password. Just a stinkin password.";
+
+			size_t lanes = store.HashLanes();
+			size_t count = 2 * lanes + 1;
+
+			SecureStore store(2 * lanes + 2, sizeof(password) + 16, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			{
+				PasswordVector pw(nullptr, password, sizeof(password));
+				StrongPassword strong(store, name);
+				success = strong.Store(cipher, pw, &TestError);
+				Assert::IsTrue(success, L"Store failed, see StrongPassword_Store_Destroy_Test0");
+				strong.Release();
+			}
+
+			std::vector<std::string> mnemonics;
+			for (size_t n = 0; n < count; n++)
+				mnemonics.push_back("site " + std::to_string(n));
+
+			std::vector<std::string> expected;
+			for (size_t n = 0; n < count; n++)
+			{
+				PasswordArray<13> gen;
+
+				StrongPassword strong(store, name);
+				success = strong.GeneratePassword(mnemonics[n], cipher, gen, 12, recipe, &TestError);
+				Assert::IsTrue(success, L"GeneratePassword failed");
+
+				expected.push_back(std::string(gen));
+
+				strong.ReleasePassword(gen, &TestError);
+				strong.Release();
+			}
+
+			std::vector<PasswordArray<13>> batch(count);
+			std::vector<PasswordVector*> passwords;
+			for (auto& gen : batch)
+				passwords.push_back(&gen);
+
+			StrongPassword strong(store, name);
+			success = strong.GeneratePasswords(mnemonics, cipher, passwords.data(), 12, recipe, &TestError);
+			Assert::IsTrue(success, L"GeneratePasswords failed");
+
+			for (size_t n = 0; n < count; n++)
+			{
+				Assert::IsTrue(strlen(batch[n]) == 12, L"Batched password not the right length");
+				Assert::IsTrue(expected[n] == (const char*)batch[n], L"Batched password differs");
+				strong.ReleasePassword(batch[n], &TestError);
+			}
+			strong.Release();
+		}
+
+		void StoreStrong(SecureStore& store, Cipher& cipher, const char* name)
+		{
+			char password[] = "This is a password. Just a stinkin password.";
+
+			PasswordVector pw(nullptr, password, sizeof(password));
+			StrongPassword strong(store, name);
+			bool success = strong.Store(cipher, pw, &TestError);
+			Assert::IsTrue(success, L"Store failed, see StrongPassword_Store_Destroy_Test0");
+			strong.Release();
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Parallel_Test0)
+			TEST_DESCRIPTION(L"Parallel generation matches serial generation for any number of threads.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Parallel_Test0)
+		{
+			bool success = true;
+
+			Recipe recipe({
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				});
+			Recipe numeric({ nullptr, 0, OSP_RECIPE_NUMERIC });
+
+			size_t lanes = store.HashLanes();
+			size_t count = 4 * lanes + 3;
+
+			SecureStore store(2 * lanes + 2, 64, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			std::vector<std::string> mnemonics;
+			std::vector<size_t> lengths;
+			std::vector<const Recipe*> recipes;
+			for (size_t n = 0; n < count; n++)
+			{
+				mnemonics.push_back("site " + std::to_string(n));
+				lengths.push_back(8 + n % 13);
+				recipes.push_back(n % 3 ? &recipe : &numeric);
+			}
+
+			std::vector<PasswordArray<24>> serial(count);
+			std::vector<PasswordVector*> passwords;
+			for (auto& gen : serial)
+				passwords.push_back(&gen);
+
+			std::vector<std::string> expected;
+			{
+				StrongPassword strong(store, name);
+				success = strong.GeneratePasswords(
+					mnemonics, cipher, passwords.data(), lengths.data(), recipes.data(), &TestError
+				);
+				Assert::IsTrue(success, L"GeneratePasswords failed");
+
+				for (size_t n = 0; n < count; n++)
+				{
+					expected.push_back(std::string(serial[n]));
+					strong.ReleasePassword(serial[n], &TestError);
+				}
+				strong.Release();
+			}
+
+			for (size_t threads = 1; threads <= 3; threads++)
+			{
+				PasswordPool pool;
+				success = pool.Start(threads, &TestError);
+				Assert::IsTrue(success, L"Starting the pool failed");
+				Assert::IsTrue(pool.Threads() == threads, L"Wrong number of threads");
+
+				std::vector<PasswordArray<24>> parallel(count);
+				passwords.clear();
+				for (auto& gen : parallel)
+					passwords.push_back(&gen);
+
+				StrongPassword strong(store, name);
+				success = strong.GeneratePasswords(
+					mnemonics, cipher, passwords.data(), lengths.data(), recipes.data(), pool, &TestError
+				);
+				Assert::IsTrue(success, L"Parallel GeneratePasswords failed");
+
+				for (size_t n = 0; n < count; n++)
+				{
+					Assert::IsTrue(strlen(parallel[n]) == lengths[n], L"Parallel password not the right length");
+					Assert::IsTrue(expected[n] == (const char*)parallel[n], L"Parallel password differs");
+					strong.ReleasePassword(parallel[n], &TestError);
+				}
+				strong.Release();
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Expansion_Benchmark0)
+			TEST_DESCRIPTION(L"Generation latency by recipe density, strong hashing again versus counter mode.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Expansion_Benchmark0)
+		{
+			typedef struct Density { const char* Name; OSPRecipe Recipe; } Density;
+
+			const Density densities[] = {
+				{ "numeric", { nullptr, 0, OSP_RECIPE_NUMERIC } },
+				{ "lowercase", { nullptr, 0, OSP_RECIPE_LOWERCASE } },
+				{ "alphanumeric", { nullptr, 0, OSP_RECIPE_ALPHANUMERIC } },
+				{ "all", {
+					OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				} }
+			};
+
+			SecureStore store(4, BLOCK_SIZE, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			OSPKdfProfile profile = store.KdfProfile();
+			const int count = 4;
+
+			std::string message = "32 character password, ms legacy/counter:";
+
+			for (const Density& density : densities)
+			{
+				Recipe recipe(density.Recipe);
+				unsigned long ms[2];
+
+				for (uint32_t expansion : { OSP_EXPANSION_LEGACY, OSP_EXPANSION_COUNTER })
+				{
+					profile.Expansion = expansion;
+					bool success = store.KdfProfile(profile, &TestError);
+
+					StrongPassword strong(store, name);
+
+					auto t0 = GetTickCount();
+					for (int n = 0; success && n < count; n++)
+					{
+						PasswordArray<33> gen;
+						success = strong.GeneratePassword("mnemonic", cipher, gen, 32, recipe, &TestError);
+						strong.ReleasePassword(gen, &TestError);
+					}
+					auto t1 = GetTickCount();
+
+					Assert::IsTrue(success, L"GeneratePassword failed");
+					strong.Release();
+
+					ms[expansion] = (t1 - t0) / count;
+				}
+
+				message += std::string(" ") + density.Name + " " + std::to_string(ms[0]) + "/" + std::to_string(ms[1]);
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Constructive_Test0)
+			TEST_DESCRIPTION(L"The constructive generator meets every combination of required classes in one pass.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Constructive_Test0)
+		{
+			SecureStore store(4, BLOCK_SIZE, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			DECLARE_OSPKdfProfile(profile);
+			profile.Iterations = 100;
+			profile.Generator = OSP_GENERATOR_CONSTRUCTIVE;
+			Assert::IsTrue(store.KdfProfile(profile, &TestError), L"Profile refused");
+
+			StrongPassword strong(store, name);
+
+			for (uint32_t required = 0; required < 16; required++)
+			{
+				Recipe recipe({
+					OSP_RECIPE_ALL_SUPPORTED_SPECIALS,
+					strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS),
+					OSP_RECIPE_ALPHANUMERIC | (required * OSP_RECIPE_NUMERIC_REQUIRED)
+				});
+
+				size_t classes = 0;
+				for (uint32_t bits = required; bits; bits >>= 1)
+					classes += bits & 1;
+
+				for (size_t length = 1; length <= 8; length++)
+				{
+					PasswordArray<9> gen;
+					bool success = strong.GeneratePassword("mnemonic", cipher, gen, length, recipe, &TestError);
+
+					if (length < classes)
+					{
+						Assert::IsFalse(success, L"Generated a password too short for the recipe");
+						Assert::AreEqual(OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS, TestError.Code, L"Wrong error");
+						CLEAR_OSPError(TestError);
+						continue;
+					}
+
+					Assert::IsTrue(success, L"GeneratePassword failed");
+					Assert::AreEqual(length, strlen(gen), L"Password not the right length");
+					Assert::IsTrue(recipe.Verified(gen, length), L"Password does not meet the recipe");
+					for (size_t n = 0; n < length; n++)
+						Assert::IsTrue(recipe.HasChar(gen[n]), L"Password has a character not in the recipe");
+
+					char first[9];
+					strncpy(first, gen, sizeof(first));
+					strong.ReleasePassword(gen, &TestError);
+
+					PasswordArray<9> again;
+					success = strong.GeneratePassword("mnemonic", cipher, again, length, recipe, &TestError);
+					Assert::IsTrue(success && strncmp(first, again, length) == 0, L"Password not reproduced");
+					strong.ReleasePassword(again, &TestError);
+				}
+			}
+
+			{
+				// No specials to require
+				Recipe recipe({ nullptr, 0, OSP_RECIPE_ALPHANUMERIC | OSP_RECIPE_SPECIAL_REQUIRED });
+
+				PasswordArray<9> gen;
+				bool success = strong.GeneratePassword("mnemonic", cipher, gen, 8, recipe, &TestError);
+				Assert::IsFalse(success, L"Generated a special without specials");
+				Assert::AreEqual(OSP_ERROR_UNABLE_TO_MEET_PASSWORD_REQUIREMENTS, TestError.Code, L"Wrong error");
+				CLEAR_OSPError(TestError);
+			}
+
+			strong.Release();
+		}
+
+		template<typename Policy> void TestGenerateStatic(SecureStore& store, Cipher& cipher, const char* name)
+		{
+			Recipe recipe = Policy::Runtime();
+			StrongPassword strong(store, name);
+
+			for (size_t length : { 4, 12, 64 })
+			{
+				char expected[65];
+				{
+					PasswordArray<65> gen;
+					bool success = strong.GeneratePassword("mnemonic", cipher, gen, length, recipe, &TestError);
+					Assert::IsTrue(success, L"GeneratePassword failed");
+					strncpy(expected, gen, sizeof(expected));
+					strong.ReleasePassword(gen, &TestError);
+				}
+
+				PasswordArray<65> gen;
+				bool success = strong.GeneratePassword<Policy>("mnemonic", cipher, gen, length, &TestError);
+				Assert::IsTrue(success, L"Static GeneratePassword failed");
+				Assert::IsTrue(strcmp(expected, gen) == 0, L"Static recipe generated a different password");
+				strong.ReleasePassword(gen, &TestError);
+			}
+
+			strong.Release();
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Static_Test0)
+			TEST_DESCRIPTION(L"Static recipes generate the same passwords as the recipes built at run time.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Static_Test0)
+		{
+			SecureStore store(4, BLOCK_SIZE, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			DECLARE_OSPKdfProfile(profile);
+			profile.Iterations = 100;
+
+			for (uint32_t generator : { OSP_GENERATOR_LEGACY, OSP_GENERATOR_UNIFORM, OSP_GENERATOR_CONSTRUCTIVE })
+			{
+				profile.Generator = generator;
+				Assert::IsTrue(store.KdfProfile(profile, &TestError), L"Profile refused");
+
+				TestGenerateStatic<PinRecipe>(store, cipher, name);
+				TestGenerateStatic<AlphanumericRecipe>(store, cipher, name);
+				TestGenerateStatic<StrongRecipe>(store, cipher, name);
+			}
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Constructive_Benchmark0)
+			TEST_DESCRIPTION(L"Worst generation latency over every combination of required classes, retrying versus constructive.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Constructive_Benchmark0)
+		{
+			SecureStore store(4, BLOCK_SIZE, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			OSPKdfProfile profile = store.KdfProfile();
+			const char* mnemonics[] = { "one", "two", "three", "four" };
+
+			std::string message = "Worst of every required combination, ms retry/constructive:";
+
+			for (size_t length : { 4, 8, 16 })
+			{
+				unsigned long worst[2] = { 0, 0 };
+
+				for (uint32_t generator : { OSP_GENERATOR_UNIFORM, OSP_GENERATOR_CONSTRUCTIVE })
+				{
+					profile.Generator = generator;
+					bool success = store.KdfProfile(profile, &TestError);
+
+					StrongPassword strong(store, name);
+
+					for (uint32_t required = 0; success && required < 16; required++)
+					{
+						Recipe recipe({
+							OSP_RECIPE_ALL_SUPPORTED_SPECIALS,
+							strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS),
+							OSP_RECIPE_ALPHANUMERIC | (required * OSP_RECIPE_NUMERIC_REQUIRED)
+						});
+
+						for (const char* mnemonic : mnemonics)
+						{
+							PasswordArray<17> gen;
+
+							auto t0 = GetTickCount();
+							success = strong.GeneratePassword(mnemonic, cipher, gen, length, recipe, &TestError);
+							auto t1 = GetTickCount();
+
+							success = success && recipe.Verified(gen, length);
+							strong.ReleasePassword(gen, &TestError);
+
+							unsigned long& w = worst[generator == OSP_GENERATOR_CONSTRUCTIVE];
+							w = std::max<unsigned long>(w, t1 - t0);
+						}
+					}
+
+					Assert::IsTrue(success, L"GeneratePassword failed");
+					strong.Release();
+				}
+
+				message += " " + std::to_string(length) + " " + std::to_string(worst[0]) + "/" + std::to_string(worst[1]);
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(StrongPassword_Generate_Parallel_Benchmark0)
+			TEST_DESCRIPTION(L"Parallel generation throughput from one thread to one per core.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(StrongPassword_Generate_Parallel_Benchmark0)
+		{
+			bool success = true;
+
+			Recipe recipe({
+				OSP_RECIPE_ALL_SUPPORTED_SPECIALS, strlen(OSP_RECIPE_ALL_SUPPORTED_SPECIALS), OSP_RECIPE_ALPHANUMERIC
+				});
+
+			size_t lanes = store.HashLanes();
+			size_t cores = ThreadPool::MaxThreads();
+			size_t count = 2 * lanes * cores;
+
+			SecureStore store(2 * lanes + 2, 64, &TestError);
+
+			const char* name = "test";
+
+			DECLARE_OSPCipher(c);
+			Cipher cipher(store, c);
+			Setup(cipher);
+
+			StoreStrong(store, cipher, name);
+
+			std::vector<std::string> mnemonics;
+			for (size_t n = 0; n < count; n++)
+				mnemonics.push_back("site " + std::to_string(n));
+
+			std::vector<size_t> lengths(count, 16);
+			std::vector<const Recipe*> recipes(count, &recipe);
+
+			std::string message = std::to_string(count) + " passwords, ms by threads:";
+
+			for (size_t threads = 1; threads <= cores; threads++)
+			{
+				PasswordPool pool;
+				success = pool.Start(threads, &TestError);
+				Assert::IsTrue(success, L"Starting the pool failed");
+
+				std::vector<PasswordArray<17>> generated(count);
+				std::vector<PasswordVector*> passwords;
+				for (auto& gen : generated)
+					passwords.push_back(&gen);
+
+				StrongPassword strong(store, name);
+
+				auto t0 = GetTickCount();
+				success = strong.GeneratePasswords(
+					mnemonics, cipher, passwords.data(), lengths.data(), recipes.data(), pool, &TestError
+				);
+				auto t1 = GetTickCount();
+
+				Assert::IsTrue(success, L"Parallel GeneratePasswords failed");
+
+				for (auto& gen : generated)
+					strong.ReleasePassword(gen, &TestError);
+				strong.Release();
+
+				message += " " + std::to_string(threads) + ":" + std::to_string(t1 - t0);
+			}
+
+			Logger::WriteMessage((message + "\n").c_str());
+		}
+
 	};
 }
\ No newline at end of file
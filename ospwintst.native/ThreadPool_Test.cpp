@@ -0,0 +1,183 @@
+/*
+One Strong Password
+
+Copyright(c) Robert Richard Flores. (MIT License)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files(the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+- The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+- The Software is provided "as is", without warranty of any kind, express or
+implied, including but not limited to the warranties of merchantability,
+fitness for a particular purpose and noninfringement.In no event shall the
+authors or copyright holders be liable for any claim, damages or other
+liability, whether in an action of contract, tort or otherwise, arising from,
+out of or in connection with the Software or the use or other dealings in the
+Software.
+*/
+
+
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../osp/os.h"
+#include "../osp/threadpool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace OneStrongPassword
+{
+	TEST_CLASS(ThreadPool_Test)
+	{
+		OSPError TestError;
+
+		TEST_METHOD_INITIALIZE(MethodInitialize)
+		{
+			CLEAR_OSPError(TestError);
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(ThreadPool_Start_Test0)
+			TEST_DESCRIPTION(L"Start, restart and stop workers.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(ThreadPool_Start_Test0)
+		{
+			ThreadPool pool;
+			Assert::IsTrue(pool.Threads() == 0, L"Threads before start");
+
+			bool success = pool.Start(0, &TestError);
+			Assert::IsTrue(success, L"Start failed");
+			Assert::IsTrue(pool.Threads() == ThreadPool::MaxThreads(), L"Not one thread per core");
+
+			success = pool.Start(2, &TestError);
+			Assert::IsFalse(success, L"Start should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_ALREADY_INITIALIZED, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			pool.Stop();
+			Assert::IsTrue(pool.Threads() == 0, L"Threads after stop");
+
+			success = pool.Start(2, &TestError);
+			Assert::IsTrue(success, L"Restart failed");
+			Assert::IsTrue(pool.Threads() == 2, L"Wrong number of threads");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(ThreadPool_Run_Test0)
+			TEST_DESCRIPTION(L"Every task runs exactly once, run after run.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(ThreadPool_Run_Test0)
+		{
+			ThreadPool pool(4);
+
+			const size_t count = 1000;
+
+			for (int run = 0; run < 10; run++)
+			{
+				std::vector<std::atomic<int>> ran(count);
+				for (auto& r : ran)
+					r = 0;
+
+				bool success = pool.Run(count, [&](size_t worker, size_t task, OSPError* error)
+				{
+					Assert::IsTrue(worker < 4, L"Unknown worker");
+					ran[task]++;
+					return true;
+				}, &TestError);
+
+				Assert::IsTrue(success, L"Run failed");
+				for (size_t n = 0; n < count; n++)
+					Assert::IsTrue(ran[n] == 1, L"Task did not run exactly once");
+			}
+
+			bool success = pool.Run(0, [](size_t, size_t, OSPError*) { return false; }, &TestError);
+			Assert::IsTrue(success, L"Running no tasks failed");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(ThreadPool_Run_Test1)
+			TEST_DESCRIPTION(L"Idle workers steal from a busy worker's share.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(ThreadPool_Run_Test1)
+		{
+			ThreadPool pool(2);
+
+			const size_t count = 16;
+			std::vector<size_t> ranBy(count, 2);
+
+			// The first share is slow, the second finishes at once
+			bool success = pool.Run(count, [&](size_t worker, size_t task, OSPError* error)
+			{
+				if (task < count / 2)
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				ranBy[task] = worker;
+				return true;
+			}, &TestError);
+
+			Assert::IsTrue(success, L"Run failed");
+
+			size_t stolen = 0;
+			for (size_t n = 0; n < count / 2; n++)
+				stolen += ranBy[n] == 1 ? 1 : 0;
+			Assert::IsTrue(stolen > 0, L"Nothing stolen from the busy worker");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(ThreadPool_Run_Test2)
+			TEST_DESCRIPTION(L"A failing task fails the run with its error, the pool stays usable.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(ThreadPool_Run_Test2)
+		{
+			ThreadPool pool(3);
+
+			bool success = pool.Run(100, [](size_t worker, size_t task, OSPError* error)
+			{
+				if (task == 5)
+					return OS::SetOSPError(error, OSP_API_Error, OSP_ERROR_UNKNOWN);
+				return true;
+			}, &TestError);
+
+			Assert::IsFalse(success, L"Run should not have succeeded");
+			Assert::AreEqual(OSP_ERROR_UNKNOWN, TestError.Code, L"Wrong error");
+			CLEAR_OSPError(TestError);
+
+			std::atomic<size_t> ran(0);
+			success = pool.Run(100, [&](size_t worker, size_t task, OSPError* error) { ran++; return true; }, &TestError);
+			Assert::IsTrue(success, L"Run after a failure failed");
+			Assert::IsTrue(ran == 100, L"Not every task ran");
+		}
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(ThreadPool_Run_Test3)
+			TEST_DESCRIPTION(L"Without workers tasks run in order on the calling thread.")
+		END_TEST_METHOD_ATTRIBUTE()
+
+		TEST_METHOD(ThreadPool_Run_Test3)
+		{
+			ThreadPool pool;
+
+			std::vector<size_t> order;
+			auto caller = std::this_thread::get_id();
+
+			bool success = pool.Run(10, [&](size_t worker, size_t task, OSPError* error)
+			{
+				Assert::IsTrue(worker == 0, L"Not worker 0");
+				Assert::IsTrue(std::this_thread::get_id() == caller, L"Not the calling thread");
+				order.push_back(task);
+				return true;
+			}, &TestError);
+
+			Assert::IsTrue(success, L"Run failed");
+			for (size_t n = 0; n < order.size(); n++)
+				Assert::IsTrue(order[n] == n, L"Tasks out of order");
+			Assert::IsTrue(order.size() == 10, L"Not every task ran");
+		}
+	};
+}